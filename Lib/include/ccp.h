@@ -0,0 +1,336 @@
+/** @file
+ * CCP passthrough copy engine API.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_ccp_h
+#define __include_ccp_h
+
+#include <types.h>
+
+/*
+ * The CCP (v5) processes 32 byte descriptors from a ring in memory, the queue registers
+ * hold the address of the next descriptor to process (head) and the address after the last
+ * descriptor submitted (tail). The passthrough engine copies between the PSP local memory
+ * and the x86 (system) memory without going through the mapping windows, so a single
+ * descriptor can move a range the CPU would have to copy window by window.
+ * The driver only uses a single queue and waits for every submission to complete by polling
+ * the head register, no interrupts are involved. The registers are accessed through a backend
+ * interface like the mapping manager so the driver runs against a simulated queue on the host.
+ * The wait is bounded by the time the submitted bytes take at a pessimistic throughput. A
+ * submission which doesn't finish in time is halted and the driver waits for the head to stop
+ * moving before returning, so the caller can safely copy the range with the CPU afterwards.
+ */
+
+/** Base address of the CCP MMIO registers. */
+#define CCP_MMIO_BASE                   0x03000000
+/** Distance between the register blocks of two queues, queue 0 starts one block after the base. */
+#define CCP_Q_REGS_SZ                   0x1000
+/** Queue control register. */
+#define CCP_Q_REG_CTRL                  0x0000
+/** Queue tail address register (low 32 bits). */
+#define CCP_Q_REG_TAIL_LO               0x0004
+/** Queue head address register (low 32 bits). */
+#define CCP_Q_REG_HEAD_LO               0x0008
+/** Queue interrupt enable register. */
+#define CCP_Q_REG_INT_ENABLE            0x000c
+/** Queue interrupt status register, write 1 to clear. */
+#define CCP_Q_REG_INT_STATUS            0x0010
+/** Queue status register, the low bits hold the error code of the last failed command. */
+#define CCP_Q_REG_STATUS                0x0100
+
+/** Control: The queue is running. */
+#define CCP_Q_CTRL_RUN                  BIT(0)
+/** Control: The queue is halted (read only). */
+#define CCP_Q_CTRL_HALT                 BIT(1)
+/** Control: The descriptor ring is in the PSP local memory. */
+#define CCP_Q_CTRL_MEM_LOCAL            BIT(2)
+/** Control: Shift of the ring size field, the ring holds 2^(size + 1) descriptors. */
+#define CCP_Q_CTRL_SIZE_SHIFT           3
+/** Control: Mask of the ring size field. */
+#define CCP_Q_CTRL_SIZE_MASK            0x1f
+/** Status: Mask of the error code. */
+#define CCP_Q_STATUS_ERR_MASK           0x3f
+/** Interrupt status: A command completed successfully. */
+#define CCP_Q_INT_SUCCESS               BIT(0)
+/** Interrupt status: A command failed. */
+#define CCP_Q_INT_ERROR                 BIT(1)
+
+/** Descriptor dword 0: Interrupt on completion. */
+#define CCP_DESC_DW0_IOC                BIT(1)
+/** Descriptor dword 0: End of message. */
+#define CCP_DESC_DW0_EOM                BIT(4)
+/** Descriptor dword 0: Shift of the engine specific function field. */
+#define CCP_DESC_DW0_FUNCTION_SHIFT     5
+/** Descriptor dword 0: Mask of the engine specific function field. */
+#define CCP_DESC_DW0_FUNCTION_MASK      0x7fff
+/** Descriptor dword 0: Shift of the engine field. */
+#define CCP_DESC_DW0_ENGINE_SHIFT       20
+/** Descriptor dword 0: Mask of the engine field. */
+#define CCP_DESC_DW0_ENGINE_MASK        0xf
+/** Engine: Passthrough, the function selects byte swapping and bitwise operations, 0 for a plain copy. */
+#define CCP_ENGINE_PASSTHRU             5
+/** Address high dword: Shift of the memory type. */
+#define CCP_DESC_ADDR_HI_MEM_SHIFT      16
+/** Address high dword: Mask of the memory type. */
+#define CCP_DESC_ADDR_HI_MEM_MASK       0x3
+/** Address high dword: Mask of the upper 16 address bits. */
+#define CCP_DESC_ADDR_HI_MASK           0xffff
+
+/** Number of descriptors in the ring. */
+#define CCP_DESC_COUNT                  16
+/** Maximum number of bytes copied by a single descriptor. */
+#define CCP_DESC_XFER_MAX               _1M
+/** Time every submission is given on top of the time its bytes take, in microseconds. */
+#define CCP_WAIT_BASE_US                10000
+/** Lowest passthrough throughput assumed for the wait, in bytes per microsecond. */
+#define CCP_WAIT_BYTES_PER_US_MIN       16
+/** Number of consecutive timed out submissions after which the CCP isn't used anymore. */
+#define CCP_WAIT_TIMEOUTS_MAX           3
+
+
+/**
+ * Memory type of a descriptor address.
+ */
+typedef enum CCPMEM
+{
+    /** x86 physical memory. */
+    CCPMEM_SYSTEM = 0,
+    /** CCP internal storage block. */
+    CCPMEM_SB,
+    /** PSP local memory. */
+    CCPMEM_LOCAL,
+    /** 32bit hack. */
+    CCPMEM_32BIT_HACK = 0x7fffffff
+} CCPMEM;
+
+
+/**
+ * CCP v5 descriptor.
+ */
+typedef struct CCPDESC
+{
+    /** Flags, function and engine. */
+    uint32_t                    u32Dw0;
+    /** Number of bytes to process. */
+    uint32_t                    cbSrc;
+    /** Source address, low 32 bits. */
+    uint32_t                    u32SrcLo;
+    /** Source address, high 16 bits and memory type. */
+    uint32_t                    u32SrcHi;
+    /** Destination address, low 32 bits. */
+    uint32_t                    u32DstLo;
+    /** Destination address, high 16 bits and memory type. */
+    uint32_t                    u32DstHi;
+    /** Key address, low 32 bits (unused for passthrough). */
+    uint32_t                    u32KeyLo;
+    /** Key address, high 16 bits and memory type (unused for passthrough). */
+    uint32_t                    u32KeyHi;
+} CCPDESC;
+/** Pointer to a CCP descriptor. */
+typedef CCPDESC *PCCPDESC;
+/** Pointer to a const CCP descriptor. */
+typedef const CCPDESC *PCCCPDESC;
+
+
+/**
+ * Returns the current time, used to bound the wait for a submission.
+ *
+ * @returns Number of microseconds passed since an arbitrary point in time.
+ * @param   pvUser                  Opaque user data given during initialisation.
+ */
+typedef uint64_t FNCCPGETMICROS(void *pvUser);
+/** Pointer to a time source. */
+typedef FNCCPGETMICROS *PFNCCPGETMICROS;
+
+
+/** Pointer to a const register access backend. */
+typedef const struct CCPREGIF *PCCCPREGIF;
+
+/**
+ * Register access backend.
+ */
+typedef struct CCPREGIF
+{
+    /**
+     * Reads a 32bit queue register.
+     *
+     * @returns Register value.
+     * @param   pvUser              Opaque user data given during initialisation.
+     * @param   PspAddrReg          The register address.
+     */
+    uint32_t    (*pfnRegRead) (void *pvUser, PSPADDR PspAddrReg);
+
+    /**
+     * Writes a 32bit queue register.
+     *
+     * @returns nothing.
+     * @param   pvUser              Opaque user data given during initialisation.
+     * @param   PspAddrReg          The register address.
+     * @param   u32Val              The value to write.
+     */
+    void        (*pfnRegWrite) (void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val);
+
+    /**
+     * Makes the descriptors and source data written by the CPU visible to the CCP.
+     *
+     * @returns nothing.
+     * @param   pvUser              Opaque user data given during initialisation.
+     */
+    void        (*pfnSync) (void *pvUser);
+} CCPREGIF;
+
+
+/**
+ * CCP copy engine instance data.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct CCP
+{
+    /** Backing memory for the descriptor ring, twice the ring size as the alignment can't be relied on when embedded. */
+    CCPDESC                     aDescsBacking[CCP_DESC_COUNT * 2];
+    /** The descriptor ring inside aDescsBacking, the CCP wraps around at the ring size so it is aligned to it. */
+    PCCPDESC                    paDescs;
+    /** The register access backend. */
+    PCCCPREGIF                  pRegIf;
+    /** Opaque user data for the backend. */
+    void                        *pvUser;
+    /** The time source, NULL if every head poll counts as a microsecond. */
+    PFNCCPGETMICROS             pfnGetMicros;
+    /** Opaque user data for the time source. */
+    void                        *pvUserGetMicros;
+    /** Base address of the queue registers. */
+    PSPADDR                     PspAddrQRegs;
+    /** Index of the next free descriptor in the ring. */
+    uint32_t                    idxDescNext;
+    /** Number of consecutive submissions which timed out. */
+    uint32_t                    cTimeouts;
+    /** Flag whether the CCP passed the self test. */
+    bool                        fAvail;
+} CCP;
+/** Pointer to a CCP copy engine instance. */
+typedef CCP *PCCP;
+/** Pointer to a const CCP copy engine instance. */
+typedef const CCP *PCCCP;
+
+
+/**
+ * Resolves a x86 physical address for the simulated queue.
+ *
+ * @returns Pointer to the memory backing the address or NULL if it isn't accessible.
+ * @param   pvUser                  Opaque user data given to CCPSimInit().
+ * @param   PhysX86Addr             The x86 physical address.
+ * @param   pcbContig               Where to store the number of bytes accessible from the returned pointer on.
+ */
+typedef void *FNCCPSIMX86RESOLVE(void *pvUser, X86PADDR PhysX86Addr, size_t *pcbContig);
+/** Pointer to a x86 physical address resolver. */
+typedef FNCCPSIMX86RESOLVE *PFNCCPSIMX86RESOLVE;
+
+
+/**
+ * Simulated CCP queue for the host.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct CCPSIM
+{
+    /** The control register. */
+    uint32_t                    u32Ctrl;
+    /** The tail address register. */
+    uint32_t                    u32Tail;
+    /** The head address register. */
+    uint32_t                    u32Head;
+    /** The interrupt enable register. */
+    uint32_t                    u32IntEnable;
+    /** The interrupt status register. */
+    uint32_t                    u32IntStatus;
+    /** The status register. */
+    uint32_t                    u32Status;
+    /** The x86 physical address resolver. */
+    PFNCCPSIMX86RESOLVE         pfnX86Resolve;
+    /** Opaque user data for the resolver. */
+    void                        *pvUser;
+    /** Number of descriptors processed. */
+    uint32_t                    cDescs;
+} CCPSIM;
+/** Pointer to a simulated CCP queue. */
+typedef CCPSIM *PCCPSIM;
+
+
+/** The register backend accessing the real MMIO registers, takes no user data. */
+extern const CCPREGIF g_CcpRegIfMmio;
+/** The register backend accessing a simulated queue, takes a PCCPSIM as user data. */
+extern const CCPREGIF g_CcpRegIfSim;
+
+
+/**
+ * Initialises the CCP copy engine, setting up the queue and checking it with a small copy.
+ *
+ * @returns Status code.
+ * @retval  ERR_CCP_NOT_AVAILABLE if the self test failed, CCPCopy() refuses to work then.
+ * @param   pThis                   The CCP copy engine to initialise.
+ * @param   pRegIf                  The register access backend to use.
+ * @param   pvUser                  Opaque user data for the backend.
+ * @param   pfnGetMicros            The time source bounding the wait for a submission, NULL
+ *                                  if there is none and every head poll counts as a microsecond.
+ * @param   pvUserGetMicros         Opaque user data for the time source.
+ * @param   idQueue                 The queue to use.
+ */
+int CCPInit(PCCP pThis, PCCCPREGIF pRegIf, void *pvUser, PFNCCPGETMICROS pfnGetMicros, void *pvUserGetMicros,
+            uint32_t idQueue);
+
+/**
+ * Returns whether the CCP can be used for copies.
+ *
+ * @returns Flag whether the CCP is available.
+ * @param   pThis                   The CCP copy engine.
+ */
+bool CCPIsAvailable(PCCCP pThis);
+
+/**
+ * Copies a range through the passthrough engine, waiting for the copy to complete.
+ *
+ * @returns Status code.
+ * @retval  ERR_CCP_NOT_AVAILABLE if the CCP didn't pass the self test.
+ * @retval  ERR_CCP_CMD_FAILED if the CCP reported an error or didn't halt after a timeout, the
+ *          range is only partially copied.
+ * @retval  ERR_TIMEOUT if a submission didn't complete in time, the queue is halted and idle
+ *          then, so the range can be copied by other means. The CCP is not used anymore after
+ *          CCP_WAIT_TIMEOUTS_MAX consecutive timeouts.
+ * @param   pThis                   The CCP copy engine.
+ * @param   enmMemDst               Memory type of the destination.
+ * @param   uAddrDst                The destination address.
+ * @param   enmMemSrc               Memory type of the source.
+ * @param   uAddrSrc                The source address.
+ * @param   cbCopy                  Number of bytes to copy.
+ */
+int CCPCopy(PCCP pThis, CCPMEM enmMemDst, uint64_t uAddrDst, CCPMEM enmMemSrc, uint64_t uAddrSrc, size_t cbCopy);
+
+/**
+ * Initialises a simulated CCP queue.
+ *
+ * @returns nothing.
+ * @param   pSim                    The simulated queue to initialise.
+ * @param   pfnX86Resolve           Resolver for the x86 physical addresses of the descriptors.
+ * @param   pvUser                  Opaque user data for the resolver.
+ */
+void CCPSimInit(PCCPSIM pSim, PFNCCPSIMX86RESOLVE pfnX86Resolve, void *pvUser);
+
+#endif /* __include_ccp_h */
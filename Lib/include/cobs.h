@@ -0,0 +1,170 @@
+/** @file
+ * COBS - Consistent Overhead Byte Stuffing framing API.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_cobs_h
+#define __include_cobs_h
+
+#include <types.h>
+
+/*
+ * COBS removes all zero bytes from a frame at the cost of at most one byte per 254 bytes,
+ * so a zero byte can be used as an unambiguous frame delimiter. A receiver which lost track because
+ * of dropped or corrupted bytes is back in sync with the next delimiter.
+ * The encoder emits a delimiter before and after every frame.
+ */
+
+/** Maximum number of data bytes in a single COBS block. */
+#define COBS_BLOCK_DATA_MAX 254
+
+/**
+ * Encoder output callback.
+ *
+ * @returns Status code.
+ * @param   pvUser  Opaque user data given during initialisation.
+ * @param   pvBuf   The encoded data to write.
+ * @param   cbBuf   Number of bytes to write.
+ */
+typedef int FNCOBSENCWRITE(void *pvUser, const void *pvBuf, size_t cbBuf);
+/** Pointer to an encoder output callback. */
+typedef FNCOBSENCWRITE *PFNCOBSENCWRITE;
+
+/**
+ * COBS encoder state.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct COBSENC
+{
+    /** The output callback. */
+    PFNCOBSENCWRITE     pfnWrite;
+    /** Opaque user data for the callback. */
+    void                *pvUser;
+    /** Number of data bytes in the current block. */
+    uint32_t            cbBlock;
+    /** The current block, the first byte is reserved for the code. */
+    uint8_t             abBlock[COBS_BLOCK_DATA_MAX + 1];
+} COBSENC;
+/** Pointer to a COBS encoder. */
+typedef COBSENC *PCOBSENC;
+
+/**
+ * COBS decoder state.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct COBSDEC
+{
+    /** Where to store the decoded frame. */
+    uint8_t             *pbFrame;
+    /** Size of the frame buffer. */
+    size_t              cbFrameMax;
+    /** Number of bytes decoded for the current frame. */
+    size_t              cbFrame;
+    /** Size of the last completed frame. */
+    size_t              cbFrameDone;
+    /** Number of data bytes left in the current block. */
+    uint32_t            cbBlockLeft;
+    /** Code byte of the current block, 0 if no block was started for the current frame. */
+    uint8_t             bCode;
+    /** Flag whether the current frame overflowed the buffer and is discarded. */
+    bool                fOverflow;
+} COBSDEC;
+/** Pointer to a COBS decoder. */
+typedef COBSDEC *PCOBSDEC;
+
+/**
+ * Initialises a COBS encoder.
+ *
+ * @returns nothing.
+ * @param   pEnc     The encoder to initialise.
+ * @param   pfnWrite The callback to hand the encoded data to.
+ * @param   pvUser   Opaque user data to pass in the callback.
+ */
+void COBSEncInit(PCOBSENC pEnc, PFNCOBSENCWRITE pfnWrite, void *pvUser);
+
+/**
+ * Starts a new frame, emitting the leading delimiter.
+ *
+ * @returns Status code of the output callback.
+ * @param   pEnc     The encoder to use.
+ */
+int COBSEncFrameBegin(PCOBSENC pEnc);
+
+/**
+ * Encodes the given data as part of the current frame.
+ *
+ * @returns Status code of the output callback.
+ * @param   pEnc     The encoder to use.
+ * @param   pvBuf    The data to encode.
+ * @param   cbBuf    Number of bytes to encode.
+ */
+int COBSEncWrite(PCOBSENC pEnc, const void *pvBuf, size_t cbBuf);
+
+/**
+ * Completes the current frame, emitting the outstanding block and the trailing delimiter.
+ *
+ * @returns Status code of the output callback.
+ * @param   pEnc     The encoder to use.
+ */
+int COBSEncFrameEnd(PCOBSENC pEnc);
+
+/**
+ * Initialises a COBS decoder.
+ *
+ * @returns nothing.
+ * @param   pDec       The decoder to initialise.
+ * @param   pvFrame    Where to store decoded frames.
+ * @param   cbFrameMax Size of the frame buffer in bytes.
+ */
+void COBSDecInit(PCOBSDEC pDec, void *pvFrame, size_t cbFrameMax);
+
+/**
+ * Discards the frame currently being decoded.
+ *
+ * @returns nothing.
+ * @param   pDec       The decoder to reset.
+ */
+void COBSDecReset(PCOBSDEC pDec);
+
+/**
+ * Feeds a single received byte into the decoder.
+ *
+ * @returns Status code.
+ * @retval  INF_SUCCESS if a frame was completed, query the size with COBSDecGetFrameSize().
+ *          The frame buffer must not be touched by the decoder until the frame was consumed,
+ *          so don't feed any more bytes before that.
+ * @retval  INF_TRY_AGAIN if the frame is not complete yet.
+ * @retval  ERR_BUFFER_OVERFLOW if the frame was discarded because it doesn't fit into the buffer.
+ * @retval  ERR_COBS_FRAME_MALFORMED if the frame ended in the middle of a block (lost or corrupted bytes).
+ * @param   pDec       The decoder to use.
+ * @param   bIn        The received byte.
+ */
+int COBSDecPutByte(PCOBSDEC pDec, uint8_t bIn);
+
+/**
+ * Returns the size of the last completed frame.
+ *
+ * @returns Size of the frame in bytes.
+ * @param   pDec       The decoder to use.
+ */
+size_t COBSDecGetFrameSize(PCOBSDEC pDec);
+
+#endif /* __include_cobs_h */
@@ -0,0 +1,46 @@
+/** @file
+ * CRC32 checksum API.
+ */
+
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_crc32_h
+#define __include_crc32_h
+
+#include <types.h>
+
+/*
+ * The common reflected CRC32 with polynomial 0xedb88320 (Ethernet, zlib, PNG), so
+ * host tools can verify the result with any standard implementation.
+ */
+
+/** Size of a CRC32 checksum in bytes. */
+#define CRC32_SIZE 4
+
+/**
+ * Calculates the CRC32 of the given data, continuing a previous calculation.
+ *
+ * @returns The updated CRC32.
+ * @param   uCrc    The CRC32 of the data so far, 0 to start a new calculation.
+ * @param   pvBuf   The data to process.
+ * @param   cbBuf   Number of bytes to process.
+ */
+uint32_t CRC32Calc(uint32_t uCrc, const void *pvBuf, size_t cbBuf);
+
+#endif /* __include_crc32_h */
@@ -16,6 +16,8 @@
 #define ERR_NOT_IMPLEMENTED   (-3)
 /** Invalid state encountered. */
 #define ERR_INVALID_STATE     (-4)
+/** The operation timed out. */
+#define ERR_TIMEOUT           (-5)
 
 /**
  * USS specific error codes.
@@ -56,4 +58,18 @@
 /** There are not enough datapoints collected to get a trend. */
 #define ERR_FLOWCTL_NOT_ENOUGH_DATAPOINTS_FOR_TREND      (-500)
 
+/**
+ * COBS framing error codes.
+ */
+/** The frame ended in the middle of a block. */
+#define ERR_COBS_FRAME_MALFORMED                         (-600)
+
+/**
+ * CCP copy engine error codes.
+ */
+/** The CCP didn't pass the self test and is not used. */
+#define ERR_CCP_NOT_AVAILABLE                            (-700)
+/** The CCP reported an error for a command. */
+#define ERR_CCP_CMD_FAILED                               (-701)
+
 #endif
@@ -0,0 +1,513 @@
+/** @file
+ * MAPMGR - x86 and SMN address space mapping manager API.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_map_mgr_h
+#define __include_map_mgr_h
+
+#include <types.h>
+
+/*
+ * The PSP reaches the x86 and SMN address spaces through a fixed number of windows
+ * which are configured through the slot registers at 0x03230000 (x86, 64MB windows)
+ * and 0x03220000 (SMN, 1MB windows). The mapping manager hands out references to
+ * these windows. Unreferenced windows stay programmed and are only evicted (least
+ * recently used first) when a new window is required, so repeated accesses to the
+ * same window don't need to touch the slot registers at all.
+ * The registers are accessed through a backend interface so the same code runs on
+ * the PSP and against a simulated register file on the host.
+ */
+
+/** Number of x86 mapping slots. */
+#define MAPMGR_X86_SLOT_COUNT           15
+/** First x86 mapping slot which can be used for MMIO mappings. */
+#define MAPMGR_X86_SLOT_MMIO_FIRST      8
+/** Number of SMN mapping slots. */
+#define MAPMGR_SMN_SLOT_COUNT           32
+/** Number of hash buckets for the x86 mapping lookup (power of two). */
+#define MAPMGR_X86_HASH_SZ              16
+/** Number of hash buckets for the SMN mapping lookup (power of two). */
+#define MAPMGR_SMN_HASH_SZ              32
+/** Slot index terminating a hash chain. */
+#define MAPMGR_HASH_NIL                 0xff
+/** SMN base address marking a free SMN mapping slot (can't collide with a 1MB aligned base). */
+#define MAPMGR_SMN_SLOT_FREE            0xffffffff
+/** Number of dies the SMN mapping slots can target. */
+#define MAPMGR_SMN_DIE_COUNT            16
+/** Shift of the target die ID in a SMN slot control half-word, the bits above the 1MB aligned base. */
+#define MAPMGR_SMN_SLOT_DIE_SHIFT       12
+/** Programs the die ID into the SMN slots for mappings of other dies. The encoding above is not verified
+ * against the hardware and a wrong guess maps the wrong die or faults, so without this only die 0 can be
+ * mapped and the other dies fail with ERR_NOT_IMPLEMENTED. */
+/*#define MAPMGR_SMN_REMOTE_DIE           1*/
+
+/** Start of the x86 mapping windows in the PSP address space. */
+#define MAPMGR_X86_WINDOW_BASE          0x04000000
+/** Start of the SMN mapping windows in the PSP address space. */
+#define MAPMGR_SMN_WINDOW_BASE          0x01000000
+/** Start of the x86 mapping slot registers. */
+#define MAPMGR_X86_REGS_BASE            0x03230000
+/** Size of the x86 mapping slot register area. */
+#define MAPMGR_X86_REGS_SZ              0x600
+/** Start of the SMN mapping control registers (two slots per register). */
+#define MAPMGR_SMN_REGS_BASE            0x03220000
+
+/** x86 memory type used for normal memory mappings unless told otherwise. */
+#define MAPMGR_X86_MEMTYPE_MEM          0x4
+/** x86 memory type used for MMIO mappings unless told otherwise (strongly ordered). */
+#define MAPMGR_X86_MEMTYPE_MMIO         0x6
+/** Highest x86 memory type value which can be programmed into a slot. */
+#define MAPMGR_X86_MEMTYPE_MAX          0xf
+/** Selects the default x86 memory type for the kind of mapping. */
+#define MAPMGR_X86_MEMTYPE_DEFAULT      UINT32_MAX
+
+
+/** Pointer to a const register access backend. */
+typedef const struct MAPMGRREGIF *PCMAPMGRREGIF;
+
+/**
+ * Register access backend.
+ */
+typedef struct MAPMGRREGIF
+{
+    /**
+     * Reads a 32bit mapping control register.
+     *
+     * @returns Register value.
+     * @param   pvUser              Opaque user data given during initialisation.
+     * @param   PspAddrReg          The register address.
+     */
+    uint32_t    (*pfnRegRead) (void *pvUser, PSPADDR PspAddrReg);
+
+    /**
+     * Writes a 32bit mapping control register.
+     *
+     * @returns nothing.
+     * @param   pvUser              Opaque user data given during initialisation.
+     * @param   PspAddrReg          The register address.
+     * @param   u32Val              The value to write.
+     */
+    void        (*pfnRegWrite) (void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val);
+
+    /**
+     * Waits for all outstanding accesses through the mapping windows to finish.
+     *
+     * @returns nothing.
+     * @param   pvUser              Opaque user data given during initialisation.
+     */
+    void        (*pfnSync) (void *pvUser);
+} MAPMGRREGIF;
+
+
+/**
+ * Per slot statistics.
+ */
+typedef struct MAPMGRSLOTSTATS
+{
+    /** Number of map requests served by the mapping already programmed. */
+    uint32_t                    cHits;
+    /** Number of times the slot was programmed for a map request. */
+    uint32_t                    cMisses;
+    /** Number of times a cached mapping was evicted from the slot. */
+    uint32_t                    cEvictions;
+} MAPMGRSLOTSTATS;
+/** Pointer to per slot statistics. */
+typedef MAPMGRSLOTSTATS *PMAPMGRSLOTSTATS;
+
+
+/**
+ * x86 mapping slot.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MAPMGRX86SLOT
+{
+    /** The base X86 address being mapped (aligned to a 64MB boundary), NIL_X86PADDR if free. */
+    X86PADDR                    PhysX86AddrBase;
+    /** The memory type being used. */
+    uint32_t                    uMemType;
+    /** Reference counter for this mapping, the mapping stays cached when it reaches 0. */
+    uint32_t                    cRefs;
+    /** Value of the map sequence counter when the mapping was last requested, used for LRU eviction. */
+    uint32_t                    uSeqLastUse;
+    /** Index of the next slot in the same hash chain, MAPMGR_HASH_NIL if last. */
+    uint8_t                     idxHashNext;
+    /** Flag whether the mapping was requested as MMIO, plain memory mappings can occupy the MMIO capable slots too. */
+    bool                        fMmio;
+    /** The slot statistics. */
+    MAPMGRSLOTSTATS             Stats;
+} MAPMGRX86SLOT;
+
+
+/**
+ * SMN mapping slot.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MAPMGRSMNSLOT
+{
+    /** Base SMN address being mapped (aligned to a 1MB boundary), MAPMGR_SMN_SLOT_FREE if free. */
+    SMNADDR                     SmnAddrBase;
+    /** The die whose SMN address space is mapped, 0 for the local one. */
+    uint32_t                    idDie;
+    /** Reference counter for this mapping, the mapping stays cached when it reaches 0. */
+    uint32_t                    cRefs;
+    /** Value of the map sequence counter when the mapping was last requested, used for LRU eviction. */
+    uint32_t                    uSeqLastUse;
+    /** Index of the next slot in the same hash chain, MAPMGR_HASH_NIL if last. */
+    uint8_t                     idxHashNext;
+    /** The slot statistics. */
+    MAPMGRSLOTSTATS             Stats;
+} MAPMGRSMNSLOT;
+
+
+/**
+ * Mapping manager instance data.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MAPMGR
+{
+    /** The register access backend. */
+    PCMAPMGRREGIF               pRegIf;
+    /** Opaque user data for the backend. */
+    void                        *pvUser;
+    /** Map sequence counter, incremented for every map request. */
+    uint32_t                    uSeq;
+    /** The x86 mapping slots. */
+    MAPMGRX86SLOT               aX86Slots[MAPMGR_X86_SLOT_COUNT];
+    /** The SMN mapping slots. */
+    MAPMGRSMNSLOT               aSmnSlots[MAPMGR_SMN_SLOT_COUNT];
+    /** Head slot index of each x86 mapping hash chain. */
+    uint8_t                     aidxX86Hash[MAPMGR_X86_HASH_SZ];
+    /** Head slot index of each SMN mapping hash chain. */
+    uint8_t                     aidxSmnHash[MAPMGR_SMN_HASH_SZ];
+} MAPMGR;
+/** Pointer to a mapping manager instance. */
+typedef MAPMGR *PMAPMGR;
+
+
+/**
+ * Accumulated mapping statistics.
+ */
+typedef struct MAPMGRSTATS
+{
+    /** Accumulated x86 slot statistics. */
+    MAPMGRSLOTSTATS             X86;
+    /** Number of x86 slots currently holding a mapping. */
+    uint32_t                    cX86SlotsMapped;
+    /** Accumulated SMN slot statistics. */
+    MAPMGRSLOTSTATS             Smn;
+    /** Number of SMN slots currently holding a mapping. */
+    uint32_t                    cSmnSlotsMapped;
+} MAPMGRSTATS;
+/** Pointer to accumulated mapping statistics. */
+typedef MAPMGRSTATS *PMAPMGRSTATS;
+
+
+/**
+ * Mapping slot information.
+ */
+typedef struct MAPMGRSLOTINFO
+{
+    /** The mapped base address, UINT64_MAX if the slot is free. */
+    uint64_t                    uAddrBase;
+    /** The memory type for x86 slots, 0 for SMN slots. */
+    uint32_t                    uMemType;
+    /** The target die for SMN slots, 0 for x86 slots. */
+    uint32_t                    idDie;
+    /** Number of references held. */
+    uint32_t                    cRefs;
+    /** The slot statistics. */
+    MAPMGRSLOTSTATS             Stats;
+} MAPMGRSLOTINFO;
+/** Pointer to mapping slot information. */
+typedef MAPMGRSLOTINFO *PMAPMGRSLOTINFO;
+/** Pointer to const mapping slot information. */
+typedef const MAPMGRSLOTINFO *PCMAPMGRSLOTINFO;
+
+
+/**
+ * Address space an iterator walks.
+ */
+typedef enum MAPMGRADDRSPACE
+{
+    /** Invalid address space. */
+    MAPMGRADDRSPACE_INVALID = 0,
+    /** SMN address space. */
+    MAPMGRADDRSPACE_SMN,
+    /** x86 physical address space, normal memory. */
+    MAPMGRADDRSPACE_X86_MEM,
+    /** x86 physical address space, MMIO. */
+    MAPMGRADDRSPACE_X86_MMIO,
+    /** 32bit hack. */
+    MAPMGRADDRSPACE_32BIT_HACK = 0x7fffffff
+} MAPMGRADDRSPACE;
+
+
+/**
+ * Iterator walking a physical address range window by window.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MAPMGRWINITER
+{
+    /** The mapping manager used. */
+    PMAPMGR                     pMapMgr;
+    /** The address space being walked. */
+    MAPMGRADDRSPACE             enmAddrSpace;
+    /** The memory type for x86 mappings. */
+    uint32_t                    uX86MemType;
+    /** The target die for SMN mappings. */
+    uint32_t                    idSmnDie;
+    /** The current mapping, NULL if nothing is mapped. */
+    void                        *pvMapCur;
+    /** Next address to map. */
+    uint64_t                    uAddrNext;
+    /** Number of bytes left to walk. */
+    uint64_t                    cbLeft;
+} MAPMGRWINITER;
+/** Pointer to a window iterator. */
+typedef MAPMGRWINITER *PMAPMGRWINITER;
+
+
+/**
+ * Simulated mapping register file for the host.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MAPMGRREGSIM
+{
+    /** The SMN mapping control registers. */
+    uint32_t                    au32SmnRegs[MAPMGR_SMN_SLOT_COUNT / 2];
+    /** The x86 mapping slot register area. */
+    uint32_t                    au32X86Regs[MAPMGR_X86_REGS_SZ / sizeof(uint32_t)];
+    /** Number of register reads. */
+    uint32_t                    cRegReads;
+    /** Number of register writes. */
+    uint32_t                    cRegWrites;
+} MAPMGRREGSIM;
+/** Pointer to a simulated mapping register file. */
+typedef MAPMGRREGSIM *PMAPMGRREGSIM;
+
+
+/** The register backend accessing the real MMIO registers, takes no user data. */
+extern const MAPMGRREGIF g_MapMgrRegIfMmio;
+/** The register backend accessing a simulated register file, takes a PMAPMGRREGSIM as user data. */
+extern const MAPMGRREGIF g_MapMgrRegIfSim;
+
+
+/**
+ * Initialises a mapping manager, all slots start out free.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager to initialise.
+ * @param   pRegIf                  The register access backend to use.
+ * @param   pvUser                  Opaque user data for the backend.
+ */
+int MAPMgrInit(PMAPMGR pThis, PCMAPMGRREGIF pRegIf, void *pvUser);
+
+/**
+ * Returns the default mapping manager accessing the MMIO registers, initialising it on first use.
+ *
+ * @returns Pointer to the default mapping manager.
+ */
+PMAPMGR MAPMgrGetDefault(void);
+
+/**
+ * Maps the given x86 physical address into the PSP address space.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   PhysX86Addr             The x86 physical address to map.
+ * @param   fMmio                   Flag whether this a MMIO address.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int MAPMgrX86PhysMap(PMAPMGR pThis, X86PADDR PhysX86Addr, bool fMmio, void **ppv);
+
+/**
+ * Maps the given x86 physical address into the PSP address space using the given memory type.
+ *
+ * Mappings of the same address with different memory types are distinct and can coexist.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   PhysX86Addr             The x86 physical address to map.
+ * @param   fMmio                   Flag whether this a MMIO address.
+ * @param   uMemType                The memory type programmed into the slot, MAPMGR_X86_MEMTYPE_DEFAULT
+ *                                  selects the default for the kind of mapping.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int MAPMgrX86PhysMapEx(PMAPMGR pThis, X86PADDR PhysX86Addr, bool fMmio, uint32_t uMemType, void **ppv);
+
+/**
+ * Releases a reference to a x86 mapping, the mapping stays cached.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   pv                      Pointer to the mapping as returned by a successful call to MAPMgrX86PhysMap().
+ */
+int MAPMgrX86PhysUnmapByPtr(PMAPMGR pThis, void *pv);
+
+/**
+ * Tears down all cached x86 mappings which are not referenced anymore.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ */
+void MAPMgrX86Flush(PMAPMGR pThis);
+
+/**
+ * Maps the given SMN address into the PSP address space.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   SmnAddr                 The SMN address to map.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int MAPMgrSmnMap(PMAPMGR pThis, SMNADDR SmnAddr, void **ppv);
+
+/**
+ * Maps the given SMN address of the given die into the PSP address space.
+ *
+ * The target die is encoded in the upper bits of the slot control register which are
+ * not used by the base address. Die 0 is the local die and programs the same value as
+ * MAPMgrSmnMap().
+ *
+ * @returns Status code.
+ * @retval  ERR_NOT_IMPLEMENTED if idDie isn't 0 and MAPMGR_SMN_REMOTE_DIE isn't defined.
+ * @param   pThis                   The mapping manager.
+ * @param   idDie                   The die to access, must be below MAPMGR_SMN_DIE_COUNT.
+ * @param   SmnAddr                 The SMN address to map.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int MAPMgrSmnMapEx(PMAPMGR pThis, uint32_t idDie, SMNADDR SmnAddr, void **ppv);
+
+/**
+ * Releases a reference to a SMN mapping, the mapping stays cached.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   pv                      Pointer to the mapping as returned by a successful call to MAPMgrSmnMap().
+ */
+int MAPMgrSmnUnmapByPtr(PMAPMGR pThis, void *pv);
+
+/**
+ * Tears down all cached SMN mappings which are not referenced anymore.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ */
+void MAPMgrSmnFlush(PMAPMGR pThis);
+
+/**
+ * Returns the statistics accumulated over all slots.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   pStats                  Where to store the statistics.
+ */
+void MAPMgrQueryStats(PMAPMGR pThis, PMAPMGRSTATS pStats);
+
+/**
+ * Returns information about a single x86 slot.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index.
+ * @param   pInfo                   Where to store the slot information.
+ */
+int MAPMgrX86SlotQuery(PMAPMGR pThis, uint32_t idxSlot, PMAPMGRSLOTINFO pInfo);
+
+/**
+ * Returns information about a single SMN slot.
+ *
+ * @returns Status code.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index.
+ * @param   pInfo                   Where to store the slot information.
+ */
+int MAPMgrSmnSlotQuery(PMAPMGR pThis, uint32_t idxSlot, PMAPMGRSLOTINFO pInfo);
+
+/**
+ * Initialises an iterator walking the given physical address range.
+ *
+ * @returns Status code.
+ * @param   pIt                     The iterator to initialise.
+ * @param   pThis                   The mapping manager to map the windows with.
+ * @param   enmAddrSpace            The address space to walk.
+ * @param   uAddrStart              Start address of the range.
+ * @param   cbRange                 Size of the range in bytes, can span any number of windows.
+ */
+int MAPMgrWinIterInit(PMAPMGRWINITER pIt, PMAPMGR pThis, MAPMGRADDRSPACE enmAddrSpace, uint64_t uAddrStart, uint64_t cbRange);
+
+/**
+ * Initialises an iterator walking the given physical address range, extended version.
+ *
+ * @returns Status code.
+ * @param   pIt                     The iterator to initialise.
+ * @param   pThis                   The mapping manager to map the windows with.
+ * @param   enmAddrSpace            The address space to walk.
+ * @param   uAddrStart              Start address of the range.
+ * @param   cbRange                 Size of the range in bytes, can span any number of windows.
+ * @param   uX86MemType             The memory type for x86 mappings, must be MAPMGR_X86_MEMTYPE_DEFAULT for SMN.
+ * @param   idSmnDie                The die to access for SMN, must be 0 for x86.
+ */
+int MAPMgrWinIterInitEx(PMAPMGRWINITER pIt, PMAPMGR pThis, MAPMGRADDRSPACE enmAddrSpace, uint64_t uAddrStart, uint64_t cbRange,
+                        uint32_t uX86MemType, uint32_t idSmnDie);
+
+/**
+ * Maps the next chunk of the range, releasing the chunk returned previously.
+ *
+ * A chunk never crosses a window boundary, so it is contiguous in the PSP address space.
+ *
+ * @returns Status code.
+ * @param   pIt                     The iterator.
+ * @param   cbMax                   Maximum number of bytes to return in this chunk.
+ * @param   ppv                     Where to store the pointer to the chunk on success.
+ * @param   pcbChunk                Where to store the size of the chunk on success, 0 if the end of the range was reached.
+ */
+int MAPMgrWinIterNext(PMAPMGRWINITER pIt, size_t cbMax, void **ppv, size_t *pcbChunk);
+
+/**
+ * Returns the number of bytes the iterator didn't return yet.
+ *
+ * @returns Number of bytes left.
+ * @param   pIt                     The iterator.
+ */
+uint64_t MAPMgrWinIterGetLeft(PMAPMGRWINITER pIt);
+
+/**
+ * Releases the chunk mapped last, must be called when done with the iterator.
+ *
+ * @returns nothing.
+ * @param   pIt                     The iterator.
+ */
+void MAPMgrWinIterEnd(PMAPMGRWINITER pIt);
+
+/**
+ * Initialises a simulated register file with all registers cleared.
+ *
+ * @returns nothing.
+ * @param   pRegSim                 The simulated register file to initialise.
+ */
+void MAPMgrRegSimInit(PMAPMGRREGSIM pRegSim);
+
+#endif /* !__include_map_mgr_h */
@@ -0,0 +1,82 @@
+/** @file
+ * Byte pattern search API.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_memsearch_h
+#define __include_memsearch_h
+
+#include <types.h>
+
+/*
+ * Boyer-Moore-Horspool search for a byte pattern with an optional per byte mask.
+ * The skip table is indexed by the buffer byte aligned with the last pattern byte and
+ * holds how far the pattern can be moved without skipping over a possible match.
+ * A masked pattern byte matches several (or for a zero mask all) buffer bytes, so all of
+ * them get the shorter skip distance, wildcards close to the end limit the skips accordingly.
+ */
+
+/** Maximum pattern size in bytes. */
+#define MEMSEARCH_PATTERN_MAX 64
+
+/**
+ * Pattern search state.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct MEMSEARCH
+{
+    /** Size of the pattern in bytes. */
+    size_t              cbPattern;
+    /** The pattern with the mask already applied. */
+    uint8_t             abPattern[MEMSEARCH_PATTERN_MAX];
+    /** The mask. */
+    uint8_t             abMask[MEMSEARCH_PATTERN_MAX];
+    /** Skip distance indexed by the buffer byte aligned with the last pattern byte. */
+    uint8_t             acbSkip[256];
+} MEMSEARCH;
+/** Pointer to a pattern search state. */
+typedef MEMSEARCH *PMEMSEARCH;
+/** Pointer to a const pattern search state. */
+typedef const MEMSEARCH *PCMEMSEARCH;
+
+/**
+ * Initialises a pattern search, building the skip table.
+ *
+ * @returns Status code.
+ * @retval  ERR_INVALID_PARAMETER if the pattern is empty or exceeds MEMSEARCH_PATTERN_MAX.
+ * @param   pThis     The search state to initialise.
+ * @param   pvPattern The pattern to search for.
+ * @param   pvMask    Mask applied to the buffer and pattern bytes before comparing, NULL to compare all bits.
+ * @param   cbPattern Size of the pattern (and mask) in bytes.
+ */
+int MEMSearchInit(PMEMSEARCH pThis, const void *pvPattern, const void *pvMask, size_t cbPattern);
+
+/**
+ * Searches the given buffer for the first occurrence of the pattern.
+ *
+ * @returns Flag whether the pattern was found.
+ * @param   pThis     The search state to use.
+ * @param   pvBuf     The buffer to search.
+ * @param   cbBuf     Size of the buffer in bytes.
+ * @param   poffMatch Where to store the offset of the match in the buffer.
+ */
+bool MEMSearchFind(PCMEMSEARCH pThis, const void *pvBuf, size_t cbBuf, size_t *poffMatch);
+
+#endif /* __include_memsearch_h */
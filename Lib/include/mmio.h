@@ -53,4 +53,127 @@ static inline void pspMmioAccess(void *pvDst, const void *pvSrc, size_t cb)
     }
 }
 
+
+#ifndef PSP_MMIO_HOOKS
+
+# include <string.h>
+
+/**
+ * Reads a 8bit device register.
+ *
+ * @returns Register value.
+ * @param   pv                  The register address.
+ */
+static inline uint8_t pspMmioReadU8(volatile const void *pv)
+{
+    return *(volatile const uint8_t *)pv;
+}
+
+
+/**
+ * Reads a 16bit device register.
+ *
+ * @returns Register value.
+ * @param   pv                  The register address.
+ */
+static inline uint16_t pspMmioReadU16(volatile const void *pv)
+{
+    return *(volatile const uint16_t *)pv;
+}
+
+
+/**
+ * Reads a 32bit device register.
+ *
+ * @returns Register value.
+ * @param   pv                  The register address.
+ */
+static inline uint32_t pspMmioReadU32(volatile const void *pv)
+{
+    return *(volatile const uint32_t *)pv;
+}
+
+
+/**
+ * Writes a 8bit device register.
+ *
+ * @returns nothing.
+ * @param   pv                  The register address.
+ * @param   bVal                The value to write.
+ */
+static inline void pspMmioWriteU8(volatile void *pv, uint8_t bVal)
+{
+    *(volatile uint8_t *)pv = bVal;
+}
+
+
+/**
+ * Writes a 16bit device register.
+ *
+ * @returns nothing.
+ * @param   pv                  The register address.
+ * @param   u16Val              The value to write.
+ */
+static inline void pspMmioWriteU16(volatile void *pv, uint16_t u16Val)
+{
+    *(volatile uint16_t *)pv = u16Val;
+}
+
+
+/**
+ * Writes a 32bit device register.
+ *
+ * @returns nothing.
+ * @param   pv                  The register address.
+ * @param   u32Val              The value to write.
+ */
+static inline void pspMmioWriteU32(volatile void *pv, uint32_t u32Val)
+{
+    *(volatile uint32_t *)pv = u32Val;
+}
+
+
+/**
+ * Copies data from a device memory window.
+ *
+ * @returns nothing.
+ * @param   pvDst               Where to store the data.
+ * @param   pvSrc               The device memory to copy from.
+ * @param   cb                  Number of bytes to copy.
+ */
+static inline void pspMmioCopyFrom(void *pvDst, volatile const void *pvSrc, size_t cb)
+{
+    memcpy(pvDst, (const void *)pvSrc, cb);
+}
+
+
+/**
+ * Copies data to a device memory window.
+ *
+ * @returns nothing.
+ * @param   pvDst               The device memory to copy to.
+ * @param   pvSrc               The data to copy.
+ * @param   cb                  Number of bytes to copy.
+ */
+static inline void pspMmioCopyTo(volatile void *pvDst, const void *pvSrc, size_t cb)
+{
+    memcpy((void *)pvDst, pvSrc, cb);
+}
+
+#else /* PSP_MMIO_HOOKS */
+
+/*
+ * Host builds (Tools/LinkSim) provide the accessors to route the device accesses to models.
+ */
+uint8_t  pspMmioReadU8(volatile const void *pv);
+uint16_t pspMmioReadU16(volatile const void *pv);
+uint32_t pspMmioReadU32(volatile const void *pv);
+void     pspMmioWriteU8(volatile void *pv, uint8_t bVal);
+void     pspMmioWriteU16(volatile void *pv, uint16_t u16Val);
+void     pspMmioWriteU32(volatile void *pv, uint32_t u32Val);
+void     pspMmioCopyFrom(void *pvDst, volatile const void *pvSrc, size_t cb);
+void     pspMmioCopyTo(volatile void *pvDst, const void *pvSrc, size_t cb);
+
+#endif /* PSP_MMIO_HOOKS */
+
 #endif /* !__include_mmio_h */
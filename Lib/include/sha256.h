@@ -0,0 +1,79 @@
+/** @file
+ * SHA-256 hash API.
+ */
+
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_sha256_h
+#define __include_sha256_h
+
+#include <types.h>
+
+/** Size of a SHA-256 digest in bytes. */
+#define SHA256_DIGEST_SIZE 32
+/** Size of a SHA-256 block in bytes. */
+#define SHA256_BLOCK_SIZE  64
+
+/**
+ * SHA-256 hash context.
+ *
+ * @note: Everything in this struct is private, don't access directly.
+ */
+typedef struct SHA256CTX
+{
+    /** The intermediate hash value. */
+    uint32_t            au32H[8];
+    /** Total number of bytes hashed so far. */
+    uint64_t            cbTotal;
+    /** Number of bytes in the partial block. */
+    uint32_t            cbBlock;
+    /** The partial block. */
+    uint8_t             abBlock[SHA256_BLOCK_SIZE];
+} SHA256CTX;
+/** Pointer to a SHA-256 hash context. */
+typedef SHA256CTX *PSHA256CTX;
+
+/**
+ * Initialises a SHA-256 hash context.
+ *
+ * @returns nothing.
+ * @param   pCtx     The context to initialise.
+ */
+void SHA256Init(PSHA256CTX pCtx);
+
+/**
+ * Hashes the given data.
+ *
+ * @returns nothing.
+ * @param   pCtx     The context to use.
+ * @param   pvBuf    The data to hash.
+ * @param   cbBuf    Number of bytes to hash.
+ */
+void SHA256Update(PSHA256CTX pCtx, const void *pvBuf, size_t cbBuf);
+
+/**
+ * Completes the hash, the context has to be initialised again before reuse.
+ *
+ * @returns nothing.
+ * @param   pCtx     The context to use.
+ * @param   pbDigest Where to store the SHA256_DIGEST_SIZE bytes of the digest.
+ */
+void SHA256Final(PSHA256CTX pCtx, uint8_t *pbDigest);
+
+#endif /* __include_sha256_h */
@@ -26,26 +26,12 @@
 
 #include <types.h>
 
-/**
- * SMN mapping slot.
- */
-typedef struct PSPSMNMAPPING
-{
-    /** Base SMN address being mapped (aligned to a 1MB boundary). */
-    SMNADDR                 SmnAddrBase;
-    /* Reference counter for this mapping, the mapping gets cleand up if it reaches 0. */
-    uint32_t                cRefs;
-} PSPSMNMAPPING;
-
-/** Pointer to a SMN mapping slot. */
-typedef PSPSMNMAPPING *PPSPSMNMAPPING;
-
-/** Pointer to a const SMN mapping slot. */
-typedef const PSPSMNMAPPING *PCPSPSMNMAPPING;
-
 /**
  * Maps the given SMN address into the PSP address space.
  *
+ * Unreferenced mappings are kept and reused, the least recently used one is only
+ * evicted when a new window is required. This uses the default mapping manager, see map-mgr.h.
+ *
  * @returns Status code.
  * @param   SmnAddr                 The SMN address to map.
  * @param   ppv                     Where to store the pointer to the mapping on success.
@@ -60,6 +46,23 @@ int pspSmnMap(SMNADDR SmnAddr, void **ppv);
  */
 int pspSmnUnmapByPtr(void *pv);
 
+/**
+ * Tears down all cached mappings which are not referenced anymore.
+ *
+ * Required before handing the mapping slots to other code or if stale
+ * mappings must not be left behind.
+ */
+void pspSmnMapFlush(void);
+
+/**
+ * Returns the mapping cache counters accumulated so far.
+ *
+ * @param   pcHits                  Where to store the number of map requests served by a cached mapping.
+ * @param   pcMisses                Where to store the number of map requests which had to program a slot.
+ * @param   pcEvictions             Where to store the number of cached mappings evicted for a new one.
+ */
+void pspSmnMapQueryStats(uint32_t *pcHits, uint32_t *pcMisses, uint32_t *pcEvictions);
+
 /**
  * Stores a 32 bit value at the provided SMN address.
  *
@@ -25,42 +25,47 @@
 #include <types.h>
 
 /**
- * x86 memory mapping slot.
+ * Maps the given x86 physical address into the PSP address space.
+ *
+ * Unreferenced mappings are kept and reused, the least recently used one is only
+ * evicted when a new window is required. This uses the default mapping manager, see map-mgr.h.
+ *
+ * @returns Status code.
+ * @param   PhysX86Addr             The x86 physical address to map.
+ * @param   fMmio                   Flag whether this a MMIO address.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
  */
-typedef struct PSPX86MAPPING
-{
-    /** The base X86 address being mapped (aligned to a 64MB boundary). */
-    X86PADDR                PhysX86AddrBase;
-    /** The memory type being used. */
-    uint32_t                uMemType;
-    /** Reference counter for this mapping, the mapping gets cleaned up if it reaches 0. */
-    uint32_t                cRefs;
-} PSPX86MAPPING;
-
-/** Pointer to an x86 memory mapping slot. */
-typedef PSPX86MAPPING *PPSPX86MAPPING;
-
-/** Pointer to a const x86 memory mapping slot. */
-typedef const PSPX86MAPPING *PCPSPX86MAPPING;
+int pspX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv);
 
 /**
- * Maps the given x86 physical address into the PSP address space.
+ * Maps the given x86 physical address into the PSP address space with the given memory type.
  *
  * @returns Status code.
  * @param   PhysX86Addr             The x86 physical address to map.
  * @param   fMmio                   Flag whether this a MMIO address.
+ * @param   uMemType                The memory type to program, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
  * @param   ppv                     Where to store the pointer to the mapping on success.
  */
-int pspX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv);
+int pspX86PhysMapEx(X86PADDR PhysX86Addr, bool fMmio, uint32_t uMemType, void **ppv);
 
 /**
  * Unmaps a previously mapped x86 physical address.
  *
+ * The slot stays programmed after the last reference was dropped, see pspX86MapFlush().
+ *
  * @returns Status code.
  * @param   pv                      Pointer to the mapping as returned by a successful call to pspStubX86PhysMap().
  */
 int pspX86PhysUnmapByPtr(void *pv);
 
+/**
+ * Tears down all cached mappings which are not referenced anymore.
+ *
+ * Required before handing the mapping slots to other code or if stale
+ * mappings must not be left behind.
+ */
+void pspX86MapFlush(void);
+
 /**
  * Stores a 32 bit value at the provided x86 address.
  *
@@ -0,0 +1,221 @@
+/** @file
+ * CCP passthrough copy engine - simulated queue for the host.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <string.h>
+#include <ccp.h>
+
+
+/*
+ * The simulated queue processes the descriptors synchronously when the queue is started,
+ * so the head already equals the tail when the driver polls it the first time. Only plain
+ * passthrough copies are supported, anything else halts the queue with an error like the
+ * hardware does for a failing command. PSP local addresses are used as is (the host build
+ * maps the PSP address space 1:1), x86 addresses go through the resolver.
+ */
+
+/** Error code reported for unsupported descriptors and inaccessible addresses. */
+#define CCP_SIM_ERR_INVALID             0x1
+
+
+/**
+ * Resolves the given descriptor address.
+ *
+ * @returns Pointer to the memory or NULL if the address isn't accessible.
+ * @param   pSim                    The simulated queue.
+ * @param   enmMem                  Memory type of the address.
+ * @param   uAddr                   The address.
+ * @param   pcbContig               Where to store the number of bytes accessible from the returned pointer on.
+ */
+static uint8_t *ccpSimAddrResolve(PCCPSIM pSim, CCPMEM enmMem, uint64_t uAddr, size_t *pcbContig)
+{
+    switch (enmMem)
+    {
+        case CCPMEM_LOCAL:
+            if (uAddr > UINT32_MAX)
+                return NULL;
+            *pcbContig = (size_t)(((uint64_t)UINT32_MAX + 1) - uAddr);
+            return (uint8_t *)(uintptr_t)uAddr;
+        case CCPMEM_SYSTEM:
+            return (uint8_t *)pSim->pfnX86Resolve(pSim->pvUser, uAddr, pcbContig);
+        default:
+            return NULL;
+    }
+}
+
+
+/**
+ * Executes a single passthrough descriptor.
+ *
+ * @returns Flag whether the descriptor was executed successfully.
+ * @param   pSim                    The simulated queue.
+ * @param   pDesc                   The descriptor.
+ */
+static bool ccpSimDescExec(PCCPSIM pSim, PCCCPDESC pDesc)
+{
+    CCPMEM enmMemSrc = (CCPMEM)((pDesc->u32SrcHi >> CCP_DESC_ADDR_HI_MEM_SHIFT) & CCP_DESC_ADDR_HI_MEM_MASK);
+    CCPMEM enmMemDst = (CCPMEM)((pDesc->u32DstHi >> CCP_DESC_ADDR_HI_MEM_SHIFT) & CCP_DESC_ADDR_HI_MEM_MASK);
+    uint64_t uAddrSrc = ((uint64_t)(pDesc->u32SrcHi & CCP_DESC_ADDR_HI_MASK) << 32) | pDesc->u32SrcLo;
+    uint64_t uAddrDst = ((uint64_t)(pDesc->u32DstHi & CCP_DESC_ADDR_HI_MASK) << 32) | pDesc->u32DstLo;
+    size_t cbLeft = pDesc->cbSrc;
+
+    if (   ((pDesc->u32Dw0 >> CCP_DESC_DW0_ENGINE_SHIFT) & CCP_DESC_DW0_ENGINE_MASK) != CCP_ENGINE_PASSTHRU
+        || ((pDesc->u32Dw0 >> CCP_DESC_DW0_FUNCTION_SHIFT) & CCP_DESC_DW0_FUNCTION_MASK))
+        return false;
+
+    while (cbLeft)
+    {
+        size_t cbSrc = 0;
+        size_t cbDst = 0;
+        uint8_t *pbSrc = ccpSimAddrResolve(pSim, enmMemSrc, uAddrSrc, &cbSrc);
+        uint8_t *pbDst = ccpSimAddrResolve(pSim, enmMemDst, uAddrDst, &cbDst);
+        if (   !pbSrc
+            || !pbDst)
+            return false;
+
+        size_t cbThisCopy = MIN(cbLeft, MIN(cbSrc, cbDst));
+        memcpy(pbDst, pbSrc, cbThisCopy);
+
+        uAddrSrc += cbThisCopy;
+        uAddrDst += cbThisCopy;
+        cbLeft   -= cbThisCopy;
+    }
+
+    return true;
+}
+
+
+/**
+ * Processes the descriptors between head and tail.
+ *
+ * @returns nothing.
+ * @param   pSim                    The simulated queue.
+ */
+static void ccpSimQueueRun(PCCPSIM pSim)
+{
+    uint32_t cDescsRing = 2 << ((pSim->u32Ctrl >> CCP_Q_CTRL_SIZE_SHIFT) & CCP_Q_CTRL_SIZE_MASK);
+    uint32_t cbRing = cDescsRing * sizeof(CCPDESC);
+
+    while (pSim->u32Head != pSim->u32Tail)
+    {
+        PCCCPDESC pDesc = (PCCCPDESC)(uintptr_t)pSim->u32Head;
+
+        if (!ccpSimDescExec(pSim, pDesc))
+        {
+            /* The queue halts with the head still pointing to the failing descriptor. */
+            pSim->u32Status     = CCP_SIM_ERR_INVALID;
+            pSim->u32IntStatus |= CCP_Q_INT_ERROR;
+            pSim->u32Ctrl       = (pSim->u32Ctrl & ~CCP_Q_CTRL_RUN) | CCP_Q_CTRL_HALT;
+            return;
+        }
+
+        pSim->cDescs++;
+        if (pDesc->u32Dw0 & CCP_DESC_DW0_IOC)
+            pSim->u32IntStatus |= CCP_Q_INT_SUCCESS;
+
+        /* The ring is aligned to its size, so wrapping around only affects the offset bits. */
+        pSim->u32Head =   (pSim->u32Head & ~(cbRing - 1))
+                        | ((pSim->u32Head + sizeof(CCPDESC)) & (cbRing - 1));
+    }
+}
+
+
+static uint32_t ccpSimRegRead(void *pvUser, PSPADDR PspAddrReg)
+{
+    PCCPSIM pSim = (PCCPSIM)pvUser;
+
+    switch (PspAddrReg & (CCP_Q_REGS_SZ - 1))
+    {
+        case CCP_Q_REG_CTRL:
+            return pSim->u32Ctrl;
+        case CCP_Q_REG_TAIL_LO:
+            return pSim->u32Tail;
+        case CCP_Q_REG_HEAD_LO:
+            return pSim->u32Head;
+        case CCP_Q_REG_INT_ENABLE:
+            return pSim->u32IntEnable;
+        case CCP_Q_REG_INT_STATUS:
+            return pSim->u32IntStatus;
+        case CCP_Q_REG_STATUS:
+            return pSim->u32Status;
+        default:
+            return 0;
+    }
+}
+
+
+static void ccpSimRegWrite(void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val)
+{
+    PCCPSIM pSim = (PCCPSIM)pvUser;
+
+    switch (PspAddrReg & (CCP_Q_REGS_SZ - 1))
+    {
+        case CCP_Q_REG_CTRL:
+            pSim->u32Ctrl = u32Val & ~CCP_Q_CTRL_HALT;
+            if (u32Val & CCP_Q_CTRL_RUN)
+            {
+                pSim->u32Status = 0;
+                ccpSimQueueRun(pSim);
+            }
+            break;
+        case CCP_Q_REG_TAIL_LO:
+            pSim->u32Tail = u32Val;
+            break;
+        case CCP_Q_REG_HEAD_LO:
+            pSim->u32Head = u32Val;
+            break;
+        case CCP_Q_REG_INT_ENABLE:
+            pSim->u32IntEnable = u32Val;
+            break;
+        case CCP_Q_REG_INT_STATUS:
+            pSim->u32IntStatus &= ~u32Val;
+            break;
+        default:
+            break;
+    }
+}
+
+
+static void ccpSimSync(void *pvUser)
+{
+    (void)pvUser;
+    /* Nothing to wait for. */
+}
+
+
+const CCPREGIF g_CcpRegIfSim =
+{
+    /** pfnRegRead */
+    ccpSimRegRead,
+    /** pfnRegWrite */
+    ccpSimRegWrite,
+    /** pfnSync */
+    ccpSimSync
+};
+
+
+void CCPSimInit(PCCPSIM pSim, PFNCCPSIMX86RESOLVE pfnX86Resolve, void *pvUser)
+{
+    memset(pSim, 0, sizeof(*pSim));
+    pSim->pfnX86Resolve = pfnX86Resolve;
+    pSim->pvUser        = pvUser;
+}
@@ -0,0 +1,359 @@
+/** @file
+ * CCP passthrough copy engine.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <err.h>
+#include <string.h>
+#include <ccp.h>
+
+
+/** Value of the ring size field for CCP_DESC_COUNT descriptors. */
+#define CCP_Q_CTRL_SIZE_VAL             3
+_Static_assert((2 << CCP_Q_CTRL_SIZE_VAL) == CCP_DESC_COUNT, "CCP_Q_CTRL_SIZE_VAL doesn't match the ring size");
+/** Size of the self test copy in bytes. */
+#define CCP_SELF_TEST_SZ                64
+
+
+/** Self test buffers, static so they live in memory the CCP (and the simulated queue) can address. */
+static uint8_t g_abCcpSelfTestSrc[CCP_SELF_TEST_SZ];
+static uint8_t g_abCcpSelfTestDst[CCP_SELF_TEST_SZ];
+
+
+static uint32_t ccpMmioRegRead(void *pvUser, PSPADDR PspAddrReg)
+{
+    (void)pvUser;
+    return *(volatile uint32_t *)(uintptr_t)PspAddrReg;
+}
+
+static void ccpMmioRegWrite(void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val)
+{
+    (void)pvUser;
+    *(volatile uint32_t *)(uintptr_t)PspAddrReg = u32Val;
+}
+
+static void ccpMmioSync(void *pvUser)
+{
+    (void)pvUser;
+#if defined(__arm__)
+    asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
+const CCPREGIF g_CcpRegIfMmio =
+{
+    /** pfnRegRead */
+    ccpMmioRegRead,
+    /** pfnRegWrite */
+    ccpMmioRegWrite,
+    /** pfnSync */
+    ccpMmioSync
+};
+
+
+/**
+ * Reads the given queue register.
+ *
+ * @returns Register value.
+ * @param   pThis                   The CCP copy engine.
+ * @param   offReg                  Offset of the register in the queue register block.
+ */
+static inline uint32_t ccpRegRead(PCCP pThis, uint32_t offReg)
+{
+    return pThis->pRegIf->pfnRegRead(pThis->pvUser, pThis->PspAddrQRegs + offReg);
+}
+
+
+/**
+ * Writes the given queue register.
+ *
+ * @returns nothing.
+ * @param   pThis                   The CCP copy engine.
+ * @param   offReg                  Offset of the register in the queue register block.
+ * @param   u32Val                  The value to write.
+ */
+static inline void ccpRegWrite(PCCP pThis, uint32_t offReg, uint32_t u32Val)
+{
+    pThis->pRegIf->pfnRegWrite(pThis->pvUser, pThis->PspAddrQRegs + offReg, u32Val);
+}
+
+
+/**
+ * Returns the address of the given descriptor as seen by the CCP.
+ *
+ * @returns Descriptor address.
+ * @param   pThis                   The CCP copy engine.
+ * @param   idxDesc                 The descriptor index.
+ */
+static inline uint32_t ccpDescAddr(PCCP pThis, uint32_t idxDesc)
+{
+    return (uint32_t)(uintptr_t)&pThis->paDescs[idxDesc];
+}
+
+
+/**
+ * Stops the queue and points head and tail to the start of the ring.
+ *
+ * @returns nothing.
+ * @param   pThis                   The CCP copy engine.
+ */
+static void ccpQueueReset(PCCP pThis)
+{
+    ccpRegWrite(pThis, CCP_Q_REG_CTRL, 0);
+    ccpRegWrite(pThis, CCP_Q_REG_INT_ENABLE, 0);
+    ccpRegWrite(pThis, CCP_Q_REG_INT_STATUS, 0xffffffff);
+    ccpRegWrite(pThis, CCP_Q_REG_HEAD_LO, ccpDescAddr(pThis, 0));
+    ccpRegWrite(pThis, CCP_Q_REG_TAIL_LO, ccpDescAddr(pThis, 0));
+    pThis->idxDescNext = 0;
+}
+
+
+/**
+ * Returns the current time of the time source.
+ *
+ * @returns Number of microseconds, without a time source the number of calls so far.
+ * @param   pThis                   The CCP copy engine.
+ * @param   pcPolls                 The poll counter used without a time source.
+ */
+static uint64_t ccpGetMicros(PCCP pThis, uint64_t *pcPolls)
+{
+    if (pThis->pfnGetMicros)
+        return pThis->pfnGetMicros(pThis->pvUserGetMicros);
+
+    return (*pcPolls)++;
+}
+
+
+/**
+ * Halts the queue after a submission timed out and waits for the head to stop moving.
+ *
+ * @returns Status code.
+ * @retval  INF_SUCCESS if the submission completed after all.
+ * @retval  ERR_TIMEOUT if the queue stopped with descriptors left, the CCP doesn't access any memory anymore.
+ * @retval  ERR_CCP_CMD_FAILED if the head didn't stop moving, the CCP might still access the memory.
+ * @param   pThis                   The CCP copy engine.
+ * @param   u32Tail                 The tail of the submission.
+ */
+static int ccpQueueHalt(PCCP pThis, uint32_t u32Tail)
+{
+    /* The descriptor being processed is finished before the queue stops, which takes as long as a full descriptor at worst. */
+    uint64_t cUsQuiet = CCP_WAIT_BASE_US + CCP_DESC_XFER_MAX / CCP_WAIT_BYTES_PER_US_MIN;
+    uint64_t cPolls = 0;
+
+    ccpRegWrite(pThis, CCP_Q_REG_CTRL,   CCP_Q_CTRL_MEM_LOCAL
+                                       | (CCP_Q_CTRL_SIZE_VAL << CCP_Q_CTRL_SIZE_SHIFT));
+
+    uint32_t u32Head = ccpRegRead(pThis, CCP_Q_REG_HEAD_LO);
+    uint64_t tsStart = ccpGetMicros(pThis, &cPolls);
+    uint64_t tsHeadMoved = tsStart;
+    for (;;)
+    {
+        if (u32Head == u32Tail)
+            return INF_SUCCESS;
+
+        uint64_t tsNow = ccpGetMicros(pThis, &cPolls);
+        if (   (ccpRegRead(pThis, CCP_Q_REG_CTRL) & CCP_Q_CTRL_HALT)
+            || tsNow - tsHeadMoved >= cUsQuiet)
+            return ERR_TIMEOUT;
+
+        /* The head can't pass the tail, so it moving for longer than the whole ring takes means the CCP is broken. */
+        if (tsNow - tsStart >= CCP_DESC_COUNT * cUsQuiet)
+            return ERR_CCP_CMD_FAILED;
+
+        uint32_t u32HeadCur = ccpRegRead(pThis, CCP_Q_REG_HEAD_LO);
+        if (u32HeadCur != u32Head)
+        {
+            u32Head     = u32HeadCur;
+            tsHeadMoved = tsNow;
+        }
+    }
+}
+
+
+/**
+ * Starts the queue on the descriptors written since the last submission and waits for them to complete.
+ *
+ * @returns Status code.
+ * @param   pThis                   The CCP copy engine.
+ * @param   cbSubmit                Number of bytes the submitted descriptors copy, bounds the wait.
+ */
+static int ccpSubmitAndWait(PCCP pThis, size_t cbSubmit)
+{
+    uint32_t u32Tail = ccpDescAddr(pThis, pThis->idxDescNext);
+    uint64_t cUsTimeout = CCP_WAIT_BASE_US + cbSubmit / CCP_WAIT_BYTES_PER_US_MIN;
+    uint64_t cPolls = 0;
+    int rc = ERR_TIMEOUT;
+
+    pThis->pRegIf->pfnSync(pThis->pvUser);
+    ccpRegWrite(pThis, CCP_Q_REG_TAIL_LO, u32Tail);
+    ccpRegWrite(pThis, CCP_Q_REG_CTRL,   CCP_Q_CTRL_RUN
+                                       | CCP_Q_CTRL_MEM_LOCAL
+                                       | (CCP_Q_CTRL_SIZE_VAL << CCP_Q_CTRL_SIZE_SHIFT));
+
+    /* The head moves past every completed descriptor, a failing one halts the queue with the head on it. */
+    uint64_t tsStart = ccpGetMicros(pThis, &cPolls);
+    do
+    {
+        if (ccpRegRead(pThis, CCP_Q_REG_HEAD_LO) == u32Tail)
+        {
+            rc = INF_SUCCESS;
+            break;
+        }
+
+        if (ccpRegRead(pThis, CCP_Q_REG_STATUS) & CCP_Q_STATUS_ERR_MASK)
+        {
+            rc = ERR_CCP_CMD_FAILED;
+            break;
+        }
+    } while (ccpGetMicros(pThis, &cPolls) - tsStart < cUsTimeout);
+
+    /* The caller copies the range with the CPU after a timeout, so the CCP must not touch it anymore. */
+    bool fRunning = false;
+    if (rc == ERR_TIMEOUT)
+    {
+        rc = ccpQueueHalt(pThis, u32Tail);
+        fRunning = rc == ERR_CCP_CMD_FAILED;
+    }
+
+    if (!rc)
+    {
+        pThis->cTimeouts = 0;
+        ccpRegWrite(pThis, CCP_Q_REG_INT_STATUS, CCP_Q_INT_SUCCESS | CCP_Q_INT_ERROR);
+    }
+    else if (fRunning)
+        pThis->fAvail = false; /* Resetting a queue which is still running isn't safe, leave it alone for good. */
+    else
+    {
+        ccpQueueReset(pThis);
+        /* A single slow submission is no reason to give up on the CCP, one which keeps getting stuck is. */
+        if (   rc == ERR_TIMEOUT
+            && ++pThis->cTimeouts >= CCP_WAIT_TIMEOUTS_MAX)
+            pThis->fAvail = false;
+    }
+
+    pThis->pRegIf->pfnSync(pThis->pvUser);
+    return rc;
+}
+
+
+/**
+ * Copies the given range, the CCP availability isn't checked.
+ *
+ * @returns Status code.
+ * @param   pThis                   The CCP copy engine.
+ * @param   enmMemDst               Memory type of the destination.
+ * @param   uAddrDst                The destination address.
+ * @param   enmMemSrc               Memory type of the source.
+ * @param   uAddrSrc                The source address.
+ * @param   cbCopy                  Number of bytes to copy.
+ */
+static int ccpCopyWorker(PCCP pThis, CCPMEM enmMemDst, uint64_t uAddrDst, CCPMEM enmMemSrc, uint64_t uAddrSrc, size_t cbCopy)
+{
+    int rc = INF_SUCCESS;
+
+    while (   cbCopy
+           && !rc)
+    {
+        size_t cbSubmit = 0;
+
+        /* One descriptor is always left free, a full ring would look like an empty one (head == tail). */
+        for (uint32_t cDescs = 0; cDescs < CCP_DESC_COUNT - 1 && cbCopy; cDescs++)
+        {
+            PCCPDESC pDesc = &pThis->paDescs[pThis->idxDescNext];
+            size_t cbThisCopy = MIN(cbCopy, CCP_DESC_XFER_MAX);
+
+            pDesc->u32Dw0   =   CCP_DESC_DW0_EOM
+                              | (CCP_ENGINE_PASSTHRU << CCP_DESC_DW0_ENGINE_SHIFT);
+            pDesc->cbSrc    = (uint32_t)cbThisCopy;
+            pDesc->u32SrcLo = (uint32_t)uAddrSrc;
+            pDesc->u32SrcHi =   ((uint32_t)(uAddrSrc >> 32) & CCP_DESC_ADDR_HI_MASK)
+                              | ((uint32_t)enmMemSrc << CCP_DESC_ADDR_HI_MEM_SHIFT);
+            pDesc->u32DstLo = (uint32_t)uAddrDst;
+            pDesc->u32DstHi =   ((uint32_t)(uAddrDst >> 32) & CCP_DESC_ADDR_HI_MASK)
+                              | ((uint32_t)enmMemDst << CCP_DESC_ADDR_HI_MEM_SHIFT);
+            pDesc->u32KeyLo = 0;
+            pDesc->u32KeyHi = 0;
+
+            uAddrDst += cbThisCopy;
+            uAddrSrc += cbThisCopy;
+            cbCopy   -= cbThisCopy;
+            cbSubmit += cbThisCopy;
+            pThis->idxDescNext = (pThis->idxDescNext + 1) % CCP_DESC_COUNT;
+
+            if (   cDescs == CCP_DESC_COUNT - 2
+                || !cbCopy)
+                pDesc->u32Dw0 |= CCP_DESC_DW0_IOC;
+        }
+
+        rc = ccpSubmitAndWait(pThis, cbSubmit);
+    }
+
+    return rc;
+}
+
+
+int CCPInit(PCCP pThis, PCCCPREGIF pRegIf, void *pvUser, PFNCCPGETMICROS pfnGetMicros, void *pvUserGetMicros,
+            uint32_t idQueue)
+{
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pRegIf          = pRegIf;
+    pThis->pvUser          = pvUser;
+    pThis->pfnGetMicros    = pfnGetMicros;
+    pThis->pvUserGetMicros = pvUserGetMicros;
+    pThis->PspAddrQRegs    = CCP_MMIO_BASE + (idQueue + 1) * CCP_Q_REGS_SZ;
+    pThis->paDescs         = (PCCPDESC)(((uintptr_t)&pThis->aDescsBacking[0] + CCP_DESC_COUNT * sizeof(CCPDESC) - 1)
+                                        & ~(uintptr_t)(CCP_DESC_COUNT * sizeof(CCPDESC) - 1));
+    pThis->fAvail          = false;
+
+    ccpQueueReset(pThis);
+
+    for (uint32_t i = 0; i < sizeof(g_abCcpSelfTestSrc); i++)
+    {
+        g_abCcpSelfTestSrc[i] = (uint8_t)(i * 7 + 1);
+        g_abCcpSelfTestDst[i] = 0;
+    }
+
+    int rc = ccpCopyWorker(pThis, CCPMEM_LOCAL, (uintptr_t)&g_abCcpSelfTestDst[0],
+                           CCPMEM_LOCAL, (uintptr_t)&g_abCcpSelfTestSrc[0], sizeof(g_abCcpSelfTestSrc));
+    if (   rc
+        || memcmp(&g_abCcpSelfTestSrc[0], &g_abCcpSelfTestDst[0], sizeof(g_abCcpSelfTestSrc)))
+        return ERR_CCP_NOT_AVAILABLE;
+
+    pThis->fAvail = true;
+    return INF_SUCCESS;
+}
+
+
+bool CCPIsAvailable(PCCCP pThis)
+{
+    return pThis->fAvail;
+}
+
+
+int CCPCopy(PCCP pThis, CCPMEM enmMemDst, uint64_t uAddrDst, CCPMEM enmMemSrc, uint64_t uAddrSrc, size_t cbCopy)
+{
+    if (!pThis->fAvail)
+        return ERR_CCP_NOT_AVAILABLE;
+
+    return ccpCopyWorker(pThis, enmMemDst, uAddrDst, enmMemSrc, uAddrSrc, cbCopy);
+}
@@ -0,0 +1,170 @@
+/** @file
+ * COBS - Consistent Overhead Byte Stuffing framing.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <err.h>
+#include <cobs.h>
+
+/** The frame delimiter. */
+#define COBS_DELIMITER 0x00
+
+/**
+ * Writes out the current block.
+ *
+ * @returns Status code of the output callback.
+ * @param   pEnc     The encoder.
+ */
+static int cobsEncBlockFlush(PCOBSENC pEnc)
+{
+    /* The code is the offset of the next (implicit) zero byte. */
+    pEnc->abBlock[0] = (uint8_t)(pEnc->cbBlock + 1);
+
+    int rc = pEnc->pfnWrite(pEnc->pvUser, &pEnc->abBlock[0], pEnc->cbBlock + 1);
+    pEnc->cbBlock = 0;
+    return rc;
+}
+
+void COBSEncInit(PCOBSENC pEnc, PFNCOBSENCWRITE pfnWrite, void *pvUser)
+{
+    pEnc->pfnWrite = pfnWrite;
+    pEnc->pvUser   = pvUser;
+    pEnc->cbBlock  = 0;
+}
+
+int COBSEncFrameBegin(PCOBSENC pEnc)
+{
+    uint8_t bDelim = COBS_DELIMITER;
+
+    pEnc->cbBlock = 0;
+    return pEnc->pfnWrite(pEnc->pvUser, &bDelim, sizeof(bDelim));
+}
+
+int COBSEncWrite(PCOBSENC pEnc, const void *pvBuf, size_t cbBuf)
+{
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    int rc = INF_SUCCESS;
+
+    while (   cbBuf--
+           && !rc)
+    {
+        uint8_t b = *pbBuf++;
+
+        if (b == COBS_DELIMITER)
+            rc = cobsEncBlockFlush(pEnc); /* The zero is implied by the block end. */
+        else
+        {
+            pEnc->abBlock[++pEnc->cbBlock] = b;
+            /* A full block has no implied zero at the end. */
+            if (pEnc->cbBlock == COBS_BLOCK_DATA_MAX)
+                rc = cobsEncBlockFlush(pEnc);
+        }
+    }
+
+    return rc;
+}
+
+int COBSEncFrameEnd(PCOBSENC pEnc)
+{
+    uint8_t bDelim = COBS_DELIMITER;
+
+    /* The last block is always written, the implied zero at its end is dropped by the decoder. */
+    int rc = cobsEncBlockFlush(pEnc);
+    if (!rc)
+        rc = pEnc->pfnWrite(pEnc->pvUser, &bDelim, sizeof(bDelim));
+
+    return rc;
+}
+
+void COBSDecInit(PCOBSDEC pDec, void *pvFrame, size_t cbFrameMax)
+{
+    pDec->pbFrame     = (uint8_t *)pvFrame;
+    pDec->cbFrameMax  = cbFrameMax;
+    pDec->cbFrameDone = 0;
+    COBSDecReset(pDec);
+}
+
+void COBSDecReset(PCOBSDEC pDec)
+{
+    pDec->cbFrame     = 0;
+    pDec->cbBlockLeft = 0;
+    pDec->bCode       = 0;
+    pDec->fOverflow   = false;
+}
+
+/**
+ * Appends a decoded byte to the frame.
+ *
+ * @returns nothing.
+ * @param   pDec       The decoder.
+ * @param   b          The decoded byte.
+ */
+static void cobsDecFrameAppend(PCOBSDEC pDec, uint8_t b)
+{
+    if (pDec->cbFrame < pDec->cbFrameMax)
+        pDec->pbFrame[pDec->cbFrame++] = b;
+    else
+        pDec->fOverflow = true;
+}
+
+int COBSDecPutByte(PCOBSDEC pDec, uint8_t bIn)
+{
+    int rc = INF_TRY_AGAIN;
+
+    if (bIn == COBS_DELIMITER)
+    {
+        if (pDec->fOverflow)
+            rc = ERR_BUFFER_OVERFLOW;
+        else if (pDec->cbBlockLeft)
+            rc = ERR_COBS_FRAME_MALFORMED;
+        else if (pDec->bCode) /* Back to back delimiters are just ignored. */
+        {
+            pDec->cbFrameDone = pDec->cbFrame;
+            rc = INF_SUCCESS;
+        }
+
+        COBSDecReset(pDec);
+    }
+    else if (!pDec->fOverflow)
+    {
+        if (!pDec->cbBlockLeft)
+        {
+            /* Start of a new block, emit the zero implied by the end of the previous one. */
+            if (   pDec->bCode
+                && pDec->bCode != COBS_BLOCK_DATA_MAX + 1)
+                cobsDecFrameAppend(pDec, COBS_DELIMITER);
+
+            pDec->bCode       = bIn;
+            pDec->cbBlockLeft = bIn - 1;
+        }
+        else
+        {
+            cobsDecFrameAppend(pDec, bIn);
+            pDec->cbBlockLeft--;
+        }
+    }
+
+    return rc;
+}
+
+size_t COBSDecGetFrameSize(PCOBSDEC pDec)
+{
+    return pDec->cbFrameDone;
+}
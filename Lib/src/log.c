@@ -426,7 +426,7 @@ void LOGLoggerV(PLOGGER pLogger, const char *pszFmt, va_list hArgs)
                         void *pv = va_arg(hArgs, void *);
                         logLoggerAppendString(pLogger, "0x");
                         if (sizeof(void *) == 4)
-                            logLoggerAppendHexU32(pLogger, (uint32_t)pv,  8);
+                            logLoggerAppendHexU32(pLogger, (uint32_t)(uintptr_t)pv,  8);
 #ifdef __AMD64__
                         else if (sizeof(void *) == 8)
                             logLoggerAppendHexU64(pLogger, (uint64_t)pv, 16);
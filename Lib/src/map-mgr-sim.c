@@ -0,0 +1,94 @@
+/** @file
+ * MAPMGR - Simulated mapping register file for host builds.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <string.h>
+#include <map-mgr.h>
+
+
+/**
+ * Returns the simulated register backing the given register address.
+ *
+ * @returns Pointer to the simulated register or NULL if the address isn't part of the register file.
+ * @param   pRegSim                 The simulated register file.
+ * @param   PspAddrReg              The register address.
+ */
+static uint32_t *mapMgrSimRegGet(PMAPMGRREGSIM pRegSim, PSPADDR PspAddrReg)
+{
+    if (PspAddrReg & (sizeof(uint32_t) - 1))
+        return NULL;
+
+    if (   PspAddrReg >= MAPMGR_SMN_REGS_BASE
+        && PspAddrReg < MAPMGR_SMN_REGS_BASE + sizeof(pRegSim->au32SmnRegs))
+        return &pRegSim->au32SmnRegs[(PspAddrReg - MAPMGR_SMN_REGS_BASE) / sizeof(uint32_t)];
+
+    if (   PspAddrReg >= MAPMGR_X86_REGS_BASE
+        && PspAddrReg < MAPMGR_X86_REGS_BASE + sizeof(pRegSim->au32X86Regs))
+        return &pRegSim->au32X86Regs[(PspAddrReg - MAPMGR_X86_REGS_BASE) / sizeof(uint32_t)];
+
+    return NULL;
+}
+
+
+static uint32_t mapMgrSimRegRead(void *pvUser, PSPADDR PspAddrReg)
+{
+    PMAPMGRREGSIM pRegSim = (PMAPMGRREGSIM)pvUser;
+    uint32_t *pu32Reg = mapMgrSimRegGet(pRegSim, PspAddrReg);
+
+    pRegSim->cRegReads++;
+    return pu32Reg ? *pu32Reg : 0xffffffff;
+}
+
+
+static void mapMgrSimRegWrite(void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val)
+{
+    PMAPMGRREGSIM pRegSim = (PMAPMGRREGSIM)pvUser;
+    uint32_t *pu32Reg = mapMgrSimRegGet(pRegSim, PspAddrReg);
+
+    pRegSim->cRegWrites++;
+    if (pu32Reg)
+        *pu32Reg = u32Val;
+}
+
+
+static void mapMgrSimSync(void *pvUser)
+{
+    (void)pvUser;
+    /* Nothing to wait for. */
+}
+
+
+const MAPMGRREGIF g_MapMgrRegIfSim =
+{
+    /** pfnRegRead */
+    mapMgrSimRegRead,
+    /** pfnRegWrite */
+    mapMgrSimRegWrite,
+    /** pfnSync */
+    mapMgrSimSync
+};
+
+
+void MAPMgrRegSimInit(PMAPMGRREGSIM pRegSim)
+{
+    memset(pRegSim, 0, sizeof(*pRegSim));
+}
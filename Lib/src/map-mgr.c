@@ -0,0 +1,732 @@
+/** @file
+ * MAPMGR - x86 and SMN address space mapping manager.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <err.h>
+#include <string.h>
+#include <map-mgr.h>
+
+
+/** The default mapping manager used by the pspX86PhysMap()/pspSmnMap() API. */
+static MAPMGR g_MapMgrDef;
+/** Flag whether the default mapping manager was initialised. */
+static bool   g_fMapMgrDefInit = false;
+
+
+static uint32_t mapMgrMmioRegRead(void *pvUser, PSPADDR PspAddrReg)
+{
+    (void)pvUser;
+    return *(volatile uint32_t *)(uintptr_t)PspAddrReg;
+}
+
+static void mapMgrMmioRegWrite(void *pvUser, PSPADDR PspAddrReg, uint32_t u32Val)
+{
+    (void)pvUser;
+    *(volatile uint32_t *)(uintptr_t)PspAddrReg = u32Val;
+}
+
+static void mapMgrMmioSync(void *pvUser)
+{
+    (void)pvUser;
+#if defined(__arm__)
+    asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
+const MAPMGRREGIF g_MapMgrRegIfMmio =
+{
+    /** pfnRegRead */
+    mapMgrMmioRegRead,
+    /** pfnRegWrite */
+    mapMgrMmioRegWrite,
+    /** pfnSync */
+    mapMgrMmioSync
+};
+
+
+/**
+ * Programs the given x86 mapping slot registers.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index to program.
+ * @param   PhysX86AddrBase         The 64MB aligned x86 base address to map.
+ * @param   uMemType                The memory type to use.
+ */
+static void mapMgrX86SlotProgram(PMAPMGR pThis, uint32_t idxSlot, X86PADDR PhysX86AddrBase, uint32_t uMemType)
+{
+    PCMAPMGRREGIF pRegIf = pThis->pRegIf;
+    PSPADDR PspAddrSlotBase = MAPMGR_X86_REGS_BASE + idxSlot * 4 * sizeof(uint32_t);
+
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase,      ((PhysX86AddrBase >> 32) << 6) | ((PhysX86AddrBase >> 26) & 0x3f));
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 4,  0x12); /* Unknown but fixed value. */
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 8,  uMemType);
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 12, uMemType);
+    pRegIf->pfnRegWrite(pThis->pvUser, MAPMGR_X86_REGS_BASE + 0x3e0 + idxSlot * sizeof(uint32_t), 0xffffffff);
+    pRegIf->pfnRegWrite(pThis->pvUser, MAPMGR_X86_REGS_BASE + 0x4d8 + idxSlot * sizeof(uint32_t), 0xc0000000);
+    pRegIf->pfnRegWrite(pThis->pvUser, MAPMGR_X86_REGS_BASE + 0x5ec, 0x3333);
+}
+
+
+/**
+ * Clears the given x86 mapping slot registers.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index to clear.
+ */
+static void mapMgrX86SlotClear(PMAPMGR pThis, uint32_t idxSlot)
+{
+    PCMAPMGRREGIF pRegIf = pThis->pRegIf;
+    PSPADDR PspAddrSlotBase = MAPMGR_X86_REGS_BASE + idxSlot * 4 * sizeof(uint32_t);
+
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase,      0);
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 4,  0); /* Unknown but fixed value. */
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 8,  0);
+    pRegIf->pfnRegWrite(pThis->pvUser, PspAddrSlotBase + 12, 0);
+    pRegIf->pfnRegWrite(pThis->pvUser, MAPMGR_X86_REGS_BASE + 0x3e0 + idxSlot * sizeof(uint32_t), 0xffffffff);
+    pRegIf->pfnRegWrite(pThis->pvUser, MAPMGR_X86_REGS_BASE + 0x4d8 + idxSlot * sizeof(uint32_t), 0);
+}
+
+
+/**
+ * Sets the given SMN mapping slot to the given base address.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index to program.
+ * @param   idDie                   The die to target.
+ * @param   SmnAddrBase             The 1MB aligned SMN base address to map, 0 to clear the slot.
+ */
+static void mapMgrSmnSlotProgram(PMAPMGR pThis, uint32_t idxSlot, uint32_t idDie, SMNADDR SmnAddrBase)
+{
+    /* Each control register holds two slots, so leave the other half alone. */
+    PSPADDR PspAddrReg = MAPMGR_SMN_REGS_BASE + (idxSlot / 2) * sizeof(uint32_t);
+    uint32_t u16Ctrl = (idDie << MAPMGR_SMN_SLOT_DIE_SHIFT) | (SmnAddrBase >> 20);
+    uint32_t u32RegSmnMapCtrl = pThis->pRegIf->pfnRegRead(pThis->pvUser, PspAddrReg);
+    if (idxSlot & 0x1)
+        u32RegSmnMapCtrl = (u32RegSmnMapCtrl & 0xffff) | (u16Ctrl << 16);
+    else
+        u32RegSmnMapCtrl = (u32RegSmnMapCtrl & 0xffff0000) | u16Ctrl;
+    pThis->pRegIf->pfnRegWrite(pThis->pvUser, PspAddrReg, u32RegSmnMapCtrl);
+}
+
+
+/**
+ * Returns the hash bucket for the given x86 window.
+ *
+ * @returns Hash bucket index.
+ * @param   PhysX86AddrBase         The 64MB aligned x86 base address.
+ * @param   uMemType                The memory type.
+ * @param   fMmio                   Flag whether the mapping is requested as MMIO, the same window can be mapped as both.
+ */
+static inline uint32_t mapMgrX86Hash(X86PADDR PhysX86AddrBase, uint32_t uMemType, bool fMmio)
+{
+    uint32_t uKey = (uint32_t)(PhysX86AddrBase >> 26);
+    return (uKey ^ (uKey >> 4) ^ (uKey >> 8) ^ uMemType ^ (fMmio ? 0x9 : 0)) & (MAPMGR_X86_HASH_SZ - 1);
+}
+
+
+/**
+ * Returns the hash bucket for the given SMN window.
+ *
+ * @returns Hash bucket index.
+ * @param   idDie                   The target die.
+ * @param   SmnAddrBase             The 1MB aligned SMN base address.
+ */
+static inline uint32_t mapMgrSmnHash(uint32_t idDie, SMNADDR SmnAddrBase)
+{
+    uint32_t uKey = SmnAddrBase >> 20;
+    return (uKey ^ (uKey >> 5) ^ (uKey >> 10) ^ (idDie * 7)) & (MAPMGR_SMN_HASH_SZ - 1);
+}
+
+
+/**
+ * Looks up the slot mapping the given x86 window.
+ *
+ * @returns Slot index or UINT32_MAX if the window isn't mapped.
+ * @param   pThis                   The mapping manager.
+ * @param   PhysX86AddrBase         The 64MB aligned x86 base address.
+ * @param   uMemType                The memory type.
+ * @param   fMmio                   Flag whether the mapping is requested as MMIO.
+ */
+static uint32_t mapMgrX86Lookup(PMAPMGR pThis, X86PADDR PhysX86AddrBase, uint32_t uMemType, bool fMmio)
+{
+    uint32_t idxSlot = pThis->aidxX86Hash[mapMgrX86Hash(PhysX86AddrBase, uMemType, fMmio)];
+
+    while (idxSlot != MAPMGR_HASH_NIL)
+    {
+        MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+        /* An explicit memory type doesn't change the slot class, MMIO accesses stay in the MMIO slots. */
+        if (   pSlot->PhysX86AddrBase == PhysX86AddrBase
+            && pSlot->uMemType == uMemType
+            && pSlot->fMmio == fMmio)
+            return idxSlot;
+
+        idxSlot = pSlot->idxHashNext;
+    }
+
+    return UINT32_MAX;
+}
+
+
+/**
+ * Looks up the slot mapping the given SMN window.
+ *
+ * @returns Slot index or UINT32_MAX if the window isn't mapped.
+ * @param   pThis                   The mapping manager.
+ * @param   idDie                   The target die.
+ * @param   SmnAddrBase             The 1MB aligned SMN base address.
+ */
+static uint32_t mapMgrSmnLookup(PMAPMGR pThis, uint32_t idDie, SMNADDR SmnAddrBase)
+{
+    uint32_t idxSlot = pThis->aidxSmnHash[mapMgrSmnHash(idDie, SmnAddrBase)];
+
+    while (idxSlot != MAPMGR_HASH_NIL)
+    {
+        MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+        if (   pSlot->SmnAddrBase == SmnAddrBase
+            && pSlot->idDie == idDie)
+            return idxSlot;
+
+        idxSlot = pSlot->idxHashNext;
+    }
+
+    return UINT32_MAX;
+}
+
+
+/**
+ * Removes the given x86 slot from its hash chain.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index, must be in the lookup.
+ */
+static void mapMgrX86HashRemove(PMAPMGR pThis, uint32_t idxSlot)
+{
+    MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+    uint8_t *pidxCur = &pThis->aidxX86Hash[mapMgrX86Hash(pSlot->PhysX86AddrBase, pSlot->uMemType, pSlot->fMmio)];
+
+    while (*pidxCur != idxSlot)
+    {
+        if (*pidxCur == MAPMGR_HASH_NIL) /* Can't happen. */
+            return;
+        pidxCur = &pThis->aX86Slots[*pidxCur].idxHashNext;
+    }
+
+    *pidxCur = pSlot->idxHashNext;
+    pSlot->idxHashNext = MAPMGR_HASH_NIL;
+}
+
+
+/**
+ * Removes the given SMN slot from its hash chain.
+ *
+ * @returns nothing.
+ * @param   pThis                   The mapping manager.
+ * @param   idxSlot                 The slot index, must be in the lookup.
+ */
+static void mapMgrSmnHashRemove(PMAPMGR pThis, uint32_t idxSlot)
+{
+    MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+    uint8_t *pidxCur = &pThis->aidxSmnHash[mapMgrSmnHash(pSlot->idDie, pSlot->SmnAddrBase)];
+
+    while (*pidxCur != idxSlot)
+    {
+        if (*pidxCur == MAPMGR_HASH_NIL) /* Can't happen. */
+            return;
+        pidxCur = &pThis->aSmnSlots[*pidxCur].idxHashNext;
+    }
+
+    *pidxCur = pSlot->idxHashNext;
+    pSlot->idxHashNext = MAPMGR_HASH_NIL;
+}
+
+
+int MAPMgrInit(PMAPMGR pThis, PCMAPMGRREGIF pRegIf, void *pvUser)
+{
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pRegIf = pRegIf;
+    pThis->pvUser = pvUser;
+    pThis->uSeq   = 0;
+
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aX86Slots); i++)
+    {
+        pThis->aX86Slots[i].PhysX86AddrBase = NIL_X86PADDR;
+        pThis->aX86Slots[i].idxHashNext     = MAPMGR_HASH_NIL;
+    }
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aSmnSlots); i++)
+    {
+        pThis->aSmnSlots[i].SmnAddrBase = MAPMGR_SMN_SLOT_FREE;
+        pThis->aSmnSlots[i].idDie       = 0;
+        pThis->aSmnSlots[i].idxHashNext = MAPMGR_HASH_NIL;
+    }
+    memset(&pThis->aidxX86Hash[0], MAPMGR_HASH_NIL, sizeof(pThis->aidxX86Hash));
+    memset(&pThis->aidxSmnHash[0], MAPMGR_HASH_NIL, sizeof(pThis->aidxSmnHash));
+
+    return INF_SUCCESS;
+}
+
+
+PMAPMGR MAPMgrGetDefault(void)
+{
+    if (!g_fMapMgrDefInit)
+    {
+        MAPMgrInit(&g_MapMgrDef, &g_MapMgrRegIfMmio, NULL /*pvUser*/);
+        g_fMapMgrDefInit = true;
+    }
+
+    return &g_MapMgrDef;
+}
+
+
+int MAPMgrX86PhysMap(PMAPMGR pThis, X86PADDR PhysX86Addr, bool fMmio, void **ppv)
+{
+    return MAPMgrX86PhysMapEx(pThis, PhysX86Addr, fMmio, MAPMGR_X86_MEMTYPE_DEFAULT, ppv);
+}
+
+
+int MAPMgrX86PhysMapEx(PMAPMGR pThis, X86PADDR PhysX86Addr, bool fMmio, uint32_t uMemType, void **ppv)
+{
+    int rc = INF_SUCCESS;
+
+    if (uMemType == MAPMGR_X86_MEMTYPE_DEFAULT)
+        uMemType = fMmio ? MAPMGR_X86_MEMTYPE_MMIO : MAPMGR_X86_MEMTYPE_MEM;
+    else if (uMemType > MAPMGR_X86_MEMTYPE_MAX)
+        return ERR_INVALID_PARAMETER;
+
+    /* Split physical address into 64MB aligned base and offset. */
+    X86PADDR PhysX86AddrBase = (PhysX86Addr & ~(_64M - 1));
+    uint32_t offStart = PhysX86Addr - PhysX86AddrBase;
+
+    uint32_t idxSlot = mapMgrX86Lookup(pThis, PhysX86AddrBase, uMemType, fMmio);
+    if (idxSlot != UINT32_MAX)
+        pThis->aX86Slots[idxSlot].Stats.cHits++;
+    else
+    {
+        /* Not mapped, take a free slot or evict the least recently used one (only reached on a miss). */
+        for (uint32_t i = fMmio ? MAPMGR_X86_SLOT_MMIO_FIRST : 0; i < ELEMENTS(pThis->aX86Slots); i++)
+        {
+            MAPMGRX86SLOT *pCur = &pThis->aX86Slots[i];
+
+            if (!pCur->cRefs)
+            {
+                /* Free slots are always preferred over evicting a cached mapping. */
+                if (   idxSlot == UINT32_MAX
+                    || (   pThis->aX86Slots[idxSlot].PhysX86AddrBase != NIL_X86PADDR
+                        && (   pCur->PhysX86AddrBase == NIL_X86PADDR
+                            || pThis->uSeq - pCur->uSeqLastUse > pThis->uSeq - pThis->aX86Slots[idxSlot].uSeqLastUse)))
+                    idxSlot = i;
+            }
+        }
+
+        if (idxSlot != UINT32_MAX)
+        {
+            /* Set up the mapping, reprogramming the slot replaces any cached mapping. */
+            MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+            if (pSlot->PhysX86AddrBase != NIL_X86PADDR)
+            {
+                mapMgrX86HashRemove(pThis, idxSlot);
+                pSlot->Stats.cEvictions++;
+            }
+            pSlot->Stats.cMisses++;
+            pSlot->uMemType        = uMemType;
+            pSlot->PhysX86AddrBase = PhysX86AddrBase;
+            pSlot->fMmio           = fMmio;
+
+            uint8_t *pidxHead = &pThis->aidxX86Hash[mapMgrX86Hash(PhysX86AddrBase, uMemType, fMmio)];
+            pSlot->idxHashNext = *pidxHead;
+            *pidxHead = (uint8_t)idxSlot;
+
+            pThis->pRegIf->pfnSync(pThis->pvUser);
+            mapMgrX86SlotProgram(pThis, idxSlot, PhysX86AddrBase, uMemType);
+        }
+    }
+
+    if (idxSlot != UINT32_MAX)
+    {
+        MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+
+        pThis->pRegIf->pfnSync(pThis->pvUser);
+        pSlot->cRefs++;
+        pSlot->uSeqLastUse = pThis->uSeq++;
+        *ppv = (void *)(uintptr_t)(MAPMGR_X86_WINDOW_BASE + idxSlot * _64M + offStart);
+    }
+    else
+        rc = ERR_INVALID_STATE;
+
+    return rc;
+}
+
+
+int MAPMgrX86PhysUnmapByPtr(PMAPMGR pThis, void *pv)
+{
+    int rc = INF_SUCCESS;
+    uintptr_t PspAddrMapBase = ((uintptr_t)pv) & ~(_64M - 1);
+    PspAddrMapBase -= MAPMGR_X86_WINDOW_BASE;
+
+    uint32_t idxSlot = PspAddrMapBase / _64M;
+    if (   idxSlot < ELEMENTS(pThis->aX86Slots)
+        && PspAddrMapBase % _64M == 0)
+    {
+        MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+
+        pThis->pRegIf->pfnSync(pThis->pvUser);
+        if (pSlot->cRefs > 0)
+            pSlot->cRefs--;
+        else
+            rc = ERR_INVALID_PARAMETER;
+    }
+    else
+        rc = ERR_INVALID_PARAMETER;
+
+    return rc;
+}
+
+
+void MAPMgrX86Flush(PMAPMGR pThis)
+{
+    pThis->pRegIf->pfnSync(pThis->pvUser);
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aX86Slots); i++)
+    {
+        MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[i];
+
+        if (   !pSlot->cRefs
+            && pSlot->PhysX86AddrBase != NIL_X86PADDR)
+        {
+            mapMgrX86HashRemove(pThis, i);
+            pSlot->uMemType        = 0;
+            pSlot->PhysX86AddrBase = NIL_X86PADDR;
+            pSlot->fMmio           = false;
+            mapMgrX86SlotClear(pThis, i);
+        }
+    }
+    pThis->pRegIf->pfnSync(pThis->pvUser);
+}
+
+
+/**
+ * Checks whether the given die can be mapped.
+ *
+ * @returns Status code.
+ * @param   idDie                   The die to check.
+ */
+static inline int mapMgrSmnDieCheck(uint32_t idDie)
+{
+    if (idDie >= MAPMGR_SMN_DIE_COUNT)
+        return ERR_INVALID_PARAMETER;
+#ifndef MAPMGR_SMN_REMOTE_DIE
+    /* The die select encoding is a guess, keep it out of the live slot registers unless asked for. */
+    if (idDie)
+        return ERR_NOT_IMPLEMENTED;
+#endif
+
+    return INF_SUCCESS;
+}
+
+
+int MAPMgrSmnMap(PMAPMGR pThis, SMNADDR SmnAddr, void **ppv)
+{
+    return MAPMgrSmnMapEx(pThis, 0 /*idDie*/, SmnAddr, ppv);
+}
+
+
+int MAPMgrSmnMapEx(PMAPMGR pThis, uint32_t idDie, SMNADDR SmnAddr, void **ppv)
+{
+    int rc = mapMgrSmnDieCheck(idDie);
+    if (rc)
+        return rc;
+
+    /* Split physical address into 1MB aligned base and offset. */
+    SMNADDR  SmnAddrBase = (SmnAddr & ~(_1M - 1));
+    uint32_t offStart = SmnAddr - SmnAddrBase;
+
+    uint32_t idxSlot = mapMgrSmnLookup(pThis, idDie, SmnAddrBase);
+    if (idxSlot != UINT32_MAX)
+        pThis->aSmnSlots[idxSlot].Stats.cHits++;
+    else
+    {
+        /* Not mapped, take a free slot or evict the least recently used one (only reached on a miss). */
+        for (uint32_t i = 0; i < ELEMENTS(pThis->aSmnSlots); i++)
+        {
+            MAPMGRSMNSLOT *pCur = &pThis->aSmnSlots[i];
+
+            if (!pCur->cRefs)
+            {
+                /* Free slots are always preferred over evicting a cached mapping. */
+                if (   idxSlot == UINT32_MAX
+                    || (   pThis->aSmnSlots[idxSlot].SmnAddrBase != MAPMGR_SMN_SLOT_FREE
+                        && (   pCur->SmnAddrBase == MAPMGR_SMN_SLOT_FREE
+                            || pThis->uSeq - pCur->uSeqLastUse > pThis->uSeq - pThis->aSmnSlots[idxSlot].uSeqLastUse)))
+                    idxSlot = i;
+            }
+        }
+
+        if (idxSlot != UINT32_MAX)
+        {
+            /* Set up the mapping, reprogramming the slot replaces any cached mapping. */
+            MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+            if (pSlot->SmnAddrBase != MAPMGR_SMN_SLOT_FREE)
+            {
+                mapMgrSmnHashRemove(pThis, idxSlot);
+                pSlot->Stats.cEvictions++;
+            }
+            pSlot->Stats.cMisses++;
+            pSlot->SmnAddrBase = SmnAddrBase;
+            pSlot->idDie       = idDie;
+
+            uint8_t *pidxHead = &pThis->aidxSmnHash[mapMgrSmnHash(idDie, SmnAddrBase)];
+            pSlot->idxHashNext = *pidxHead;
+            *pidxHead = (uint8_t)idxSlot;
+
+            mapMgrSmnSlotProgram(pThis, idxSlot, idDie, SmnAddrBase);
+        }
+    }
+
+    if (idxSlot != UINT32_MAX)
+    {
+        MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+
+        pSlot->cRefs++;
+        pSlot->uSeqLastUse = pThis->uSeq++;
+        *ppv = (void *)(uintptr_t)(MAPMGR_SMN_WINDOW_BASE + idxSlot * _1M + offStart);
+    }
+    else
+        rc = ERR_INVALID_STATE;
+
+    return rc;
+}
+
+
+int MAPMgrSmnUnmapByPtr(PMAPMGR pThis, void *pv)
+{
+    int rc = INF_SUCCESS;
+    uintptr_t PspAddrMapBase = ((uintptr_t)pv) & ~(_1M - 1);
+    PspAddrMapBase -= MAPMGR_SMN_WINDOW_BASE;
+
+    uint32_t idxSlot = PspAddrMapBase / _1M;
+    if (   idxSlot < ELEMENTS(pThis->aSmnSlots)
+        && PspAddrMapBase % _1M == 0)
+    {
+        MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+
+        if (pSlot->cRefs > 0)
+            pSlot->cRefs--;
+        else
+            rc = ERR_INVALID_PARAMETER;
+    }
+    else
+        rc = ERR_INVALID_PARAMETER;
+
+    return rc;
+}
+
+
+void MAPMgrSmnFlush(PMAPMGR pThis)
+{
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aSmnSlots); i++)
+    {
+        MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[i];
+
+        if (   !pSlot->cRefs
+            && pSlot->SmnAddrBase != MAPMGR_SMN_SLOT_FREE)
+        {
+            mapMgrSmnHashRemove(pThis, i);
+            pSlot->SmnAddrBase = MAPMGR_SMN_SLOT_FREE;
+            pSlot->idDie       = 0;
+            mapMgrSmnSlotProgram(pThis, i, 0 /*idDie*/, 0);
+        }
+    }
+}
+
+
+void MAPMgrQueryStats(PMAPMGR pThis, PMAPMGRSTATS pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aX86Slots); i++)
+    {
+        MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[i];
+
+        pStats->X86.cHits      += pSlot->Stats.cHits;
+        pStats->X86.cMisses    += pSlot->Stats.cMisses;
+        pStats->X86.cEvictions += pSlot->Stats.cEvictions;
+        if (pSlot->PhysX86AddrBase != NIL_X86PADDR)
+            pStats->cX86SlotsMapped++;
+    }
+
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aSmnSlots); i++)
+    {
+        MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[i];
+
+        pStats->Smn.cHits      += pSlot->Stats.cHits;
+        pStats->Smn.cMisses    += pSlot->Stats.cMisses;
+        pStats->Smn.cEvictions += pSlot->Stats.cEvictions;
+        if (pSlot->SmnAddrBase != MAPMGR_SMN_SLOT_FREE)
+            pStats->cSmnSlotsMapped++;
+    }
+}
+
+
+int MAPMgrX86SlotQuery(PMAPMGR pThis, uint32_t idxSlot, PMAPMGRSLOTINFO pInfo)
+{
+    if (idxSlot >= ELEMENTS(pThis->aX86Slots))
+        return ERR_INVALID_PARAMETER;
+
+    MAPMGRX86SLOT *pSlot = &pThis->aX86Slots[idxSlot];
+    pInfo->uAddrBase = pSlot->PhysX86AddrBase;
+    pInfo->uMemType  = pSlot->uMemType;
+    pInfo->idDie     = 0;
+    pInfo->cRefs     = pSlot->cRefs;
+    pInfo->Stats     = pSlot->Stats;
+    return INF_SUCCESS;
+}
+
+
+int MAPMgrSmnSlotQuery(PMAPMGR pThis, uint32_t idxSlot, PMAPMGRSLOTINFO pInfo)
+{
+    if (idxSlot >= ELEMENTS(pThis->aSmnSlots))
+        return ERR_INVALID_PARAMETER;
+
+    MAPMGRSMNSLOT *pSlot = &pThis->aSmnSlots[idxSlot];
+    pInfo->uAddrBase =   pSlot->SmnAddrBase != MAPMGR_SMN_SLOT_FREE
+                       ? pSlot->SmnAddrBase
+                       : UINT64_MAX;
+    pInfo->uMemType  = 0;
+    pInfo->idDie     = pSlot->idDie;
+    pInfo->cRefs     = pSlot->cRefs;
+    pInfo->Stats     = pSlot->Stats;
+    return INF_SUCCESS;
+}
+
+
+int MAPMgrWinIterInit(PMAPMGRWINITER pIt, PMAPMGR pThis, MAPMGRADDRSPACE enmAddrSpace, uint64_t uAddrStart, uint64_t cbRange)
+{
+    return MAPMgrWinIterInitEx(pIt, pThis, enmAddrSpace, uAddrStart, cbRange, MAPMGR_X86_MEMTYPE_DEFAULT, 0 /*idSmnDie*/);
+}
+
+
+int MAPMgrWinIterInitEx(PMAPMGRWINITER pIt, PMAPMGR pThis, MAPMGRADDRSPACE enmAddrSpace, uint64_t uAddrStart, uint64_t cbRange,
+                        uint32_t uX86MemType, uint32_t idSmnDie)
+{
+    switch (enmAddrSpace)
+    {
+        case MAPMGRADDRSPACE_SMN:
+        {
+            /* The SMN address space is only 32bit wide and has no memory types. */
+            if (   uAddrStart > UINT32_MAX
+                || uX86MemType != MAPMGR_X86_MEMTYPE_DEFAULT
+                || cbRange > (uint64_t)UINT32_MAX + 1 - uAddrStart)
+                return ERR_INVALID_PARAMETER;
+
+            int rc = mapMgrSmnDieCheck(idSmnDie);
+            if (rc)
+                return rc;
+            break;
+        }
+        case MAPMGRADDRSPACE_X86_MEM:
+        case MAPMGRADDRSPACE_X86_MMIO:
+            if (   (   cbRange
+                    && cbRange - 1 > UINT64_MAX - uAddrStart)
+                || (   uX86MemType != MAPMGR_X86_MEMTYPE_DEFAULT
+                    && uX86MemType > MAPMGR_X86_MEMTYPE_MAX)
+                || idSmnDie)
+                return ERR_INVALID_PARAMETER;
+            break;
+        default:
+            return ERR_INVALID_PARAMETER;
+    }
+
+    pIt->pMapMgr      = pThis;
+    pIt->enmAddrSpace = enmAddrSpace;
+    pIt->uX86MemType  = uX86MemType;
+    pIt->idSmnDie     = idSmnDie;
+    pIt->pvMapCur     = NULL;
+    pIt->uAddrNext    = uAddrStart;
+    pIt->cbLeft       = cbRange;
+    return INF_SUCCESS;
+}
+
+
+int MAPMgrWinIterNext(PMAPMGRWINITER pIt, size_t cbMax, void **ppv, size_t *pcbChunk)
+{
+    int rc = INF_SUCCESS;
+
+    MAPMgrWinIterEnd(pIt);
+    if (   !pIt->cbLeft
+        || !cbMax)
+    {
+        *pcbChunk = 0;
+        return INF_SUCCESS;
+    }
+
+    uint64_t cbWindow = 0;
+    if (pIt->enmAddrSpace == MAPMGRADDRSPACE_SMN)
+    {
+        cbWindow = _1M;
+        rc = MAPMgrSmnMapEx(pIt->pMapMgr, pIt->idSmnDie, (SMNADDR)pIt->uAddrNext, &pIt->pvMapCur);
+    }
+    else
+    {
+        cbWindow = _64M;
+        rc = MAPMgrX86PhysMapEx(pIt->pMapMgr, pIt->uAddrNext, pIt->enmAddrSpace == MAPMGRADDRSPACE_X86_MMIO,
+                                pIt->uX86MemType, &pIt->pvMapCur);
+    }
+
+    if (!rc)
+    {
+        uint64_t cbChunk = cbWindow - (pIt->uAddrNext & (cbWindow - 1));
+        cbChunk = MIN(cbChunk, pIt->cbLeft);
+        cbChunk = MIN(cbChunk, cbMax);
+
+        pIt->uAddrNext += cbChunk;
+        pIt->cbLeft    -= cbChunk;
+        *ppv      = pIt->pvMapCur;
+        *pcbChunk = (size_t)cbChunk;
+    }
+    else
+        pIt->pvMapCur = NULL;
+
+    return rc;
+}
+
+
+uint64_t MAPMgrWinIterGetLeft(PMAPMGRWINITER pIt)
+{
+    return pIt->cbLeft;
+}
+
+
+void MAPMgrWinIterEnd(PMAPMGRWINITER pIt)
+{
+    if (pIt->pvMapCur)
+    {
+        if (pIt->enmAddrSpace == MAPMGRADDRSPACE_SMN)
+            MAPMgrSmnUnmapByPtr(pIt->pMapMgr, pIt->pvMapCur);
+        else
+            MAPMgrX86PhysUnmapByPtr(pIt->pMapMgr, pIt->pvMapCur);
+        pIt->pvMapCur = NULL;
+    }
+}
@@ -0,0 +1,84 @@
+/** @file
+ * Byte pattern search.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <err.h>
+#include <memsearch.h>
+
+int MEMSearchInit(PMEMSEARCH pThis, const void *pvPattern, const void *pvMask, size_t cbPattern)
+{
+    const uint8_t *pbPattern = (const uint8_t *)pvPattern;
+    const uint8_t *pbMask = (const uint8_t *)pvMask;
+
+    if (   !cbPattern
+        || cbPattern > MEMSEARCH_PATTERN_MAX)
+        return ERR_INVALID_PARAMETER;
+
+    pThis->cbPattern = cbPattern;
+    for (size_t i = 0; i < cbPattern; i++)
+    {
+        pThis->abMask[i]    = pbMask ? pbMask[i] : 0xff;
+        pThis->abPattern[i] = pbPattern[i] & pThis->abMask[i];
+    }
+
+    for (uint32_t b = 0; b < 256; b++)
+        pThis->acbSkip[b] = (uint8_t)cbPattern;
+
+    /* Going from the front lets the bytes closer to the end overwrite the skip distance with a shorter one. */
+    for (size_t i = 0; i < cbPattern - 1; i++)
+    {
+        uint8_t cbSkip = (uint8_t)(cbPattern - 1 - i);
+
+        for (uint32_t b = 0; b < 256; b++)
+        {
+            if (((uint8_t)b & pThis->abMask[i]) == pThis->abPattern[i])
+                pThis->acbSkip[b] = cbSkip;
+        }
+    }
+
+    return INF_SUCCESS;
+}
+
+bool MEMSearchFind(PCMEMSEARCH pThis, const void *pvBuf, size_t cbBuf, size_t *poffMatch)
+{
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    size_t cbPattern = pThis->cbPattern;
+    size_t off = 0;
+
+    while (off + cbPattern <= cbBuf)
+    {
+        /* Compare from the end, the last byte was just used for the skip anyway and is the most likely mismatch. */
+        size_t i = cbPattern;
+        while (   i
+               && (pbBuf[off + i - 1] & pThis->abMask[i - 1]) == pThis->abPattern[i - 1])
+            i--;
+
+        if (!i)
+        {
+            *poffMatch = off;
+            return true;
+        }
+
+        off += pThis->acbSkip[pbBuf[off + cbPattern - 1]];
+    }
+
+    return false;
+}
@@ -0,0 +1,183 @@
+/** @file
+ * SHA-256 hash (FIPS 180-4).
+ */
+
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include <sha256.h>
+
+/** Rotates the given value right. */
+#define SHA256_ROR(a_u32, a_cShift) (((a_u32) >> (a_cShift)) | ((a_u32) << (32 - (a_cShift))))
+
+/** The round constants. */
+static const uint32_t g_au32Sha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+/**
+ * Processes a single 64 byte block.
+ *
+ * @returns nothing.
+ * @param   pCtx     The context to use.
+ * @param   pbBlock  The block to process.
+ */
+static void sha256Block(PSHA256CTX pCtx, const uint8_t *pbBlock)
+{
+    uint32_t au32W[64];
+
+    for (uint32_t i = 0; i < 16; i++)
+        au32W[i] =   ((uint32_t)pbBlock[i * 4] << 24)
+                   | ((uint32_t)pbBlock[i * 4 + 1] << 16)
+                   | ((uint32_t)pbBlock[i * 4 + 2] << 8)
+                   | pbBlock[i * 4 + 3];
+    for (uint32_t i = 16; i < 64; i++)
+    {
+        uint32_t s0 = SHA256_ROR(au32W[i - 15], 7) ^ SHA256_ROR(au32W[i - 15], 18) ^ (au32W[i - 15] >> 3);
+        uint32_t s1 = SHA256_ROR(au32W[i - 2], 17) ^ SHA256_ROR(au32W[i - 2], 19) ^ (au32W[i - 2] >> 10);
+        au32W[i] = au32W[i - 16] + s0 + au32W[i - 7] + s1;
+    }
+
+    uint32_t a = pCtx->au32H[0];
+    uint32_t b = pCtx->au32H[1];
+    uint32_t c = pCtx->au32H[2];
+    uint32_t d = pCtx->au32H[3];
+    uint32_t e = pCtx->au32H[4];
+    uint32_t f = pCtx->au32H[5];
+    uint32_t g = pCtx->au32H[6];
+    uint32_t h = pCtx->au32H[7];
+
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        uint32_t S1 = SHA256_ROR(e, 6) ^ SHA256_ROR(e, 11) ^ SHA256_ROR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + S1 + ch + g_au32Sha256K[i] + au32W[i];
+        uint32_t S0 = SHA256_ROR(a, 2) ^ SHA256_ROR(a, 13) ^ SHA256_ROR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = S0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    pCtx->au32H[0] += a;
+    pCtx->au32H[1] += b;
+    pCtx->au32H[2] += c;
+    pCtx->au32H[3] += d;
+    pCtx->au32H[4] += e;
+    pCtx->au32H[5] += f;
+    pCtx->au32H[6] += g;
+    pCtx->au32H[7] += h;
+}
+
+void SHA256Init(PSHA256CTX pCtx)
+{
+    pCtx->au32H[0] = 0x6a09e667;
+    pCtx->au32H[1] = 0xbb67ae85;
+    pCtx->au32H[2] = 0x3c6ef372;
+    pCtx->au32H[3] = 0xa54ff53a;
+    pCtx->au32H[4] = 0x510e527f;
+    pCtx->au32H[5] = 0x9b05688c;
+    pCtx->au32H[6] = 0x1f83d9ab;
+    pCtx->au32H[7] = 0x5be0cd19;
+    pCtx->cbTotal  = 0;
+    pCtx->cbBlock  = 0;
+}
+
+void SHA256Update(PSHA256CTX pCtx, const void *pvBuf, size_t cbBuf)
+{
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+
+    pCtx->cbTotal += cbBuf;
+
+    /* Complete a partial block first. */
+    if (pCtx->cbBlock)
+    {
+        size_t cbThis = SHA256_BLOCK_SIZE - pCtx->cbBlock;
+        if (cbThis > cbBuf)
+            cbThis = cbBuf;
+
+        memcpy(&pCtx->abBlock[pCtx->cbBlock], pbBuf, cbThis);
+        pCtx->cbBlock += cbThis;
+        pbBuf         += cbThis;
+        cbBuf         -= cbThis;
+        if (pCtx->cbBlock < SHA256_BLOCK_SIZE)
+            return;
+
+        sha256Block(pCtx, &pCtx->abBlock[0]);
+        pCtx->cbBlock = 0;
+    }
+
+    /* Full blocks are processed in place. */
+    while (cbBuf >= SHA256_BLOCK_SIZE)
+    {
+        sha256Block(pCtx, pbBuf);
+        pbBuf += SHA256_BLOCK_SIZE;
+        cbBuf -= SHA256_BLOCK_SIZE;
+    }
+
+    if (cbBuf)
+    {
+        memcpy(&pCtx->abBlock[0], pbBuf, cbBuf);
+        pCtx->cbBlock = cbBuf;
+    }
+}
+
+void SHA256Final(PSHA256CTX pCtx, uint8_t *pbDigest)
+{
+    uint64_t cBitsTotal = pCtx->cbTotal * 8;
+
+    /* Append the 1 bit and pad with zeros until there are 8 bytes left for the length. */
+    pCtx->abBlock[pCtx->cbBlock++] = 0x80;
+    if (pCtx->cbBlock > SHA256_BLOCK_SIZE - 8)
+    {
+        memset(&pCtx->abBlock[pCtx->cbBlock], 0, SHA256_BLOCK_SIZE - pCtx->cbBlock);
+        sha256Block(pCtx, &pCtx->abBlock[0]);
+        pCtx->cbBlock = 0;
+    }
+
+    memset(&pCtx->abBlock[pCtx->cbBlock], 0, SHA256_BLOCK_SIZE - 8 - pCtx->cbBlock);
+    for (uint32_t i = 0; i < 8; i++)
+        pCtx->abBlock[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(cBitsTotal >> (i * 8));
+    sha256Block(pCtx, &pCtx->abBlock[0]);
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        pbDigest[i * 4]     = (uint8_t)(pCtx->au32H[i] >> 24);
+        pbDigest[i * 4 + 1] = (uint8_t)(pCtx->au32H[i] >> 16);
+        pbDigest[i * 4 + 2] = (uint8_t)(pCtx->au32H[i] >> 8);
+        pbDigest[i * 4 + 3] = (uint8_t)pCtx->au32H[i];
+    }
+}
@@ -99,3 +99,17 @@ void memcpy(void *pvDst, const void *pvSrc, size_t cb)
     }
 }
 
+
+int memcmp(const void *pv1, const void *pv2, size_t cb)
+{
+    const uint8_t *pb1 = (const uint8_t *)pv1;
+    const uint8_t *pb2 = (const uint8_t *)pv2;
+
+    for (size_t i = 0; i < cb; i++)
+    {
+        if (pb1[i] != pb2[i])
+            return pb1[i] < pb2[i] ? -1 : 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/** @file
+ * PSP app - x86 memory and register poll throughput benchmarks.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <string.h>
+#include <err.h>
+
+#include "psp-serial-stub-internal.h"
+
+
+/*
+ * The benchmark copies the range between the x86 mapping windows and a buffer on the PSP,
+ * the transport channel is not involved so the result reflects what the PSP itself sees
+ * for the selected memory type. The mapping of a window is reused for all chunks of that
+ * window and only the copies are timed, not the mapping setup. With the CCP the windows
+ * aren't involved at all, each buffer sized chunk is a separate submission to the queue.
+ *
+ * The register poll benchmark times the map, read and unmap sequence a register read request
+ * goes through, so it shows what the SMN mapping cache saves. Without the cache the unreferenced
+ * mappings are flushed after every read, which programs the slot control register twice per
+ * read like the map/unmap pair did before the cache existed.
+ */
+
+
+/**
+ * Copies the given window chunk from/to the buffer.
+ *
+ * @returns nothing.
+ * @param   pbMap                   The mapped chunk.
+ * @param   cbChunk                 Size of the chunk in bytes.
+ * @param   fWrite                  Flag whether to write the buffer to the chunk.
+ * @param   pbBuf                   The buffer.
+ * @param   cbBuf                   Size of the buffer in bytes.
+ */
+static void pspStubBenchCopyChunk(uint8_t *pbMap, size_t cbChunk, bool fWrite, uint8_t *pbBuf, size_t cbBuf)
+{
+    while (cbChunk)
+    {
+        size_t cbThisCopy = MIN(cbChunk, cbBuf);
+
+        if (fWrite)
+            memcpy(pbMap, pbBuf, cbThisCopy);
+        else
+            memcpy(pbBuf, pbMap, cbThisCopy);
+
+        pbMap   += cbThisCopy;
+        cbChunk -= cbThisCopy;
+    }
+}
+
+
+/**
+ * Copies the given range from/to the buffer through the CCP.
+ *
+ * @returns Status code.
+ * @param   PhysX86Start            Start x86 physical address of the range.
+ * @param   cbRange                 Size of the range in bytes.
+ * @param   fWrite                  Flag whether to write the buffer to the range.
+ * @param   pvBuf                   The buffer.
+ * @param   cbBuf                   Size of the buffer in bytes.
+ */
+static int pspStubBenchCopyCcp(X86PADDR PhysX86Start, uint32_t cbRange, bool fWrite, void *pvBuf, size_t cbBuf)
+{
+    int rc = INF_SUCCESS;
+
+    while (   cbRange
+           && !rc)
+    {
+        size_t cbThisCopy = MIN(cbRange, cbBuf);
+
+        rc = pspSerialStubCcpX86Copy(PhysX86Start, pvBuf, cbThisCopy, fWrite);
+        PhysX86Start += cbThisCopy;
+        cbRange      -= cbThisCopy;
+    }
+
+    return rc;
+}
+
+
+int pspSerialStubBenchX86Mem(X86PADDR PhysX86Start, uint32_t cbRange, bool fMmio, uint32_t uMemType, bool fWrite,
+                             bool fCcp, uint32_t cPasses, void *pvBuf, size_t cbBuf, uint64_t *pcMicros)
+{
+    int rc = INF_SUCCESS;
+    uint64_t cMicros = 0;
+
+    if (   !cbBuf
+        || (   cbRange
+            && cbRange - 1 > UINT64_MAX - PhysX86Start))
+        return ERR_INVALID_PARAMETER;
+
+    for (uint32_t iPass = 0; iPass < cPasses && !rc; iPass++)
+    {
+        if (fCcp)
+        {
+            uint64_t tsStart = pspSerialStubGetMicros();
+            rc = pspStubBenchCopyCcp(PhysX86Start, cbRange, fWrite, pvBuf, cbBuf);
+            cMicros += pspSerialStubGetMicros() - tsStart;
+            continue;
+        }
+
+        X86PADDR PhysX86Cur = PhysX86Start;
+        uint32_t cbLeft = cbRange;
+
+        while (cbLeft)
+        {
+            void *pvMap = NULL;
+            size_t cbChunk = MIN(cbLeft, _64M - (PhysX86Cur & (_64M - 1)));
+
+            rc = pspSerialStubX86PhysMapEx(PhysX86Cur, fMmio, uMemType, &pvMap);
+            if (rc)
+                break;
+
+            uint64_t tsStart = pspSerialStubGetMicros();
+            pspStubBenchCopyChunk((uint8_t *)pvMap, cbChunk, fWrite, (uint8_t *)pvBuf, cbBuf);
+            cMicros += pspSerialStubGetMicros() - tsStart;
+
+            pspSerialStubX86PhysUnmapByPtr(pvMap);
+            PhysX86Cur += cbChunk;
+            cbLeft     -= cbChunk;
+        }
+    }
+
+    if (!rc)
+        *pcMicros = cMicros;
+
+    return rc;
+}
+
+
+int pspSerialStubBenchSmnPoll(uint32_t idDie, SMNADDR SmnAddr, bool fNoCache, uint32_t cPolls, uint64_t *pcMicros)
+{
+    int rc = INF_SUCCESS;
+
+    /* Start from a cold cache in both modes. */
+    pspSerialStubSmnFlush();
+
+    uint64_t tsStart = pspSerialStubGetMicros();
+    for (uint32_t i = 0; i < cPolls && !rc; i++)
+    {
+        void *pvMap = NULL;
+
+        rc = pspSerialStubSmnMapEx(idDie, SmnAddr, &pvMap);
+        if (rc)
+            break;
+
+        (void)*(volatile uint32_t *)pvMap;
+        pspSerialStubSmnUnmapByPtr(pvMap);
+        if (fNoCache)
+            pspSerialStubSmnFlush();
+    }
+    uint64_t cMicros = pspSerialStubGetMicros() - tsStart;
+
+    if (!rc)
+        *pcMicros = cMicros;
+
+    return rc;
+}
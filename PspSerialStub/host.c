@@ -0,0 +1,200 @@
+/** @file
+ * PSP app - Glue for running the serial stub as a regular Linux process.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <psp-stub/cm-if.h>
+
+#include "../Lib/include/err.h"
+#include "../Lib/include/checkpoint.h"
+
+
+/*
+ * The stub addresses MMIO registers, the SMN/x86 mapping windows and the code module load area
+ * through plain pointers and hands out 32bit PSP addresses to the host tools. To keep all of this working
+ * the host process reserves the part of the PSP address space the stub uses as ordinary anonymous
+ * memory at the identical addresses. The binary itself is linked above this range (see the Makefile).
+ * Registers are just memory here, so only the transport channel talking to the outside world is functional.
+ */
+
+/** Start of the emulated PSP address space (the first page is left alone to catch NULL pointers). */
+#define PSP_HOST_ADDR_SPACE_START           0x00010000
+/** End of the emulated PSP address space (end of the last x86 mapping window). */
+#define PSP_HOST_ADDR_SPACE_END             0x40000000
+
+
+/** Start timestamp for the emulated timer. */
+static uint64_t g_tsStart;
+
+
+extern void pspStubHostMain(void);
+
+
+/**
+ * Returns the current monotonic timestamp.
+ *
+ * @returns Timestamp in nanoseconds.
+ */
+static uint64_t pspStubHostNanoTS(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000 + Ts.tv_nsec;
+}
+
+
+/**
+ * Returns the counter value of the emulated PSP timer.
+ *
+ * @returns Counter value in 10ns ticks, wraps around like the real counter.
+ */
+uint32_t pspStubHostTimerCntRead(void)
+{
+    return (uint32_t)((pspStubHostNanoTS() - g_tsStart) / 10);
+}
+
+
+bool PSPCheckPointSet(PPSPCHCKPT pChkPt)
+{
+    /* There is no way back after a fault on the host, the process just dies. */
+    memset(pChkPt, 0, sizeof(*pChkPt));
+    return true;
+}
+
+
+void pspSerialStubCoProcWriteAsm(uint32_t u32Val)
+{
+    /* Never called, the request is rejected on the host. */
+    (void)u32Val;
+}
+
+
+uint32_t pspSerialStubCoProcReadAsm(void)
+{
+    return 0;
+}
+
+
+void pspStubBranchToAsm(uint32_t PspAddrPc, const uint32_t *pau32Gprs)
+{
+    (void)pau32Gprs;
+    fprintf(stderr, "Branch to %#x requested, exiting\n", PspAddrPc);
+    exit(0);
+}
+
+
+/*
+ * The burst helpers from utils.S, the host has no ldm/stm so just copy words.
+ */
+
+void pspStubBurstCopyAsm(void *pvDst, const void *pvSrc, size_t cBlocks)
+{
+    volatile uint32_t *pu32Dst = (volatile uint32_t *)pvDst;
+    const volatile uint32_t *pu32Src = (const volatile uint32_t *)pvSrc;
+
+    for (size_t i = 0; i < cBlocks * 8; i++)
+        pu32Dst[i] = pu32Src[i];
+}
+
+
+void pspStubBurstFillAsm(void *pvDst, const uint32_t *pau32Pattern, size_t cBlocks)
+{
+    volatile uint32_t *pu32Dst = (volatile uint32_t *)pvDst;
+
+    for (size_t i = 0; i < cBlocks * 8; i++)
+        pu32Dst[i] = pau32Pattern[i % 8];
+}
+
+
+/*
+ * The code module interface thunks, unused as code modules are never executed on the host.
+ */
+
+size_t pspStubCmIfInBufPeekAsm(PCCMIF pCmIf, uint32_t idInBuf)
+{
+    (void)pCmIf; (void)idInBuf;
+    return 0;
+}
+
+
+int pspStubCmIfInBufPollAsm(PCCMIF pCmIf, uint32_t idInBuf, uint32_t cMillies)
+{
+    (void)pCmIf; (void)idInBuf; (void)cMillies;
+    return ERR_NOT_IMPLEMENTED;
+}
+
+
+int pspStubCmIfInBufReadAsm(PCCMIF pCmIf, uint32_t idInBuf, void *pvBuf, size_t cbRead, size_t *pcbRead)
+{
+    (void)pCmIf; (void)idInBuf; (void)pvBuf; (void)cbRead; (void)pcbRead;
+    return ERR_NOT_IMPLEMENTED;
+}
+
+
+int pspStubCmIfOutBufWriteAsm(PCCMIF pCmIf, uint32_t idOutBuf, const void *pvBuf, size_t cbWrite, size_t *pcbWritten)
+{
+    (void)pCmIf; (void)idOutBuf; (void)pvBuf; (void)cbWrite; (void)pcbWritten;
+    return ERR_NOT_IMPLEMENTED;
+}
+
+
+void pspStubCmIfDelayMsAsm(PCCMIF pCmIf, uint32_t cMillies)
+{
+    (void)pCmIf;
+    usleep(cMillies * 1000);
+}
+
+
+uint32_t pspStubCmIfTsGetMilliAsm(PCCMIF pCmIf)
+{
+    (void)pCmIf;
+    return (uint32_t)(pspStubHostNanoTS() / 1000000);
+}
+
+
+int main(int argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    void *pv = mmap((void *)PSP_HOST_ADDR_SPACE_START, PSP_HOST_ADDR_SPACE_END - PSP_HOST_ADDR_SPACE_START,
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE,
+                    -1, 0);
+    if (pv != (void *)PSP_HOST_ADDR_SPACE_START)
+    {
+        fprintf(stderr, "Reserving the PSP address space failed, check vm.mmap_min_addr and the link address\n");
+        return 1;
+    }
+
+    /* A disconnecting host tool must not kill the process, the transport channel handles the error. */
+    signal(SIGPIPE, SIG_IGN);
+
+    g_tsStart = pspStubHostNanoTS();
+    pspStubHostMain();
+    return 0;
+}
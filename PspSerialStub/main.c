@@ -29,54 +29,84 @@
 #include <checkpoint.h>
 #include <io.h>
 #include <uart.h>
+#include <cobs.h>
+#include <memsearch.h>
+#include <crc32.h>
+#include <sha256.h>
+#include <map-mgr.h>
+#include <ccp.h>
 
 #include <common/status.h>
 #include <psp-stub/psp-serial-stub.h>
 #include <psp-stub/cm-if.h>
 
 #include "pdu-transp.h"
+#include "psp-serial-stub-internal.h"
+#include "psp-serial-stub-ext.h"
 
 /** Use the SPI message channel instead of the UART. */
 #define PSP_SERIAL_STUB_SPI_MSG_CHAN    1
+/** Probe all transport channels during startup and select the fastest one answering,
+ * the channel selected by PSP_SERIAL_STUB_SPI_MSG_CHAN is used if none answers. Off by default
+ * as it sets up the SuperIO UART and sends probe notifications on channels nobody might listen on. */
+/*#define PSP_SERIAL_STUB_TRANSP_PROBE    1*/
+/** Number of probe pattern bytes sent on each transport channel. */
+#define PSP_SERIAL_STUB_TRANSP_PROBE_SZ 512
+/** How long to wait for the host to echo the probe on a single transport channel in milliseconds. */
+#define PSP_SERIAL_STUB_TRANSP_PROBE_TIMEOUT_MS 1000
+/** Adds the shared x86 DRAM mailbox to the transport channels probed with PSP_SERIAL_STUB_TRANSP_PROBE, only enable
+ * if the x86 side is up when the stub starts and the host reserved the mailbox region (see pdu-transp-x86-dram.c). */
+/*#define PSP_SERIAL_STUB_X86_DRAM_MBX    1*/
+/** Routes the log output into a dedicated channel (a transport channel ID from g_aLogTransp) instead of
+ * sending log notifications over the PDU channel. Logs are buffered and only written out when the stub is idle,
+ * if the buffer is full new messages are dropped. Falls back to log notifications if the channel
+ * is the one used for PDUs or can't be initialized. */
+/*#define PSP_SERIAL_STUB_LOG_CHAN        PSPSERIALTRANSPID_SPI_LOG*/
+/** Size of the log buffer for the dedicated log channel. */
+#define PSP_SERIAL_STUB_LOG_BUF_SZ      _4K
+/** Maximum number of bytes written to the log channel at once before checking for new PDUs again. */
+#define PSP_SERIAL_STUB_LOG_DRAIN_SZ    64
+/** Frames every PDU with COBS (zero byte delimited frames) on top of the header/footer magics, so the receiver
+ * is back in sync with the next PDU after dropped or corrupted bytes instead of waiting for a timeout.
+ * Meant for noisy UART links, the host side has to use the same framing. */
+/*#define PSP_SERIAL_STUB_COBS_FRAMING    1*/
 /** Disables use of the hardware timers with the downside to not have accurate timekeeping. */
 /*#define PSP_STUB_NO_HW_TIMER            1*/
+/** Number of sockets in the system, can't be detected reliably from the boot ROM service page. */
+#ifndef PSP_SERIAL_STUB_SOCKET_COUNT
+# define PSP_SERIAL_STUB_SOCKET_COUNT   1
+#endif
+/** Number of dies (CCDs in the protocol) per socket. Requests designated for the other dies are served
+ * from this PSP through the SMN mapping slots, so only SMN and x86 accesses work for them. */
+#ifndef PSP_SERIAL_STUB_CCDS_PER_SOCKET
+# define PSP_SERIAL_STUB_CCDS_PER_SOCKET 1
+#endif
 
 /** Indefinite wait. */
 #define PSP_SERIAL_STUB_INDEFINITE_WAIT 0xffffffff
-
-
-/**
- * x86 memory mapping slot.
- */
-typedef struct PSPX86MAPPING
-{
-    /** The base X86 address being mapped (aligned to a 64MB boundary). */
-    X86PADDR                PhysX86AddrBase;
-    /** The memory type being used. */
-    uint32_t                uMemType;
-    /** Reference counter for this mapping, the mapping gets cleaned up if it reaches 0. */
-    uint32_t                cRefs;
-} PSPX86MAPPING;
-/** Pointer to an x86 memory mapping slot. */
-typedef PSPX86MAPPING *PPSPX86MAPPING;
-/** Pointer to a const x86 memory mapping slot. */
-typedef const PSPX86MAPPING *PCPSPX86MAPPING;
-
-
-/**
- * SMN mapping slot.
- */
-typedef struct PSPSMNMAPPING
-{
-    /** Base SMN address being mapped (aligned to a 1MB boundary). */
-    SMNADDR                 SmnAddrBase;
-    /* Reference counter for this mapping, the mapping gets cleand up if it reaches 0. */
-    uint32_t                cRefs;
-} PSPSMNMAPPING;
-/** Pointer to a SMN mapping slot. */
-typedef PSPSMNMAPPING *PPSPSMNMAPPING;
-/** Pointer to a const SMN mapping slot. */
-typedef const PSPSMNMAPPING *PCPSPSMNMAPPING;
+/** Maximum number of mapping windows which can be pinned at the same time. */
+#define PSP_SERIAL_STUB_MAP_PIN_MAX     8
+/** Maximum number of data bytes sent in a single range read notification. */
+#define PSP_SERIAL_STUB_MEM_RANGE_CHUNK_SZ (2 * _1K)
+/** Maximum timeout of a poll request in microseconds, the stub doesn't serve anything else while polling. */
+#define PSP_SERIAL_STUB_POLL_TIMEOUT_MAX_US (10 * 1000 * 1000)
+/** Maximum number of PSP memory bytes hashed in one go by the digest request, keeps the chunk size within size_t. */
+#define PSP_SERIAL_STUB_DIGEST_CHUNK_MAX _1M
+/** Maximum number of snapshots which can exist at the same time. */
+#define PSP_SERIAL_STUB_SNAPSHOT_MAX    4
+/** Maximum number of blocks a single snapshot can track. */
+#define PSP_SERIAL_STUB_SNAPSHOT_BLOCKS_MAX 512
+/** The CCP queue used for copies, the firmware isn't running while the stub is so the first one is free. */
+#define PSP_SERIAL_STUB_CCP_QUEUE       0
+/** Maximum number of addresses on the watchlist. */
+#define PSP_SERIAL_STUB_WATCH_MAX       16
+/** Default watchlist sampling interval in milliseconds. */
+#define PSP_SERIAL_STUB_WATCH_INTERVAL_DEF_MS 10
+
+#ifdef PSP_SERIAL_STUB_HOST
+/* The host build only talks over the unix socket channel which can't be probed without dropping the connection. */
+# undef PSP_SERIAL_STUB_TRANSP_PROBE
+#endif
 
 
 /**
@@ -95,6 +125,76 @@ typedef struct PSPTIMER
 typedef PSPTIMER *PPSPTIMER;
 
 
+/**
+ * Pinned mapping window.
+ */
+typedef struct PSPSTUBMAPPIN
+{
+    /** The address space of the window, PSPADDRSPACE_INVALID if the entry is free. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Size of the window in bytes. */
+    uint32_t                    cbWindow;
+    /** The window base address. */
+    uint64_t                    uAddrBase;
+    /** Start of the window in the PSP address space. */
+    uint8_t                     *pbMap;
+} PSPSTUBMAPPIN;
+/** Pointer to a pinned mapping window. */
+typedef PSPSTUBMAPPIN *PPSPSTUBMAPPIN;
+
+
+/**
+ * Snapshot of a range, remembering the CRC32 of every block.
+ */
+typedef struct PSPSTUBSNAPSHOT
+{
+    /** The address space of the range, PSPADDRSPACE_INVALID if the entry is free. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** The die the range is read from. */
+    uint32_t                    idCcd;
+    /** The x86 memory type to map the range with. */
+    uint32_t                    uMemType;
+    /** Flag whether au32Crc holds valid values, cleared until the first update. */
+    bool                        fBaseline;
+    /** Start address of the range. */
+    uint64_t                    u64AddrStart;
+    /** Size of the range in bytes. */
+    uint64_t                    cbRange;
+    /** Block size in bytes. */
+    uint32_t                    cbBlock;
+    /** Number of blocks. */
+    uint32_t                    cBlocks;
+    /** CRC32 of every block as of the last update. */
+    uint32_t                    au32Crc[PSP_SERIAL_STUB_SNAPSHOT_BLOCKS_MAX];
+} PSPSTUBSNAPSHOT;
+/** Pointer to a snapshot. */
+typedef PSPSTUBSNAPSHOT *PPSPSTUBSNAPSHOT;
+
+
+/**
+ * Watched address.
+ */
+typedef struct PSPSTUBWATCH
+{
+    /** The address space of the address, PSPADDRSPACE_INVALID if the entry is free. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** The die the address is read from. */
+    uint32_t                    idCcd;
+    /** Caching flags for the x86 address spaces. */
+    uint32_t                    fCaching;
+    /** Access width in bytes. */
+    uint32_t                    cbAccess;
+    /** The address. */
+    uint64_t                    u64Addr;
+    /** Mask applied to the value read. */
+    uint64_t                    u64Mask;
+    /** The masked value of the last sample. */
+    uint64_t                    u64ValLast;
+} PSPSTUBWATCH;
+/** Pointer to a watched address. */
+typedef PSPSTUBWATCH *PPSPSTUBWATCH;
+
+
 /**
  * Input buffer related state.
  */
@@ -151,6 +251,22 @@ typedef enum PSPSTUBEXCP
 } PSPSTUBEXCP;
 
 
+/**
+ * Transport channel descriptor.
+ */
+typedef struct PSPSTUBTRANSPDESC
+{
+    /** The transport channel ID reported to the host. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** The transport channel interface. */
+    PCPSPPDUTRANSPIF            pIfTransp;
+} PSPSTUBTRANSPDESC;
+/** Pointer to a transport channel descriptor. */
+typedef PSPSTUBTRANSPDESC *PPSPSTUBTRANSPDESC;
+/** Pointer to a const transport channel descriptor. */
+typedef const PSPSTUBTRANSPDESC *PCPSPSTUBTRANSPDESC;
+
+
 /**
  * Global stub instance.
  */
@@ -168,12 +284,12 @@ typedef struct PSPSTUBSTATE
     PCPSPPDUTRANSPIF            pIfTransp;
     /** Handle to the PDU transport channel. */
     PSPPDUTRANSP                hPduTransp;
+    /** ID of the selected transport channel. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** Measured bandwidth of the selected transport channel in bytes per second, 0 if not probed. */
+    uint32_t                    cbPerSecTransp;
     /** Private transport channel instance data. */
     uint8_t                     abTranspData[128];
-    /** x86 mapping bookkeeping data. */
-    PSPX86MAPPING               aX86MapSlots[15];
-    /** SMN mapping bookkeeping data. */
-    PSPSMNMAPPING               aSmnMapSlots[32];
     /** Number of CCDs detected. */
     uint32_t                    cCcds;
     /** Flag whether someone is connected. */
@@ -212,13 +328,67 @@ typedef struct PSPSTUBSTATE
     /** Pending exception. */
     PSPSTUBEXCP                 enmExcpPending;
     /** Padding to 16byte boundary. */
-    uint8_t                     abPad0[12];
+    uint8_t                     abPad0[4];
     /** The PDU receive buffer. */
     uint8_t                     abPdu[_4K];
     /** The PDU response buffer. */
     uint8_t                     abPduResp[_4K];
-    /** Scratch space. */
+    /** Scratch space, handed out to the host in the connect response. */
     uint8_t                     abScratch[16 * _1K];
+    /** Staging buffer for the request handlers, never handed out to the host unlike abScratch. */
+    uint8_t                     abStaging[16 * _1K];
+    /** The x86 and SMN mapping manager. */
+    MAPMGR                      MapMgr;
+    /** Windows pinned by the host, indexed by the pin handle. */
+    PSPSTUBMAPPIN               aMapPins[PSP_SERIAL_STUB_MAP_PIN_MAX];
+    /** The CCD the request currently being processed is designated for. */
+    uint32_t                    idCcdReq;
+    /** Snapshots created by the host, indexed by the snapshot ID. */
+    PSPSTUBSNAPSHOT             aSnapshots[PSP_SERIAL_STUB_SNAPSHOT_MAX];
+    /** The watchlist, indexed by the watch ID. */
+    PSPSTUBWATCH                aWatches[PSP_SERIAL_STUB_WATCH_MAX];
+    /** Number of watches in use. */
+    uint32_t                    cWatches;
+    /** Watchlist sampling interval in milliseconds, 0 if sampling is paused. */
+    uint32_t                    cMsWatchInterval;
+    /** Millisecond timestamp of the last watchlist sample. */
+    uint32_t                    tsWatchLast;
+    /** The CCP copy engine for x86 copies. */
+    CCP                         Ccp;
+#ifdef PSP_SERIAL_STUB_HOST
+    /** The simulated mapping registers the mapping manager works on in the host build. */
+    MAPMGRREGSIM                MapRegSim;
+    /** The simulated CCP queue the copy engine works on in the host build. */
+    CCPSIM                      CcpSim;
+#endif
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+    /** The dedicated log channel, NULL if logs are sent as notifications over the PDU channel. */
+    PCPSPPDUTRANSPIF            pIfTranspLog;
+    /** Handle to the dedicated log channel. */
+    PSPPDUTRANSP                hPduTranspLog;
+    /** Read offset into the log buffer. */
+    uint32_t                    offLogBufRead;
+    /** Number of bytes in the log buffer. */
+    uint32_t                    cbLogBuf;
+    /** Number of log bytes dropped because the buffer was full. */
+    uint32_t                    cbLogDropped;
+    /** Private log channel instance data. */
+    uint8_t                     abTranspLogData[128];
+    /** Log buffer. */
+    uint8_t                     abLogBuf[PSP_SERIAL_STUB_LOG_BUF_SZ];
+#endif
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+    /** COBS encoder for sent PDUs. */
+    COBSENC                     CobsEnc;
+    /** COBS decoder for received PDUs, decodes straight into abPdu. */
+    COBSDEC                     CobsDec;
+    /** Offset of the next byte to feed into the decoder. */
+    uint32_t                    offCobsRecv;
+    /** Number of valid bytes in abCobsRecv. */
+    uint32_t                    cbCobsRecv;
+    /** Received bytes not fed into the decoder yet. */
+    uint8_t                     abCobsRecv[64];
+#endif
 } PSPSTUBSTATE;
 /** Pointer to the binary loader state. */
 typedef PSPSTUBSTATE *PPSPSTUBSTATE;
@@ -227,6 +397,11 @@ typedef PSPSTUBSTATE *PPSPSTUBSTATE;
 _Static_assert((__builtin_offsetof(PSPSTUBSTATE, abPdu) & 0xf) == 0);
 _Static_assert((__builtin_offsetof(PSPSTUBSTATE, abPduResp) & 0xf) == 0);
 _Static_assert((__builtin_offsetof(PSPSTUBSTATE, abScratch) & 0xf) == 0);
+_Static_assert((__builtin_offsetof(PSPSTUBSTATE, abStaging) & 0xf) == 0);
+_Static_assert(  sizeof(PSPSERIALMAPSLOTSTATSRESP)
+               + (MAPMGR_X86_SLOT_COUNT + MAPMGR_SMN_SLOT_COUNT) * sizeof(PSPSERIALMAPSLOTSTATS)
+               <= sizeof(((PPSPSTUBSTATE)0)->abPduResp));
+_Static_assert(PSP_SERIAL_STUB_SOCKET_COUNT * PSP_SERIAL_STUB_CCDS_PER_SOCKET <= MAPMGR_SMN_DIE_COUNT);
 #endif
 
 
@@ -260,16 +435,39 @@ static PSPCHCKPT g_ChkPt;
 extern const PSPPDUTRANSPIF g_UartTransp;
 extern const PSPPDUTRANSPIF g_SpiFlashTransp;
 extern const PSPPDUTRANSPIF g_SpiFlashTranspEm100;
+extern const PSPPDUTRANSPIF g_X86DramTransp;
+extern const PSPPDUTRANSPIF g_SpiLogTransp;
+#ifdef PSP_SERIAL_STUB_HOST
+extern const PSPPDUTRANSPIF g_UnixSocketTransp;
+#endif
 
 /**
  * Available transport channels.
  */
-static PCPSPPDUTRANSPIF g_aPduTransp[] =
+static const PSPSTUBTRANSPDESC g_aPduTransp[] =
+{
+#ifdef PSP_SERIAL_STUB_HOST
+    { PSPSERIALTRANSPID_UNIX,      &g_UnixSocketTransp    },
+#endif
+    { PSPSERIALTRANSPID_UART,      &g_UartTransp          },
+    { PSPSERIALTRANSPID_SPI_FLASH, &g_SpiFlashTransp      },
+    { PSPSERIALTRANSPID_SPI_EM100, &g_SpiFlashTranspEm100 },
+#ifdef PSP_SERIAL_STUB_X86_DRAM_MBX
+    { PSPSERIALTRANSPID_X86_DRAM,  &g_X86DramTransp       }
+#endif
+};
+
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+/**
+ * Channels usable for logging.
+ */
+static const PSPSTUBTRANSPDESC g_aLogTransp[] =
 {
-    &g_UartTransp,
-    &g_SpiFlashTransp,
-    &g_SpiFlashTranspEm100
+    { PSPSERIALTRANSPID_SPI_LOG,   &g_SpiLogTransp        },
+    { PSPSERIALTRANSPID_UART,      &g_UartTransp          },
+    { PSPSERIALTRANSPID_X86_DRAM,  &g_X86DramTransp       }
 };
+#endif
 
 
 extern size_t pspStubCmIfInBufPeekAsm(PCCMIF pCmIf, uint32_t idInBuf);
@@ -284,249 +482,238 @@ extern uint32_t pspSerialStubCoProcReadAsm(void);
 
 extern void pspStubBranchToAsm(uint32_t PspAddrPc, const uint32_t *pau32Gprs) __attribute__((noreturn));
 
+extern void pspStubBurstCopyAsm(void *pvDst, const void *pvSrc, size_t cBlocks);
+extern void pspStubBurstFillAsm(void *pvDst, const uint32_t *pau32Pattern, size_t cBlocks);
+
+#ifdef PSP_SERIAL_STUB_HOST
+extern uint32_t pspStubHostTimerCntRead(void);
+#endif
+
 static int pspStubPduProcess(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR pPdu);
 static void pspStubIrqProcess(PPSPSTUBSTATE pThis);
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+static void pspStubLogDrain(PPSPSTUBSTATE pThis);
+#endif
 
 
 /**
- * Maps the given x86 physical address into the PSP address space.
+ * Waits for all outstanding memory accesses to finish and flushes the pipeline.
  *
- * @returns Status code.
- * @param   pThis                   The serial stub instance data.
- * @param   PhysX86Addr             The x86 physical address to map.
- * @param   fMmio                   Flag whether this a MMIO address.
- * @param   ppv                     Where to store the pointer to the mapping on success.
+ * @returns nothing.
  */
-static int pspStubX86PhysMap(PPSPSTUBSTATE pThis, X86PADDR PhysX86Addr, bool fMmio, void **ppv)
+static inline void pspStubMemSync(void)
 {
-    int rc = INF_SUCCESS;
-    uint32_t uMemType = fMmio ? 0x6 : 0x4;
-
-    /* Split physical address into 64MB aligned base and offset. */
-    X86PADDR PhysX86AddrBase = (PhysX86Addr & ~(_64M - 1));
-    uint32_t offStart = PhysX86Addr - PhysX86AddrBase;
-
-    PPSPX86MAPPING pMapping = NULL;
-    uint32_t idxSlot = 0;
-    for (uint32_t i = fMmio ? 8 : 0; i < ELEMENTS(pThis->aX86MapSlots); i++)
-    {
-        if (   (   pThis->aX86MapSlots[i].PhysX86AddrBase == NIL_X86PADDR
-                && pThis->aX86MapSlots[i].cRefs == 0)
-            || (   pThis->aX86MapSlots[i].PhysX86AddrBase == PhysX86AddrBase
-                && pThis->aX86MapSlots[i].uMemType == uMemType))
-        {
-            pMapping = &pThis->aX86MapSlots[i];
-            idxSlot = i;
-            break;
-        }
-    }
+#ifndef PSP_SERIAL_STUB_HOST
+    asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
+#endif
+}
 
-    if (pMapping)
-    {
-        if (pMapping->PhysX86AddrBase == NIL_X86PADDR)
-        {
-            /* Set up the mapping. */
-            pMapping->uMemType         = uMemType;
-            pMapping->PhysX86AddrBase  = PhysX86AddrBase;
 
-            /* Program base address. */
-            PSPADDR PspAddrSlotBase = 0x03230000 + idxSlot * 4 * sizeof(uint32_t);
-            *(volatile uint32_t *)PspAddrSlotBase        = ((PhysX86AddrBase >> 32) << 6) | ((PhysX86AddrBase >> 26) & 0x3f);
-            *(volatile uint32_t *)(PspAddrSlotBase + 4)  = 0x12; /* Unknown but fixed value. */
-            *(volatile uint32_t *)(PspAddrSlotBase + 8)  = uMemType;
-            *(volatile uint32_t *)(PspAddrSlotBase + 12) = uMemType;
-            *(volatile uint32_t *)(0x032303e0 + idxSlot * sizeof(uint32_t)) = 0xffffffff;
-            *(volatile uint32_t *)(0x032304d8 + idxSlot * sizeof(uint32_t)) = 0xc0000000;
-            *(volatile uint32_t *)0x32305ec = 0x3333;
-        }
+/**
+ * Masks IRQs and FIQs, returning the previous state.
+ *
+ * @returns The previous CPSR to pass to pspStubIrqRestore().
+ */
+static inline uint32_t pspStubIrqSave(void)
+{
+    uint32_t fCpsr = 0;
+#ifndef PSP_SERIAL_STUB_HOST
+    asm volatile("mrs %0, cpsr\n"
+                 "cpsid if\n": "=r" (fCpsr) : :"memory");
+#endif
+    return fCpsr;
+}
 
-        asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
-        pMapping->cRefs++;
-        *ppv = (void *)(0x04000000 + idxSlot * _64M + offStart);
-    }
-    else
-        rc = ERR_INVALID_STATE;
 
-    return rc;
+/**
+ * Restores the IRQ and FIQ mask state saved with pspStubIrqSave().
+ *
+ * @returns nothing.
+ * @param   fCpsr                   The CPSR returned by pspStubIrqSave().
+ */
+static inline void pspStubIrqRestore(uint32_t fCpsr)
+{
+#ifndef PSP_SERIAL_STUB_HOST
+    asm volatile("msr cpsr_c, %0\n": : "r" (fCpsr) :"memory");
+#else
+    (void)fCpsr;
+#endif
 }
 
 
 /**
- * Unmaps a previously mapped x86 physical address.
+ * Releases the given pinned window.
  *
- * @returns Status code.
+ * @returns nothing.
  * @param   pThis                   The serial stub instance data.
- * @param   pv                      Pointer to the mapping as returned by a successful call to pspStubX86PhysMap().
+ * @param   pPin                    The pinned window to release.
  */
-static int pspStubX86PhysUnmapByPtr(PPSPSTUBSTATE pThis, void *pv)
+static void pspStubMapPinRelease(PPSPSTUBSTATE pThis, PPSPSTUBMAPPIN pPin)
 {
-    int rc = INF_SUCCESS;
-    uintptr_t PspAddrMapBase = ((uintptr_t)pv) & ~(_64M - 1);
-    PspAddrMapBase -= 0x04000000;
-
-    uint32_t idxSlot = PspAddrMapBase / _64M;
-    if (   idxSlot < ELEMENTS(pThis->aX86MapSlots)
-        && PspAddrMapBase % _64M == 0)
-    {
-        PPSPX86MAPPING pMapping = &pThis->aX86MapSlots[idxSlot];
-
-        asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
-        if (pMapping->cRefs > 0)
-        {
-            pMapping->cRefs--;
+    if (pPin->enmAddrSpace == PSPADDRSPACE_SMN)
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pPin->pbMap);
+    else if (pPin->enmAddrSpace != PSPADDRSPACE_INVALID)
+        MAPMgrX86PhysUnmapByPtr(&pThis->MapMgr, pPin->pbMap);
+
+    pPin->enmAddrSpace = PSPADDRSPACE_INVALID;
+    pPin->cbWindow     = 0;
+    pPin->uAddrBase    = 0;
+    pPin->pbMap        = NULL;
+}
 
-            /* Clear out the mapping if there is no reference held. */
-            if (!pMapping->cRefs)
-            {
-                pMapping->uMemType        = 0;
-                pMapping->PhysX86AddrBase = NIL_X86PADDR;
-
-                PSPADDR PspAddrSlotBase = 0x03230000 + idxSlot * 4 * sizeof(uint32_t);
-                *(volatile uint32_t *)PspAddrSlotBase        = 0;
-                *(volatile uint32_t *)(PspAddrSlotBase + 4)  = 0; /* Unknown but fixed value. */
-                *(volatile uint32_t *)(PspAddrSlotBase + 8)  = 0;
-                *(volatile uint32_t *)(PspAddrSlotBase + 12) = 0;
-                *(volatile uint32_t *)(0x032303e0 + idxSlot * sizeof(uint32_t)) = 0xffffffff;
-                *(volatile uint32_t *)(0x032304d8 + idxSlot * sizeof(uint32_t)) = 0;
-            }
-        }
-        else
-            rc = ERR_INVALID_PARAMETER;
-    }
-    else
-        rc = ERR_INVALID_PARAMETER;
 
-    return rc;
+/**
+ * Releases all pinned windows.
+ *
+ * @returns nothing.
+ * @param   pThis                   The serial stub instance data.
+ */
+static void pspStubMapPinReleaseAll(PPSPSTUBSTATE pThis)
+{
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aMapPins); i++)
+        pspStubMapPinRelease(pThis, &pThis->aMapPins[i]);
 }
 
 
 /**
- * Maps the given SMN address into the PSP address space.
+ * Checks that every mapping slot class still has a slot without references which can be evicted
+ * for the request handlers, pins on plain memory can end up in the MMIO capable slots as well.
  *
- * @returns Status code.
+ * @returns Flag whether each slot class has an evictable slot left.
  * @param   pThis                   The serial stub instance data.
- * @param   SmnAddr                 The SMN address to map.
- * @param   ppv                     Where to store the pointer to the mapping on success.
  */
-static int pspStubSmnMap(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, void **ppv)
+static bool pspStubMapPinSlotsEvictable(PPSPSTUBSTATE pThis)
 {
-    int rc = INF_SUCCESS;
+    uint32_t cX86MemFree  = 0;
+    uint32_t cX86MmioFree = 0;
+    uint32_t cSmnFree     = 0;
+    MAPMGRSLOTINFO Info;
 
-    /* Split physical address into 1MB aligned base and offset. */
-    SMNADDR  SmnAddrBase = (SmnAddr & ~(_1M - 1));
-    uint32_t offStart = SmnAddr - SmnAddrBase;
-
-    PPSPSMNMAPPING pMapping = NULL;
-    uint32_t idxSlot = 0;
-    for (uint32_t i = 0; i < ELEMENTS(pThis->aSmnMapSlots); i++)
+    for (uint32_t i = 0; i < MAPMGR_X86_SLOT_COUNT; i++)
     {
-        if (   (   pThis->aSmnMapSlots[i].SmnAddrBase == 0
-                && pThis->aSmnMapSlots[i].cRefs == 0)
-            || pThis->aSmnMapSlots[i].SmnAddrBase == SmnAddrBase)
+        MAPMgrX86SlotQuery(&pThis->MapMgr, i, &Info);
+        if (!Info.cRefs)
         {
-            pMapping = &pThis->aSmnMapSlots[i];
-            idxSlot = i;
-            break;
+            if (i < MAPMGR_X86_SLOT_MMIO_FIRST)
+                cX86MemFree++;
+            else
+                cX86MmioFree++;
         }
     }
 
-    if (pMapping)
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
     {
-        if (pMapping->SmnAddrBase == 0)
-        {
-            /* Set up the mapping. */
-            pMapping->SmnAddrBase = SmnAddrBase;
-
-            /* Program base address. */
-            PSPADDR PspAddrSlotBase = 0x03220000 + (idxSlot / 2) * sizeof(uint32_t);
-            uint32_t u32RegSmnMapCtrl = *(volatile uint32_t *)PspAddrSlotBase;
-            if (idxSlot & 0x1)
-                u32RegSmnMapCtrl |= ((SmnAddrBase >> 20) << 16);
-            else
-                u32RegSmnMapCtrl |= SmnAddrBase >> 20;
-            *(volatile uint32_t *)PspAddrSlotBase = u32RegSmnMapCtrl;
-        }
-
-        pMapping->cRefs++;
-        *ppv = (void *)(0x01000000 + idxSlot * _1M + offStart);
+        MAPMgrSmnSlotQuery(&pThis->MapMgr, i, &Info);
+        if (!Info.cRefs)
+            cSmnFree++;
     }
-    else
-        rc = ERR_INVALID_STATE;
 
-    //LogRel("pspStubSmnUnmapByPtr: SmnAddr=%#x -> rc=%d,pv=%p\n", SmnAddr, rc, *ppv);
-    return rc;
+    return cX86MemFree && cX86MmioFree && cSmnFree;
 }
 
 
 /**
- * Unmaps a previously mapped SMN address.
+ * Removes all watches from the watchlist.
  *
- * @returns Status code.
+ * @returns nothing.
  * @param   pThis                   The serial stub instance data.
- * @param   pv                      Pointer to the mapping as returned by a successful call to pspStubSmnMap().
  */
-static int pspStubSmnUnmapByPtr(PPSPSTUBSTATE pThis, void *pv)
+static void pspStubWatchRemoveAll(PPSPSTUBSTATE pThis)
 {
-    int rc = INF_SUCCESS;
-    uintptr_t PspAddrMapBase = ((uintptr_t)pv) & ~(_1M - 1);
-    PspAddrMapBase -= 0x01000000;
-
-    uint32_t idxSlot = PspAddrMapBase / _1M;
-    if (   idxSlot < ELEMENTS(pThis->aSmnMapSlots)
-        && PspAddrMapBase % _1M == 0)
-    {
-        PPSPSMNMAPPING pMapping = &pThis->aSmnMapSlots[idxSlot];
-
-        if (pMapping->cRefs > 0)
-        {
-            pMapping->cRefs--;
-
-            /* Clear out the mapping if there is no reference held. */
-            if (!pMapping->cRefs)
-            {
-                pMapping->SmnAddrBase = 0;
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aWatches); i++)
+        pThis->aWatches[i].enmAddrSpace = PSPADDRSPACE_INVALID;
+    pThis->cWatches = 0;
+}
 
-                PSPADDR PspAddrSlotBase = 0x03220000 + (idxSlot / 2) * sizeof(uint32_t);
-                uint32_t u32RegSmnMapCtrl = *(volatile uint32_t *)PspAddrSlotBase;
-                if (idxSlot & 0x1)
-                    u32RegSmnMapCtrl &= 0xffff;
-                else
-                    u32RegSmnMapCtrl &= 0xffff0000;
-                *(volatile uint32_t *)PspAddrSlotBase = u32RegSmnMapCtrl;
-            }
-        }
-        else
-            rc = ERR_INVALID_PARAMETER;
-    }
-    else
-        rc = ERR_INVALID_PARAMETER;
 
-    /*LogRel("pspStubSmnUnmapByPtr: pv=%p -> rc=%d\n", pv, rc);*/
-    return rc;
+int pspSerialStubX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv)
+{
+    return MAPMgrX86PhysMap(&g_StubState.MapMgr, PhysX86Addr, fMmio, ppv);
 }
 
 
-int pspSerialStubX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv)
+int pspSerialStubX86PhysMapEx(X86PADDR PhysX86Addr, bool fMmio, uint32_t uMemType, void **ppv)
 {
-    return pspStubX86PhysMap(&g_StubState, PhysX86Addr, fMmio, ppv);
+    return MAPMgrX86PhysMapEx(&g_StubState.MapMgr, PhysX86Addr, fMmio, uMemType, ppv);
 }
 
 
 int pspSerialStubX86PhysUnmapByPtr(void *pv)
 {
-    return pspStubX86PhysUnmapByPtr(&g_StubState, pv);
+    return MAPMgrX86PhysUnmapByPtr(&g_StubState.MapMgr, pv);
 }
 
 
 int pspSerialStubSmnUnmapByPtr(void *pv)
 {
-    return pspStubSmnUnmapByPtr(&g_StubState, pv);
+    return MAPMgrSmnUnmapByPtr(&g_StubState.MapMgr, pv);
 }
 
 
 int pspSerialStubSmnMap(SMNADDR SmnAddr, void **ppv)
 {
-    return pspStubSmnMap(&g_StubState, SmnAddr, ppv);
+    return MAPMgrSmnMap(&g_StubState.MapMgr, SmnAddr, ppv);
+}
+
+
+int pspSerialStubSmnMapEx(uint32_t idDie, SMNADDR SmnAddr, void **ppv)
+{
+    return MAPMgrSmnMapEx(&g_StubState.MapMgr, idDie, SmnAddr, ppv);
+}
+
+
+void pspSerialStubSmnFlush(void)
+{
+    MAPMgrSmnFlush(&g_StubState.MapMgr);
+}
+
+
+int pspSerialStubCcpX86Copy(X86PADDR PhysX86Addr, void *pvPsp, size_t cbCopy, bool fToX86)
+{
+    if (fToX86)
+        return CCPCopy(&g_StubState.Ccp, CCPMEM_SYSTEM, PhysX86Addr, CCPMEM_LOCAL, (uintptr_t)pvPsp, cbCopy);
+
+    return CCPCopy(&g_StubState.Ccp, CCPMEM_LOCAL, (uintptr_t)pvPsp, CCPMEM_SYSTEM, PhysX86Addr, cbCopy);
+}
+
+
+#ifdef PSP_SERIAL_STUB_HOST
+/**
+ * Resolves a x86 physical address for the simulated CCP queue through the mapping windows.
+ *
+ * @returns Pointer to the memory backing the address or NULL if it can't be mapped.
+ * @param   pvUser                  The serial stub instance data.
+ * @param   PhysX86Addr             The x86 physical address.
+ * @param   pcbContig               Where to store the number of bytes accessible from the returned pointer on.
+ */
+static void *pspStubCcpSimX86Resolve(void *pvUser, X86PADDR PhysX86Addr, size_t *pcbContig)
+{
+    PPSPSTUBSTATE pThis = (PPSPSTUBSTATE)pvUser;
+    void *pv = NULL;
+
+    /* The window memory stays around on the host, so the reference isn't needed beyond the lookup. */
+    if (MAPMgrX86PhysMap(&pThis->MapMgr, PhysX86Addr, false /*fMmio*/, &pv))
+        return NULL;
+
+    MAPMgrX86PhysUnmapByPtr(&pThis->MapMgr, pv);
+    *pcbContig = _64M - (PhysX86Addr & (_64M - 1));
+    return pv;
+}
+#endif
+
+
+/**
+ * Returns the current counter value of the 2nd timer.
+ *
+ * @returns Counter value, the counter runs at 100MHz.
+ */
+static inline uint32_t pspStubTimerCntRead(void)
+{
+#ifdef PSP_SERIAL_STUB_HOST
+    return pspStubHostTimerCntRead();
+#else
+    return *(volatile uint32_t *)(0x03010424 + 32);
+#endif
 }
 
 
@@ -563,7 +750,7 @@ static int pspStubTimerInit(PPSPTIMER pTimer)
 static void pspStubTimerHandle(PPSPTIMER pTimer)
 {
 #ifndef PSP_STUB_NO_HW_TIMER
-    uint32_t cCnts = *(volatile uint32_t *)(0x03010424 + 32);
+    uint32_t cCnts = pspStubTimerCntRead();
     uint32_t cTicksPassed = 0;
 
     /* Check how many ticks we advanced since the last check. */
@@ -648,6 +835,30 @@ void pspSerialStubDelayUs(uint64_t cMicros)
 }
 
 
+uint64_t pspSerialStubGetMicros(void)
+{
+    return pspStubGetMicros(&g_StubState);
+}
+
+
+#ifndef PSP_STUB_NO_HW_TIMER
+/**
+ * Returns the current time for bounding the wait for a CCP submission.
+ *
+ * @returns Number of microseconds passed.
+ * @param   pvUser                  The serial stub instance data.
+ */
+static uint64_t pspStubCcpGetMicros(void *pvUser)
+{
+    return pspStubGetMicros((PPSPSTUBSTATE)pvUser);
+}
+# define PSP_STUB_CCP_GET_MICROS        pspStubCcpGetMicros
+#else
+/* No accurate time, the CCP counts each poll as a microsecond. */
+# define PSP_STUB_CCP_GET_MICROS        NULL
+#endif
+
+
 /**
  * Returns the amount of milliseconds passed since power on/reset.
  *
@@ -698,45 +909,6 @@ void pspSerialStubDelayMs(uint32_t cMillies)
 }
 
 
-/**
- * Initializes the selected transport channel.
- *
- * @returns Status code.
- * @param   pThis                   The serial stub instance data.
- */
-static int pspStubTranspInit(PPSPSTUBSTATE pThis)
-{
-    PCPSPPDUTRANSPIF pTranspIf = NULL;
-
-    if (pThis->fSpiMsgChan)
-        pTranspIf = &g_SpiFlashTranspEm100;
-    else
-        pTranspIf = &g_UartTransp;
-
-    int rc = pTranspIf->pfnInit(&pThis->abTranspData[0], sizeof(pThis->abTranspData), &pThis->hPduTransp);
-    if (rc == INF_SUCCESS)
-        pThis->pIfTransp = pTranspIf;
-
-    return rc;
-}
-
-
-/**
- * Terminates the currently used transport channel.
- *
- * @returns nothing.
- * @param   pThis                   The serial stub instance data.
- */
-static void pspStubTranspTerm(PPSPSTUBSTATE pThis)
-{
-    PCPSPPDUTRANSPIF pTranspIf = NULL;
-
-    pThis->pIfTransp->pfnTerm(pThis->hPduTransp);
-    pThis->pIfTransp = NULL;
-    memset(&pThis->abTranspData[0], 0, sizeof(pThis->abTranspData[0]));
-}
-
-
 /**
  * Returns the number of bytes available for reading.
  *
@@ -805,6 +977,40 @@ static int pspStubTranspEnd(PPSPSTUBSTATE pThis)
 }
 
 
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+/**
+ * COBS encoder output callback writing to the underlying transport channel.
+ *
+ * @returns Status code.
+ * @param   pvUser                  The serial stub instance data.
+ * @param   pvBuf                   The encoded data to write.
+ * @param   cbBuf                   Number of bytes to write.
+ */
+static int pspStubCobsEncWrite(void *pvUser, const void *pvBuf, size_t cbBuf)
+{
+    return pspStubTranspWrite((PPSPSTUBSTATE)pvUser, pvBuf, cbBuf);
+}
+#endif
+
+
+/**
+ * Writes part of a PDU, applying the framing if enabled.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvBuf                   The data to write.
+ * @param   cbWrite                 Number of bytes to write.
+ */
+static int pspStubPduWrite(PPSPSTUBSTATE pThis, const void *pvBuf, size_t cbWrite)
+{
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+    return COBSEncWrite(&pThis->CobsEnc, pvBuf, cbWrite);
+#else
+    return pspStubTranspWrite(pThis, pvBuf, cbWrite);
+#endif
+}
+
+
 /**
  * Sends the given PDU - two payload parts.
  *
@@ -855,15 +1061,25 @@ static int pspStubPduSend2(PPSPSTUBSTATE pThis, int32_t rcReq, uint32_t idCcd, P
 
     /* Send everything, header first, then payload and footer last. */
     pspStubTranspBegin(pThis);
-    int rc = pspStubTranspWrite(pThis, &PduHdr, sizeof(PduHdr));
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+    int rc = COBSEncFrameBegin(&pThis->CobsEnc);
+    if (!rc)
+        rc = pspStubPduWrite(pThis, &PduHdr, sizeof(PduHdr));
+#else
+    int rc = pspStubPduWrite(pThis, &PduHdr, sizeof(PduHdr));
+#endif
     if (!rc && pvPayload1 && cbPayload1)
-        rc = pspStubTranspWrite(pThis, pvPayload1, cbPayload1);
+        rc = pspStubPduWrite(pThis, pvPayload1, cbPayload1);
     if (!rc && pvPayload2 && cbPayload2)
-        rc = pspStubTranspWrite(pThis, pvPayload2, cbPayload2);
+        rc = pspStubPduWrite(pThis, pvPayload2, cbPayload2);
     if (!rc && cbPad)
-        rc = pspStubTranspWrite(pThis, &abPad[0], cbPad);
+        rc = pspStubPduWrite(pThis, &abPad[0], cbPad);
+    if (!rc)
+        rc = pspStubPduWrite(pThis, &PduFooter, sizeof(PduFooter));
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
     if (!rc)
-        rc = pspStubTranspWrite(pThis, &PduFooter, sizeof(PduFooter));
+        rc = COBSEncFrameEnd(&pThis->CobsEnc);
+#endif
     pspStubTranspEnd(pThis);
 
     return rc;
@@ -898,6 +1114,11 @@ static void pspStubPduRecvReset(PPSPSTUBSTATE pThis)
     pThis->enmPduRecvState = PSPSERIALPDURECVSTATE_HDR;
     pThis->cbPduRecvLeft   = sizeof(PSPSERIALPDUHDR);
     pThis->offPduRecv      = 0;
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+    pThis->offCobsRecv     = 0;
+    pThis->cbCobsRecv      = 0;
+    COBSDecReset(&pThis->CobsDec);
+#endif
 }
 
 
@@ -914,8 +1135,10 @@ static int pspStubPduHdrValidate(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR pHdr)
         return -1;
     if (pHdr->u.Fields.cbPdu > sizeof(pThis->abPdu) - sizeof(PSPSERIALPDUHDR) - sizeof(PSPSERIALPDUFOOTER))
         return -1;
-    if (   pHdr->u.Fields.enmRrnId < PSPSERIALPDURRNID_REQUEST_FIRST
-        || pHdr->u.Fields.enmRrnId >= PSPSERIALPDURRNID_REQUEST_INVALID_FIRST)
+    if (   (   pHdr->u.Fields.enmRrnId < PSPSERIALPDURRNID_REQUEST_FIRST
+            || pHdr->u.Fields.enmRrnId >= PSPSERIALPDURRNID_REQUEST_INVALID_FIRST)
+        && (   pHdr->u.Fields.enmRrnId < PSPSERIALPDURRNID_REQUEST_EXT_FIRST
+            || pHdr->u.Fields.enmRrnId >= PSPSERIALPDURRNID_REQUEST_EXT_INVALID_FIRST))
         return -1;
     if (pHdr->u.Fields.cPdus != pThis->cPduRecvNext)
         return -1;
@@ -1030,28 +1253,105 @@ static int pspStubPduRecvAdvance(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR *ppPduRc
 }
 
 
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
 /**
- * Waits for a PDU to be received or until the given timeout elapsed.
+ * Validates a complete PDU received in a COBS frame.
  *
  * @returns Status code.
  * @param   pThis                   The serial stub instance data.
- * @param   ppPduRcvd               Where to store the pointer to the received complete PDU on success.
- * @param   cMillies                Amount of milliseconds to wait until a timeout is returned.
+ * @param   cbFrame                 Size of the decoded frame in bytes.
  */
-static int pspStubPduRecv(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR *ppPduRcvd, uint32_t cMillies)
+static int pspStubPduFrameValidate(PPSPSTUBSTATE pThis, size_t cbFrame)
 {
-    int rc = INF_SUCCESS;
-    uint32_t tsStartMs = pspStubGetMillies(pThis);
+    PCPSPSERIALPDUHDR pHdr = (PCPSPSERIALPDUHDR)&pThis->abPdu[0];
 
-    do
-    {
-        /*
-         * Check for pending interrupts and send a notification (needs to be done here
+    if (cbFrame < sizeof(PSPSERIALPDUHDR) + sizeof(PSPSERIALPDUFOOTER))
+        return -1;
+    if (pspStubPduHdrValidate(pThis, pHdr))
+        return -1;
+    if (cbFrame != sizeof(PSPSERIALPDUHDR) + ((pHdr->u.Fields.cbPdu + 7) & ~7) + sizeof(PSPSERIALPDUFOOTER))
+        return -1;
+
+    return pspStubPduValidate(pThis, pHdr);
+}
+
+
+/**
+ * Feeds received data into the COBS decoder until a valid PDU was decoded or the data is exhausted.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   cbAvail                 Number of bytes available for reading from the transport channel.
+ * @param   ppPduRcvd               Where to store the pointer to the received complete PDU on success.
+ */
+static int pspStubPduRecvCobs(PPSPSTUBSTATE pThis, size_t cbAvail, PCPSPSERIALPDUHDR *ppPduRcvd)
+{
+    *ppPduRcvd = NULL;
+
+    /* Bytes left over after the last frame are processed first. */
+    if (pThis->offCobsRecv == pThis->cbCobsRecv)
+    {
+        size_t cbThisRecv = MIN(cbAvail, sizeof(pThis->abCobsRecv));
+
+        int rc = pspStubTranspRead(pThis, &pThis->abCobsRecv[0], cbThisRecv);
+        if (rc)
+            return rc;
+
+        pThis->offCobsRecv = 0;
+        pThis->cbCobsRecv  = cbThisRecv;
+    }
+
+    while (pThis->offCobsRecv < pThis->cbCobsRecv)
+    {
+        int rc = COBSDecPutByte(&pThis->CobsDec, pThis->abCobsRecv[pThis->offCobsRecv++]);
+
+        /* Malformed or invalid frames are dropped silently, the host retries after a timeout. */
+        if (   rc == INF_SUCCESS
+            && !pspStubPduFrameValidate(pThis, COBSDecGetFrameSize(&pThis->CobsDec)))
+        {
+            pThis->cPduRecvNext++;
+            *ppPduRcvd = (PCPSPSERIALPDUHDR)&pThis->abPdu[0];
+            break;
+        }
+    }
+
+    return INF_SUCCESS;
+}
+#endif
+
+
+/**
+ * Waits for a PDU to be received or until the given timeout elapsed.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   ppPduRcvd               Where to store the pointer to the received complete PDU on success.
+ * @param   cMillies                Amount of milliseconds to wait until a timeout is returned.
+ */
+static int pspStubPduRecv(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR *ppPduRcvd, uint32_t cMillies)
+{
+    int rc = INF_SUCCESS;
+    uint32_t tsStartMs = pspStubGetMillies(pThis);
+
+    do
+    {
+        /*
+         * Check for pending interrupts and send a notification (needs to be done here
          * as this is the core runloop during PDU processing and when code modules are executed).
          */
         pspStubIrqProcess(pThis);
 
         size_t cbAvail = pspStubTranspPeek(pThis);
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+        if (   cbAvail
+            || pThis->offCobsRecv < pThis->cbCobsRecv)
+        {
+            rc = pspStubPduRecvCobs(pThis, cbAvail, ppPduRcvd);
+            if (   !rc
+                && *ppPduRcvd != NULL)
+                break; /* We received a complete and valid PDU. */
+        }
+#else
         if (cbAvail)
         {
             /* Only read what is required for the current state. */
@@ -1074,6 +1374,11 @@ static int pspStubPduRecv(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR *ppPduRcvd, uin
                 }
             }
         }
+#endif
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+        else
+            pspStubLogDrain(pThis); /* Nothing to receive, good time to get rid of some log output. */
+#endif
     } while (   !rc
              && (   pspStubGetMillies(pThis) - tsStartMs < cMillies
                  || cMillies == PSP_SERIAL_STUB_INDEFINITE_WAIT));
@@ -1087,6 +1392,198 @@ static int pspStubPduRecv(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR *ppPduRcvd, uin
 }
 
 
+/**
+ * Initializes the given transport channel and makes it the active one.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pTransp                 The transport channel to initialize.
+ */
+static int pspStubTranspInitWorker(PPSPSTUBSTATE pThis, PCPSPSTUBTRANSPDESC pTransp)
+{
+    memset(&pThis->abTranspData[0], 0, sizeof(pThis->abTranspData));
+
+    int rc = pTransp->pIfTransp->pfnInit(&pThis->abTranspData[0], sizeof(pThis->abTranspData), &pThis->hPduTransp);
+    if (rc == INF_SUCCESS)
+    {
+        pThis->pIfTransp   = pTransp->pIfTransp;
+        pThis->enmTranspId = pTransp->enmTranspId;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Terminates the currently used transport channel.
+ *
+ * @returns nothing.
+ * @param   pThis                   The serial stub instance data.
+ */
+static void pspStubTranspTerm(PPSPSTUBSTATE pThis)
+{
+    pThis->pIfTransp->pfnTerm(pThis->hPduTransp);
+    pThis->pIfTransp   = NULL;
+    pThis->enmTranspId = PSPSERIALTRANSPID_INVALID;
+    memset(&pThis->abTranspData[0], 0, sizeof(pThis->abTranspData));
+}
+
+
+/**
+ * Returns the transport channel descriptor for the given ID.
+ *
+ * @returns Pointer to the transport channel descriptor or NULL if not found.
+ * @param   enmTranspId             The transport channel ID to look for.
+ */
+static PCPSPSTUBTRANSPDESC pspStubTranspDescFind(PSPSERIALTRANSPID enmTranspId)
+{
+    for (uint32_t i = 0; i < ELEMENTS(g_aPduTransp); i++)
+    {
+        if (g_aPduTransp[i].enmTranspId == enmTranspId)
+            return &g_aPduTransp[i];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Resets the PDU counters and receive state to start over with a new connection.
+ *
+ * @returns nothing.
+ * @param   pThis                   The serial stub instance data.
+ */
+static void pspStubPduStateReset(PPSPSTUBSTATE pThis)
+{
+    pThis->cPdusSent    = 0;
+    pThis->cPduRecvNext = 1;
+    pspStubPduRecvReset(pThis);
+}
+
+
+#ifdef PSP_SERIAL_STUB_TRANSP_PROBE
+/**
+ * Runs the throughput handshake with the host on the currently active transport channel.
+ *
+ * @returns Status code.
+ * @retval  INF_TRY_AGAIN if the host didn't answer in time.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pcbPerSec               Where to store the measured round trip bandwidth in bytes per second on success.
+ */
+static int pspStubTranspProbe(PPSPSTUBSTATE pThis, uint32_t *pcbPerSec)
+{
+    PSPSERIALTRANSPPROBE Probe;
+    uint8_t *pbPattern = &pThis->abStaging[0];
+
+    Probe.enmTranspId = pThis->enmTranspId;
+    Probe.cbProbe     = PSP_SERIAL_STUB_TRANSP_PROBE_SZ;
+    for (uint32_t i = 0; i < Probe.cbProbe; i++)
+        pbPattern[i] = (uint8_t)(i ^ (i >> 8) ^ 0xa5);
+
+    /* Every channel starts with fresh PDU counters. */
+    pspStubPduStateReset(pThis);
+
+    uint64_t tsStart = pspStubGetMicros(pThis);
+    int rc = pspStubPduSend2(pThis, INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_NOTIFICATION_TRANSP_PROBE,
+                             &Probe, sizeof(Probe), pbPattern, Probe.cbProbe);
+    if (!rc)
+    {
+        PCPSPSERIALPDUHDR pPdu = NULL;
+        rc = pspStubPduRecv(pThis, &pPdu, PSP_SERIAL_STUB_TRANSP_PROBE_TIMEOUT_MS);
+        if (   !rc
+            && pPdu)
+        {
+            uint64_t cUsElapsed = pspStubGetMicros(pThis) - tsStart;
+            PCPSPSERIALTRANSPPROBE pEcho = (PCPSPSERIALTRANSPPROBE)(pPdu + 1);
+
+            if (   pPdu->u.Fields.enmRrnId == PSPSERIALPDURRNID_REQUEST_TRANSP_PROBE
+                && pPdu->u.Fields.cbPdu == sizeof(Probe) + Probe.cbProbe
+                && pEcho->enmTranspId == Probe.enmTranspId
+                && pEcho->cbProbe == Probe.cbProbe
+                && !memcmp(pEcho + 1, pbPattern, Probe.cbProbe))
+            {
+                /* Both directions carry the complete PDU including header and footer. */
+                uint64_t cbXfer = 2 * (  sizeof(PSPSERIALPDUHDR) + sizeof(Probe)
+                                       + Probe.cbProbe + sizeof(PSPSERIALPDUFOOTER));
+                PSPSERIALTRANSPPROBERESP Resp;
+
+                Resp.enmTranspId = Probe.enmTranspId;
+                Resp.cbPerSec    = (uint32_t)((cbXfer * 1000000) / MAX(cUsElapsed, 1));
+                rc = pspStubPduSend(pThis, INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_TRANSP_PROBE,
+                                    &Resp, sizeof(Resp));
+                if (!rc)
+                    *pcbPerSec = Resp.cbPerSec;
+            }
+            else
+                rc = ERR_INVALID_STATE;
+        }
+        else if (!rc)
+            rc = INF_TRY_AGAIN;
+    }
+
+    return rc;
+}
+#endif
+
+
+/**
+ * Initializes the data transport channel, probing all available ones if configured.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ */
+static int pspStubTranspInit(PPSPSTUBSTATE pThis)
+{
+    int rc = INF_SUCCESS;
+
+    pThis->cbPerSecTransp = 0;
+
+#ifdef PSP_SERIAL_STUB_TRANSP_PROBE
+    PCPSPSTUBTRANSPDESC pTranspBest = NULL;
+    uint32_t cbPerSecBest = 0;
+
+    for (uint32_t i = 0; i < ELEMENTS(g_aPduTransp); i++)
+    {
+        rc = pspStubTranspInitWorker(pThis, &g_aPduTransp[i]);
+        if (!rc)
+        {
+            uint32_t cbPerSec = 0;
+            rc = pspStubTranspProbe(pThis, &cbPerSec);
+            if (   !rc
+                && cbPerSec > cbPerSecBest)
+            {
+                pTranspBest  = &g_aPduTransp[i];
+                cbPerSecBest = cbPerSec;
+            }
+
+            pspStubTranspTerm(pThis);
+        }
+    }
+
+    pspStubPduStateReset(pThis);
+    if (pTranspBest)
+    {
+        rc = pspStubTranspInitWorker(pThis, pTranspBest);
+        if (!rc)
+        {
+            pThis->cbPerSecTransp = cbPerSecBest;
+            return rc;
+        }
+    }
+#endif
+
+    /* Nothing answered (or probing is disabled), go with the configured default. */
+#ifdef PSP_SERIAL_STUB_HOST
+    PCPSPSTUBTRANSPDESC pTransp = pspStubTranspDescFind(PSPSERIALTRANSPID_UNIX);
+#else
+    PCPSPSTUBTRANSPDESC pTransp =   pThis->fSpiMsgChan
+                                  ? pspStubTranspDescFind(PSPSERIALTRANSPID_SPI_EM100)
+                                  : pspStubTranspDescFind(PSPSERIALTRANSPID_UART);
+#endif
+    return pspStubTranspInitWorker(pThis, pTransp);
+}
+
+
 /**
  * Waits for a connect request PDU.
  *
@@ -1109,14 +1606,33 @@ static int pspStubCheckConnection(PPSPSTUBSTATE pThis, uint32_t cMillies)
             Resp.cbPduMax       = sizeof(pThis->abPdu);
             Resp.cbScratch      = sizeof(pThis->abScratch);
             Resp.PspAddrScratch = (PSPADDR)(uintptr_t)&pThis->abScratch[0];
-            Resp.cSysSockets    = 1; /** @todo */
-            Resp.cCcdsPerSocket = 1; /** @todo */
+            Resp.cSysSockets    = PSP_SERIAL_STUB_SOCKET_COUNT;
+            Resp.cCcdsPerSocket = PSP_SERIAL_STUB_CCDS_PER_SOCKET;
             Resp.au32Pad0       = 0;
 
+            PSPSERIALCONNECTRESPEXT RespExt;
+            PCPSPSERIALCONNECTREQEXT pReqExt = (PCPSPSERIALCONNECTREQEXT)(pPdu + 1);
+            size_t cbRespExt = 0;
+
+            RespExt.enmTranspId = pThis->enmTranspId;
+            RespExt.cbPerSec    = pThis->cbPerSecTransp;
+
+            /* Hosts not knowing about the trailer send no payload and might check for the exact response size. */
+            if (   pPdu->u.Fields.cbPdu >= sizeof(*pReqExt)
+                && (pReqExt->fCaps & PSP_SERIAL_CONNECT_CAPS_F_RESP_EXT))
+                cbRespExt = sizeof(RespExt);
+
             /* Reset the PDU counter. */
             pThis->cPdusSent     = 0;
 
-            rc = pspStubPduSend(pThis, INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_CONNECT, &Resp, sizeof(Resp));
+            /* Pins, snapshots and watches belong to the session, don't keep windows reserved for a host which went away. */
+            pspStubMapPinReleaseAll(pThis);
+            for (uint32_t i = 0; i < ELEMENTS(pThis->aSnapshots); i++)
+                pThis->aSnapshots[i].enmAddrSpace = PSPADDRSPACE_INVALID;
+            pspStubWatchRemoveAll(pThis);
+
+            rc = pspStubPduSend2(pThis, INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_CONNECT,
+                                 &Resp, sizeof(Resp), &RespExt, cbRespExt);
             if (!rc)
             {
                 LogRel("Someone connected to us \\o/...\n");
@@ -1140,10 +1656,11 @@ static int pspStubCheckConnection(PPSPSTUBSTATE pThis, uint32_t cMillies)
  */
 static int pspStubPduRecvProcessSingle(PPSPSTUBSTATE pThis, uint32_t cMillies)
 {
-    PCPSPSERIALPDUHDR pPdu;
+    PCPSPSERIALPDUHDR pPdu = NULL;
 
     int rc = pspStubPduRecv(pThis, &pPdu, cMillies);
-    if (!rc)
+    if (   !rc
+        && pPdu) /* Nothing received if the timeout elapsed. */
         rc = pspStubPduProcess(pThis, pPdu);
 
     return rc;
@@ -1445,6 +1962,7 @@ static int pspStubPduProcessPspMemXfer(PPSPSTUBSTATE pThis, const void *pvPayloa
             const void *pvSrc = (pReq + 1);
             memcpy(pvDst, pvSrc, cbXfer);
 
+#ifndef PSP_SERIAL_STUB_HOST
             /* Invalidate and clean memory. */
             while (cbXfer)
             {
@@ -1452,6 +1970,7 @@ static int pspStubPduProcessPspMemXfer(PPSPSTUBSTATE pThis, const void *pvPayloa
                 pvDst = (uint8_t *)pvDst + 32;
                 cbXfer -= MIN(cbXfer, 32);
             }
+#endif
         }
         else
         {
@@ -1464,7 +1983,7 @@ static int pspStubPduProcessPspMemXfer(PPSPSTUBSTATE pThis, const void *pvPayloa
 
     PSPSTS rcReq = STS_INF_SUCCESS;
     pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbPayload);
-    return pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbResPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbResPayload);
 }
 
 
@@ -1549,83 +2068,111 @@ static int pspStubPduProcessPspMmioXfer(PPSPSTUBSTATE pThis, const void *pvPaylo
 
     PSPSTS rcReq = STS_INF_SUCCESS;
     pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbPayload);
-    return pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbResPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbResPayload);
 }
 
 
 /**
- * Reads/writes data in the SMN address space.
+ * Converts the x86 caching flags given by the host to the memory type to program.
  *
- * @returns Stauts code.
- * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
- * @param   fWrite                  Flag whether this is rad or write request.
+ * @returns Status code.
+ * @param   fCaching                The caching flags, see PSP_SERIAL_X86_CACHING_F_MEMTYPE.
+ * @param   puMemType               Where to store the memory type on success.
  */
-static int pspStubPduProcessPspSmnXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+static int pspStubX86CachingToMemType(uint32_t fCaching, uint32_t *puMemType)
 {
-    PCPSPSERIALSMNMEMXFERREQ pReq = (PCPSPSERIALSMNMEMXFERREQ)pvPayload;
+    if (fCaching & ~PSP_SERIAL_X86_CACHING_VALID_MASK)
+        return ERR_INVALID_PARAMETER;
 
-    if (cbPayload < sizeof(*pReq))
+    if (fCaching & PSP_SERIAL_X86_CACHING_F_MEMTYPE)
+        *puMemType = fCaching & PSP_SERIAL_X86_CACHING_MEMTYPE_MASK;
+    else if (!fCaching)
+        *puMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    else
         return ERR_INVALID_PARAMETER;
 
-    PSPSERIALPDURRNID enmResponse =   fWrite
-                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_SMN_WRITE
-                                    : PSPSERIALPDURRNID_RESPONSE_PSP_SMN_READ;
-    void *pvMap = NULL;
-    int rc = pspStubSmnMap(pThis, pReq->SmnAddrStart, &pvMap);
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Reads/writes a range in the SMN or x86 address space, the range can span multiple mapping windows.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   enmAddrSpace            The address space to access.
+ * @param   uAddrStart              Start address of the range.
+ * @param   cbXfer                  Number of bytes to transfer.
+ * @param   uX86MemType             The memory type for x86 mappings, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
+ * @param   pvWrite                 The data to write, NULL for a read.
+ * @param   enmResponse             The response ID to send.
+ */
+static int pspStubPduProcessRangeXfer(PPSPSTUBSTATE pThis, MAPMGRADDRSPACE enmAddrSpace, uint64_t uAddrStart, size_t cbXfer,
+                                      uint32_t uX86MemType, const void *pvWrite, PSPSERIALPDURRNID enmResponse)
+{
+    MAPMGRWINITER It;
+
+    if (   !pvWrite
+        && cbXfer > sizeof(pThis->abPduResp))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    int rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, uAddrStart, cbXfer, uX86MemType,
+                                 enmAddrSpace == MAPMGRADDRSPACE_SMN ? pThis->idCcdReq : 0);
     if (!rc)
     {
         const void *pvRespPayload = NULL;
-        uint8_t abRead[8];
         size_t cbRespPayload = 0;
 
         if (PSPCheckPointSet(&g_ChkPt))
         {
-            if (   pReq->cbXfer == 1
-                || pReq->cbXfer == 2
-                || pReq->cbXfer == 4)
-            {
-                if (fWrite)
-                    pspStubMmioAccess(pvMap, (pReq + 1), pReq->cbXfer);
-                else
-                {
-                    pspStubMmioAccess(&abRead[0], pvMap, pReq->cbXfer);
-                    pvRespPayload = &abRead[0];
-                    cbRespPayload = pReq->cbXfer;
-                }
-            }
-            else
+            const uint8_t *pbSrc = (const uint8_t *)pvWrite;
+            uint8_t *pbDst = &pThis->abPduResp[0];
+
+            for (;;)
             {
-                if (fWrite)
+                void *pvMap = NULL;
+                size_t cbChunk = 0;
+
+                rc = MAPMgrWinIterNext(&It, cbXfer, &pvMap, &cbChunk);
+                if (   rc
+                    || !cbChunk)
+                    break;
+
+                if (pvWrite)
                 {
-                    const void *pvSrc = (pReq + 1);
-                    memcpy(pvMap, pvSrc, pReq->cbXfer);
+                    memcpy(pvMap, pbSrc, cbChunk);
+                    pbSrc += cbChunk;
                 }
                 else
                 {
-                    memcpy(&pThis->abPduResp[0], pvMap, pReq->cbXfer);
-                    pvRespPayload = &pThis->abPduResp[0];
-                    cbRespPayload = pReq->cbXfer;
+                    memcpy(pbDst, pvMap, cbChunk);
+                    pbDst += cbChunk;
                 }
             }
+
+            if (   !rc
+                && !pvWrite)
+            {
+                pvRespPayload = &pThis->abPduResp[0];
+                cbRespPayload = cbXfer;
+            }
         }
 
-        pspStubSmnUnmapByPtr(pThis, pvMap);
+        MAPMgrWinIterEnd(&It);
 
-        PSPSTS rcReq = STS_INF_SUCCESS;
+        PSPSTS rcReq = rc;
         pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
-        return pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbRespPayload);
+        rc = pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
     }
     else
-        rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+        rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 
     return rc;
 }
 
 
 /**
- * Reads/writes data to normal memory in x86 address space.
+ * Reads/writes data in the SMN address space.
  *
  * @returns Stauts code.
  * @param   pThis                   The serial stub instance data.
@@ -1633,53 +2180,61 @@ static int pspStubPduProcessPspSmnXfer(PPSPSTUBSTATE pThis, const void *pvPayloa
  * @param   cbPayload               Payload size in bytes.
  * @param   fWrite                  Flag whether this is rad or write request.
  */
-static int pspStubPduProcessPspX86MemXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+static int pspStubPduProcessPspSmnXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
 {
-    PCPSPSERIALX86MEMXFERREQ pReq = (PCPSPSERIALX86MEMXFERREQ)pvPayload;
+    PCPSPSERIALSMNMEMXFERREQ pReq = (PCPSPSERIALSMNMEMXFERREQ)pvPayload;
 
-    if (cbPayload < sizeof(*pReq))
+    if (   cbPayload < sizeof(*pReq)
+        || (   fWrite
+            && cbPayload - sizeof(*pReq) < pReq->cbXfer))
         return ERR_INVALID_PARAMETER;
 
     PSPSERIALPDURRNID enmResponse =   fWrite
-                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_X86_MEM_WRITE
-                                    : PSPSERIALPDURRNID_RESPONSE_PSP_X86_MEM_READ;
+                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_SMN_WRITE
+                                    : PSPSERIALPDURRNID_RESPONSE_PSP_SMN_READ;
+
+    /* Anything but a single register access is a block copy which may cross mapping windows. */
+    if (   pReq->cbXfer != 1
+        && pReq->cbXfer != 2
+        && pReq->cbXfer != 4)
+        return pspStubPduProcessRangeXfer(pThis, MAPMGRADDRSPACE_SMN, pReq->SmnAddrStart, pReq->cbXfer,
+                                          MAPMGR_X86_MEMTYPE_DEFAULT, fWrite ? (pReq + 1) : NULL, enmResponse);
+
     void *pvMap = NULL;
-    int rc = pspStubX86PhysMap(pThis, pReq->PhysX86Start, false /*fMmio*/, &pvMap);
+    int rc = MAPMgrSmnMapEx(&pThis->MapMgr, pThis->idCcdReq, pReq->SmnAddrStart, &pvMap);
     if (!rc)
     {
-        size_t cbXfer = pReq->cbXfer;
         const void *pvRespPayload = NULL;
+        uint8_t abRead[8];
         size_t cbRespPayload = 0;
 
         if (PSPCheckPointSet(&g_ChkPt))
         {
             if (fWrite)
-            {
-                const void *pvSrc = (pReq + 1);
-                memcpy(pvMap, pvSrc, cbXfer);
-            }
+                pspStubMmioAccess(pvMap, (pReq + 1), pReq->cbXfer);
             else
             {
-                pvRespPayload = pvMap;
-                cbRespPayload = cbXfer;
-                /** @todo Need to copy into temporary buffer for proper exception handling. */
+                pspStubMmioAccess(&abRead[0], pvMap, pReq->cbXfer);
+                pvRespPayload = &abRead[0];
+                cbRespPayload = pReq->cbXfer;
             }
         }
 
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pvMap);
+
         PSPSTS rcReq = STS_INF_SUCCESS;
         pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
-        rc = pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbRespPayload);
-        pspStubX86PhysUnmapByPtr(pThis, pvMap);
+        return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
     }
     else
-        rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+        rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 
     return rc;
 }
 
 
 /**
- * Reads/writes data to MMIO in x86 address space.
+ * Reads/writes data to normal memory in x86 address space.
  *
  * @returns Stauts code.
  * @param   pThis                   The serial stub instance data.
@@ -1687,54 +2242,99 @@ static int pspStubPduProcessPspX86MemXfer(PPSPSTUBSTATE pThis, const void *pvPay
  * @param   cbPayload               Payload size in bytes.
  * @param   fWrite                  Flag whether this is rad or write request.
  */
-static int pspStubPduProcessPspX86MmioXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+static int pspStubPduProcessPspX86MemXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
 {
     PCPSPSERIALX86MEMXFERREQ pReq = (PCPSPSERIALX86MEMXFERREQ)pvPayload;
 
     if (   cbPayload < sizeof(*pReq)
-        || (   pReq->cbXfer != 1
-            && pReq->cbXfer != 2
-            && pReq->cbXfer != 4
-            && pReq->cbXfer != 8))
+        || (   fWrite
+            && cbPayload - sizeof(*pReq) < pReq->cbXfer))
         return ERR_INVALID_PARAMETER;
 
     PSPSERIALPDURRNID enmResponse =   fWrite
-                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_X86_MMIO_WRITE
-                                    : PSPSERIALPDURRNID_RESPONSE_PSP_X86_MMIO_READ;
-    void *pvMap = NULL;
-    int rc = pspStubX86PhysMap(pThis, pReq->PhysX86Start, true /*fMmio*/, &pvMap);
-    if (!rc)
-    {
-        const void *pvRespPayload = NULL;
-        uint8_t abRead[8];
-        size_t cbRespPayload = 0;
-        const void *pvSrc = NULL;
-        void *pvDst = NULL;
-
-        if (PSPCheckPointSet(&g_ChkPt))
+                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_X86_MEM_WRITE
+                                    : PSPSERIALPDURRNID_RESPONSE_PSP_X86_MEM_READ;
+    return pspStubPduProcessRangeXfer(pThis, MAPMGRADDRSPACE_X86_MEM, pReq->PhysX86Start, pReq->cbXfer,
+                                      MAPMGR_X86_MEMTYPE_DEFAULT, fWrite ? (pReq + 1) : NULL, enmResponse);
+}
+
+
+/**
+ * Does a single 1, 2, 4 or 8 byte access to a x86 MMIO register.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   PhysX86Addr             The x86 physical address to access.
+ * @param   uMemType                The memory type to map the register with, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
+ * @param   cbXfer                  Number of bytes to transfer.
+ * @param   pvWrite                 The data to write, NULL for a read.
+ * @param   enmResponse             The response ID to send.
+ */
+static int pspStubPduProcessX86RegXfer(PPSPSTUBSTATE pThis, X86PADDR PhysX86Addr, uint32_t uMemType, size_t cbXfer,
+                                       const void *pvWrite, PSPSERIALPDURRNID enmResponse)
+{
+    void *pvMap = NULL;
+    int rc = MAPMgrX86PhysMapEx(&pThis->MapMgr, PhysX86Addr, true /*fMmio*/, uMemType, &pvMap);
+    if (!rc)
+    {
+        const void *pvRespPayload = NULL;
+        uint8_t abRead[8];
+        size_t cbRespPayload = 0;
+        const void *pvSrc = NULL;
+        void *pvDst = NULL;
+
+        if (PSPCheckPointSet(&g_ChkPt))
         {
-            if (fWrite)
-                pspStubMmioAccess(pvMap, (pReq + 1), pReq->cbXfer);
+            if (pvWrite)
+                pspStubMmioAccess(pvMap, pvWrite, cbXfer);
             else
             {
-                pspStubMmioAccess(&abRead[0], pvMap, pReq->cbXfer);
+                pspStubMmioAccess(&abRead[0], pvMap, cbXfer);
                 pvRespPayload = &abRead[0];
-                cbRespPayload = pReq->cbXfer;
+                cbRespPayload = cbXfer;
             }
         }
 
-        pspStubX86PhysUnmapByPtr(pThis, pvMap);
+        MAPMgrX86PhysUnmapByPtr(&pThis->MapMgr, pvMap);
         PSPSTS rcReq = STS_INF_SUCCESS;
         pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
-        rc = pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbRespPayload);
+        rc = pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
     }
     else
-        rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+        rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 
     return rc;
 }
 
 
+/**
+ * Reads/writes data to MMIO in x86 address space.
+ *
+ * @returns Stauts code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ * @param   fWrite                  Flag whether this is rad or write request.
+ */
+static int pspStubPduProcessPspX86MmioXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+{
+    PCPSPSERIALX86MEMXFERREQ pReq = (PCPSPSERIALX86MEMXFERREQ)pvPayload;
+
+    if (   cbPayload < sizeof(*pReq)
+        || (   pReq->cbXfer != 1
+            && pReq->cbXfer != 2
+            && pReq->cbXfer != 4
+            && pReq->cbXfer != 8))
+        return ERR_INVALID_PARAMETER;
+
+    PSPSERIALPDURRNID enmResponse =   fWrite
+                                    ? PSPSERIALPDURRNID_RESPONSE_PSP_X86_MMIO_WRITE
+                                    : PSPSERIALPDURRNID_RESPONSE_PSP_X86_MMIO_READ;
+    return pspStubPduProcessX86RegXfer(pThis, pReq->PhysX86Start, MAPMGR_X86_MEMTYPE_DEFAULT, pReq->cbXfer,
+                                       fWrite ? (pReq + 1) : NULL, enmResponse);
+}
+
+
 /**
  * Reads/writes to a Co-Processor.
  *
@@ -1754,6 +2354,7 @@ static int pspStubPduProcessCoProcRw(PPSPSTUBSTATE pThis, const void *pvPayload,
     PSPSERIALPDURRNID enmResponse =   fWrite
                                     ? PSPSERIALPDURRNID_RESPONSE_COPROC_WRITE
                                     : PSPSERIALPDURRNID_RESPONSE_COPROC_READ;
+#ifndef PSP_SERIAL_STUB_HOST
     const void *pvRespPayload = NULL;
     uint32_t uValRead = 0;
     size_t cbRespPayload = 0;
@@ -1772,7 +2373,7 @@ static int pspStubPduProcessCoProcRw(PPSPSTUBSTATE pThis, const void *pvPayload,
                     | BIT(4)
                     | (pReq->u8Crm & 0xf);
         asm volatile("mcr p15, 0x0, %0, cr7, cr5, 0x1\n": : "r" (pu32Insn) :"memory");
-        asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
+        pspStubMemSync();
 
         if (PSPCheckPointSet(&g_ChkPt))
             pspSerialStubCoProcWriteAsm(uVal);
@@ -1794,80 +2395,109 @@ static int pspStubPduProcessCoProcRw(PPSPSTUBSTATE pThis, const void *pvPayload,
                     | BIT(4)
                     | (pReq->u8Crm & 0xf);
         asm volatile("mcr p15, 0x0, %0, cr7, cr5, 0x1\n": : "r" (pu32Insn) :"memory");
-        asm volatile("dsb #0xf\nisb #0xf\n": : :"memory");
+        pspStubMemSync();
         if (PSPCheckPointSet(&g_ChkPt))
             uValRead = pspSerialStubCoProcReadAsm();
     }
 
     PSPSTS rcReq = STS_INF_SUCCESS;
     pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
-    return pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
+#else
+    /* There is no co-processor to talk to on the host. */
+    return pspStubPduSend(pThis, ERR_NOT_IMPLEMENTED, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+#endif
 }
 
 
+/** Size of a single ldm/stm burst in bytes. */
+#define PSP_SERIAL_STUB_BURST_SZ        32
+
+
 /**
- * Maps the given address from the data xfer request start address.
+ * Does one access of the given type per element, the addresses are advanced by the given element counts.
  *
- * @returns Status code.
- * @param   pThis                   The serial stub instance data.
- * @param   pReq                    The data xfer request.
- * @param   ppv                     Where to store the pointer to the mapping on success.
+ * @param   a_Type                  The access type.
  */
-static int pspStubPduDataXferAddressMap(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void **ppv)
-{
-    int rc = 0;
+#define PSP_STUB_DATA_XFER_LOOP(a_Type) \
+    do { \
+        volatile a_Type *pDst = (volatile a_Type *)pvDst; \
+        volatile const a_Type *pSrc = (volatile const a_Type *)pvSrc; \
+        size_t cElems = cbXfer / sizeof(a_Type); \
+        size_t cDstAdv = fIncrDst ? 1 : 0; \
+        size_t cSrcAdv = fIncrSrc ? 1 : 0; \
+        while (cElems--) \
+        { \
+            *pDst = *pSrc; \
+            pDst += cDstAdv; \
+            pSrc += cSrcAdv; \
+        } \
+    } while (0)
 
-    switch (pReq->enmAddrSpace)
+
+/**
+ * Copies data with one access per element of the given stride.
+ *
+ * @returns nothing.
+ * @param   pvDst                   The destination.
+ * @param   pvSrc                   The source.
+ * @param   cbXfer                  Number of bytes to process, multiple of the stride.
+ * @param   cbStride                The access width, 1, 2, 4 or 8.
+ * @param   fIncrDst                Flag whether to advance the destination after each access.
+ * @param   fIncrSrc                Flag whether to advance the source after each access.
+ */
+static void pspStubDataXferStrided(void *pvDst, const void *pvSrc, size_t cbXfer, size_t cbStride, bool fIncrDst, bool fIncrSrc)
+{
+    /* Dispatch on the stride once so the loops only consist of the accesses. */
+    switch (cbStride)
     {
-        case PSPADDRSPACE_PSP_MEM:
-        case PSPADDRSPACE_PSP_MMIO:
-            *ppv = (void *)pReq->u.PspAddrStart;
+        case 1:
+            PSP_STUB_DATA_XFER_LOOP(uint8_t);
             break;
-        case PSPADDRSPACE_SMN:
-            rc = pspStubSmnMap(pThis, pReq->u.SmnAddrStart, ppv);
+        case 2:
+            PSP_STUB_DATA_XFER_LOOP(uint16_t);
             break;
-        case PSPADDRSPACE_X86_MEM:
-            rc = pspStubX86PhysMap(pThis, pReq->u.X86.PhysX86AddrStart, false /*fMmio*/, ppv);
-            /** @todo Caching flags. */
+        case 4:
+            PSP_STUB_DATA_XFER_LOOP(uint32_t);
             break;
-        case PSPADDRSPACE_X86_MMIO:
-            rc = pspStubX86PhysMap(pThis, pReq->u.X86.PhysX86AddrStart, true /*fMmio*/, ppv);
-            /** @todo Caching flags. */
+        case 8:
+            PSP_STUB_DATA_XFER_LOOP(uint64_t);
             break;
         default:
-            rc = -1;
             break;
     }
-
-    return rc;
 }
 
 
 /**
- * Unmaps the given pointer returned by a previous call to pspStubPduDataXferAddressMap().
+ * Copies data with ldm/stm bursts, the tail not filling a whole burst is copied with the given stride.
  *
  * @returns nothing.
- * @param   pThis                   The serial stub instance data.
- * @param   pReq                    The data xfer request.
- * @param   pv                      Pointer to the address to unmap.
+ * @param   pvDst                   The destination.
+ * @param   pvSrc                   The source.
+ * @param   cbXfer                  Number of bytes to process, multiple of the stride.
+ * @param   cbStride                The access width, 4 or 8.
  */
-static void pspStubPduDataXferAddressUnmapByPtr(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pv)
+static void pspStubDataXferBurstCopy(void *pvDst, const void *pvSrc, size_t cbXfer, size_t cbStride)
 {
-    switch (pReq->enmAddrSpace)
+    size_t cBursts = cbXfer / PSP_SERIAL_STUB_BURST_SZ;
+
+    /* ldm/stm fault on unaligned addresses. */
+    if (   ((uintptr_t)pvDst & 0x3)
+        || ((uintptr_t)pvSrc & 0x3))
+        cBursts = 0;
+
+    if (cBursts)
     {
-        case PSPADDRSPACE_PSP_MEM:
-        case PSPADDRSPACE_PSP_MMIO:
-            break;
-        case PSPADDRSPACE_SMN:
-            pspStubSmnUnmapByPtr(pThis, pv);
-            break;
-        case PSPADDRSPACE_X86_MEM:
-        case PSPADDRSPACE_X86_MMIO:
-            pspStubX86PhysUnmapByPtr(pThis, pv);
-            break;
-        default:
-            break;
+        size_t cbBursts = cBursts * PSP_SERIAL_STUB_BURST_SZ;
+
+        pspStubBurstCopyAsm(pvDst, pvSrc, cBursts);
+        pvDst   = (uint8_t *)pvDst + cbBursts;
+        pvSrc   = (const uint8_t *)pvSrc + cbBursts;
+        cbXfer -= cbBursts;
     }
+
+    pspStubDataXferStrided(pvDst, pvSrc, cbXfer, cbStride, true /*fIncrDst*/, true /*fIncrSrc*/);
 }
 
 
@@ -1878,23 +2508,30 @@ static void pspStubPduDataXferAddressUnmapByPtr(PPSPSTUBSTATE pThis, PCPSPSERIAL
  * @param   pThis                   The serial stub instance data.
  * @param   pReq                    The data xfer request.
  * @param   pv                      The mapped address.
+ * @param   pvVal                   The value to set, stride sized.
+ * @param   cbXfer                  Number of bytes to process.
  */
-static void pspStubPduDataXferMemset(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pv)
+static void pspStubPduDataXferMemset(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pv, const void *pvVal, size_t cbXfer)
 {
-    void *pvVal = (void *)(pReq + 1);
-    size_t cbWrLeft = pReq->cbXfer;
     size_t cbStride = pReq->cbStride;
     bool fIncrAddr = (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR) ? true : false;
 
-    uint8_t *pb = (uint8_t *)pv;
-    while (cbWrLeft)
+    if (   (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_BURST)
+        && !((uintptr_t)pv & 0x3)
+        && cbXfer >= PSP_SERIAL_STUB_BURST_SZ)
     {
-        pspStubMmioAccess(pb, pvVal, cbStride);
-        if (fIncrAddr)
-            pb += cbStride;
+        uint32_t au32Pattern[PSP_SERIAL_STUB_BURST_SZ / sizeof(uint32_t)];
+        size_t cBursts = cbXfer / PSP_SERIAL_STUB_BURST_SZ;
 
-        cbWrLeft -= cbStride;
+        for (uint32_t i = 0; i < sizeof(au32Pattern); i += cbStride)
+            memcpy((uint8_t *)&au32Pattern[0] + i, pvVal, cbStride);
+
+        pspStubBurstFillAsm(pv, &au32Pattern[0], cBursts);
+        pv      = (uint8_t *)pv + cBursts * PSP_SERIAL_STUB_BURST_SZ;
+        cbXfer -= cBursts * PSP_SERIAL_STUB_BURST_SZ;
     }
+
+    pspStubDataXferStrided(pv, pvVal, cbXfer, cbStride, fIncrAddr, false /*fIncrSrc*/);
 }
 
 
@@ -1906,25 +2543,16 @@ static void pspStubPduDataXferMemset(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ
  * @param   pReq                    The data xfer request.
  * @param   pvSrc                   The mapped address to read from.
  * @param   pvDst                   Where to store the read data.
+ * @param   cbXfer                  Number of bytes to process.
  */
-static void pspStubPduDataXferRead(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, const void *pvSrc, void *pvDst)
+static void pspStubPduDataXferRead(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, const void *pvSrc, void *pvDst, size_t cbXfer)
 {
-    void *pvVal = (void *)(pReq + 1);
-    size_t cbRdLeft = pReq->cbXfer;
-    size_t cbStride = pReq->cbStride;
     bool fIncrAddr = (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR) ? true : false;
 
-    uint8_t *pbDst = (uint8_t *)pvDst;
-    uint8_t *pbSrc = (uint8_t *)pvSrc;
-    while (cbRdLeft)
-    {
-        pspStubMmioAccess(pbDst, pbSrc, cbStride);
-        if (fIncrAddr)
-            pbSrc += cbStride;
-
-        pbDst    += cbStride;
-        cbRdLeft -= cbStride;
-    }
+    if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_BURST)
+        pspStubDataXferBurstCopy(pvDst, pvSrc, cbXfer, pReq->cbStride);
+    else
+        pspStubDataXferStrided(pvDst, pvSrc, cbXfer, pReq->cbStride, true /*fIncrDst*/, fIncrAddr);
 }
 
 
@@ -1936,242 +2564,2565 @@ static void pspStubPduDataXferRead(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ p
  * @param   pReq                    The data xfer request.
  * @param   pvDst                   The mapped address to write to.
  * @param   pvSrc                   The data to write.
+ * @param   cbXfer                  Number of bytes to process.
  */
-static void pspStubPduDataXferWrite(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pvDst, const void *pvSrc)
+static void pspStubPduDataXferWrite(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pvDst, const void *pvSrc, size_t cbXfer)
+{
+    bool fIncrAddr = (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR) ? true : false;
+
+    if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_BURST)
+        pspStubDataXferBurstCopy(pvDst, pvSrc, cbXfer, pReq->cbStride);
+    else
+        pspStubDataXferStrided(pvDst, pvSrc, cbXfer, pReq->cbStride, fIncrAddr, true /*fIncrSrc*/);
+}
+
+
+/**
+ * Executes the data xfer operation on the given mapped chunk.
+ *
+ * @returns nothing.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pReq                    The data xfer request.
+ * @param   pv                      The mapped chunk.
+ * @param   pbBuf                   The data buffer for the chunk (the value for a memset).
+ * @param   cbXfer                  Number of bytes to process.
+ */
+static void pspStubPduDataXferChunk(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, void *pv, uint8_t *pbBuf, size_t cbXfer)
+{
+    if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+        pspStubPduDataXferMemset(pThis, pReq, pv, pbBuf, cbXfer);
+    else if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_READ)
+        pspStubPduDataXferRead(pThis, pReq, pv, pbBuf, cbXfer);
+    else if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_WRITE)
+        pspStubPduDataXferWrite(pThis, pReq, pv, pbBuf, cbXfer);
+}
+
+
+/**
+ * Walks the SMN or x86 range of the data xfer request window by window.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pReq                    The data xfer request.
+ * @param   pIt                     The initialised window iterator.
+ * @param   pbBuf                   The data buffer (the value for a memset).
+ */
+static int pspStubPduDataXferWalk(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, PMAPMGRWINITER pIt, uint8_t *pbBuf)
+{
+    bool fIncrAddr = (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR) ? true : false;
+    size_t cbLeft = pReq->cbXfer;
+    int rc = INF_SUCCESS;
+
+    while (cbLeft)
+    {
+        void *pv = NULL;
+        size_t cbChunk = 0;
+
+        rc = MAPMgrWinIterNext(pIt, fIncrAddr ? cbLeft : pReq->cbStride, &pv, &cbChunk);
+        if (rc)
+            break;
+
+        if (cbChunk % pReq->cbStride)
+        {
+            /* An access would straddle a window boundary. */
+            rc = ERR_INVALID_PARAMETER;
+            break;
+        }
+
+        if (!fIncrAddr)
+            cbChunk = cbLeft; /* The same address is accessed over and over. */
+
+        pspStubPduDataXferChunk(pThis, pReq, pv, pbBuf, cbChunk);
+        if (!(pReq->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET))
+            pbBuf += cbChunk;
+        cbLeft -= cbChunk;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Validates the given data xfer descriptor.
+ *
+ * @returns Status code.
+ * @param   pReq                    The data xfer request.
+ * @param   cbData                  Number of data bytes following the request for a write or memset.
+ */
+static int pspStubPduDataXferValidate(PCPSPSERIALDATAXFERREQ pReq, size_t cbData)
+{
+    if (   (   pReq->cbStride != 1
+            && pReq->cbStride != 2
+            && pReq->cbStride != 4
+            && pReq->cbStride != 8)
+        || pReq->cbXfer % pReq->cbStride
+        || (   (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_BURST)
+            && (   !(pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR)
+                || pReq->cbStride < 4))
+        || (   (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+            && cbData < pReq->cbStride))
+        return ERR_INVALID_PARAMETER;
+
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Returns whether the given data xfer request targets the address space of the PSP itself.
+ *
+ * @returns Flag whether the PSP address space is accessed.
+ * @param   pReq                    The data xfer request.
+ */
+static inline bool pspStubPduDataXferIsPsp(PCPSPSERIALDATAXFERREQ pReq)
+{
+    return    pReq->enmAddrSpace == PSPADDRSPACE_PSP_MEM
+           || pReq->enmAddrSpace == PSPADDRSPACE_PSP_MMIO;
+}
+
+
+/**
+ * Sets up the window iterator for the given data xfer request, nothing to do for the PSP address space.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pReq                    The data xfer request.
+ * @param   pIt                     The window iterator to initialise.
+ */
+static int pspStubPduDataXferIterInit(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, PMAPMGRWINITER pIt)
 {
-    void *pvVal = (void *)(pReq + 1);
-    size_t cbWrLeft = pReq->cbXfer;
-    size_t cbStride = pReq->cbStride;
     bool fIncrAddr = (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_INCR_ADDR) ? true : false;
+    uint64_t cbRange = fIncrAddr ? pReq->cbXfer : pReq->cbStride;
+    int rc = INF_SUCCESS;
+
+    switch (pReq->enmAddrSpace)
+    {
+        case PSPADDRSPACE_PSP_MEM:
+        case PSPADDRSPACE_PSP_MMIO:
+            /* The address space of the other PSPs isn't reachable from here. */
+            if (pThis->idCcdReq)
+                rc = ERR_NOT_IMPLEMENTED;
+            else if (!fIncrAddr && pReq->u.PspAddrStart % pReq->cbStride)
+                rc = ERR_INVALID_PARAMETER;
+            break;
+        case PSPADDRSPACE_SMN:
+            /* Registers accessed over and over must be naturally aligned, this keeps the access within a single window too. */
+            if (!fIncrAddr && pReq->u.SmnAddrStart % pReq->cbStride)
+                rc = ERR_INVALID_PARAMETER;
+            else
+                rc = MAPMgrWinIterInitEx(pIt, &pThis->MapMgr, MAPMGRADDRSPACE_SMN, pReq->u.SmnAddrStart, cbRange,
+                                         MAPMGR_X86_MEMTYPE_DEFAULT, pThis->idCcdReq);
+            break;
+        case PSPADDRSPACE_X86_MEM:
+        case PSPADDRSPACE_X86_MMIO:
+        {
+            uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+            rc = pspStubX86CachingToMemType(pReq->u.X86.fCaching, &uMemType);
+            if (!rc && !fIncrAddr && pReq->u.X86.PhysX86AddrStart % pReq->cbStride)
+                rc = ERR_INVALID_PARAMETER;
+            if (!rc)
+                rc = MAPMgrWinIterInitEx(pIt, &pThis->MapMgr,
+                                           pReq->enmAddrSpace == PSPADDRSPACE_X86_MMIO
+                                         ? MAPMGRADDRSPACE_X86_MMIO
+                                         : MAPMGRADDRSPACE_X86_MEM,
+                                         pReq->u.X86.PhysX86AddrStart, cbRange, uMemType, 0 /*idSmnDie*/);
+            break;
+        }
+        default:
+            rc = -1;
+            break;
+    }
+
+    return rc;
+}
+
+
+/**
+ * Executes the given data xfer request, must be called with a checkpoint set.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pReq                    The data xfer request.
+ * @param   pIt                     The window iterator initialised with pspStubPduDataXferIterInit().
+ * @param   pbBuf                   The data buffer (the value for a memset).
+ */
+static int pspStubPduDataXferExec(PPSPSTUBSTATE pThis, PCPSPSERIALDATAXFERREQ pReq, PMAPMGRWINITER pIt, uint8_t *pbBuf)
+{
+    if (pspStubPduDataXferIsPsp(pReq))
+    {
+        pspStubPduDataXferChunk(pThis, pReq, (void *)(uintptr_t)pReq->u.PspAddrStart, pbBuf, pReq->cbXfer);
+        return INF_SUCCESS;
+    }
+
+    return pspStubPduDataXferWalk(pThis, pReq, pIt, pbBuf);
+}
+
+
+/**
+ * Extended data transfer mechanism.
+ *
+ * @returns Stauts code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ */
+static int pspStubPduProcessDataXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALDATAXFERREQ pReq = (PCPSPSERIALDATAXFERREQ)pvPayload;
+
+    if (   cbPayload < sizeof(*pReq)
+        || pspStubPduDataXferValidate(pReq, cbPayload - sizeof(*pReq))
+        || (   (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_READ)
+            && pReq->cbXfer > sizeof(pThis->abPduResp)))
+        return ERR_INVALID_PARAMETER;
+
+    PSPSERIALPDURRNID enmResponse = PSPSERIALPDURRNID_RESPONSE_PSP_DATA_XFER;
+    MAPMGRWINITER It;
+    int rc = pspStubPduDataXferIterInit(pThis, pReq, &It);
+    if (!rc)
+    {
+        uint8_t *pbBuf =   (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_READ)
+                         ? &pThis->abPduResp[0]
+                         : (uint8_t *)(pReq + 1);
+        void *pvRespPayload = NULL;
+        size_t cbRespPayload = 0;
+
+        if (PSPCheckPointSet(&g_ChkPt))
+        {
+            rc = pspStubPduDataXferExec(pThis, pReq, &It, pbBuf);
+            if (   !rc
+                && (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_READ))
+            {
+                pvRespPayload = pbBuf;
+                cbRespPayload = pReq->cbXfer;
+            }
+        }
+
+        if (!pspStubPduDataXferIsPsp(pReq))
+            MAPMgrWinIterEnd(&It);
+
+        PSPSTS rcReq = rc;
+        pspStubPduCheckForExcp(pThis, &rcReq, (const void **)&pvRespPayload, &cbRespPayload);
+        rc = pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
+    }
+    else
+        rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    return rc;
+}
+
+
+/**
+ * Processes a scatter/gather data transfer request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessDataXferSg(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALDATAXFERSGREQ pReq = (PCPSPSERIALDATAXFERSGREQ)pvPayload;
+    PPSPSERIALDATAXFERSGRESP pResp = (PPSPSERIALDATAXFERSGRESP)&pThis->abPduResp[0];
+    PCPSPSERIALDATAXFERREQ paDescs = (PCPSPSERIALDATAXFERREQ)(pReq + 1);
+    size_t cbDescs = 0;
+    size_t cbData = 0;
+    size_t cbResp = sizeof(*pResp);
+
+    pResp->cDescsDone = 0;
+    pResp->u32Rsvd    = 0;
+
+    /* Validate everything upfront so a malformed list doesn't get executed partially. */
+    int rc = INF_SUCCESS;
+    if (   cbPayload < sizeof(*pReq)
+        || pReq->u32Rsvd
+        || pReq->cDescs > (cbPayload - sizeof(*pReq)) / sizeof(*paDescs))
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        cbDescs = sizeof(*pReq) + pReq->cDescs * sizeof(*paDescs);
+
+        for (uint32_t i = 0; i < pReq->cDescs && !rc; i++)
+        {
+            PCPSPSERIALDATAXFERREQ pDesc = &paDescs[i];
+            size_t cbDataLeft = cbPayload - cbDescs > cbData ? cbPayload - cbDescs - cbData : 0;
+
+            rc = pspStubPduDataXferValidate(pDesc, cbDataLeft);
+            if (rc)
+                break;
+
+            if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+                cbData += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbStride);
+            else if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_READ)
+            {
+                if (sizeof(pThis->abPduResp) - cbResp < pDesc->cbXfer)
+                    rc = ERR_INVALID_PARAMETER;
+                cbResp += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbXfer);
+            }
+            else if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_WRITE)
+            {
+                if (cbDataLeft < pDesc->cbXfer)
+                    rc = ERR_INVALID_PARAMETER;
+                cbData += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbXfer);
+            }
+            else
+                rc = ERR_INVALID_PARAMETER;
+        }
+    }
+
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_DATA_XFER_SG, pResp, sizeof(*pResp));
+
+    /* Execute the descriptors in order, stopping at the first one failing. */
+    const uint8_t *pbData = (const uint8_t *)pvPayload + cbDescs;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    cbResp = sizeof(*pResp);
+    for (uint32_t i = 0; i < pReq->cDescs; i++)
+    {
+        PCPSPSERIALDATAXFERREQ pDesc = &paDescs[i];
+        bool fRead =    !(pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+                     && (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_READ);
+        uint8_t *pbBuf = fRead ? &pThis->abPduResp[cbResp] : (uint8_t *)pbData;
+        const void *pvDummy = pbBuf;
+        size_t cbDummy = 0;
+        MAPMGRWINITER It;
+
+        rc = pspStubPduDataXferIterInit(pThis, pDesc, &It);
+        if (rc)
+        {
+            rcReq = rc;
+            break;
+        }
+
+        if (PSPCheckPointSet(&g_ChkPt))
+            rcReq = pspStubPduDataXferExec(pThis, pDesc, &It, pbBuf);
+
+        if (!pspStubPduDataXferIsPsp(pDesc))
+            MAPMgrWinIterEnd(&It);
+
+        pspStubPduCheckForExcp(pThis, &rcReq, &pvDummy, &cbDummy);
+        if (rcReq != STS_INF_SUCCESS)
+            break;
+
+        if (fRead)
+            cbResp += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbXfer);
+        else if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+            pbData += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbStride);
+        else
+            pbData += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbXfer);
+        pResp->cDescsDone++;
+    }
+
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_DATA_XFER_SG, pResp, cbResp);
+}
+
+
+/**
+ * Generates the next elements of a counter or LFSR fill sequence.
+ *
+ * @returns nothing.
+ * @param   enmMode                 The fill mode, PSP_SERIAL_FILL_MODE_COUNTER or PSP_SERIAL_FILL_MODE_LFSR.
+ * @param   pbBuf                   Where to store the elements.
+ * @param   cbBuf                   Number of bytes to generate, multiple of the element size.
+ * @param   cbElem                  The element size, 1, 2, 4 or 8.
+ * @param   pu64State               The counter value or LFSR state, updated on return.
+ * @param   u64Incr                 The counter increment.
+ */
+static void pspStubFillGen(uint32_t enmMode, uint8_t *pbBuf, size_t cbBuf, size_t cbElem, uint64_t *pu64State, uint64_t u64Incr)
+{
+    uint64_t u64State = *pu64State;
+
+    /* The PSP is little endian, so copying the low bytes of the state truncates it to the element size. */
+    for (size_t off = 0; off < cbBuf; off += cbElem)
+    {
+        memcpy(&pbBuf[off], &u64State, cbElem);
+
+        if (enmMode == PSP_SERIAL_FILL_MODE_COUNTER)
+            u64State += u64Incr;
+        else
+        {
+            u64State ^= u64State << 13;
+            u64State ^= u64State >> 7;
+            u64State ^= u64State << 17;
+        }
+    }
+
+    *pu64State = u64State;
+}
+
+
+/**
+ * Processes a fill request, generating the data on the PSP.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessFill(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALFILLREQ pReq = (PCPSPSERIALFILLREQ)pvPayload;
+    PSPSERIALFILLRESP Resp;
+    MAPMGRADDRSPACE enmAddrSpace = MAPMGRADDRSPACE_INVALID;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    MAPMGRWINITER It;
+
+    memset(&Resp, 0, sizeof(Resp));
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload < sizeof(*pReq)
+        || (   pReq->cbElem != 1
+            && pReq->cbElem != 2
+            && pReq->cbElem != 4
+            && pReq->cbElem != 8)
+        || pReq->u64AddrStart % pReq->cbElem
+        || !pReq->cbRange
+        || pReq->cbRange % pReq->cbElem
+        || (pReq->fFlags & ~PSP_SERIAL_FILL_F_BURST)
+        || (   (pReq->fFlags & PSP_SERIAL_FILL_F_BURST)
+            && pReq->cbElem < 4))
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        switch (pReq->enmMode)
+        {
+            case PSP_SERIAL_FILL_MODE_PATTERN:
+                /* The pattern is repeated in the staging buffer so it has to fit at least once. */
+                if (   !pReq->cbPattern
+                    || pReq->cbPattern % pReq->cbElem
+                    || pReq->cbPattern > sizeof(pThis->abStaging)
+                    || cbPayload - sizeof(*pReq) < pReq->cbPattern)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            case PSP_SERIAL_FILL_MODE_COUNTER:
+                if (pReq->cbPattern)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            case PSP_SERIAL_FILL_MODE_LFSR:
+                /* Zero is the fixed point of the LFSR. */
+                if (   pReq->cbPattern
+                    || !pReq->u64Seed)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            default:
+                rc = ERR_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    if (!rc)
+    {
+        switch (pReq->enmAddrSpace)
+        {
+            case PSPADDRSPACE_PSP_MEM:
+            case PSPADDRSPACE_PSP_MMIO:
+                /* The address space of the other PSPs isn't reachable from here. */
+                if (pThis->idCcdReq)
+                    rc = ERR_NOT_IMPLEMENTED;
+                else if (   pReq->u64AddrStart > UINT32_MAX
+                         || pReq->cbRange > (uint64_t)UINT32_MAX + 1 - pReq->u64AddrStart)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            case PSPADDRSPACE_SMN:
+                enmAddrSpace = MAPMGRADDRSPACE_SMN;
+                break;
+            case PSPADDRSPACE_X86_MEM:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            case PSPADDRSPACE_X86_MMIO:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            default:
+                rc = ERR_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    if (   !rc
+        && enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, pReq->u64AddrStart, pReq->cbRange, uMemType,
+                                 enmAddrSpace == MAPMGRADDRSPACE_SMN ? pThis->idCcdReq : 0);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_FILL, &Resp, sizeof(Resp));
+
+    /*
+     * The data is generated into the staging buffer and copied from there with the same loops as a data
+     * transfer. A pattern is repeated as often as it fits once upfront and each copy starts at the
+     * pattern offset the destination is at, so the buffer only has to be set up once.
+     */
+    size_t cbStaging = sizeof(pThis->abStaging);
+    size_t offPattern = 0;
+    uint64_t u64State = pReq->u64Seed;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    uint64_t tsStart = pspStubGetMicros(pThis);
+
+    if (pReq->enmMode == PSP_SERIAL_FILL_MODE_PATTERN)
+    {
+        cbStaging -= cbStaging % pReq->cbPattern;
+        for (size_t off = 0; off < cbStaging; off += pReq->cbPattern)
+            memcpy(&pThis->abStaging[off], (pReq + 1), pReq->cbPattern);
+    }
+    else
+        cbStaging -= cbStaging % pReq->cbElem;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        while (Resp.cbFilled < pReq->cbRange)
+        {
+            size_t cbChunk = (size_t)MIN(cbStaging - offPattern, pReq->cbRange - Resp.cbFilled);
+            void *pvMap = NULL;
+
+            if (enmAddrSpace == MAPMGRADDRSPACE_INVALID)
+                pvMap = (void *)(uintptr_t)(pReq->u64AddrStart + Resp.cbFilled);
+            else
+            {
+                rcReq = MAPMgrWinIterNext(&It, cbChunk, &pvMap, &cbChunk);
+                if (   rcReq
+                    || !cbChunk)
+                    break;
+            }
+
+            /* The state is only advanced once the chunk was written, so it matches cbFilled should the write fault. */
+            uint64_t u64StateNext = u64State;
+            if (pReq->enmMode != PSP_SERIAL_FILL_MODE_PATTERN)
+                pspStubFillGen(pReq->enmMode, &pThis->abStaging[0], cbChunk, pReq->cbElem, &u64StateNext, pReq->u64Incr);
+
+            if (pReq->fFlags & PSP_SERIAL_FILL_F_BURST)
+                pspStubDataXferBurstCopy(pvMap, &pThis->abStaging[offPattern], cbChunk, pReq->cbElem);
+            else
+                pspStubDataXferStrided(pvMap, &pThis->abStaging[offPattern], cbChunk, pReq->cbElem,
+                                       true /*fIncrDst*/, true /*fIncrSrc*/);
+
+            if (pReq->enmMode == PSP_SERIAL_FILL_MODE_PATTERN)
+                offPattern = (offPattern + cbChunk) % pReq->cbPattern;
+            u64State       = u64StateNext;
+            Resp.cbFilled += cbChunk;
+        }
+    }
+
+    Resp.u64SeedNext = u64State;
+    Resp.cMicros     = pspStubGetMicros(pThis) - tsStart;
+
+    if (enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        MAPMgrWinIterEnd(&It);
+
+    const void *pvRespPayload = &Resp;
+    size_t cbRespPayload = sizeof(Resp);
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_FILL, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Copies memory with the CPU, moving 4 byte aligned runs in ldm/stm bursts.
+ *
+ * @returns nothing.
+ * @param   pvDst                   The destination.
+ * @param   pvSrc                   The source.
+ * @param   cbCopy                  Number of bytes to copy.
+ */
+static void pspStubCopyCpu(void *pvDst, const void *pvSrc, size_t cbCopy)
+{
+    size_t cbBursts = cbCopy & ~(size_t)(PSP_SERIAL_STUB_BURST_SZ - 1);
+
+    if (   cbBursts
+        && !(((uintptr_t)pvDst | (uintptr_t)pvSrc) & 0x3))
+    {
+        pspStubDataXferBurstCopy(pvDst, pvSrc, cbBursts, sizeof(uint32_t));
+        pvDst   = (uint8_t *)pvDst + cbBursts;
+        pvSrc   = (const uint8_t *)pvSrc + cbBursts;
+        cbCopy -= cbBursts;
+    }
+
+    memcpy(pvDst, pvSrc, cbCopy);
+}
+
+
+/**
+ * Copies between x86 memory and PSP memory, through the CCP if possible and with the CPU otherwise,
+ * must be called with a checkpoint set.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   PhysX86Addr             The x86 physical address.
+ * @param   pvPsp                   The PSP memory.
+ * @param   cbCopy                  Number of bytes to copy.
+ * @param   fToX86                  Flag whether to copy to the x86 memory instead of from it.
+ * @param   uMemType                The memory type for the CPU copy, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
+ * @param   fCpu                    Flag whether to copy with the CPU even if the CCP is available.
+ * @param   pfCcp                   Where to store whether the CCP did the copy.
+ */
+static int pspStubX86Copy(PPSPSTUBSTATE pThis, X86PADDR PhysX86Addr, void *pvPsp, size_t cbCopy, bool fToX86,
+                          uint32_t uMemType, bool fCpu, bool *pfCcp)
+{
+    MAPMGRWINITER It;
+
+    /* The CCP doesn't go through the mapping slots, so it can't honour an explicit memory type. */
+    *pfCcp = false;
+    if (   !fCpu
+        && uMemType == MAPMGR_X86_MEMTYPE_DEFAULT
+        && CCPIsAvailable(&pThis->Ccp))
+    {
+        int rc = pspSerialStubCcpX86Copy(PhysX86Addr, pvPsp, cbCopy, fToX86);
+        /* A timed out submission is halted before returning, so the whole range can be copied again with the CPU. */
+        if (rc != ERR_TIMEOUT)
+        {
+            *pfCcp = true;
+            return rc;
+        }
+    }
+
+    int rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, MAPMGRADDRSPACE_X86_MEM, PhysX86Addr, cbCopy, uMemType, 0 /*idSmnDie*/);
+    if (rc)
+        return rc;
+
+    uint8_t *pbPsp = (uint8_t *)pvPsp;
+    for (;;)
+    {
+        void *pvMap = NULL;
+        size_t cbChunk = 0;
+
+        rc = MAPMgrWinIterNext(&It, cbCopy, &pvMap, &cbChunk);
+        if (   rc
+            || !cbChunk)
+            break;
+
+        if (fToX86)
+            pspStubCopyCpu(pvMap, pbPsp, cbChunk);
+        else
+            pspStubCopyCpu(pbPsp, pvMap, cbChunk);
+        pbPsp += cbChunk;
+    }
+
+    MAPMgrWinIterEnd(&It);
+    return rc;
+}
+
+
+/**
+ * Processes a x86 copy request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessX86Copy(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALX86COPYREQ pReq = (PCPSPSERIALX86COPYREQ)pvPayload;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    PSPSERIALX86COPYRESP Resp;
+
+    memset(&Resp, 0, sizeof(Resp));
+    if (   cbPayload != sizeof(*pReq)
+        || !pReq->cbCopy
+        || pReq->cbCopy - 1 > UINT32_MAX - pReq->PspAddr
+        || (pReq->fFlags & ~(PSP_SERIAL_X86_COPY_F_TO_X86 | PSP_SERIAL_X86_COPY_F_CPU))
+        || pspStubX86CachingToMemType(pReq->fCaching, &uMemType))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_X86_COPY,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    /* The memory of the other PSPs isn't reachable from here. */
+    if (pThis->idCcdReq)
+        return pspStubPduSend(pThis, ERR_NOT_IMPLEMENTED, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_X86_COPY,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    const void *pvRespPayload = NULL;
+    size_t cbRespPayload = 0;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        uint64_t tsStart = pspStubGetMicros(pThis);
+        bool fCcp = false;
+
+        rcReq = pspStubX86Copy(pThis, pReq->PhysX86Addr, (void *)(uintptr_t)pReq->PspAddr, pReq->cbCopy,
+                               (pReq->fFlags & PSP_SERIAL_X86_COPY_F_TO_X86) ? true : false, uMemType,
+                               (pReq->fFlags & PSP_SERIAL_X86_COPY_F_CPU) ? true : false, &fCcp);
+        Resp.cMicros  = pspStubGetMicros(pThis) - tsStart;
+        Resp.fCcp     = fCcp ? 1 : 0;
+        pvRespPayload = &Resp;
+        cbRespPayload = sizeof(Resp);
+    }
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_X86_COPY, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Writes to the given input buffer.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ */
+static int pspStubPduProcessInputBufWrite(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALINBUFWRREQ pReq = (PCPSPSERIALINBUFWRREQ)pvPayload;
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload > sizeof(*pReq)
+        && pReq->idInBuf < ELEMENTS(pThis->aInBufs))
+    {
+        PPSPINBUF pInBuf = &pThis->aInBufs[pReq->idInBuf];
+        uint8_t *pbData = (uint8_t *)(pReq + 1);
+        uint8_t *pbDst = (uint8_t *)pInBuf->pvInBuf + pInBuf->offInBuf;
+        size_t cbData = cbPayload - sizeof(*pReq);
+
+        if (cbData <= pInBuf->cbInBuf - pInBuf->offInBuf)
+        {
+            memcpy(pbDst, pbData, cbData);
+            pInBuf->offInBuf += cbData;
+        }
+        else
+            rc = ERR_INVALID_PARAMETER;
+    }
+    else
+        rc = ERR_INVALID_PARAMETER;
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_INPUT_BUF_WRITE, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Initiates a load code module request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ */
+static int pspStubPduProcessLoadCodeMod(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALLOADCODEMODREQ pReq = (PCPSPSERIALLOADCODEMODREQ)pvPayload;
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload == sizeof(*pReq)
+        && pReq->u32Pad0 < ELEMENTS(pThis->aInBufs))
+    {
+        if (pReq->enmCmType == PSPSERIALCMTYPE_FLAT_BINARY)
+        {
+            PPSPINBUF pInBuf = &pThis->aInBufs[pReq->u32Pad0];
+            pInBuf->pvInBuf  = (void *)CM_FLAT_BINARY_LOAD_ADDR;
+            pInBuf->cbInBuf  = 0x3f000 - CM_FLAT_BINARY_LOAD_ADDR;
+            pInBuf->offInBuf = 0;
+            memset(pInBuf->pvInBuf, 0, pInBuf->cbInBuf);
+        }
+        else
+            rc = ERR_NOT_IMPLEMENTED;
+    }
+    else
+        rc = ERR_INVALID_PARAMETER;
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_LOAD_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Executes a previously loaded code module.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ */
+static int pspStubPduProcessExecCodeMod(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+#ifndef PSP_SERIAL_STUB_HOST
+    PCPSPSERIALEXECCODEMODREQ pReq = (PCPSPSERIALEXECCODEMODREQ)pvPayload;
+
+    int rc = INF_SUCCESS;
+    if (cbPayload == sizeof(*pReq))
+    {
+        uint32_t u32Arg0 = pReq->u32Arg0;
+        uint32_t u32Arg1 = pReq->u32Arg1;
+        uint32_t u32Arg2 = pReq->u32Arg2;
+        uint32_t u32Arg3 = pReq->u32Arg3;
+
+        /* Send a success response before running the code module. */
+        rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_EXEC_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+        if (!rc)
+        {
+            /* Setup the code exec helper. */
+            CMEXEC CmExec;
+
+            CmExec.pStub               = pThis;
+            CmExec.CmIf.pfnInBufPeek   = pspStubCmIfInBufPeekAsm;
+            CmExec.CmIf.pfnInBufPoll   = pspStubCmIfInBufPollAsm;
+            CmExec.CmIf.pfnInBufRead   = pspStubCmIfInBufReadAsm;
+            CmExec.CmIf.pfnOutBufWrite = pspStubCmIfOutBufWriteAsm;
+            CmExec.CmIf.pfnDelayMs     = pspStubCmIfDelayMsAsm;
+            CmExec.CmIf.pfnTsGetMilli  = pspStubCmIfTsGetMilliAsm;
+
+            /* The code module programs the mapping slots on its own. */
+            MAPMgrX86Flush(&pThis->MapMgr);
+            MAPMgrSmnFlush(&pThis->MapMgr);
+
+            /* Reset the stdin buffer. */
+            PPSPINBUF pInBuf = &pThis->aInBufs[0];
+            pInBuf->pvInBuf  = &pThis->abScratch[0];
+            pInBuf->cbInBuf  = sizeof(pThis->abScratch);
+            pInBuf->offInBuf = 0;
+
+            /* Call the module. */
+            PFNCMENTRY pfnEntry = (PFNCMENTRY)CM_FLAT_BINARY_LOAD_ADDR;
+            uint32_t u32CmRet = pfnEntry(&CmExec.CmIf, u32Arg0, u32Arg1, u32Arg2, u32Arg3);
+            MAPMgrX86Flush(&pThis->MapMgr);
+            MAPMgrSmnFlush(&pThis->MapMgr);
+
+            /* The code module finished, send the notification. */
+            PSPSERIALEXECCMFINISHEDNOT ExecFinishedNot;
+            ExecFinishedNot.u32CmRet = u32CmRet;
+            ExecFinishedNot.u32Pad0  = 0;
+            rc = pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_NOTIFICATION_CODE_MOD_EXEC_FINISHED, &ExecFinishedNot, sizeof(ExecFinishedNot));
+        }
+    }
+    else
+        rc = pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_EXEC_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    return rc;
+#else
+    (void)pvPayload;
+    (void)cbPayload;
+
+    /* Code modules are PSP code, nothing we can run on the host. */
+    return pspStubPduSend(pThis, ERR_NOT_IMPLEMENTED, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_EXEC_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+#endif
+}
+
+
+/**
+ * Branches to a given address.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               PDU payload.
+ * @param   cbPayload               Payload size in bytes.
+ */
+static int pspStubPduProcessBranchTo(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALBRANCHTOREQ pReq = (PCPSPSERIALBRANCHTOREQ)pvPayload;
+
+    int rc = INF_SUCCESS;
+    if (cbPayload == sizeof(*pReq))
+    {
+        /* Send the response for branching of. */
+        rc = pspStubPduSend(pThis, STS_INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_BRANCH_TO, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+        if (STS_SUCCESS(rc))
+        {
+            PSPADDR PspAddrDst = pReq->PspAddrDst;
+            if (pReq->u32Flags & PSP_SERIAL_BRANCH_TO_F_THUMB)
+                PspAddrDst |= 1; /* switches to thumb in our assembly helper. */
+
+            pspStubTranspTerm(pThis); /* Terminate the transport layer. */
+            MAPMgrX86Flush(&pThis->MapMgr); /* Don't leave any cached mappings behind. */
+            MAPMgrSmnFlush(&pThis->MapMgr);
+            pspStubBranchToAsm(PspAddrDst, &pReq->au32Gprs[0]); /* This will NOT return!. */
+        }
+    }
+    else
+        rc = pspStubPduSend(pThis, STS_ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_BRANCH_TO, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    return rc;
+}
+
+
+/**
+ * Processes a transport statistics query request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessTranspStatsQuery(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PSPSERIALTRANSPSTATSRESP Resp;
+    PSPPDUTRANSPSTATS Stats;
+
+    if (cbPayload)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_TRANSP_STATS_QUERY,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    memset(&Resp, 0, sizeof(Resp));
+    int rc = pThis->pIfTransp->pfnQueryStats(pThis->hPduTransp, &Stats);
+    if (!rc)
+    {
+        Resp.enmTranspId = pThis->enmTranspId;
+        Resp.cPdusSent   = pThis->cPdusSent;
+        Resp.cPdusRecvd  = pThis->cPduRecvNext - 1;
+        Resp.cReads      = Stats.cReads;
+        Resp.cWrites     = Stats.cWrites;
+        Resp.cBusyWaits  = Stats.cBusyWaits;
+        Resp.cLocks      = Stats.cLocks;
+        Resp.cbRead      = Stats.cbRead;
+        Resp.cbWritten   = Stats.cbWritten;
+        Resp.cUsBlocked  = Stats.cUsBlocked;
+    }
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_TRANSP_STATS_QUERY,
+                          &Resp, sizeof(Resp));
+}
+
+
+/**
+ * Processes a mapping flush request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMapFlush(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    (void)pvPayload;
+
+    if (cbPayload)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_FLUSH,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    MAPMgrX86Flush(&pThis->MapMgr);
+    MAPMgrSmnFlush(&pThis->MapMgr);
+    return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_FLUSH,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Processes a mapping statistics query request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMapStatsQuery(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PSPSERIALMAPSTATSRESP Resp;
+    MAPMGRSTATS Stats;
+
+    (void)pvPayload;
+
+    if (cbPayload)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_STATS_QUERY,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    MAPMgrQueryStats(&pThis->MapMgr, &Stats);
+    Resp.cX86Hits        = Stats.X86.cHits;
+    Resp.cX86Misses      = Stats.X86.cMisses;
+    Resp.cX86Evictions   = Stats.X86.cEvictions;
+    Resp.cX86SlotsMapped = Stats.cX86SlotsMapped;
+    Resp.cSmnHits        = Stats.Smn.cHits;
+    Resp.cSmnMisses      = Stats.Smn.cMisses;
+    Resp.cSmnEvictions   = Stats.Smn.cEvictions;
+    Resp.cSmnSlotsMapped = Stats.cSmnSlotsMapped;
+
+    return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_STATS_QUERY,
+                          &Resp, sizeof(Resp));
+}
+
+
+/**
+ * Fills in the slot statistics entry from the given slot information.
+ *
+ * @returns nothing.
+ * @param   pSlotStats              The slot statistics entry to fill in.
+ * @param   pInfo                   The slot information.
+ */
+static void pspStubMapSlotStatsFromInfo(PPSPSERIALMAPSLOTSTATS pSlotStats, PCMAPMGRSLOTINFO pInfo)
+{
+    pSlotStats->uAddrBase  = pInfo->uAddrBase;
+    pSlotStats->uMemType   = pInfo->uMemType;
+    pSlotStats->cRefs      = pInfo->cRefs;
+    pSlotStats->cHits      = pInfo->Stats.cHits;
+    pSlotStats->cMisses    = pInfo->Stats.cMisses;
+    pSlotStats->cEvictions = pInfo->Stats.cEvictions;
+    pSlotStats->idDie      = pInfo->idDie;
+}
+
+
+/**
+ * Processes a per mapping slot statistics query request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMapSlotStatsQuery(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PPSPSERIALMAPSLOTSTATSRESP pResp = (PPSPSERIALMAPSLOTSTATSRESP)&pThis->abPduResp[0];
+    PPSPSERIALMAPSLOTSTATS pSlotStats = (PPSPSERIALMAPSLOTSTATS)(pResp + 1);
+    MAPMGRSLOTINFO Info;
+
+    (void)pvPayload;
+
+    if (cbPayload)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_SLOT_STATS_QUERY,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    pResp->cX86Slots = MAPMGR_X86_SLOT_COUNT;
+    pResp->cSmnSlots = MAPMGR_SMN_SLOT_COUNT;
+    for (uint32_t i = 0; i < MAPMGR_X86_SLOT_COUNT; i++)
+    {
+        MAPMgrX86SlotQuery(&pThis->MapMgr, i, &Info);
+        pspStubMapSlotStatsFromInfo(pSlotStats++, &Info);
+    }
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+    {
+        MAPMgrSmnSlotQuery(&pThis->MapMgr, i, &Info);
+        pspStubMapSlotStatsFromInfo(pSlotStats++, &Info);
+    }
+
+    return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_SLOT_STATS_QUERY,
+                          pResp, (uint8_t *)pSlotStats - (uint8_t *)pResp);
+}
+
+
+/**
+ * Processes a range read request, streaming the range to the host.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMemRangeRead(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALMEMRANGEREADREQ pReq = (PCPSPSERIALMEMRANGEREADREQ)pvPayload;
+    PSPSERIALMEMRANGEREADRESP Resp;
+    MAPMGRADDRSPACE enmAddrSpace = MAPMGRADDRSPACE_INVALID;
+    MAPMGRWINITER It;
+
+    Resp.cbRead = 0;
+    if (cbPayload != sizeof(*pReq))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MEM_RANGE_READ,
+                              &Resp, sizeof(Resp));
+
+    switch (pReq->enmAddrSpace)
+    {
+        case PSPADDRSPACE_SMN:
+            enmAddrSpace = MAPMGRADDRSPACE_SMN;
+            break;
+        case PSPADDRSPACE_X86_MEM:
+            enmAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+            break;
+        case PSPADDRSPACE_X86_MMIO:
+            enmAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+            break;
+        default:
+            break;
+    }
+
+    int rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, pReq->u64AddrStart, pReq->cbRead, MAPMGR_X86_MEMTYPE_DEFAULT,
+                                 enmAddrSpace == MAPMGRADDRSPACE_SMN ? pThis->idCcdReq : 0);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MEM_RANGE_READ,
+                              &Resp, sizeof(Resp));
+
+    /* The data is copied into the staging buffer first so an access fault doesn't hit while sending. */
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    for (;;)
+    {
+        const void *pvData = NULL;
+        void *pvMap = NULL;
+        size_t cbChunk = 0;
+
+        rc = MAPMgrWinIterNext(&It, PSP_SERIAL_STUB_MEM_RANGE_CHUNK_SZ, &pvMap, &cbChunk);
+        if (   rc
+            || !cbChunk)
+        {
+            rcReq = rc;
+            break;
+        }
+
+        if (PSPCheckPointSet(&g_ChkPt))
+        {
+            memcpy(&pThis->abStaging[0], pvMap, cbChunk);
+            pvData = &pThis->abStaging[0];
+        }
+
+        pspStubPduCheckForExcp(pThis, &rcReq, &pvData, &cbChunk);
+        if (rcReq != STS_INF_SUCCESS)
+            break;
+
+        PSPSERIALMEMRANGEDATA DataHdr;
+        DataHdr.offData = Resp.cbRead;
+        rc = pspStubPduSend2(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_NOTIFICATION_MEM_RANGE_DATA,
+                             &DataHdr, sizeof(DataHdr), pvData, cbChunk);
+        if (rc)
+        {
+            rcReq = rc;
+            break;
+        }
+
+        Resp.cbRead += cbChunk;
+    }
+
+    MAPMgrWinIterEnd(&It);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MEM_RANGE_READ,
+                          &Resp, sizeof(Resp));
+}
+
+
+/**
+ * Processes a window pin request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMapPin(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALMAPPINREQ pReq = (PCPSPSERIALMAPPINREQ)pvPayload;
+    PPSPSTUBMAPPIN pPin = NULL;
+    PSPSERIALMAPPINRESP Resp;
+    void *pvMap = NULL;
+    int rc = INF_SUCCESS;
+
+    memset(&Resp, 0, sizeof(Resp));
+    if (cbPayload != sizeof(*pReq))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_PIN,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aMapPins); i++)
+    {
+        if (pThis->aMapPins[i].enmAddrSpace == PSPADDRSPACE_INVALID)
+        {
+            pPin = &pThis->aMapPins[i];
+            Resp.idPin = i;
+            break;
+        }
+    }
+
+    if (!pPin)
+        return pspStubPduSend(pThis, ERR_INVALID_STATE, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_PIN,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    /* The reference held by the pin keeps the window from being evicted or flushed. */
+    switch (pReq->enmAddrSpace)
+    {
+        case PSPADDRSPACE_SMN:
+            Resp.cbWindow  = _1M;
+            Resp.uAddrBase = pReq->u64Addr & ~(uint64_t)(_1M - 1);
+            if (pReq->u64Addr <= UINT32_MAX)
+                rc = MAPMgrSmnMapEx(&pThis->MapMgr, pThis->idCcdReq, (SMNADDR)Resp.uAddrBase, &pvMap);
+            else
+                rc = ERR_INVALID_PARAMETER;
+            break;
+        case PSPADDRSPACE_X86_MEM:
+        case PSPADDRSPACE_X86_MMIO:
+            Resp.cbWindow  = _64M;
+            Resp.uAddrBase = pReq->u64Addr & ~(uint64_t)(_64M - 1);
+            rc = MAPMgrX86PhysMap(&pThis->MapMgr, Resp.uAddrBase, pReq->enmAddrSpace == PSPADDRSPACE_X86_MMIO, &pvMap);
+            break;
+        default:
+            rc = ERR_INVALID_PARAMETER;
+            break;
+    }
+
+    if (!rc)
+    {
+        pPin->enmAddrSpace = pReq->enmAddrSpace;
+        pPin->cbWindow     = Resp.cbWindow;
+        pPin->uAddrBase    = Resp.uAddrBase;
+        pPin->pbMap        = (uint8_t *)pvMap;
+
+        /* Don't let pins starve the request handlers of a slot class, they would fail with an obscure error otherwise. */
+        if (pspStubMapPinSlotsEvictable(pThis))
+            return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_PIN,
+                                  &Resp, sizeof(Resp));
+
+        pspStubMapPinRelease(pThis, pPin);
+        rc = ERR_INVALID_STATE;
+    }
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_PIN,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Processes a window unpin request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMapUnpin(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALMAPUNPINREQ pReq = (PCPSPSERIALMAPUNPINREQ)pvPayload;
+    int rc = INF_SUCCESS;
+
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->idPin >= ELEMENTS(pThis->aMapPins)
+        || pThis->aMapPins[pReq->idPin].enmAddrSpace == PSPADDRSPACE_INVALID)
+        rc = ERR_INVALID_PARAMETER;
+    else
+        pspStubMapPinRelease(pThis, &pThis->aMapPins[pReq->idPin]);
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MAP_UNPIN,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Reads/writes data through a pinned window.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ * @param   fWrite                  Flag whether this is a read or write request.
+ */
+static int pspStubPduProcessMapPinXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+{
+    PCPSPSERIALMAPPINXFERREQ pReq = (PCPSPSERIALMAPPINXFERREQ)pvPayload;
+    PSPSERIALPDURRNID enmResponse =   fWrite
+                                    ? PSPSERIALPDURRNID_RESPONSE_MAP_PIN_WRITE
+                                    : PSPSERIALPDURRNID_RESPONSE_MAP_PIN_READ;
+
+    if (   cbPayload < sizeof(*pReq)
+        || pReq->idPin >= ELEMENTS(pThis->aMapPins)
+        || (   fWrite
+            && cbPayload - sizeof(*pReq) < pReq->cbXfer)
+        || (   !fWrite
+            && pReq->cbXfer > sizeof(pThis->abPduResp)))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, enmResponse,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    PPSPSTUBMAPPIN pPin = &pThis->aMapPins[pReq->idPin];
+    if (   pPin->enmAddrSpace == PSPADDRSPACE_INVALID
+        || pReq->offWindow >= pPin->cbWindow
+        || pReq->cbXfer > pPin->cbWindow - pReq->offWindow)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, enmResponse,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    /* No lookup at all, the window stays mapped for as long as it is pinned. */
+    uint8_t *pbMap = pPin->pbMap + pReq->offWindow;
+    const void *pvRespPayload = NULL;
+    size_t cbRespPayload = 0;
+    bool fMmioAccess =    pReq->cbXfer == 1
+                       || pReq->cbXfer == 2
+                       || pReq->cbXfer == 4
+                       || pReq->cbXfer == 8;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        if (fWrite)
+        {
+            if (fMmioAccess)
+                pspStubMmioAccess(pbMap, (pReq + 1), pReq->cbXfer);
+            else
+                memcpy(pbMap, (pReq + 1), pReq->cbXfer);
+        }
+        else
+        {
+            if (fMmioAccess)
+                pspStubMmioAccess(&pThis->abPduResp[0], pbMap, pReq->cbXfer);
+            else
+                memcpy(&pThis->abPduResp[0], pbMap, pReq->cbXfer);
+            pvRespPayload = &pThis->abPduResp[0];
+            cbRespPayload = pReq->cbXfer;
+        }
+    }
+
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, enmResponse, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Reads/writes x86 memory with an explicit memory type.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ * @param   fWrite                  Flag whether this is a read or write request.
+ */
+static int pspStubPduProcessX86XferEx(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload, bool fWrite)
+{
+    PCPSPSERIALX86XFEREXREQ pReq = (PCPSPSERIALX86XFEREXREQ)pvPayload;
+    PSPSERIALPDURRNID enmResponse =   fWrite
+                                    ? PSPSERIALPDURRNID_RESPONSE_X86_XFER_EX_WRITE
+                                    : PSPSERIALPDURRNID_RESPONSE_X86_XFER_EX_READ;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+
+    if (   cbPayload < sizeof(*pReq)
+        || (pReq->fFlags & ~PSP_SERIAL_X86_XFER_EX_F_MMIO)
+        || pReq->u32Rsvd
+        || (   fWrite
+            && cbPayload - sizeof(*pReq) < pReq->cbXfer)
+        || pspStubX86CachingToMemType(pReq->fCaching, &uMemType))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, enmResponse,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    bool fMmio = (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_MMIO) ? true : false;
+    const void *pvWrite = fWrite ? (pReq + 1) : NULL;
+
+    /* Register sized MMIO accesses not crossing a window are done as a single access. */
+    if (   fMmio
+        && (   pReq->cbXfer == 1
+            || pReq->cbXfer == 2
+            || pReq->cbXfer == 4
+            || pReq->cbXfer == 8)
+        && (pReq->PhysX86Start & (_64M - 1)) + pReq->cbXfer <= _64M)
+        return pspStubPduProcessX86RegXfer(pThis, pReq->PhysX86Start, uMemType, pReq->cbXfer, pvWrite, enmResponse);
+
+    return pspStubPduProcessRangeXfer(pThis, fMmio ? MAPMGRADDRSPACE_X86_MMIO : MAPMGRADDRSPACE_X86_MEM,
+                                      pReq->PhysX86Start, pReq->cbXfer, uMemType, pvWrite, enmResponse);
+}
+
+
+/**
+ * Measures the x86 memory throughput for the requested memory type.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessX86MemBench(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALX86MEMBENCHREQ pReq = (PCPSPSERIALX86MEMBENCHREQ)pvPayload;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+
+    if (   cbPayload != sizeof(*pReq)
+        || (pReq->fFlags & ~(PSP_SERIAL_X86_XFER_EX_F_MMIO | PSP_SERIAL_X86_XFER_EX_F_WRITE | PSP_SERIAL_X86_XFER_EX_F_CCP))
+        || pspStubX86CachingToMemType(pReq->fCaching, &uMemType)
+        || (   (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_CCP)
+            && (   (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_MMIO)
+                || uMemType != MAPMGR_X86_MEMTYPE_DEFAULT)))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_X86_MEM_BENCH,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    PSPSERIALX86MEMBENCHRESP Resp;
+    const void *pvRespPayload = NULL;
+    size_t cbRespPayload = 0;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        uint64_t cMicros = 0;
+
+        rcReq = pspSerialStubBenchX86Mem(pReq->PhysX86Start, pReq->cbRange,
+                                         (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_MMIO) ? true : false, uMemType,
+                                         (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_WRITE) ? true : false,
+                                         (pReq->fFlags & PSP_SERIAL_X86_XFER_EX_F_CCP) ? true : false,
+                                         pReq->cPasses, &pThis->abStaging[0], sizeof(pThis->abStaging), &cMicros);
+        if (!rcReq)
+        {
+            Resp.cbXfered = (uint64_t)pReq->cbRange * pReq->cPasses;
+            Resp.cMicros  = cMicros;
+            pvRespPayload = &Resp;
+            cbRespPayload = sizeof(Resp);
+        }
+    }
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_X86_MEM_BENCH, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Processes a register poll benchmark request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessRegPollBench(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALREGPOLLBENCHREQ pReq = (PCPSPSERIALREGPOLLBENCHREQ)pvPayload;
+
+    if (   cbPayload != sizeof(*pReq)
+        || (pReq->fFlags & ~PSP_SERIAL_REG_POLL_BENCH_F_NO_CACHE)
+        || (pReq->SmnAddr & (sizeof(uint32_t) - 1))
+        || pReq->u32Rsvd)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_REG_POLL_BENCH,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    PSPSERIALREGPOLLBENCHRESP Resp;
+    const void *pvRespPayload = NULL;
+    size_t cbRespPayload = 0;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        uint64_t cMicros = 0;
+
+        rcReq = pspSerialStubBenchSmnPoll(pThis->idCcdReq, pReq->SmnAddr,
+                                          (pReq->fFlags & PSP_SERIAL_REG_POLL_BENCH_F_NO_CACHE) ? true : false,
+                                          pReq->cPolls, &cMicros);
+        if (!rcReq)
+        {
+            Resp.cPolls   = pReq->cPolls;
+            Resp.cMicros  = cMicros;
+            pvRespPayload = &Resp;
+            cbRespPayload = sizeof(Resp);
+        }
+    }
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_REG_POLL_BENCH, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Processes a memory search request, scanning the range for the pattern.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessMemSearch(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALMEMSEARCHREQ pReq = (PCPSPSERIALMEMSEARCHREQ)pvPayload;
+    PPSPSERIALMEMSEARCHRESP pResp = (PPSPSERIALMEMSEARCHRESP)&pThis->abPduResp[0];
+    uint64_t *pau64OffMatches = (uint64_t *)(pResp + 1);
+    uint32_t cMatchesMax = (sizeof(pThis->abPduResp) - sizeof(*pResp)) / sizeof(uint64_t);
+    MAPMGRADDRSPACE enmAddrSpace = MAPMGRADDRSPACE_INVALID;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    MEMSEARCH Search;
+    MAPMGRWINITER It;
+
+    pResp->cbScanned = 0;
+    pResp->cMatches  = 0;
+    pResp->u32Rsvd   = 0;
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload < sizeof(*pReq)
+        || (pReq->fFlags & ~PSP_SERIAL_MEM_SEARCH_F_VALID_MASK)
+        || !pReq->cMatchesMax
+        || pReq->u32Rsvd
+        ||   cbPayload - sizeof(*pReq)
+           != ((pReq->fFlags & PSP_SERIAL_MEM_SEARCH_F_MASK) ? 2 * pReq->cbPattern : pReq->cbPattern))
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        const uint8_t *pbPattern = (const uint8_t *)(pReq + 1);
+
+        rc = MEMSearchInit(&Search, pbPattern,
+                           (pReq->fFlags & PSP_SERIAL_MEM_SEARCH_F_MASK) ? pbPattern + pReq->cbPattern : NULL,
+                           pReq->cbPattern);
+    }
+
+    if (!rc)
+    {
+        switch (pReq->enmAddrSpace)
+        {
+            case PSPADDRSPACE_PSP_MEM:
+            case PSPADDRSPACE_PSP_MMIO:
+                /* The address space of the other PSPs isn't reachable from here. */
+                if (pThis->idCcdReq)
+                    rc = ERR_NOT_IMPLEMENTED;
+                break;
+            case PSPADDRSPACE_SMN:
+                enmAddrSpace = MAPMGRADDRSPACE_SMN;
+                break;
+            case PSPADDRSPACE_X86_MEM:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            case PSPADDRSPACE_X86_MMIO:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            default:
+                rc = ERR_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    if (   !rc
+        && enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, pReq->u64AddrStart, pReq->cbRange, uMemType,
+                                 enmAddrSpace == MAPMGRADDRSPACE_SMN ? pThis->idCcdReq : 0);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MEM_SEARCH, pResp, sizeof(*pResp));
+
+    /*
+     * The range is copied into the staging buffer chunk by chunk, which keeps access faults out of the
+     * search and lets a match straddle mapping windows. The last cbPattern - 1 bytes of a chunk are
+     * carried over into the next one, they can't contain a complete match themselves.
+     */
+    size_t cbCarryMax = pReq->cbPattern - 1;
+    size_t cbChunkMax = sizeof(pThis->abStaging) - cbCarryMax;
+    uint64_t offChunk = 0;
+    size_t cbCarry = 0;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    cMatchesMax = MIN(cMatchesMax, pReq->cMatchesMax);
+    while (   offChunk < pReq->cbRange
+           && pResp->cMatches < cMatchesMax)
+    {
+        const void *pvData = NULL;
+        void *pvMap = NULL;
+        size_t cbChunk = 0;
+
+        if (enmAddrSpace == MAPMGRADDRSPACE_INVALID)
+        {
+            pvMap   = (void *)(uintptr_t)(pReq->u64AddrStart + offChunk);
+            cbChunk = (size_t)MIN(pReq->cbRange - offChunk, cbChunkMax);
+        }
+        else
+        {
+            rc = MAPMgrWinIterNext(&It, cbChunkMax, &pvMap, &cbChunk);
+            if (   rc
+                || !cbChunk)
+            {
+                rcReq = rc;
+                break;
+            }
+        }
+
+        if (PSPCheckPointSet(&g_ChkPt))
+        {
+            memcpy(&pThis->abStaging[cbCarry], pvMap, cbChunk);
+            pvData = &pThis->abStaging[0];
+        }
+
+        size_t cbDummy = 0;
+        pspStubPduCheckForExcp(pThis, &rcReq, &pvData, &cbDummy);
+        if (rcReq != STS_INF_SUCCESS)
+            break;
+
+        uint64_t offBuf = offChunk - cbCarry; /* Range offset of the first staging buffer byte. */
+        size_t cbBuf = cbCarry + cbChunk;
+        size_t off = 0;
+        size_t offMatch = 0;
+
+        offChunk += cbChunk;
+        pResp->cbScanned = offChunk;
+        while (MEMSearchFind(&Search, &pThis->abStaging[off], cbBuf - off, &offMatch))
+        {
+            pau64OffMatches[pResp->cMatches++] = offBuf + off + offMatch;
+            off += offMatch + 1;
+            if (pResp->cMatches == cMatchesMax)
+            {
+                /* Resuming right after the last match finds everything the scan skipped. */
+                pResp->cbScanned = offBuf + off;
+                break;
+            }
+        }
+
+        /* Copying to the front byte by byte is fine even if the carry overlaps itself. */
+        cbCarry = MIN(cbCarryMax, cbBuf);
+        for (size_t i = 0; i < cbCarry; i++)
+            pThis->abStaging[i] = pThis->abStaging[cbBuf - cbCarry + i];
+    }
+
+    if (enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        MAPMgrWinIterEnd(&It);
+
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_MEM_SEARCH, pResp,
+                          sizeof(*pResp) + pResp->cMatches * sizeof(uint64_t));
+}
+
+
+/**
+ * Digest calculation state for the digest request.
+ */
+typedef union PSPSTUBDIGEST
+{
+    /** CRC32 so far. */
+    uint32_t                    uCrc32;
+    /** SHA-256 context. */
+    SHA256CTX                   Sha256;
+} PSPSTUBDIGEST;
+/** Pointer to a digest calculation state. */
+typedef PSPSTUBDIGEST *PPSPSTUBDIGEST;
+
+
+/**
+ * Starts a new digest.
+ *
+ * @returns nothing.
+ * @param   pDigest                 The digest state.
+ * @param   enmAlgo                 The digest algorithm, PSP_SERIAL_DIGEST_ALGO_XXX.
+ */
+static void pspStubDigestInit(PPSPSTUBDIGEST pDigest, uint32_t enmAlgo)
+{
+    if (enmAlgo == PSP_SERIAL_DIGEST_ALGO_CRC32)
+        pDigest->uCrc32 = 0;
+    else
+        SHA256Init(&pDigest->Sha256);
+}
+
+
+/**
+ * Adds the given data to the digest.
+ *
+ * @returns nothing.
+ * @param   pDigest                 The digest state.
+ * @param   enmAlgo                 The digest algorithm, PSP_SERIAL_DIGEST_ALGO_XXX.
+ * @param   pvBuf                   The data.
+ * @param   cbBuf                   Number of bytes.
+ */
+static void pspStubDigestUpdate(PPSPSTUBDIGEST pDigest, uint32_t enmAlgo, const void *pvBuf, size_t cbBuf)
+{
+    if (enmAlgo == PSP_SERIAL_DIGEST_ALGO_CRC32)
+        pDigest->uCrc32 = CRC32Calc(pDigest->uCrc32, pvBuf, cbBuf);
+    else
+        SHA256Update(&pDigest->Sha256, pvBuf, cbBuf);
+}
+
+
+/**
+ * Completes the digest.
+ *
+ * @returns nothing.
+ * @param   pDigest                 The digest state.
+ * @param   enmAlgo                 The digest algorithm, PSP_SERIAL_DIGEST_ALGO_XXX.
+ * @param   pbDigest                Where to store the digest.
+ */
+static void pspStubDigestFinal(PPSPSTUBDIGEST pDigest, uint32_t enmAlgo, uint8_t *pbDigest)
+{
+    if (enmAlgo == PSP_SERIAL_DIGEST_ALGO_CRC32)
+        memcpy(pbDigest, &pDigest->uCrc32, sizeof(pDigest->uCrc32));
+    else
+        SHA256Final(&pDigest->Sha256, pbDigest);
+}
+
+
+/**
+ * Processes a digest request, computing the digest of every block of the range.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessDigest(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALDIGESTREQ pReq = (PCPSPSERIALDIGESTREQ)pvPayload;
+    PPSPSERIALDIGESTRESP pResp = (PPSPSERIALDIGESTRESP)&pThis->abPduResp[0];
+    uint8_t *pbDigests = (uint8_t *)(pResp + 1);
+    MAPMGRADDRSPACE enmAddrSpace = MAPMGRADDRSPACE_INVALID;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    uint64_t cBlocks = 0;
+    MAPMGRWINITER It;
+
+    pResp->cBlocks  = 0;
+    pResp->cbDigest = 0;
+    pResp->cMicros  = 0;
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload != sizeof(*pReq)
+        || !pReq->cbRange
+        || (   pReq->enmAlgo != PSP_SERIAL_DIGEST_ALGO_CRC32
+            && pReq->enmAlgo != PSP_SERIAL_DIGEST_ALGO_SHA256))
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        pResp->cbDigest = pReq->enmAlgo == PSP_SERIAL_DIGEST_ALGO_CRC32 ? CRC32_SIZE : SHA256_DIGEST_SIZE;
+        cBlocks = pReq->cbBlock ? (pReq->cbRange + pReq->cbBlock - 1) / pReq->cbBlock : 1;
+        if (cBlocks > (sizeof(pThis->abPduResp) - sizeof(*pResp)) / pResp->cbDigest)
+            rc = ERR_INVALID_PARAMETER;
+    }
+
+    if (!rc)
+    {
+        switch (pReq->enmAddrSpace)
+        {
+            case PSPADDRSPACE_PSP_MEM:
+            case PSPADDRSPACE_PSP_MMIO:
+                /* The address space of the other PSPs isn't reachable from here. */
+                if (pThis->idCcdReq)
+                    rc = ERR_NOT_IMPLEMENTED;
+                else if (   pReq->u64AddrStart > UINT32_MAX
+                         || pReq->cbRange > (uint64_t)UINT32_MAX + 1 - pReq->u64AddrStart)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            case PSPADDRSPACE_SMN:
+                enmAddrSpace = MAPMGRADDRSPACE_SMN;
+                break;
+            case PSPADDRSPACE_X86_MEM:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            case PSPADDRSPACE_X86_MMIO:
+                enmAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            default:
+                rc = ERR_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    if (   !rc
+        && enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, pReq->u64AddrStart, pReq->cbRange, uMemType,
+                                 enmAddrSpace == MAPMGRADDRSPACE_SMN ? pThis->idCcdReq : 0);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_DIGEST, pResp, sizeof(*pResp));
+
+    /* The data is hashed in place, the chunks are cut at the block boundaries so a window never spans two blocks. */
+    const void *pvRespPayload = pResp;
+    size_t cbRespPayload = sizeof(*pResp);
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    uint64_t tsStart = pspStubGetMicros(pThis);
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        uint64_t offRange = 0;
+
+        for (uint32_t idxBlock = 0; idxBlock < cBlocks && !rcReq; idxBlock++)
+        {
+            uint64_t cbBlockLeft = pReq->cbBlock ? MIN(pReq->cbBlock, pReq->cbRange - offRange) : pReq->cbRange;
+            PSPSTUBDIGEST Digest;
+
+            pspStubDigestInit(&Digest, pReq->enmAlgo);
+            while (cbBlockLeft)
+            {
+                void *pvMap = NULL;
+                size_t cbChunk = 0;
+
+                if (enmAddrSpace == MAPMGRADDRSPACE_INVALID)
+                {
+                    pvMap   = (void *)(uintptr_t)(pReq->u64AddrStart + offRange);
+                    cbChunk = (size_t)MIN(cbBlockLeft, PSP_SERIAL_STUB_DIGEST_CHUNK_MAX);
+                    if (!cbChunk) /* Can't happen, but a chunk of 0 would never finish the block. */
+                    {
+                        rcReq = ERR_INVALID_STATE;
+                        break;
+                    }
+                }
+                else
+                {
+                    rcReq = MAPMgrWinIterNext(&It, (size_t)MIN(cbBlockLeft, UINT32_MAX), &pvMap, &cbChunk);
+                    if (   rcReq
+                        || !cbChunk)
+                        break;
+                }
+
+                pspStubDigestUpdate(&Digest, pReq->enmAlgo, pvMap, cbChunk);
+                offRange    += cbChunk;
+                cbBlockLeft -= cbChunk;
+            }
+
+            if (!rcReq)
+            {
+                pspStubDigestFinal(&Digest, pReq->enmAlgo, &pbDigests[idxBlock * pResp->cbDigest]);
+                pResp->cBlocks++;
+            }
+        }
+    }
+
+    pResp->cMicros = pspStubGetMicros(pThis) - tsStart;
+    cbRespPayload += pResp->cBlocks * pResp->cbDigest;
+
+    if (enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        MAPMgrWinIterEnd(&It);
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_DIGEST, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Processes a snapshot create request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessSnapshotCreate(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALSNAPSHOTCREATEREQ pReq = (PCPSPSERIALSNAPSHOTCREATEREQ)pvPayload;
+    PPSPSTUBSNAPSHOT pSnapshot = NULL;
+    PSPSERIALSNAPSHOTCREATERESP Resp;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    uint64_t cBlocks = 0;
+    int rc = INF_SUCCESS;
+
+    memset(&Resp, 0, sizeof(Resp));
+    /* A block has to fit into the staging buffer as it is copied there before being compared and sent. */
+    if (   cbPayload != sizeof(*pReq)
+        || !pReq->cbRange
+        || !pReq->cbBlock
+        || pReq->cbBlock > sizeof(pThis->abStaging)
+        || pReq->u32Rsvd)
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        cBlocks = (pReq->cbRange + pReq->cbBlock - 1) / pReq->cbBlock;
+        if (cBlocks > PSP_SERIAL_STUB_SNAPSHOT_BLOCKS_MAX)
+            rc = ERR_INVALID_PARAMETER;
+    }
+
+    if (!rc)
+    {
+        switch (pReq->enmAddrSpace)
+        {
+            case PSPADDRSPACE_PSP_MEM:
+            case PSPADDRSPACE_PSP_MMIO:
+                /* The address space of the other PSPs isn't reachable from here. */
+                if (pThis->idCcdReq)
+                    rc = ERR_NOT_IMPLEMENTED;
+                else if (   pReq->u64AddrStart > UINT32_MAX
+                         || pReq->cbRange > (uint64_t)UINT32_MAX + 1 - pReq->u64AddrStart)
+                    rc = ERR_INVALID_PARAMETER;
+                break;
+            case PSPADDRSPACE_SMN:
+                break;
+            case PSPADDRSPACE_X86_MEM:
+            case PSPADDRSPACE_X86_MMIO:
+                rc = pspStubX86CachingToMemType(pReq->fCaching, &uMemType);
+                break;
+            default:
+                rc = ERR_INVALID_PARAMETER;
+                break;
+        }
+    }
+
+    if (!rc)
+    {
+        for (uint32_t i = 0; i < ELEMENTS(pThis->aSnapshots); i++)
+        {
+            if (pThis->aSnapshots[i].enmAddrSpace == PSPADDRSPACE_INVALID)
+            {
+                pSnapshot = &pThis->aSnapshots[i];
+                Resp.idSnapshot = i;
+                break;
+            }
+        }
+
+        if (!pSnapshot)
+            rc = ERR_INVALID_STATE;
+    }
+
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_CREATE,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    pSnapshot->enmAddrSpace = pReq->enmAddrSpace;
+    pSnapshot->idCcd        = pThis->idCcdReq;
+    pSnapshot->uMemType     = uMemType;
+    pSnapshot->fBaseline    = false;
+    pSnapshot->u64AddrStart = pReq->u64AddrStart;
+    pSnapshot->cbRange      = pReq->cbRange;
+    pSnapshot->cbBlock      = pReq->cbBlock;
+    pSnapshot->cBlocks      = (uint32_t)cBlocks;
+
+    Resp.cBlocks = pSnapshot->cBlocks;
+    return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_CREATE,
+                          &Resp, sizeof(Resp));
+}
+
+
+/**
+ * Processes a snapshot update request, sending the blocks which changed since the last update.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessSnapshotUpdate(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALSNAPSHOTUPDATEREQ pReq = (PCPSPSERIALSNAPSHOTUPDATEREQ)pvPayload;
+    PPSPSERIALSNAPSHOTUPDATERESP pResp = (PPSPSERIALSNAPSHOTUPDATERESP)&pThis->abPduResp[0];
+    uint32_t *pau32Changed = (uint32_t *)(pResp + 1);
+    MAPMGRADDRSPACE enmAddrSpace = MAPMGRADDRSPACE_INVALID;
+    MAPMGRWINITER It;
+
+    pResp->cBlocks        = 0;
+    pResp->cBlocksChanged = 0;
+    pResp->cMicros        = 0;
+
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->idSnapshot >= ELEMENTS(pThis->aSnapshots)
+        || pThis->aSnapshots[pReq->idSnapshot].enmAddrSpace == PSPADDRSPACE_INVALID
+        || (pReq->fFlags & ~(PSP_SERIAL_SNAPSHOT_UPDATE_F_NO_DATA | PSP_SERIAL_SNAPSHOT_UPDATE_F_RESET)))
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_UPDATE,
+                              pResp, sizeof(*pResp));
+
+    PPSPSTUBSNAPSHOT pSnapshot = &pThis->aSnapshots[pReq->idSnapshot];
+    size_t cbChanged = ((pSnapshot->cBlocks + 31) / 32) * sizeof(uint32_t);
+
+    memset(pau32Changed, 0, cbChanged);
+    if (pReq->fFlags & PSP_SERIAL_SNAPSHOT_UPDATE_F_RESET)
+        pSnapshot->fBaseline = false;
+
+    switch (pSnapshot->enmAddrSpace)
+    {
+        case PSPADDRSPACE_SMN:
+            enmAddrSpace = MAPMGRADDRSPACE_SMN;
+            break;
+        case PSPADDRSPACE_X86_MEM:
+            enmAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+            break;
+        case PSPADDRSPACE_X86_MMIO:
+            enmAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+            break;
+        default:
+            break;
+    }
+
+    int rc = INF_SUCCESS;
+    if (enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        rc = MAPMgrWinIterInitEx(&It, &pThis->MapMgr, enmAddrSpace, pSnapshot->u64AddrStart, pSnapshot->cbRange,
+                                 pSnapshot->uMemType, enmAddrSpace == MAPMGRADDRSPACE_SMN ? pSnapshot->idCcd : 0);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_UPDATE,
+                              pResp, sizeof(*pResp));
+
+    /*
+     * Each block is copied into the staging buffer first so an access fault doesn't hit while sending,
+     * the remembered CRC is only updated once the block made it to the host.
+     */
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    uint64_t tsStart = pspStubGetMicros(pThis);
+    uint64_t offRange = 0;
+
+    for (uint32_t idxBlock = 0; idxBlock < pSnapshot->cBlocks; idxBlock++)
+    {
+        size_t cbBlock = (size_t)MIN(pSnapshot->cbBlock, pSnapshot->cbRange - offRange);
+        const void *pvData = NULL;
+        size_t cbData = cbBlock;
+
+        if (PSPCheckPointSet(&g_ChkPt))
+        {
+            size_t offBlock = 0;
+
+            while (offBlock < cbBlock)
+            {
+                void *pvMap = NULL;
+                size_t cbChunk = 0;
+
+                if (enmAddrSpace == MAPMGRADDRSPACE_INVALID)
+                {
+                    pvMap   = (void *)(uintptr_t)(pSnapshot->u64AddrStart + offRange);
+                    cbChunk = cbBlock;
+                }
+                else
+                {
+                    rcReq = MAPMgrWinIterNext(&It, cbBlock - offBlock, &pvMap, &cbChunk);
+                    if (   rcReq
+                        || !cbChunk)
+                        break;
+                }
+
+                memcpy(&pThis->abStaging[offBlock], pvMap, cbChunk);
+                offBlock += cbChunk;
+            }
+
+            if (offBlock == cbBlock)
+                pvData = &pThis->abStaging[0];
+            else if (!rcReq)
+                rcReq = ERR_INVALID_STATE;
+        }
+
+        pspStubPduCheckForExcp(pThis, &rcReq, &pvData, &cbData);
+        if (rcReq != STS_INF_SUCCESS)
+            break;
+
+        uint32_t u32Crc = CRC32Calc(0, pvData, cbData);
+        if (   !pSnapshot->fBaseline
+            || pSnapshot->au32Crc[idxBlock] != u32Crc)
+        {
+            if (!(pReq->fFlags & PSP_SERIAL_SNAPSHOT_UPDATE_F_NO_DATA))
+            {
+                for (size_t offBlock = 0; offBlock < cbData && !rcReq; offBlock += PSP_SERIAL_STUB_MEM_RANGE_CHUNK_SZ)
+                {
+                    PSPSERIALMEMRANGEDATA DataHdr;
+
+                    DataHdr.offData = offRange + offBlock;
+                    rcReq = pspStubPduSend2(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_NOTIFICATION_MEM_RANGE_DATA,
+                                            &DataHdr, sizeof(DataHdr), (const uint8_t *)pvData + offBlock,
+                                            MIN(cbData - offBlock, PSP_SERIAL_STUB_MEM_RANGE_CHUNK_SZ));
+                }
+
+                if (rcReq)
+                    break;
+            }
+
+            pSnapshot->au32Crc[idxBlock] = u32Crc;
+            pau32Changed[idxBlock / 32] |= BIT(idxBlock % 32);
+            pResp->cBlocksChanged++;
+        }
+
+        pResp->cBlocks++;
+        offRange += cbData;
+    }
+
+    /* Without a baseline the blocks not reached yet hold no valid CRC, only a complete pass establishes one. */
+    if (   !rcReq
+        && pResp->cBlocks == pSnapshot->cBlocks)
+        pSnapshot->fBaseline = true;
+
+    pResp->cMicros = pspStubGetMicros(pThis) - tsStart;
+
+    if (enmAddrSpace != MAPMGRADDRSPACE_INVALID)
+        MAPMgrWinIterEnd(&It);
+
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_UPDATE,
+                          pResp, sizeof(*pResp) + cbChanged);
+}
+
+
+/**
+ * Processes a snapshot destroy request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessSnapshotDestroy(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALSNAPSHOTDESTROYREQ pReq = (PCPSPSERIALSNAPSHOTDESTROYREQ)pvPayload;
+    int rc = INF_SUCCESS;
+
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->idSnapshot >= ELEMENTS(pThis->aSnapshots)
+        || pThis->aSnapshots[pReq->idSnapshot].enmAddrSpace == PSPADDRSPACE_INVALID)
+        rc = ERR_INVALID_PARAMETER;
+    else
+        pThis->aSnapshots[pReq->idSnapshot].enmAddrSpace = PSPADDRSPACE_INVALID;
+
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_DESTROY,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
+
+
+/**
+ * Maps a single register for a poll or read-modify-write request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   idCcd                   The die to access the register on.
+ * @param   enmAddrSpace            The address space of the register.
+ * @param   u64Addr                 The register address.
+ * @param   cbAccess                The access width, 1, 2, 4 or 8.
+ * @param   fCaching                Caching flags for the x86 address spaces.
+ * @param   pIt                     The window iterator holding the mapping.
+ * @param   ppv                     Where to store the pointer to the register on success.
+ * @param   pfMapped                Where to store whether the iterator needs to be ended with MAPMgrWinIterEnd().
+ */
+static int pspStubRegMap(PPSPSTUBSTATE pThis, uint32_t idCcd, PSPADDRSPACE enmAddrSpace, uint64_t u64Addr, size_t cbAccess,
+                         uint32_t fCaching, PMAPMGRWINITER pIt, void **ppv, bool *pfMapped)
+{
+    MAPMGRADDRSPACE enmMapAddrSpace = MAPMGRADDRSPACE_INVALID;
+    uint32_t uMemType = MAPMGR_X86_MEMTYPE_DEFAULT;
+    int rc = INF_SUCCESS;
+
+    *pfMapped = false;
+    if (   (   cbAccess != 1
+            && cbAccess != 2
+            && cbAccess != 4
+            && cbAccess != 8)
+        || (u64Addr & (cbAccess - 1)))
+        return ERR_INVALID_PARAMETER;
+
+    switch (enmAddrSpace)
+    {
+        case PSPADDRSPACE_PSP_MEM:
+        case PSPADDRSPACE_PSP_MMIO:
+            /* The address space of the other PSPs isn't reachable from here. */
+            if (idCcd)
+                return ERR_NOT_IMPLEMENTED;
+            *ppv = (void *)(uintptr_t)u64Addr;
+            return INF_SUCCESS;
+        case PSPADDRSPACE_SMN:
+            enmMapAddrSpace = MAPMGRADDRSPACE_SMN;
+            break;
+        case PSPADDRSPACE_X86_MEM:
+            enmMapAddrSpace = MAPMGRADDRSPACE_X86_MEM;
+            rc = pspStubX86CachingToMemType(fCaching, &uMemType);
+            break;
+        case PSPADDRSPACE_X86_MMIO:
+            enmMapAddrSpace = MAPMGRADDRSPACE_X86_MMIO;
+            rc = pspStubX86CachingToMemType(fCaching, &uMemType);
+            break;
+        default:
+            rc = ERR_INVALID_PARAMETER;
+            break;
+    }
+
+    if (!rc)
+        rc = MAPMgrWinIterInitEx(pIt, &pThis->MapMgr, enmMapAddrSpace, u64Addr, cbAccess, uMemType,
+                                 enmMapAddrSpace == MAPMGRADDRSPACE_SMN ? idCcd : 0);
+    if (!rc)
+    {
+        size_t cbChunk = 0;
+
+        rc = MAPMgrWinIterNext(pIt, cbAccess, ppv, &cbChunk);
+        if (!rc && cbChunk != cbAccess)
+            rc = ERR_INVALID_PARAMETER;
+        if (!rc)
+            *pfMapped = true;
+        else
+            MAPMgrWinIterEnd(pIt);
+    }
+
+    return rc;
+}
+
+
+/**
+ * Reads the given register with a single access, 8 byte registers are read
+ * as two 32bit accesses with the low half first.
+ *
+ * @returns The value read.
+ * @param   pv                      The mapped register.
+ * @param   cbAccess                The access width, 1, 2, 4 or 8.
+ */
+static uint64_t pspStubRegRead(const void *pv, size_t cbAccess)
+{
+    uint64_t u64Val = 0;
+
+    if (cbAccess == sizeof(uint64_t))
+    {
+        /* ldrd isn't single copy atomic on device memory, so make the two accesses and their order explicit. */
+        volatile const uint32_t *pu32 = (volatile const uint32_t *)pv;
+        uint32_t u32Lo = pu32[0];
+        uint32_t u32Hi = pu32[1];
+
+        u64Val = ((uint64_t)u32Hi << 32) | u32Lo;
+    }
+    else /* Little endian, so the low bytes are filled regardless of the width. */
+        pspStubMmioAccess(&u64Val, pv, cbAccess);
+    return u64Val;
+}
+
+
+/**
+ * Writes the given register with a single access, 8 byte registers are written
+ * as two 32bit accesses with the low half first.
+ *
+ * @returns nothing.
+ * @param   pv                      The mapped register.
+ * @param   u64Val                  The value to write, truncated to the access width.
+ * @param   cbAccess                The access width, 1, 2, 4 or 8.
+ */
+static void pspStubRegWrite(void *pv, uint64_t u64Val, size_t cbAccess)
+{
+    if (cbAccess == sizeof(uint64_t))
+    {
+        volatile uint32_t *pu32 = (volatile uint32_t *)pv;
+
+        pu32[0] = (uint32_t)u64Val;
+        pu32[1] = (uint32_t)(u64Val >> 32);
+    }
+    else
+        pspStubMmioAccess(pv, &u64Val, cbAccess);
+}
+
+
+/**
+ * Processes a poll request, reading the given address until the masked value
+ * matches or the timeout expires.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessPoll(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALPOLLREQ pReq = (PCPSPSERIALPOLLREQ)pvPayload;
+    PSPSERIALPOLLRESP Resp;
+    MAPMGRWINITER It;
+    bool fMapped = false;
+    void *pv = NULL;
+
+    Resp.u64Val      = 0;
+    Resp.cMicros     = 0;
+    Resp.cIterations = 0;
+    Resp.u32Rsvd     = 0;
+
+    /* The register is mapped once for the whole poll. */
+    int rc = INF_SUCCESS;
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->cUsTimeout > PSP_SERIAL_STUB_POLL_TIMEOUT_MAX_US)
+        rc = ERR_INVALID_PARAMETER;
+    else
+        rc = pspStubRegMap(pThis, pThis->idCcdReq, pReq->enmAddrSpace, pReq->u64Addr, pReq->cbAccess, pReq->fCaching,
+                           &It, &pv, &fMapped);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_POLL, &Resp, sizeof(Resp));
+
+    const void *pvRespPayload = &Resp;
+    size_t cbRespPayload = sizeof(Resp);
+    PSPSTS rcReq = ERR_TIMEOUT;
+    uint64_t tsStart = pspStubGetMicros(pThis);
+
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        for (;;)
+        {
+            Resp.u64Val = pspStubRegRead(pv, pReq->cbAccess);
+            Resp.cIterations++;
+#ifndef PSP_STUB_NO_HW_TIMER
+            Resp.cMicros = pspStubGetMicros(pThis) - tsStart;
+#else
+            Resp.cMicros = Resp.cIterations; /* No accurate time, count each read as a microsecond so the poll terminates. */
+#endif
+            if ((Resp.u64Val & pReq->u64Mask) == pReq->u64Expected)
+            {
+                rcReq = STS_INF_SUCCESS;
+                break;
+            }
+
+            if (Resp.cMicros >= pReq->cUsTimeout)
+                break;
+        }
+    }
+
+    if (fMapped)
+        MAPMgrWinIterEnd(&It);
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_POLL, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Processes a read-modify-write request.
+ *
+ * @returns Status code.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
+ */
+static int pspStubPduProcessRmw(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+{
+    PCPSPSERIALRMWREQ pReq = (PCPSPSERIALRMWREQ)pvPayload;
+    PSPSERIALRMWRESP Resp;
+    MAPMGRWINITER It;
+    bool fMapped = false;
+    void *pv = NULL;
+
+    Resp.u64ValOld = 0;
+    Resp.u64ValNew = 0;
+
+    int rc = INF_SUCCESS;
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->enmOp < PSP_SERIAL_RMW_OP_AND
+        || pReq->enmOp > PSP_SERIAL_RMW_OP_ADD)
+        rc = ERR_INVALID_PARAMETER;
+    else
+        rc = pspStubRegMap(pThis, pThis->idCcdReq, pReq->enmAddrSpace, pReq->u64Addr, pReq->cbAccess, pReq->fCaching,
+                           &It, &pv, &fMapped);
+    if (rc)
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_RMW, &Resp, sizeof(Resp));
+
+    const void *pvRespPayload = &Resp;
+    size_t cbRespPayload = sizeof(Resp);
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    uint32_t fCpsr = pspStubIrqSave();
+
+    /* Nothing may run on this core between the read and the write. */
+    if (PSPCheckPointSet(&g_ChkPt))
+    {
+        uint64_t u64Val = pspStubRegRead(pv, pReq->cbAccess);
+
+        Resp.u64ValOld = u64Val;
+        switch (pReq->enmOp)
+        {
+            case PSP_SERIAL_RMW_OP_AND:
+                u64Val &= pReq->u64Operand;
+                break;
+            case PSP_SERIAL_RMW_OP_OR:
+                u64Val |= pReq->u64Operand;
+                break;
+            case PSP_SERIAL_RMW_OP_XOR:
+                u64Val ^= pReq->u64Operand;
+                break;
+            case PSP_SERIAL_RMW_OP_ADD:
+                u64Val += pReq->u64Operand;
+                break;
+            default:
+                break;
+        }
+
+        pspStubRegWrite(pv, u64Val, pReq->cbAccess);
+        pspStubMemSync();
+
+        /* Report the value as written, truncated to the access width. */
+        if (pReq->cbAccess < sizeof(uint64_t))
+            u64Val &= (UINT64_C(1) << (pReq->cbAccess * 8)) - 1;
+        Resp.u64ValNew = u64Val;
+    }
+
+    pspStubIrqRestore(fCpsr);
+
+    if (fMapped)
+        MAPMgrWinIterEnd(&It);
+
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return pspStubPduSend(pThis, rcReq, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_RMW, pvRespPayload, cbRespPayload);
+}
+
+
+/**
+ * Reads the current value of the given watch.
+ *
+ * @returns Status code, the exception status if reading the address faulted.
+ * @param   pThis                   The serial stub instance data.
+ * @param   pWatch                  The watch to read.
+ * @param   pu64Val                 Where to store the masked value on success.
+ */
+static int pspStubWatchRead(PPSPSTUBSTATE pThis, PPSPSTUBWATCH pWatch, uint64_t *pu64Val)
+{
+    MAPMGRWINITER It;
+    bool fMapped = false;
+    void *pv = NULL;
+
+    int rc = pspStubRegMap(pThis, pWatch->idCcd, pWatch->enmAddrSpace, pWatch->u64Addr, pWatch->cbAccess, pWatch->fCaching,
+                           &It, &pv, &fMapped);
+    if (rc)
+        return rc;
+
+    const void *pvRespPayload = NULL;
+    size_t cbRespPayload = 0;
+    PSPSTS rcReq = STS_INF_SUCCESS;
+
+    if (PSPCheckPointSet(&g_ChkPt))
+        *pu64Val = pspStubRegRead(pv, pWatch->cbAccess) & pWatch->u64Mask;
 
-    uint8_t *pbDst = (uint8_t *)pvDst;
-    uint8_t *pbSrc = (uint8_t *)pvSrc;
-    while (cbWrLeft)
-    {
-        pspStubMmioAccess(pbDst, pbSrc, cbStride);
-        if (fIncrAddr)
-            pbDst += cbStride;
+    if (fMapped)
+        MAPMgrWinIterEnd(&It);
 
-        pbSrc    += cbStride;
-        cbWrLeft -= cbStride;
-    }
+    pspStubPduCheckForExcp(pThis, &rcReq, &pvRespPayload, &cbRespPayload);
+    return rcReq;
 }
 
 
 /**
- * Extended data transfer mechanism.
+ * Samples the watchlist if the interval elapsed, sending a notification for every changed value.
  *
- * @returns Stauts code.
+ * @returns Number of milliseconds until the next sample is due, PSP_SERIAL_STUB_INDEFINITE_WAIT if there is nothing to sample.
  * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
  */
-static int pspStubPduProcessDataXfer(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+static uint32_t pspStubWatchSample(PPSPSTUBSTATE pThis)
 {
-    PCPSPSERIALDATAXFERREQ pReq = (PCPSPSERIALDATAXFERREQ)pvPayload;
+    if (   !pThis->cWatches
+        || !pThis->cMsWatchInterval)
+        return PSP_SERIAL_STUB_INDEFINITE_WAIT;
 
-    if (   cbPayload < sizeof(*pReq)
-        || (   pReq->cbStride != 1
-            && pReq->cbStride != 2
-            && pReq->cbStride != 4))
-        return ERR_INVALID_PARAMETER;
+    uint32_t tsNow = pspStubGetMillies(pThis);
+    if (tsNow - pThis->tsWatchLast < pThis->cMsWatchInterval)
+        return pThis->cMsWatchInterval - (tsNow - pThis->tsWatchLast);
 
-    PSPSERIALPDURRNID enmResponse = PSPSERIALPDURRNID_RESPONSE_PSP_DATA_XFER;
-    void *pvMap = NULL;
-    int rc = pspStubPduDataXferAddressMap(pThis, pReq, &pvMap);
-    if (!rc)
+    pThis->tsWatchLast = tsNow;
+
+    uint64_t tsMicros = pspStubGetMicros(pThis);
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aWatches); i++)
     {
-        void *pvRespPayload = NULL;
-        size_t cbRespPayload = 0;
+        PPSPSTUBWATCH pWatch = &pThis->aWatches[i];
+        uint64_t u64Val = 0;
 
-        if (PSPCheckPointSet(&g_ChkPt))
-        {
-            if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
-                pspStubPduDataXferMemset(pThis, pReq, pvMap);
-            else if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_READ)
-            {
-                pvRespPayload = &pThis->abPduResp[0];
-                cbRespPayload  = pReq->cbXfer;
+        if (pWatch->enmAddrSpace == PSPADDRSPACE_INVALID)
+            continue;
 
-                pspStubPduDataXferRead(pThis, pReq, pvMap, pvRespPayload);
-            }
-            else if (pReq->fFlags & PSP_SERIAL_DATA_XFER_F_WRITE)
-                pspStubPduDataXferWrite(pThis, pReq, pvMap, (void *)(pReq + 1));
-        }
+        int rc = pspStubWatchRead(pThis, pWatch, &u64Val);
+        if (   !rc
+            && u64Val == pWatch->u64ValLast)
+            continue;
 
-        pspStubPduDataXferAddressUnmapByPtr(pThis, pReq, pvMap);
+        PSPSERIALWATCHNOT WatchNot;
 
-        PSPSTS rcReq = STS_INF_SUCCESS;
-        pspStubPduCheckForExcp(pThis, &rcReq, (const void **)&pvRespPayload, &cbRespPayload);
-        rc = pspStubPduSend(pThis, rcReq, 0 /*idCcd*/, enmResponse, pvRespPayload, cbRespPayload);
+        WatchNot.idWatch   = i;
+        WatchNot.u32Rsvd   = 0;
+        WatchNot.u64ValOld = pWatch->u64ValLast;
+        WatchNot.u64ValNew = rc ? pWatch->u64ValLast : u64Val;
+        WatchNot.tsMicros  = tsMicros;
+
+        /* An address which can't be read anymore would fail on every sample, so it is dropped after reporting it once. */
+        if (rc)
+        {
+            LogRel("pspStubWatchSample: Reading watch %u failed with %d, removing it\n", i, rc);
+            pWatch->enmAddrSpace = PSPADDRSPACE_INVALID;
+            pThis->cWatches--;
+        }
+        else
+            pWatch->u64ValLast = u64Val;
+
+        int rcSend = pspStubPduSend(pThis, rc, pWatch->idCcd, PSPSERIALPDURRNID_NOTIFICATION_WATCH, &WatchNot, sizeof(WatchNot));
+        if (rcSend)
+            LogRel("pspStubWatchSample: Sending watch notification failed with %d\n", rcSend);
     }
-    else
-        rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, enmResponse, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 
-    return rc;
+    return pThis->cMsWatchInterval;
 }
 
 
 /**
- * Writes to the given input buffer.
+ * Processes a watchlist add request.
  *
  * @returns Status code.
  * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
  */
-static int pspStubPduProcessInputBufWrite(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+static int pspStubPduProcessWatchAdd(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
 {
-    PCPSPSERIALINBUFWRREQ pReq = (PCPSPSERIALINBUFWRREQ)pvPayload;
-
-    int rc = INF_SUCCESS;
-    if (   cbPayload > sizeof(*pReq)
-        && pReq->idInBuf < ELEMENTS(pThis->aInBufs))
+    PCPSPSERIALWATCHADDREQ pReq = (PCPSPSERIALWATCHADDREQ)pvPayload;
+    PPSPSTUBWATCH pWatch = NULL;
+    PSPSERIALWATCHADDRESP Resp;
+
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->u32Rsvd)
+        return pspStubPduSend(pThis, ERR_INVALID_PARAMETER, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_ADD,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    Resp.idWatch = 0;
+    Resp.u32Rsvd = 0;
+    Resp.u64Val  = 0;
+    for (uint32_t i = 0; i < ELEMENTS(pThis->aWatches); i++)
     {
-        PPSPINBUF pInBuf = &pThis->aInBufs[pReq->idInBuf];
-        uint8_t *pbData = (uint8_t *)(pReq + 1);
-        uint8_t *pbDst = (uint8_t *)pInBuf->pvInBuf + pInBuf->offInBuf;
-        size_t cbData = cbPayload - sizeof(*pReq);
-
-        if (cbData <= pInBuf->cbInBuf - pInBuf->offInBuf)
+        if (pThis->aWatches[i].enmAddrSpace == PSPADDRSPACE_INVALID)
         {
-            memcpy(pbDst, pbData, cbData);
-            pInBuf->offInBuf += cbData;
+            pWatch = &pThis->aWatches[i];
+            Resp.idWatch = i;
+            break;
         }
-        else
-            rc = ERR_INVALID_PARAMETER;
     }
-    else
-        rc = ERR_INVALID_PARAMETER;
 
-    return pspStubPduSend(pThis, rc, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_INPUT_BUF_WRITE, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+    if (!pWatch)
+        return pspStubPduSend(pThis, ERR_INVALID_STATE, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_ADD,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
+    pWatch->enmAddrSpace = pReq->enmAddrSpace;
+    pWatch->idCcd        = pThis->idCcdReq;
+    pWatch->fCaching     = pReq->fCaching;
+    pWatch->cbAccess     = pReq->cbAccess;
+    pWatch->u64Addr      = pReq->u64Addr;
+    pWatch->u64Mask      = pReq->u64Mask;
+
+    /* The first read validates the address and gives the baseline changes are reported against. */
+    int rc = pspStubWatchRead(pThis, pWatch, &Resp.u64Val);
+    if (rc)
+    {
+        pWatch->enmAddrSpace = PSPADDRSPACE_INVALID;
+        return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_ADD,
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+    }
+
+    pWatch->u64ValLast = Resp.u64Val;
+    pThis->cWatches++;
+    return pspStubPduSend(pThis, INF_SUCCESS, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_ADD, &Resp, sizeof(Resp));
 }
 
 
 /**
- * Initiates a load code module request.
+ * Processes a watchlist remove request.
  *
  * @returns Status code.
  * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
  */
-static int pspStubPduProcessLoadCodeMod(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+static int pspStubPduProcessWatchRemove(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
 {
-    PCPSPSERIALLOADCODEMODREQ pReq = (PCPSPSERIALLOADCODEMODREQ)pvPayload;
-
+    PCPSPSERIALWATCHREMOVEREQ pReq = (PCPSPSERIALWATCHREMOVEREQ)pvPayload;
     int rc = INF_SUCCESS;
-    if (   cbPayload == sizeof(*pReq)
-        && pReq->u32Pad0 < ELEMENTS(pThis->aInBufs))
+
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->u32Rsvd)
+        rc = ERR_INVALID_PARAMETER;
+    else if (pReq->idWatch == PSP_SERIAL_WATCH_ID_ALL)
+        pspStubWatchRemoveAll(pThis);
+    else if (   pReq->idWatch >= ELEMENTS(pThis->aWatches)
+             || pThis->aWatches[pReq->idWatch].enmAddrSpace == PSPADDRSPACE_INVALID)
+        rc = ERR_INVALID_PARAMETER;
+    else
     {
-        if (pReq->enmCmType == PSPSERIALCMTYPE_FLAT_BINARY)
-        {
-            PPSPINBUF pInBuf = &pThis->aInBufs[pReq->u32Pad0];
-            pInBuf->pvInBuf  = (void *)CM_FLAT_BINARY_LOAD_ADDR;
-            pInBuf->cbInBuf  = 0x3f000 - CM_FLAT_BINARY_LOAD_ADDR;
-            pInBuf->offInBuf = 0;
-            memset(pInBuf->pvInBuf, 0, pInBuf->cbInBuf);
-        }
-        else
-            rc = ERR_NOT_IMPLEMENTED;
+        pThis->aWatches[pReq->idWatch].enmAddrSpace = PSPADDRSPACE_INVALID;
+        pThis->cWatches--;
     }
-    else
-        rc = ERR_INVALID_PARAMETER;
 
-    return pspStubPduSend(pThis, rc, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_LOAD_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_REMOVE,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 }
 
 
 /**
- * Executes a previously loaded code module.
+ * Processes a watchlist config request.
  *
  * @returns Status code.
  * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
+ * @param   pvPayload               The PDU payload.
+ * @param   cbPayload               Size of the PDU payload in bytes.
  */
-static int pspStubPduProcessExecCodeMod(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+static int pspStubPduProcessWatchConfig(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
 {
-    PCPSPSERIALEXECCODEMODREQ pReq = (PCPSPSERIALEXECCODEMODREQ)pvPayload;
-
+    PCPSPSERIALWATCHCONFIGREQ pReq = (PCPSPSERIALWATCHCONFIGREQ)pvPayload;
     int rc = INF_SUCCESS;
-    if (cbPayload == sizeof(*pReq))
-    {
-        uint32_t u32Arg0 = pReq->u32Arg0;
-        uint32_t u32Arg1 = pReq->u32Arg1;
-        uint32_t u32Arg2 = pReq->u32Arg2;
-        uint32_t u32Arg3 = pReq->u32Arg3;
-
-        /* Send a success response before running the code module. */
-        rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_EXEC_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
-        if (!rc)
-        {
-            /* Setup the code exec helper. */
-            CMEXEC CmExec;
 
-            CmExec.pStub               = pThis;
-            CmExec.CmIf.pfnInBufPeek   = pspStubCmIfInBufPeekAsm;
-            CmExec.CmIf.pfnInBufPoll   = pspStubCmIfInBufPollAsm;
-            CmExec.CmIf.pfnInBufRead   = pspStubCmIfInBufReadAsm;
-            CmExec.CmIf.pfnOutBufWrite = pspStubCmIfOutBufWriteAsm;
-            CmExec.CmIf.pfnDelayMs     = pspStubCmIfDelayMsAsm;
-            CmExec.CmIf.pfnTsGetMilli  = pspStubCmIfTsGetMilliAsm;
+    if (   cbPayload != sizeof(*pReq)
+        || pReq->u32Rsvd)
+        rc = ERR_INVALID_PARAMETER;
+    else
+    {
+        /* The next sample is due one full interval from now. */
+        pThis->cMsWatchInterval = pReq->cMsInterval;
+        pThis->tsWatchLast      = pspStubGetMillies(pThis);
+    }
 
-            /* Reset the stdin buffer. */
-            PPSPINBUF pInBuf = &pThis->aInBufs[0];
-            pInBuf->pvInBuf  = &pThis->abScratch[0];
-            pInBuf->cbInBuf  = sizeof(pThis->abScratch);
-            pInBuf->offInBuf = 0;
+    return pspStubPduSend(pThis, rc, pThis->idCcdReq, PSPSERIALPDURRNID_RESPONSE_WATCH_CONFIG,
+                          NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+}
 
-            /* Call the module. */
-            PFNCMENTRY pfnEntry = (PFNCMENTRY)CM_FLAT_BINARY_LOAD_ADDR;
-            uint32_t u32CmRet = pfnEntry(&CmExec.CmIf, u32Arg0, u32Arg1, u32Arg2, u32Arg3);
 
-            /* The code module finished, send the notification. */
-            PSPSERIALEXECCMFINISHEDNOT ExecFinishedNot;
-            ExecFinishedNot.u32CmRet = u32CmRet;
-            ExecFinishedNot.u32Pad0  = 0;
-            rc = pspStubPduSend(pThis, rc, 0 /*idCcd*/, PSPSERIALPDURRNID_NOTIFICATION_CODE_MOD_EXEC_FINISHED, &ExecFinishedNot, sizeof(ExecFinishedNot));
-        }
-    }
-    else
-        rc = pspStubPduSend(pThis, ERR_INVALID_PARAMETER, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_EXEC_CODE_MOD, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+/**
+ * Returns the response ID for the given request ID.
+ *
+ * @returns Response ID.
+ * @param   enmReq                  The request ID.
+ */
+static PSPSERIALPDURRNID pspStubPduReqToResp(PSPSERIALPDURRNID enmReq)
+{
+    if (enmReq >= PSPSERIALPDURRNID_REQUEST_EXT_FIRST)
+        return (PSPSERIALPDURRNID)PSP_SERIAL_EXT_REQ_2_RESP(enmReq);
 
-    return rc;
+    /* The base protocol lists the responses in the same order as the requests. */
+    return (PSPSERIALPDURRNID)(PSPSERIALPDURRNID_RESPONSE_FIRST + (enmReq - PSPSERIALPDURRNID_REQUEST_FIRST));
 }
 
 
 /**
- * Branches to a given address.
+ * Returns whether the given request accesses the PSP executing the stub itself
+ * and can't be served for another die.
  *
- * @returns Status code.
- * @param   pThis                   The serial stub instance data.
- * @param   pvPayload               PDU payload.
- * @param   cbPayload               Payload size in bytes.
+ * @returns Flag whether the request is local to the PSP.
+ * @param   enmReq                  The request ID.
  */
-static int pspStubPduProcessBranchTo(PPSPSTUBSTATE pThis, const void *pvPayload, size_t cbPayload)
+static bool pspStubPduReqIsPspLocal(PSPSERIALPDURRNID enmReq)
 {
-    PCPSPSERIALBRANCHTOREQ pReq = (PCPSPSERIALBRANCHTOREQ)pvPayload;
-
-    int rc = INF_SUCCESS;
-    if (cbPayload == sizeof(*pReq))
+    switch (enmReq)
     {
-        /* Send the response for branching of. */
-        rc = pspStubPduSend(pThis, STS_INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_BRANCH_TO, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
-        if (STS_SUCCESS(rc))
-        {
-            PSPADDR PspAddrDst = pReq->PspAddrDst;
-            if (pReq->u32Flags & PSP_SERIAL_BRANCH_TO_F_THUMB)
-                PspAddrDst |= 1; /* switches to thumb in our assembly helper. */
-
-            pspStubTranspTerm(pThis); /* Terminate the transport layer. */
-            pspStubBranchToAsm(PspAddrDst, &pReq->au32Gprs[0]); /* This will NOT return!. */
-        }
+        case PSPSERIALPDURRNID_REQUEST_PSP_MEM_READ:
+        case PSPSERIALPDURRNID_REQUEST_PSP_MEM_WRITE:
+        case PSPSERIALPDURRNID_REQUEST_PSP_MMIO_READ:
+        case PSPSERIALPDURRNID_REQUEST_PSP_MMIO_WRITE:
+        case PSPSERIALPDURRNID_REQUEST_COPROC_READ:
+        case PSPSERIALPDURRNID_REQUEST_COPROC_WRITE:
+        case PSPSERIALPDURRNID_REQUEST_INPUT_BUF_WRITE:
+        case PSPSERIALPDURRNID_REQUEST_LOAD_CODE_MOD:
+        case PSPSERIALPDURRNID_REQUEST_EXEC_CODE_MOD:
+        case PSPSERIALPDURRNID_REQUEST_BRANCH_TO:
+            return true;
+        default:
+            break;
     }
-    else
-        rc = pspStubPduSend(pThis, STS_ERR_INVALID_PARAMETER, 0 /*idCcd*/, PSPSERIALPDURRNID_RESPONSE_BRANCH_TO, NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
 
-    return rc;
+    return false;
 }
 
 
@@ -2186,6 +5137,17 @@ static int pspStubPduProcess(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR pPdu)
 {
     int rc = INF_SUCCESS;
 
+    /*
+     * Requests for another die are served from this PSP, which works for SMN (through the
+     * die select bits of the mapping slots) and the x86 address space shared by all dies.
+     * Anything touching the PSP itself would need a stub running on the other die.
+     */
+    pThis->idCcdReq = pPdu->u.Fields.idCcd;
+    if (   pThis->idCcdReq
+        && pspStubPduReqIsPspLocal(pPdu->u.Fields.enmRrnId))
+        return pspStubPduSend(pThis, ERR_NOT_IMPLEMENTED, pThis->idCcdReq, pspStubPduReqToResp(pPdu->u.Fields.enmRrnId),
+                              NULL /*pvRespPayload*/, 0 /*cbRespPayload*/);
+
     switch (pPdu->u.Fields.enmRrnId)
     {
         case PSPSERIALPDURRNID_REQUEST_PSP_MEM_READ:
@@ -2239,6 +5201,84 @@ static int pspStubPduProcess(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR pPdu)
         case PSPSERIALPDURRNID_REQUEST_BRANCH_TO:
             rc = pspStubPduProcessBranchTo(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
             break;
+        case PSPSERIALPDURRNID_REQUEST_TRANSP_STATS_QUERY:
+            rc = pspStubPduProcessTranspStatsQuery(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_FLUSH:
+            rc = pspStubPduProcessMapFlush(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_STATS_QUERY:
+            rc = pspStubPduProcessMapStatsQuery(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_SLOT_STATS_QUERY:
+            rc = pspStubPduProcessMapSlotStatsQuery(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MEM_RANGE_READ:
+            rc = pspStubPduProcessMemRangeRead(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_PIN:
+            rc = pspStubPduProcessMapPin(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_UNPIN:
+            rc = pspStubPduProcessMapUnpin(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_PIN_READ:
+            rc = pspStubPduProcessMapPinXfer(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu, false /*fWrite*/);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MAP_PIN_WRITE:
+            rc = pspStubPduProcessMapPinXfer(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu, true /*fWrite*/);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_READ:
+            rc = pspStubPduProcessX86XferEx(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu, false /*fWrite*/);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_WRITE:
+            rc = pspStubPduProcessX86XferEx(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu, true /*fWrite*/);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_X86_MEM_BENCH:
+            rc = pspStubPduProcessX86MemBench(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_REG_POLL_BENCH:
+            rc = pspStubPduProcessRegPollBench(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_DATA_XFER_SG:
+            rc = pspStubPduProcessDataXferSg(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_POLL:
+            rc = pspStubPduProcessPoll(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_RMW:
+            rc = pspStubPduProcessRmw(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_MEM_SEARCH:
+            rc = pspStubPduProcessMemSearch(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_DIGEST:
+            rc = pspStubPduProcessDigest(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_SNAPSHOT_CREATE:
+            rc = pspStubPduProcessSnapshotCreate(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_SNAPSHOT_UPDATE:
+            rc = pspStubPduProcessSnapshotUpdate(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_SNAPSHOT_DESTROY:
+            rc = pspStubPduProcessSnapshotDestroy(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_FILL:
+            rc = pspStubPduProcessFill(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_X86_COPY:
+            rc = pspStubPduProcessX86Copy(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_WATCH_ADD:
+            rc = pspStubPduProcessWatchAdd(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_WATCH_REMOVE:
+            rc = pspStubPduProcessWatchRemove(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
+        case PSPSERIALPDURRNID_REQUEST_WATCH_CONFIG:
+            rc = pspStubPduProcessWatchConfig(pThis, (pPdu + 1), pPdu->u.Fields.cbPdu);
+            break;
         default:
             /* Should never happen as the ID was already checked during PDU validation. */
             break;
@@ -2258,7 +5298,9 @@ static int pspStubPduProcess(PPSPSTUBSTATE pThis, PCPSPSERIALPDUHDR pPdu)
 static inline void pspStubIrqCheck(bool *pfIrq, bool *pfFiq)
 {
     uint32_t u32Reg = 0;
+#ifndef PSP_SERIAL_STUB_HOST
     asm volatile("mrc p15, 0x0, %0, cr12, cr1, 0x0\n": "=r" (u32Reg) : :"memory");
+#endif
 
     *pfIrq = (u32Reg & BIT(7)) ? true : false;
     *pfFiq = (u32Reg & BIT(6)) ? true : false;
@@ -2272,9 +5314,11 @@ static inline void pspStubIrqCheck(bool *pfIrq, bool *pfFiq)
  */
 static inline void pspStubIrqEnable(void)
 {
+#ifndef PSP_SERIAL_STUB_HOST
     asm volatile("dsb #0xf\n"
                  "isb #0xf\n"
                  "cpsie if\n": : :"memory");
+#endif
 }
 
 
@@ -2285,9 +5329,11 @@ static inline void pspStubIrqEnable(void)
  */
 static inline void pspStubIrqDisable(void)
 {
+#ifndef PSP_SERIAL_STUB_HOST
     asm volatile("dsb #0xf\n"
                  "isb #0xf\n"
                  "cpsid if\n": : :"memory");
+#endif
 }
 
 
@@ -2364,29 +5410,29 @@ static void pspStubIrqProcess(PPSPSTUBSTATE pThis)
 
 static void pspStubMmioWrU32(PSPADDR PspAddrMmio, uint32_t uVal)
 {
-    pspStubMmioAccess((void *)PspAddrMmio, &uVal, sizeof(uint32_t));
+    pspStubMmioAccess((void *)(uintptr_t)PspAddrMmio, &uVal, sizeof(uint32_t));
 }
 
 
 static void pspStubMmioSetU32(PSPADDR PspAddrMmio, uint32_t fSet)
 {
     uint32_t uVal;
-    pspStubMmioAccess(&uVal, (void *)PspAddrMmio, sizeof(uint32_t));
+    pspStubMmioAccess(&uVal, (void *)(uintptr_t)PspAddrMmio, sizeof(uint32_t));
     LogRel("pspStubMmioSetU32: PspAddrMmio=%#x fSet=%#x uVal=%#x\n",
            PspAddrMmio, fSet, uVal);
     uVal |= fSet;
-    pspStubMmioAccess((void *)PspAddrMmio, &uVal, sizeof(uint32_t));
+    pspStubMmioAccess((void *)(uintptr_t)PspAddrMmio, &uVal, sizeof(uint32_t));
 }
 
 
 static void pspStubMmioClearU32(PSPADDR PspAddrMmio, uint32_t fClr)
 {
     uint32_t uVal;
-    pspStubMmioAccess(&uVal, (void *)PspAddrMmio, sizeof(uint32_t));
+    pspStubMmioAccess(&uVal, (void *)(uintptr_t)PspAddrMmio, sizeof(uint32_t));
     LogRel("pspStubMmioClearU32: PspAddrMmio=%#x fClr=%#x uVal=%#x\n",
            PspAddrMmio, fClr, uVal);
     uVal &= ~fClr;
-    pspStubMmioAccess((void *)PspAddrMmio, &uVal, sizeof(uint32_t));
+    pspStubMmioAccess((void *)(uintptr_t)PspAddrMmio, &uVal, sizeof(uint32_t));
 }
 
 
@@ -2396,7 +5442,7 @@ static void pspStubMmioWaitOnClrU32(PSPADDR PspAddrMmio, uint32_t fWait)
 
     do
     {
-        pspStubMmioAccess(&uVal, (void *)PspAddrMmio, sizeof(uint32_t));
+        pspStubMmioAccess(&uVal, (void *)(uintptr_t)PspAddrMmio, sizeof(uint32_t));
     } while (uVal & fWait != 0);
 }
 
@@ -2404,11 +5450,11 @@ static void pspStubMmioWaitOnClrU32(PSPADDR PspAddrMmio, uint32_t fWait)
 static void pspStubSmnSetU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t fSet)
 {
     void *pvMap = NULL;
-    int rc = pspStubSmnMap(pThis, SmnAddr, &pvMap);
+    int rc = MAPMgrSmnMap(&pThis->MapMgr, SmnAddr, &pvMap);
     if (!rc)
     {
-        pspStubMmioSetU32((PSPADDR)pvMap, fSet);
-        pspStubSmnUnmapByPtr(pThis, pvMap);
+        pspStubMmioSetU32((PSPADDR)(uintptr_t)pvMap, fSet);
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pvMap);
     }
 }
 
@@ -2416,11 +5462,11 @@ static void pspStubSmnSetU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t fSet
 static void pspStubSmnWrU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t u32Val)
 {
     void *pvMap = NULL;
-    int rc = pspStubSmnMap(pThis, SmnAddr, &pvMap);
+    int rc = MAPMgrSmnMap(&pThis->MapMgr, SmnAddr, &pvMap);
     if (!rc)
     {
-        pspStubMmioWrU32((PSPADDR)pvMap, u32Val);
-        pspStubSmnUnmapByPtr(pThis, pvMap);
+        pspStubMmioWrU32((PSPADDR)(uintptr_t)pvMap, u32Val);
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pvMap);
     }
 }
 
@@ -2428,7 +5474,7 @@ static void pspStubSmnWrU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t u32Va
 static void pspStubSmnAndOrU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t fAnd, uint32_t fOr)
 {
     void *pvMap = NULL;
-    int rc = pspStubSmnMap(pThis, SmnAddr, &pvMap);
+    int rc = MAPMgrSmnMap(&pThis->MapMgr, SmnAddr, &pvMap);
     if (!rc)
     {
         uint32_t uVal;
@@ -2437,7 +5483,7 @@ static void pspStubSmnAndOrU32(PPSPSTUBSTATE pThis, SMNADDR SmnAddr, uint32_t fA
         LogRel("pspStubSmnAndOrU32: SmnAddr=%#x fAnd=%#x fOr=%#x uVal=%#x uValNew=%#x\n",
                SmnAddr, fAnd, fOr, uVal, uValNew);
         pspStubMmioAccess((void *)pvMap, &uValNew, sizeof(uint32_t));
-        pspStubSmnUnmapByPtr(pThis, pvMap);
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pvMap);
     }
 }
 
@@ -2550,22 +5596,22 @@ static void pspStubInitHw(PPSPSTUBSTATE pThis)
 static void pspStubX86MmioWriteU32(PPSPSTUBSTATE pThis, X86PADDR PhysX86Addr, uint32_t u32Val)
 {
     volatile uint32_t *pu32 = NULL;
-    int rc = pspStubX86PhysMap(pThis, PhysX86Addr, true /*fMmio*/, (void **)&pu32);
+    int rc = MAPMgrX86PhysMap(&pThis->MapMgr, PhysX86Addr, true /*fMmio*/, (void **)&pu32);
     if (STS_SUCCESS(rc))
     {
         *pu32 = u32Val;
-        pspStubX86PhysUnmapByPtr(pThis, (void *)pu32);
+        MAPMgrX86PhysUnmapByPtr(&pThis->MapMgr, (void *)pu32);
     }
 }
 
 static void pspStubX86MmioWriteU8(PPSPSTUBSTATE pThis, X86PADDR PhysX86Addr, uint8_t bVal)
 {
     volatile uint8_t *pb = NULL;
-    int rc = pspStubX86PhysMap(pThis, PhysX86Addr, true /*fMmio*/, (void **)&pb);
+    int rc = MAPMgrX86PhysMap(&pThis->MapMgr, PhysX86Addr, true /*fMmio*/, (void **)&pb);
     if (STS_SUCCESS(rc))
     {
         *pb = bVal;
-        pspStubX86PhysUnmapByPtr(pThis, (void *)pb);
+        MAPMgrX86PhysUnmapByPtr(&pThis->MapMgr, (void *)pb);
     }
 }
 
@@ -2620,12 +5666,12 @@ static void pspStubSerialSuperIoInit(PPSPSTUBSTATE pThis)
 static uint32_t pspStubGetPhysDieId(PPSPSTUBSTATE pThis)
 {
     void *pvMap = NULL;
-    int rc = pspStubSmnMap(pThis, 0x5a078, &pvMap);
+    int rc = MAPMgrSmnMap(&pThis->MapMgr, 0x5a078, &pvMap);
     if (!rc)
     {
         uint32_t uVal;
         pspStubMmioAccess(&uVal, (void *)pvMap, sizeof(uint32_t));
-        pspStubSmnUnmapByPtr(pThis, pvMap);
+        MAPMgrSmnUnmapByPtr(&pThis->MapMgr, pvMap);
         return uVal & 0x3;
     }
 
@@ -2666,9 +5712,15 @@ static int pspStubMainloop(PPSPSTUBSTATE pThis)
     {
         LogRel("pspStubMainloop: Connection established\n");
 
-        /* Connected, main PDU receive function. */
+        /*
+         * Connected, main PDU receive function. The watchlist is only sampled here and not while
+         * waiting for PDUs in general, code modules and requests might be using the checkpoint.
+         */
         for (;;)
-            pspStubPduRecvProcessSingle(pThis, PSP_SERIAL_STUB_INDEFINITE_WAIT);
+        {
+            uint32_t cMillies = pspStubWatchSample(pThis);
+            pspStubPduRecvProcessSingle(pThis, cMillies);
+        }
     }
 
     LogRel("pspStubMainloop: Exiting with %d\n", rc);
@@ -2721,12 +5773,102 @@ static void pspStubLogFlush(void *pvUser, uint8_t *pbBuf, size_t cbBuf)
                 off   += 4;
             }
         }
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+        else if (pThis->pIfTranspLog)
+        {
+            /* Only buffer the data here, it gets written when the stub is idle. */
+            uint32_t cbFree = sizeof(pThis->abLogBuf) - pThis->cbLogBuf;
+            uint32_t cbCopy = MIN(cbFree, cbBuf);
+            uint32_t offWrite = (pThis->offLogBufRead + pThis->cbLogBuf) % sizeof(pThis->abLogBuf);
+            uint32_t cbFirst = MIN(cbCopy, sizeof(pThis->abLogBuf) - offWrite);
+
+            memcpy(&pThis->abLogBuf[offWrite], pbBuf, cbFirst);
+            memcpy(&pThis->abLogBuf[0], pbBuf + cbFirst, cbCopy - cbFirst);
+            pThis->cbLogBuf     += cbCopy;
+            pThis->cbLogDropped += cbBuf - cbCopy;
+        }
+#endif
         else
             pspStubPduSend(pThis, INF_SUCCESS, 0 /*idCcd*/, PSPSERIALPDURRNID_NOTIFICATION_LOG_MSG, pbBuf, cbBuf);
     }
 }
 
 
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+/**
+ * Writes some of the buffered log output to the dedicated log channel.
+ *
+ * @returns nothing.
+ * @param   pThis               The serial stub instance data.
+ */
+static void pspStubLogDrain(PPSPSTUBSTATE pThis)
+{
+    if (   !pThis->pIfTranspLog
+        || !pThis->cbLogBuf)
+        return;
+
+    /* Only a small piece at a time to not delay PDUs coming in. */
+    uint32_t cbThisWrite = MIN(pThis->cbLogBuf, PSP_SERIAL_STUB_LOG_DRAIN_SZ);
+    cbThisWrite = MIN(cbThisWrite, sizeof(pThis->abLogBuf) - pThis->offLogBufRead);
+
+    int rc = pThis->pIfTranspLog->pfnBegin(pThis->hPduTranspLog);
+    if (!rc)
+    {
+        rc = pThis->pIfTranspLog->pfnWrite(pThis->hPduTranspLog, &pThis->abLogBuf[pThis->offLogBufRead],
+                                           cbThisWrite, NULL /*pcbWritten*/);
+        pThis->pIfTranspLog->pfnEnd(pThis->hPduTranspLog);
+    }
+
+    /* Drop the data even on failure, there is nothing we could do about it anyway. */
+    pThis->offLogBufRead = (pThis->offLogBufRead + cbThisWrite) % sizeof(pThis->abLogBuf);
+    pThis->cbLogBuf     -= cbThisWrite;
+
+    if (   !pThis->cbLogBuf
+        && pThis->cbLogDropped)
+    {
+        uint32_t cbDropped = pThis->cbLogDropped;
+
+        pThis->cbLogDropped = 0;
+        LogRel("pspStubLogDrain: Dropped %u bytes of log output\n", cbDropped);
+    }
+}
+
+
+/**
+ * Sets up the dedicated log channel if configured.
+ *
+ * @returns nothing.
+ * @param   pThis               The serial stub instance data.
+ */
+static void pspStubLogChanInit(PPSPSTUBSTATE pThis)
+{
+    pThis->pIfTranspLog  = NULL;
+    pThis->hPduTranspLog = NULL;
+    pThis->offLogBufRead = 0;
+    pThis->cbLogBuf      = 0;
+    pThis->cbLogDropped  = 0;
+
+    /* The PDU channel can't be shared. */
+    if (pThis->enmTranspId == PSP_SERIAL_STUB_LOG_CHAN)
+        return;
+
+    for (uint32_t i = 0; i < ELEMENTS(g_aLogTransp); i++)
+    {
+        if (g_aLogTransp[i].enmTranspId == PSP_SERIAL_STUB_LOG_CHAN)
+        {
+            PCPSPPDUTRANSPIF pIfTransp = g_aLogTransp[i].pIfTransp;
+
+            memset(&pThis->abTranspLogData[0], 0, sizeof(pThis->abTranspLogData));
+            int rc = pIfTransp->pfnInit(&pThis->abTranspLogData[0], sizeof(pThis->abTranspLogData), &pThis->hPduTranspLog);
+            if (!rc)
+                pThis->pIfTranspLog = pIfTransp;
+            break;
+        }
+    }
+}
+#endif
+
+
 /**
  * Resumes the given checkpoitn after the exception handler returned.
  *
@@ -2807,7 +5949,11 @@ void ExcpFiq(void)
 }
 
 
+#ifdef PSP_SERIAL_STUB_HOST
+void pspStubHostMain(void)
+#else
 void main(void)
+#endif
 {
     /* Init the stub state and create the UART driver instances. */
     PPSPSTUBSTATE pThis = &g_StubState;
@@ -2815,7 +5961,7 @@ void main(void)
     off           = 0;
 
     pspStubIrqDisable();
-    pThis->cCcds                       = 1; /** @todo Determine the amount of available CCDs (can't be read from boot ROM service page at all times) */
+    pThis->cCcds                       = PSP_SERIAL_STUB_SOCKET_COUNT * PSP_SERIAL_STUB_CCDS_PER_SOCKET;
     pThis->fConnected                  = false;
 #if 0
     pThis->fIrqPending                 = false;
@@ -2833,17 +5979,32 @@ void main(void)
     pThis->fEarlyLogOverSpi            = true;
     pThis->fLogEnabled                 = true;
 #endif
+    pThis->pIfTransp                   = NULL;
+    pThis->enmTranspId                 = PSPSERIALTRANSPID_INVALID;
+    pThis->cbPerSecTransp              = 0;
     pThis->cBeaconsSent                = 0;
     pThis->cPdusSent                   = 0;
     pThis->cPduRecvNext                = 1;
+#ifdef PSP_SERIAL_STUB_COBS_FRAMING
+    COBSEncInit(&pThis->CobsEnc, pspStubCobsEncWrite, pThis);
+    COBSDecInit(&pThis->CobsDec, &pThis->abPdu[0], sizeof(pThis->abPdu));
+#endif
     pspStubPduRecvReset(pThis);
-    memset(&pThis->aX86MapSlots[0], 0, sizeof(pThis->aX86MapSlots));
-    memset(&pThis->aSmnMapSlots[0], 0, sizeof(pThis->aSmnMapSlots));
-    for (uint32_t i = 0; i < ELEMENTS(pThis->aX86MapSlots); i++)
-        pThis->aX86MapSlots[i].PhysX86AddrBase = NIL_X86PADDR;
+#ifdef PSP_SERIAL_STUB_HOST
+    MAPMgrRegSimInit(&pThis->MapRegSim);
+    MAPMgrInit(&pThis->MapMgr, &g_MapMgrRegIfSim, &pThis->MapRegSim);
+#else
+    MAPMgrInit(&pThis->MapMgr, &g_MapMgrRegIfMmio, NULL /*pvUser*/);
+#endif
+    memset(&pThis->aMapPins[0], 0, sizeof(pThis->aMapPins));
+    memset(&pThis->aSnapshots[0], 0, sizeof(pThis->aSnapshots));
+    memset(&pThis->aWatches[0], 0, sizeof(pThis->aWatches));
+    pThis->cWatches                    = 0;
+    pThis->cMsWatchInterval            = PSP_SERIAL_STUB_WATCH_INTERVAL_DEF_MS;
+    pThis->tsWatchLast                 = 0;
 
     if (pThis->fEarlyLogOverSpi)
-        pspStubSmnMap(pThis, 0xa0000000 + PSP_SERIAL_STUB_EARLY_SPI_LOG_OFF, &pThis->pvEarlySpiLog);
+        MAPMgrSmnMap(&pThis->MapMgr, 0xa0000000 + PSP_SERIAL_STUB_EARLY_SPI_LOG_OFF, &pThis->pvEarlySpiLog);
 
     /* Init the timer. */
     pspStubTimerInit(&pThis->Timer);
@@ -2858,9 +6019,18 @@ void main(void)
         for (;;);
     }
 
+    /* Copies fall back to the CPU if the CCP doesn't work. */
+#ifdef PSP_SERIAL_STUB_HOST
+    CCPSimInit(&pThis->CcpSim, pspStubCcpSimX86Resolve, pThis);
+    if (CCPInit(&pThis->Ccp, &g_CcpRegIfSim, &pThis->CcpSim, PSP_STUB_CCP_GET_MICROS, pThis, PSP_SERIAL_STUB_CCP_QUEUE))
+#else
+    if (CCPInit(&pThis->Ccp, &g_CcpRegIfMmio, NULL /*pvUser*/, PSP_STUB_CCP_GET_MICROS, pThis, PSP_SERIAL_STUB_CCP_QUEUE))
+#endif
+        LogRel("main: CCP not available, copying with the CPU\n");
+
     /*pspStubInitHw(pThis);*/
 
-#ifndef PSP_SERIAL_STUB_SPI_MSG_CHAN
+#if !defined(PSP_SERIAL_STUB_SPI_MSG_CHAN) || defined(PSP_SERIAL_STUB_TRANSP_PROBE)
     pspStubSerialSuperIoInit(pThis);
 #endif
 
@@ -2870,6 +6040,9 @@ void main(void)
     int rc = pspStubTranspInit(pThis);
     if (!rc)
     {
+#ifdef PSP_SERIAL_STUB_LOG_CHAN
+        pspStubLogChanInit(pThis);
+#endif
         pThis->fLogEnabled = true;
         pThis->fEarlyLogOverSpi = false;
         LogRel("main: Transport channel initialized -> starting mainloop\n");
@@ -26,6 +26,7 @@
 #include <log.h>
 
 #include <io.h>
+#include <mmio.h>
 #include <uart.h>
 
 #include "pdu-transp.h"
@@ -67,6 +68,8 @@ typedef struct PSPPDUTRANSPINT
     uint8_t                     bRegCs;
     /** */
     uint32_t                    fSpiBridgeDisable;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
 } PSPPDUTRANSPINT;
 /** Pointer to the x86 UART PDU transport channel instance. */
 typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
@@ -74,31 +77,31 @@ typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
 
 static inline void pspStubSpiMasterWriteRegU8(PPSPPDUTRANSPINT pThis, uint32_t offReg, uint8_t bVal)
 {
-    *((volatile uint8_t *)pThis->pvSmnMap + offReg) = bVal;
+    pspMmioWriteU8((volatile uint8_t *)pThis->pvSmnMap + offReg, bVal);
 }
 
 
 static inline uint8_t pspStubSpiMasterReadRegU8(PPSPPDUTRANSPINT pThis, uint32_t offReg)
 {
-    return *((volatile uint8_t *)pThis->pvSmnMap + offReg);
+    return pspMmioReadU8((volatile uint8_t *)pThis->pvSmnMap + offReg);
 }
 
 
 static inline void pspStubSpiMasterWriteRegU16(PPSPPDUTRANSPINT pThis, uint32_t offReg, uint16_t u16Val)
 {
-    *(volatile uint16_t *)((volatile uint8_t *)pThis->pvSmnMap + offReg) = u16Val;
+    pspMmioWriteU16((volatile uint8_t *)pThis->pvSmnMap + offReg, u16Val);
 }
 
 
 static inline void pspStubSpiMasterWriteRegU32(PPSPPDUTRANSPINT pThis, uint32_t offReg, uint32_t u32Val)
 {
-    *(volatile uint32_t *)((volatile uint8_t *)pThis->pvSmnMap + offReg) = u32Val;
+    pspMmioWriteU32((volatile uint8_t *)pThis->pvSmnMap + offReg, u32Val);
 }
 
 
 static inline uint32_t pspStubSpiMasterReadRegU32(PPSPPDUTRANSPINT pThis, uint32_t offReg)
 {
-    return *(volatile uint32_t *)((volatile uint8_t *)pThis->pvSmnMap + offReg);
+    return pspMmioReadU32((volatile uint8_t *)pThis->pvSmnMap + offReg);
 }
 
 
@@ -110,7 +113,8 @@ static inline uint32_t pspStubSpiMasterReadRegU32(PPSPPDUTRANSPINT pThis, uint32
  * @param   bCmd                The command byte.
  * @param   pbTx                The data to transfer.
  * @param   cbTx                Number of bytes to transmit.
- * @param   pbRx                Where to store the received bytes.
+ * @param   pbRx                Where to store the received bytes, they are stored at offset cbTx
+ *                              (like in the FIFO) so the buffer must hold cbTx + cbRx bytes.
  * @param   cbRx                Number of bytes to receive.
  */
 static int pspStubSpiMasterXact(PPSPPDUTRANSPINT pThis, uint8_t bCmd, uint8_t *pbTx, size_t cbTx,
@@ -126,7 +130,8 @@ static int pspStubSpiMasterXact(PPSPPDUTRANSPINT pThis, uint8_t bCmd, uint8_t *p
     pspStubSpiMasterWriteRegU8(pThis, PSP_SPI_MASTER_CMD_TRIG, PSP_SPI_MASTER_CMD_TRIG_BIT); /* Issues the transaction */
 
     /* Wait until the master is idling. */
-    while (pspStubSpiMasterReadRegU32(pThis, PSP_SPI_MASTER_STATUS) & PSP_SPI_MASTER_STATUS_BSY);
+    while (pspStubSpiMasterReadRegU32(pThis, PSP_SPI_MASTER_STATUS) & PSP_SPI_MASTER_STATUS_BSY)
+        pThis->Stats.cBusyWaits++;
 
     for (uint32_t i = 0; i < cbRx; i++)
         pbRx[i + cbTx] = pspStubSpiMasterReadRegU8(pThis, PSP_SPI_FIFO_START + cbTx + i);
@@ -165,11 +170,11 @@ static int pspStubEm100RegWrite(PPSPPDUTRANSPINT pThis, uint8_t idxReg, uint8_t
 static int pspStubEm100RegRead(PPSPPDUTRANSPINT pThis, uint8_t idxReg, uint8_t *pbReg)
 {
     uint8_t abCmd[2] = { 0 };
-    uint8_t abRecv[4] = { 0 };
+    uint8_t abRecv[sizeof(abCmd) + 4] = { 0 };
     abCmd[1] = 0xb0 | (idxReg & 0xf);
 
     int rc = pspStubSpiMasterXact(pThis, 0x11, &abCmd[0], sizeof(abCmd),
-                                  &abRecv[0], sizeof(abRecv));
+                                  &abRecv[0], sizeof(abRecv) - sizeof(abCmd));
     if (!rc)
         *pbReg = abRecv[3];
 
@@ -297,9 +302,10 @@ static int pspStubEm100DFifoRead(PPSPPDUTRANSPINT pThis, uint8_t *pbBuf, size_t
         return ERR_INVALID_PARAMETER;
 
     uint8_t abCmd[3];
-    uint8_t abRecv[PSP_SPI_MASTER_CHUNK_SZ + sizeof(abCmd)];
+    uint8_t abRecv[PSP_SPI_MASTER_CHUNK_SZ + 2 * sizeof(abCmd)];
     abCmd[0] = 0x0;
     abCmd[1] = 0xd0;
+    abCmd[2] = 0x0; /* Dummy */
 
     int rc = pspStubSpiMasterXact(pThis, 0x11, &abCmd[0], sizeof(abCmd),
                                   &abRecv[0], cbRead + sizeof(abCmd));
@@ -310,6 +316,7 @@ static int pspStubEm100DFifoRead(PPSPPDUTRANSPINT pThis, uint8_t *pbBuf, size_t
     }
 
     /* Wait for at least one free byte in the UFifo. */
+    uint64_t tsStart = pspSerialStubGetMicros();
     for (;;)
     {
         size_t cbFree = 0;
@@ -318,8 +325,10 @@ static int pspStubEm100DFifoRead(PPSPPDUTRANSPINT pThis, uint8_t *pbBuf, size_t
             || cbFree)
             break;
 
+        pThis->Stats.cBusyWaits++;
         pspSerialStubDelayUs(10);
     }
+    pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
 
     if (!rc)
     {
@@ -358,9 +367,11 @@ static int pspStubEm100FetchChunk(PPSPPDUTRANSPINT pThis)
      */
     size_t cbAvail = 0;
     int rc = INF_SUCCESS;
+    uint64_t tsStart = pspSerialStubGetMicros();
     for (;;)
     {
         pspSerialStubDelayUs(10);
+        pThis->Stats.cBusyWaits++;
 
         size_t cbThisAvail = 0;
         rc = pspStubEm100DFifoQueryAvail(pThis, &cbThisAvail);
@@ -374,6 +385,7 @@ static int pspStubEm100FetchChunk(PPSPPDUTRANSPINT pThis)
 
         cbAvail = cbThisAvail;
     }
+    pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
 
     /* We should never have more than chunk size here. */
     if (   !rc
@@ -396,7 +408,10 @@ static int pspStubEm100TranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, s
     PPSPPDUTRANSPINT pThis = hPduTransp;
 
     uint8_t *pbBuf = (uint8_t *)pvBuf;
+    uint64_t tsBlocked = 0;
     int rc = INF_SUCCESS;
+
+    pThis->Stats.cWrites++;
     while (   cbWrite
            && rc == INF_SUCCESS)
     {
@@ -406,6 +421,12 @@ static int pspStubEm100TranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, s
         {
             if (cbFree >= 2 * (PSP_SPI_MASTER_CHUNK_SZ + 2))
             {
+                if (tsBlocked)
+                {
+                    pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsBlocked;
+                    tsBlocked = 0;
+                }
+
                 size_t cbThisWrite = MIN(cbWrite, PSP_SPI_MASTER_CHUNK_SZ - 2);
                 cbThisWrite = MIN(cbThisWrite, cbFree);
 
@@ -414,12 +435,19 @@ static int pspStubEm100TranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, s
                 {
                     pbBuf   += cbThisWrite;
                     cbWrite -= cbThisWrite;
+                    pThis->Stats.cbWritten += cbThisWrite;
                 }
             }
-#if 0
             else
+            {
+                /* Waiting for the host to empty the uFIFO. */
+                if (!tsBlocked)
+                    tsBlocked = pspSerialStubGetMicros();
+                pThis->Stats.cBusyWaits++;
+#if 0
                 pspSerialStubDelayMs(1); /* Wait for a moment to let the host empty the uFIFO. */
 #endif
+            }
         }
     }
 
@@ -450,10 +478,21 @@ static int pspStubEm100TranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_t c
         pThis->offChunk += cbThisRead;
     }
 
+    pThis->Stats.cReads++;
+    pThis->Stats.cbRead += cbRead - cbReadLeft;
     return rc;
 }
 
 
+static int pspStubEm100TranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
+    return INF_SUCCESS;
+}
+
+
 static size_t pspStubEm100TranspPeek(PSPPDUTRANSP hPduTransp)
 {
     PPSPPDUTRANSPINT pThis = hPduTransp;
@@ -501,6 +540,8 @@ static int pspStubEm100TranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP phPdu
         return ERR_INVALID_PARAMETER;
 
     PPSPPDUTRANSPINT pThis = (PPSPPDUTRANSPINT)pvMem;
+    memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+
     int rc = pspSerialStubSmnMap(PSP_SPI_MASTER_SMN_ADDR, (void **)&pThis->pvSmnMap);
     if (!rc)
     {
@@ -553,6 +594,8 @@ const PSPPDUTRANSPIF g_SpiFlashTranspEm100 =
     /** pfnRead */
     pspStubEm100TranspRead,
     /** pfnWrite */
-    pspStubEm100TranspWrite
+    pspStubEm100TranspWrite,
+    /** pfnQueryStats */
+    pspStubEm100TranspQueryStats
 };
 
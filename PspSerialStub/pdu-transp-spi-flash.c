@@ -26,6 +26,7 @@
 #include <log.h>
 
 #include <io.h>
+#include <mmio.h>
 #include <uart.h>
 
 #include "pdu-transp.h"
@@ -35,6 +36,8 @@
 #define PSP_SPI_FLASH_SMN_ADDR          0x0a000000
 
 #define PSP_SPI_FLASH_LOCK_WAIT         50
+/** Number of PSP_SPI_FLASH_LOCK_WAIT rounds to wait for the emulator during initialization. */
+#define PSP_SPI_FLASH_INIT_ROUNDS       20
 
 /** Where in the flash the message channel is located. */
 #define SPI_MSG_CHAN_HDR_OFF            0xaab000
@@ -60,6 +63,8 @@ typedef struct PSPPDUTRANSPINT
     uint32_t                    offReadLast;
     /** Number of bytes available for reading. */
     size_t                      cbReadAvail;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
 } PSPPDUTRANSPINT;
 /** Pointer to the x86 UART PDU transport channel instance. */
 typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
@@ -82,7 +87,7 @@ static void pspStubSpiFlashWipeCache(PPSPPDUTRANSPINT pThis)
     if (!rc)
     {
         /* Make sure we don't read cached data by issuing a read to a non accecssed region. */
-        uint32_t uIgnored = *(volatile uint32_t *)pvMap;
+        (void)pspMmioReadU32(pvMap);
         pspSerialStubSmnUnmapByPtr(pvMap);
     }
 }
@@ -109,7 +114,7 @@ static void pspStubSpiFlashRead(PPSPPDUTRANSPINT pThis, uint32_t off, void *pvBu
     int rc = pspSerialStubSmnMap(PSP_SPI_FLASH_SMN_ADDR + off, &pvMap);
     if (!rc)
     {
-        memcpy(pvBuf, pvMap, cbRead);
+        pspMmioCopyFrom(pvBuf, pvMap, cbRead);
         pspSerialStubSmnUnmapByPtr(pvMap);
         pThis->offReadLast = off;
     }
@@ -137,14 +142,14 @@ static void pspStubSpiFlashWrite(PPSPPDUTRANSPINT pThis, uint32_t off, const voi
 
         while (cbWrite >= sizeof(uint32_t))
         {
-            *(volatile uint32_t *)pbDst = *(uint32_t *)pbSrc;
+            pspMmioWriteU32(pbDst, *(const uint32_t *)pbSrc);
             pbDst   += sizeof(uint32_t);
             pbSrc   += sizeof(uint32_t);
             cbWrite -= sizeof(uint32_t);
         }
 
         if (cbWrite)
-            memcpy((uint8_t *)pbDst, pbSrc, cbWrite);
+            pspMmioCopyTo(pbDst, pbSrc, cbWrite);
         pspSerialStubSmnUnmapByPtr(pvMap);
     }
 }
@@ -162,8 +167,8 @@ static inline void pspStubSpiFlashStsWr(uint32_t uSts)
     int rc = pspSerialStubSmnMap(PSP_SPI_FLASH_SMN_ADDR + SPI_MSG_CHAN_STS_OFF, &pvMap);
     if (!rc)
     {
-        *(volatile uint32_t *)pvMap = uSts;
-        uint32_t uIgnored = *((volatile uint32_t *)pvMap + 1);
+        pspMmioWriteU32(pvMap, uSts);
+        (void)pspMmioReadU32((volatile uint32_t *)pvMap + 1);
         pspSerialStubSmnUnmapByPtr(pvMap);
     }
 }
@@ -189,10 +194,12 @@ static void pspStubSpiFlashLock(PPSPPDUTRANSPINT pThis)
 #if 1
         uint32_t cRounds = 0;
 #endif
+        uint64_t tsStart = pspSerialStubGetMicros();
         do
         {
             pspSerialStubDelayMs(PSP_SPI_FLASH_LOCK_WAIT); /* Wait a moment for the emulator process the request. */
             pspStubSpiFlashRead(pThis, SPI_FLASH_LOCK_OFF, &u32Read, sizeof(u32Read));
+            pThis->Stats.cBusyWaits++;
 
 #if 1 /* Debug code for a hang where the locked magic is never read after a lock request. */
             cRounds++;
@@ -205,6 +212,9 @@ static void pspStubSpiFlashLock(PPSPPDUTRANSPINT pThis)
 #endif
         }
         while (u32Read != SPI_FLASH_LOCK_LOCKED_MAGIC);
+
+        pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
+        pThis->Stats.cLocks++;
     }
 
     pThis->cSpiFlashLock++;
@@ -232,10 +242,12 @@ static void pspStubSpiFlashUnlock(PPSPPDUTRANSPINT pThis)
 #if 1
         uint32_t cRounds = 0;
 #endif
+        uint64_t tsStart = pspSerialStubGetMicros();
         do
         {
             pspSerialStubDelayMs(PSP_SPI_FLASH_LOCK_WAIT); /* Wait a moment for the emulator process the request. */
             pspStubSpiFlashRead(pThis, SPI_FLASH_LOCK_OFF, &u32Read, sizeof(u32Read));
+            pThis->Stats.cBusyWaits++;
 
 #if 1 /* Debug code for a hang where the unlocked magic is never read after a unlock request. */
             cRounds++;
@@ -248,6 +260,8 @@ static void pspStubSpiFlashUnlock(PPSPPDUTRANSPINT pThis)
 #endif
         }
         while (u32Read != SPI_FLASH_LOCK_UNLOCKED_MAGIC);
+
+        pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
     }
 }
 
@@ -270,6 +284,9 @@ static int pspStubSpiFlashTranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf
     }
     pspStubSpiFlashUnlock(pThis);
 
+    pThis->Stats.cWrites++;
+    pThis->Stats.cbWritten += cbWrite;
+
     return INF_SUCCESS;
 }
 
@@ -295,6 +312,8 @@ static int pspStubSpiFlashTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_
             pspStubSpiFlashWrite(pThis, SPI_MSG_CHAN_AVAIL_OFF, &cbThisRead, sizeof(cbThisRead));
             pspStubSpiFlashRead(pThis, 0, &cbThisRead, sizeof(cbThisRead)); /* Dummy */
         }
+        else
+            pThis->Stats.cBusyWaits++;
 
 #if 0
         pThis->cbReadAvail -= cbThisRead;
@@ -305,6 +324,17 @@ static int pspStubSpiFlashTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_
         pspStubSpiFlashUnlock(pThis);
     }
 
+    pThis->Stats.cReads++;
+    pThis->Stats.cbRead += cbRead;
+    return INF_SUCCESS;
+}
+
+
+static int pspStubSpiFlashTranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
     return INF_SUCCESS;
 }
 
@@ -370,17 +400,24 @@ static int pspStubSpiFlashTranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP ph
     pThis->cSpiFlashLock = 0;
     pThis->offReadLast   = 0xffff0000; /* Invalid, this will always wipe the cache. */
     pThis->cbReadAvail   = 0;
+    memset(&pThis->Stats, 0, sizeof(pThis->Stats));
 
+    /* Give up after a while if there is no emulator behind the flash so other channels can be probed. */
     uint32_t u32Magic;
-    do
+    for (uint32_t i = 0; i < PSP_SPI_FLASH_INIT_ROUNDS; i++)
     {
         pspStubSpiFlashRead(pThis, 0, &u32Magic, sizeof(u32Magic)); /* Read some dummy first, to flush the SPI read cache. */
         pspStubSpiFlashRead(pThis, SPI_FLASH_LOCK_OFF, &u32Magic, sizeof(u32Magic));
+        if (u32Magic == SPI_FLASH_LOCK_UNLOCKED_MAGIC)
+        {
+            *phPduTransp = pThis;
+            return INF_SUCCESS;
+        }
+
+        pspSerialStubDelayMs(PSP_SPI_FLASH_LOCK_WAIT);
     }
-    while (u32Magic != SPI_FLASH_LOCK_UNLOCKED_MAGIC);
 
-    *phPduTransp = pThis;
-    return INF_SUCCESS;
+    return ERR_INVALID_STATE;
 }
 
 
@@ -401,6 +438,8 @@ const PSPPDUTRANSPIF g_SpiFlashTransp =
     /** pfnRead */
     pspStubSpiFlashTranspRead,
     /** pfnWrite */
-    pspStubSpiFlashTranspWrite
+    pspStubSpiFlashTranspWrite,
+    /** pfnQueryStats */
+    pspStubSpiFlashTranspQueryStats
 };
 
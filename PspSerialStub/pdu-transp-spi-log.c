@@ -0,0 +1,210 @@
+/** @file
+ * PSP app - Write only log channel into the SPI flash log window.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <string.h>
+#include <err.h>
+#include <log.h>
+
+#include <mmio.h>
+
+#include "pdu-transp.h"
+#include "psp-serial-stub-internal.h"
+
+
+/*
+ * The flash emulator traces all writes into the log window and the host side dumps them as a plain text stream,
+ * the same way the early log during startup works. The window follows the 1MB early log area so
+ * the startup log isn't overwritten. Writes wrap around at the end of the window.
+ */
+
+/** SMN address of the log window. */
+#ifndef PSP_SPI_LOG_SMN_ADDR
+# define PSP_SPI_LOG_SMN_ADDR               (0xa0000000 + _1M)
+#endif
+/** Size of the log window in bytes (must not cross a 1MB boundary). */
+#define PSP_SPI_LOG_SZ                      _1M
+
+
+/**
+ * SPI log window channel.
+ */
+typedef struct PSPPDUTRANSPINT
+{
+    /** The log window mapping. */
+    volatile uint8_t            *pbWnd;
+    /** Current write offset into the window. */
+    uint32_t                    offWnd;
+    /** Bytes of an incomplete dword not written yet. */
+    uint8_t                     abPartial[4];
+    /** Number of valid bytes in abPartial. */
+    uint32_t                    cbPartial;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
+} PSPPDUTRANSPINT;
+/** Pointer to the SPI log window channel instance. */
+typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
+
+
+/**
+ * Writes a single dword into the log window advancing the write offset.
+ *
+ * @returns nothing.
+ * @param   pThis                   SPI log window instance data.
+ * @param   pb                      The 4 bytes to write.
+ */
+static void pspStubSpiLogWriteU32(PPSPPDUTRANSPINT pThis, const uint8_t *pb)
+{
+    uint32_t u32Val = pb[3] << 24 | pb[2] << 16 | pb[1] << 8 | pb[0];
+
+    /* The flash only sees dword accesses. */
+    pspMmioWriteU32(pThis->pbWnd + pThis->offWnd, u32Val);
+    pThis->offWnd = (pThis->offWnd + sizeof(uint32_t)) % PSP_SPI_LOG_SZ;
+}
+
+
+static int pspStubSpiLogTranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, size_t cbWrite, size_t *pcbWritten)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    size_t cbWriteLeft = cbWrite;
+
+    pThis->Stats.cWrites++;
+
+    /* Complete a dword left over from the previous write first. */
+    while (   pThis->cbPartial
+           && cbWriteLeft)
+    {
+        pThis->abPartial[pThis->cbPartial++] = *pbBuf++;
+        cbWriteLeft--;
+        if (pThis->cbPartial == sizeof(uint32_t))
+        {
+            pspStubSpiLogWriteU32(pThis, &pThis->abPartial[0]);
+            pThis->cbPartial = 0;
+        }
+    }
+
+    while (cbWriteLeft >= sizeof(uint32_t))
+    {
+        pspStubSpiLogWriteU32(pThis, pbBuf);
+        pbBuf       += sizeof(uint32_t);
+        cbWriteLeft -= sizeof(uint32_t);
+    }
+
+    /* Keep the rest until the next write so no padding ends up in the log. */
+    while (cbWriteLeft--)
+        pThis->abPartial[pThis->cbPartial++] = *pbBuf++;
+
+    pThis->Stats.cbWritten += cbWrite;
+    if (pcbWritten)
+        *pcbWritten = cbWrite;
+
+    return INF_SUCCESS;
+}
+
+
+static int pspStubSpiLogTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_t cbRead, size_t *pcbRead)
+{
+    /* The window is write only. */
+    return ERR_NOT_IMPLEMENTED;
+}
+
+
+static int pspStubSpiLogTranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
+    return INF_SUCCESS;
+}
+
+
+static size_t pspStubSpiLogTranspPeek(PSPPDUTRANSP hPduTransp)
+{
+    return 0;
+}
+
+
+static int pspStubSpiLogTranspEnd(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static int pspStubSpiLogTranspBegin(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static void pspStubSpiLogTranspTerm(PSPPDUTRANSP hPduTransp)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    pspSerialStubSmnUnmapByPtr((void *)pThis->pbWnd);
+    pThis->pbWnd = NULL;
+}
+
+
+static int pspStubSpiLogTranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP phPduTransp)
+{
+    if (cbMem < sizeof(PSPPDUTRANSPINT))
+        return ERR_INVALID_PARAMETER;
+
+    PPSPPDUTRANSPINT pThis = (PPSPPDUTRANSPINT)pvMem;
+
+    pThis->offWnd    = 0;
+    pThis->cbPartial = 0;
+    memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+
+    /* The mapping is kept for the lifetime of the channel, logging happens way too often to map it every time. */
+    int rc = pspSerialStubSmnMap(PSP_SPI_LOG_SMN_ADDR, (void **)&pThis->pbWnd);
+    if (!rc)
+        *phPduTransp = pThis;
+
+    return rc;
+}
+
+
+const PSPPDUTRANSPIF g_SpiLogTransp =
+{
+    /** cbState */
+    sizeof(PSPPDUTRANSPINT),
+    /** pfnInit */
+    pspStubSpiLogTranspInit,
+    /** pfnTerm */
+    pspStubSpiLogTranspTerm,
+    /** pfnBegin */
+    pspStubSpiLogTranspBegin,
+    /** pfnEnd */
+    pspStubSpiLogTranspEnd,
+    /** pfnPeek */
+    pspStubSpiLogTranspPeek,
+    /** pfnRead */
+    pspStubSpiLogTranspRead,
+    /** pfnWrite */
+    pspStubSpiLogTranspWrite,
+    /** pfnQueryStats */
+    pspStubSpiLogTranspQueryStats
+};
@@ -21,10 +21,12 @@
  */
 #include <types.h>
 #include <cdefs.h>
+#include <string.h>
 #include <err.h>
 #include <log.h>
 
 #include <io.h>
+#include <mmio.h>
 #include <uart.h>
 
 #include "pdu-transp.h"
@@ -44,6 +46,8 @@ typedef struct PSPPDUTRANSPINT
     volatile void               *pvUart;
     /** UART device instance. */
     PSPUART                     Uart;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
 } PSPPDUTRANSPINT;
 /** Pointer to the x86 UART PDU transport channel instance. */
 typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
@@ -59,7 +63,7 @@ static int pspStubX86UartRegRead(PCPSPIODEVIF pIfIoDev, uint32_t offReg, void *p
     /* UART supports only 1 byte wide register accesses. */
     if (cbRead != 1) return ERR_INVALID_STATE;
 
-    *(uint8_t *)pvBuf = *(volatile uint8_t *)((uintptr_t)pThis->pvUart + offReg);
+    *(uint8_t *)pvBuf = pspMmioReadU8((volatile uint8_t *)pThis->pvUart + offReg);
     return INF_SUCCESS;
 }
 
@@ -74,24 +78,100 @@ static int pspStubX86UartRegWrite(PCPSPIODEVIF pIfIoDev, uint32_t offReg, const
     /* UART supports only 1 byte wide register accesses. */
     if (cbWrite != 1) return ERR_INVALID_STATE;
 
-    *(volatile uint8_t *)((uintptr_t)pThis->pvUart + offReg) = *(uint8_t *)pvBuf;
+    pspMmioWriteU8((volatile uint8_t *)pThis->pvUart + offReg, *(const uint8_t *)pvBuf);
     return INF_SUCCESS;
 }
 
 
+/**
+ * Busy waits until the UART can accept data for transmission or has received data.
+ *
+ * @returns nothing.
+ * @param   pThis                   x86 UART transport instance data.
+ * @param   fTx                     Flag whether to wait for transmit space or for received data.
+ */
+static void pspStubUartTranspWait(PPSPPDUTRANSPINT pThis, bool fTx)
+{
+    if (fTx ? PSPUartGetTxSpaceAvail(&pThis->Uart) : PSPUartGetDataAvail(&pThis->Uart))
+        return;
+
+    /* Only query the timer when we actually have to wait. */
+    uint64_t tsStart = pspSerialStubGetMicros();
+    do
+        pThis->Stats.cBusyWaits++;
+    while (!(fTx ? PSPUartGetTxSpaceAvail(&pThis->Uart) : PSPUartGetDataAvail(&pThis->Uart)));
+    pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
+}
+
+
 static int pspStubUartTranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, size_t cbWrite, size_t *pcbWritten)
 {
     PPSPPDUTRANSPINT pThis = hPduTransp;
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    size_t cbWriteLeft = cbWrite;
+    int rc = INF_SUCCESS;
+
+    pThis->Stats.cWrites++;
+    while (   cbWriteLeft
+           && rc == INF_SUCCESS)
+    {
+        pspStubUartTranspWait(pThis, true /*fTx*/);
 
-    return PSPUartWrite(&pThis->Uart, pvBuf, cbWrite, pcbWritten);
+        size_t cbThisWritten = 0;
+        rc = PSPUartWriteNB(&pThis->Uart, pbBuf, cbWriteLeft, &cbThisWritten);
+        if (rc == INF_SUCCESS)
+        {
+            pbBuf       += cbThisWritten;
+            cbWriteLeft -= cbThisWritten;
+        }
+    }
+
+    pThis->Stats.cbWritten += cbWrite - cbWriteLeft;
+    if (   rc == INF_SUCCESS
+        && pcbWritten)
+        *pcbWritten = cbWrite;
+
+    return rc;
 }
 
 
 static int pspStubUartTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_t cbRead, size_t *pcbRead)
 {
     PPSPPDUTRANSPINT pThis = hPduTransp;
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+    size_t cbReadLeft = cbRead;
+    int rc = INF_SUCCESS;
+
+    pThis->Stats.cReads++;
+    while (   cbReadLeft
+           && rc == INF_SUCCESS)
+    {
+        pspStubUartTranspWait(pThis, false /*fTx*/);
 
-    return PSPUartRead(&pThis->Uart, pvBuf, cbRead, pcbRead);
+        size_t cbThisRead = 0;
+        rc = PSPUartReadNB(&pThis->Uart, pbBuf, cbReadLeft, &cbThisRead);
+        if (rc == INF_SUCCESS)
+        {
+            pbBuf      += cbThisRead;
+            cbReadLeft -= cbThisRead;
+        }
+    }
+
+    pThis->Stats.cbRead += cbRead - cbReadLeft;
+    if (   rc == INF_SUCCESS
+        && pcbRead)
+        *pcbRead = cbRead;
+
+    return rc;
+}
+
+
+static int pspStubUartTranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
+    return INF_SUCCESS;
 }
 
 
@@ -119,7 +199,11 @@ static int pspStubUartTranspBegin(PSPPDUTRANSP hPduTransp)
 
 static void pspStubUartTranspTerm(PSPPDUTRANSP hPduTransp)
 {
-    /* Nothing to do. */
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    /* Release the mapping, the channel might get initialized again after probing. */
+    pspSerialStubX86PhysUnmapByPtr((void *)pThis->pvUart);
+    pThis->pvUart = NULL;
 }
 
 
@@ -132,6 +216,7 @@ static int pspStubUartTranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP phPduT
 
     pThis->PhysX86UartBase     = 0xfffdfc0003f8;
     pThis->pvUart              = NULL;
+    memset(&pThis->Stats, 0, sizeof(pThis->Stats));
     pThis->IfIoDev.pfnRegRead  = pspStubX86UartRegRead;
     pThis->IfIoDev.pfnRegWrite = pspStubX86UartRegWrite;
 
@@ -168,6 +253,8 @@ const PSPPDUTRANSPIF g_UartTransp =
     /** pfnRead */
     pspStubUartTranspRead,
     /** pfnWrite */
-    pspStubUartTranspWrite
+    pspStubUartTranspWrite,
+    /** pfnQueryStats */
+    pspStubUartTranspQueryStats
 };
 
@@ -0,0 +1,337 @@
+/** @file
+ * PSP app - Unix domain socket transport channel for the host build.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "pdu-transp.h"
+
+#include "../Lib/include/err.h"
+
+
+/*
+ * The channel listens on the socket given in the PSP_SERIAL_STUB_SOCKET environment variable
+ * and waits for the host tool to connect. Setting the variable to "-" uses stdin/stdout instead,
+ * so the stub can be run behind a pipe pair from an emulator or test harness.
+ * When the other end disconnects the channel waits for the next connection.
+ */
+
+/** Default socket path. */
+#define PSP_SERIAL_STUB_SOCKET_DEF          "/tmp/psp-serial-stub.sock"
+
+
+/**
+ * Unix socket channel.
+ */
+typedef struct PSPPDUTRANSPINT
+{
+    /** The listening socket, -1 when using stdin/stdout. */
+    int                         iFdListen;
+    /** The descriptor to read from, -1 if not connected. */
+    int                         iFdRead;
+    /** The descriptor to write to, -1 if not connected. */
+    int                         iFdWrite;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
+    /** The socket path. */
+    const char                  *pszPath;
+} PSPPDUTRANSPINT;
+/** Pointer to the unix socket channel instance. */
+typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
+
+
+/**
+ * Returns a microsecond timestamp.
+ *
+ * @returns Timestamp in microseconds.
+ */
+static uint64_t pspStubUnixGetMicros(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000 + Ts.tv_nsec / 1000;
+}
+
+
+/**
+ * Drops the current connection.
+ *
+ * @returns nothing.
+ * @param   pThis                   Unix socket channel instance data.
+ */
+static void pspStubUnixDisconnect(PPSPPDUTRANSPINT pThis)
+{
+    if (pThis->iFdRead != -1)
+        close(pThis->iFdRead);
+    pThis->iFdRead  = -1;
+    pThis->iFdWrite = -1;
+}
+
+
+/**
+ * Waits for the other end to connect if there is no connection currently.
+ *
+ * @returns Status code.
+ * @param   pThis                   Unix socket channel instance data.
+ */
+static int pspStubUnixConnect(PPSPPDUTRANSPINT pThis)
+{
+    if (pThis->iFdRead != -1)
+        return INF_SUCCESS;
+    if (pThis->iFdListen == -1) /* stdin/stdout are gone for good. */
+        return ERR_INVALID_STATE;
+
+    uint64_t tsStart = pspStubUnixGetMicros();
+    int iFd;
+    do
+        iFd = accept(pThis->iFdListen, NULL, NULL);
+    while (iFd == -1 && errno == EINTR);
+    pThis->Stats.cUsBlocked += pspStubUnixGetMicros() - tsStart;
+    if (iFd == -1)
+        return ERR_INVALID_STATE;
+
+    pThis->iFdRead  = iFd;
+    pThis->iFdWrite = iFd;
+    return INF_SUCCESS;
+}
+
+
+static int pspStubUnixTranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, size_t cbWrite, size_t *pcbWritten)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    size_t cbWriteLeft = cbWrite;
+
+    int rc = pspStubUnixConnect(pThis);
+    if (rc)
+        return rc;
+
+    pThis->Stats.cWrites++;
+    while (cbWriteLeft)
+    {
+        ssize_t cbThis = write(pThis->iFdWrite, pbBuf, cbWriteLeft);
+        if (cbThis < 0 && errno == EINTR)
+            continue;
+        if (cbThis <= 0)
+        {
+            /* The other end went away, the data is lost like on a real link. */
+            pspStubUnixDisconnect(pThis);
+            return ERR_INVALID_STATE;
+        }
+
+        pbBuf       += cbThis;
+        cbWriteLeft -= cbThis;
+    }
+
+    pThis->Stats.cbWritten += cbWrite;
+    if (pcbWritten)
+        *pcbWritten = cbWrite;
+
+    return INF_SUCCESS;
+}
+
+
+static int pspStubUnixTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_t cbRead, size_t *pcbRead)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+    size_t cbReadLeft = cbRead;
+
+    int rc = pspStubUnixConnect(pThis);
+    if (rc)
+        return rc;
+
+    pThis->Stats.cReads++;
+    while (cbReadLeft)
+    {
+        uint64_t tsStart = pspStubUnixGetMicros();
+        ssize_t cbThis = read(pThis->iFdRead, pbBuf, cbReadLeft);
+        pThis->Stats.cUsBlocked += pspStubUnixGetMicros() - tsStart;
+        if (cbThis < 0 && errno == EINTR)
+            continue;
+        if (cbThis <= 0)
+        {
+            pspStubUnixDisconnect(pThis);
+            return ERR_INVALID_STATE;
+        }
+
+        pbBuf      += cbThis;
+        cbReadLeft -= cbThis;
+    }
+
+    pThis->Stats.cbRead += cbRead;
+    if (pcbRead)
+        *pcbRead = cbRead;
+
+    return INF_SUCCESS;
+}
+
+
+static int pspStubUnixTranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
+    return INF_SUCCESS;
+}
+
+
+static size_t pspStubUnixTranspPeek(PSPPDUTRANSP hPduTransp)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    if (pspStubUnixConnect(pThis))
+        return 0;
+
+    struct pollfd PollFd;
+    PollFd.fd      = pThis->iFdRead;
+    PollFd.events  = POLLIN;
+    PollFd.revents = 0;
+    if (poll(&PollFd, 1, 0) <= 0)
+        return 0;
+
+    int cbAvail = 0;
+    if (   ioctl(pThis->iFdRead, FIONREAD, &cbAvail) == -1
+        || (   !cbAvail
+            && (PollFd.revents & (POLLIN | POLLHUP | POLLERR))))
+    {
+        /* Readable without any data means the other end hung up, the next call waits for a new connection. */
+        pspStubUnixDisconnect(pThis);
+        return 0;
+    }
+
+    return (size_t)cbAvail;
+}
+
+
+static int pspStubUnixTranspEnd(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static int pspStubUnixTranspBegin(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static void pspStubUnixTranspTerm(PSPPDUTRANSP hPduTransp)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    if (pThis->iFdListen != -1)
+    {
+        pspStubUnixDisconnect(pThis);
+        close(pThis->iFdListen);
+        unlink(pThis->pszPath);
+        pThis->iFdListen = -1;
+    }
+}
+
+
+static int pspStubUnixTranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP phPduTransp)
+{
+    if (cbMem < sizeof(PSPPDUTRANSPINT))
+        return ERR_INVALID_PARAMETER;
+
+    PPSPPDUTRANSPINT pThis = (PPSPPDUTRANSPINT)pvMem;
+    const char *pszPath = getenv("PSP_SERIAL_STUB_SOCKET");
+    if (!pszPath)
+        pszPath = PSP_SERIAL_STUB_SOCKET_DEF;
+
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->iFdListen = -1;
+    pThis->iFdRead   = -1;
+    pThis->iFdWrite  = -1;
+
+    if (!strcmp(pszPath, "-"))
+    {
+        pThis->iFdRead  = STDIN_FILENO;
+        pThis->iFdWrite = STDOUT_FILENO;
+        *phPduTransp = pThis;
+        return INF_SUCCESS;
+    }
+
+    struct sockaddr_un SockAddr;
+    if (strlen(pszPath) >= sizeof(SockAddr.sun_path))
+        return ERR_INVALID_PARAMETER;
+
+    memset(&SockAddr, 0, sizeof(SockAddr));
+    SockAddr.sun_family = AF_UNIX;
+    strcpy(SockAddr.sun_path, pszPath);
+    pThis->pszPath = pszPath;
+    unlink(pszPath);
+
+    pThis->iFdListen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (pThis->iFdListen == -1)
+        return ERR_INVALID_STATE;
+
+    if (   bind(pThis->iFdListen, (struct sockaddr *)&SockAddr, sizeof(SockAddr)) == -1
+        || listen(pThis->iFdListen, 1) == -1)
+    {
+        close(pThis->iFdListen);
+        pThis->iFdListen = -1;
+        return ERR_INVALID_STATE;
+    }
+
+    /* Wait for the first connection so the beacons don't go into the void. */
+    int rc = pspStubUnixConnect(pThis);
+    if (!rc)
+        *phPduTransp = pThis;
+    else
+        pspStubUnixTranspTerm(pThis);
+
+    return rc;
+}
+
+
+const PSPPDUTRANSPIF g_UnixSocketTransp =
+{
+    /** cbState */
+    sizeof(PSPPDUTRANSPINT),
+    /** pfnInit */
+    pspStubUnixTranspInit,
+    /** pfnTerm */
+    pspStubUnixTranspTerm,
+    /** pfnBegin */
+    pspStubUnixTranspBegin,
+    /** pfnEnd */
+    pspStubUnixTranspEnd,
+    /** pfnPeek */
+    pspStubUnixTranspPeek,
+    /** pfnRead */
+    pspStubUnixTranspRead,
+    /** pfnWrite */
+    pspStubUnixTranspWrite,
+    /** pfnQueryStats */
+    pspStubUnixTranspQueryStats
+};
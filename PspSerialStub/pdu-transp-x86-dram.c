@@ -0,0 +1,398 @@
+/** @file
+ * PSP app - PDU transport channel over a mailbox in shared x86 DRAM.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <types.h>
+#include <cdefs.h>
+#include <string.h>
+#include <err.h>
+#include <log.h>
+
+#include "pdu-transp.h"
+#include "psp-serial-stub-internal.h"
+
+
+/*
+ * The mailbox lives in a physical x86 DRAM region reserved by the host (memmap=1M$0x10000000 on the
+ * kernel command line for the default address). It consists of a header followed by two ring buffers
+ * of the same size, the first one carrying data from the host to the PSP, the second one the other way around.
+ * The ring offsets are free running and only ever written by one side, the ring size must be a power of two.
+ *
+ * The host has to clear the header, set up cbRing and write the host magic last. The PSP writes its magic
+ * once it attached to the mailbox. Tools/psp-dram-mbx.py implements the host side.
+ */
+
+/** The x86 physical address of the mailbox. */
+#ifndef PSP_X86_DRAM_MBX_PHYS_ADDR
+# define PSP_X86_DRAM_MBX_PHYS_ADDR         0x10000000
+#endif
+
+/** Magic written by the host when the mailbox is ready. */
+#define PSP_X86_DRAM_MBX_MAGIC_HOST         0x19120623 /* (Alan Turing) */
+/** Magic written by the PSP when it attached to the mailbox. */
+#define PSP_X86_DRAM_MBX_MAGIC_PSP          0x19061209 /* (Grace Hopper) */
+
+
+/**
+ * x86 DRAM mailbox header as shared with the host.
+ */
+typedef struct PSPX86DRAMMBXHDR
+{
+    /** Host magic, PSP_X86_DRAM_MBX_MAGIC_HOST when the mailbox is set up. */
+    volatile uint32_t           u32MagicHost;
+    /** PSP magic, PSP_X86_DRAM_MBX_MAGIC_PSP when the PSP is attached. */
+    volatile uint32_t           u32MagicPsp;
+    /** Size of each ring buffer in bytes (power of two). */
+    volatile uint32_t           cbRing;
+    /** Reserved. */
+    volatile uint32_t           u32Rsvd0;
+    /** Host to PSP ring write offset (written by the host). */
+    volatile uint32_t           offH2PWrite;
+    /** Host to PSP ring read offset (written by the PSP). */
+    volatile uint32_t           offH2PRead;
+    /** PSP to host ring write offset (written by the PSP). */
+    volatile uint32_t           offP2HWrite;
+    /** PSP to host ring read offset (written by the host). */
+    volatile uint32_t           offP2HRead;
+    /** Reserved, pads the header to 64 bytes. */
+    volatile uint32_t           au32Rsvd1[8];
+} PSPX86DRAMMBXHDR;
+/** Pointer to a x86 DRAM mailbox header. */
+typedef PSPX86DRAMMBXHDR *PPSPX86DRAMMBXHDR;
+
+
+/**
+ * x86 DRAM mailbox transport channel.
+ */
+typedef struct PSPPDUTRANSPINT
+{
+    /** The mailbox header mapping. */
+    PPSPX86DRAMMBXHDR           pHdr;
+    /** Start of the host to PSP ring. */
+    volatile uint8_t            *pbH2P;
+    /** Start of the PSP to host ring. */
+    volatile uint8_t            *pbP2H;
+    /** Size of each ring in bytes, cached from the header. */
+    uint32_t                    cbRing;
+    /** Flag whether the host put the ring offsets into an inconsistent state, the channel is unusable then. */
+    bool                        fCorrupted;
+    /** Channel statistics. */
+    PSPPDUTRANSPSTATS           Stats;
+} PSPPDUTRANSPINT;
+/** Pointer to the x86 DRAM mailbox PDU transport channel instance. */
+typedef PSPPDUTRANSPINT *PPSPPDUTRANSPINT;
+
+
+/**
+ * Makes sure all outstanding memory accesses are finished before continuing.
+ *
+ * @returns nothing.
+ */
+static inline void pspStubX86DramMemBarrier(void)
+{
+#ifdef PSP_SERIAL_STUB_HOST
+    __sync_synchronize();
+#else
+    asm volatile("dsb #0xf\n": : :"memory");
+#endif
+}
+
+
+/**
+ * Returns the number of bytes used in a ring from the given offsets.
+ *
+ * @returns Status code, ERR_INVALID_STATE if the offsets are more than a ring apart.
+ * @param   pThis                   x86 DRAM mailbox transport instance data.
+ * @param   offWrite                The free running write offset.
+ * @param   offRead                 The free running read offset.
+ * @param   pcbUsed                 Where to store the number of bytes used on success.
+ */
+static inline int pspStubX86DramRingUsed(PPSPPDUTRANSPINT pThis, uint32_t offWrite, uint32_t offRead, uint32_t *pcbUsed)
+{
+    uint32_t cbUsed = offWrite - offRead;
+
+    /* One of the offsets is written by the host, a bogus value would make the copies overrun the rings. */
+    if (   pThis->fCorrupted
+        || cbUsed > pThis->cbRing)
+    {
+        if (!pThis->fCorrupted)
+            LogRel("x86 DRAM mailbox: Ring offsets %#x/%#x are inconsistent, disabling the channel\n", offWrite, offRead);
+        pThis->fCorrupted = true;
+        return ERR_INVALID_STATE;
+    }
+
+    *pcbUsed = cbUsed;
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Returns the number of bytes available for reading in the host to PSP ring.
+ *
+ * @returns Status code.
+ * @param   pThis                   x86 DRAM mailbox transport instance data.
+ * @param   pcbAvail                Where to store the number of bytes available on success.
+ */
+static inline int pspStubX86DramH2PAvail(PPSPPDUTRANSPINT pThis, uint32_t *pcbAvail)
+{
+    return pspStubX86DramRingUsed(pThis, pThis->pHdr->offH2PWrite, pThis->pHdr->offH2PRead, pcbAvail);
+}
+
+
+/**
+ * Returns the number of bytes free in the PSP to host ring.
+ *
+ * @returns Status code.
+ * @param   pThis                   x86 DRAM mailbox transport instance data.
+ * @param   pcbFree                 Where to store the number of bytes free on success.
+ */
+static inline int pspStubX86DramP2HFree(PPSPPDUTRANSPINT pThis, uint32_t *pcbFree)
+{
+    uint32_t cbUsed = 0;
+    int rc = pspStubX86DramRingUsed(pThis, pThis->pHdr->offP2HWrite, pThis->pHdr->offP2HRead, &cbUsed);
+    if (!rc)
+        *pcbFree = pThis->cbRing - cbUsed;
+
+    return rc;
+}
+
+
+/**
+ * Busy waits until the host put data into the host to PSP ring or freed space in the PSP to host ring.
+ *
+ * @returns Status code.
+ * @param   pThis                   x86 DRAM mailbox transport instance data.
+ * @param   fTx                     Flag whether to wait for free space or for data to read.
+ * @param   pcb                     Where to store the number of bytes available for reading or free for writing,
+ *                                  never more than the ring size.
+ */
+static int pspStubX86DramTranspWait(PPSPPDUTRANSPINT pThis, bool fTx, uint32_t *pcb)
+{
+    uint32_t cb = 0;
+    int rc = fTx ? pspStubX86DramP2HFree(pThis, &cb) : pspStubX86DramH2PAvail(pThis, &cb);
+    if (   rc
+        || cb)
+    {
+        *pcb = cb;
+        return rc;
+    }
+
+    uint64_t tsStart = pspSerialStubGetMicros();
+    do
+    {
+        pThis->Stats.cBusyWaits++;
+        rc = fTx ? pspStubX86DramP2HFree(pThis, &cb) : pspStubX86DramH2PAvail(pThis, &cb);
+    } while (   !rc
+             && !cb);
+    pThis->Stats.cUsBlocked += pspSerialStubGetMicros() - tsStart;
+
+    *pcb = cb;
+    return rc;
+}
+
+
+static int pspStubX86DramTranspWrite(PSPPDUTRANSP hPduTransp, const void *pvBuf, size_t cbWrite, size_t *pcbWritten)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    size_t cbWriteLeft = cbWrite;
+
+    pThis->Stats.cWrites++;
+    while (cbWriteLeft)
+    {
+        uint32_t cbFree = 0;
+        int rc = pspStubX86DramTranspWait(pThis, true /*fTx*/, &cbFree);
+        if (rc)
+            return rc;
+
+        uint32_t offWrite = pThis->pHdr->offP2HWrite;
+        uint32_t offRing = offWrite & (pThis->cbRing - 1);
+        uint32_t cbThisWrite = MIN(cbFree, cbWriteLeft);
+        uint32_t cbFirst = MIN(cbThisWrite, pThis->cbRing - offRing);
+
+        /* Copy the data in at most two parts when wrapping around. */
+        memcpy((uint8_t *)pThis->pbP2H + offRing, pbBuf, cbFirst);
+        if (cbThisWrite > cbFirst)
+            memcpy((uint8_t *)pThis->pbP2H, pbBuf + cbFirst, cbThisWrite - cbFirst);
+
+        /* Data must be visible before the host sees the updated offset. */
+        pspStubX86DramMemBarrier();
+        pThis->pHdr->offP2HWrite = offWrite + cbThisWrite;
+        pbBuf       += cbThisWrite;
+        cbWriteLeft -= cbThisWrite;
+    }
+
+    pThis->Stats.cbWritten += cbWrite;
+    if (pcbWritten)
+        *pcbWritten = cbWrite;
+
+    return INF_SUCCESS;
+}
+
+
+static int pspStubX86DramTranspRead(PSPPDUTRANSP hPduTransp, void *pvBuf, size_t cbRead, size_t *pcbRead)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+    size_t cbReadLeft = cbRead;
+
+    pThis->Stats.cReads++;
+    while (cbReadLeft)
+    {
+        uint32_t cbAvail = 0;
+        int rc = pspStubX86DramTranspWait(pThis, false /*fTx*/, &cbAvail);
+        if (rc)
+            return rc;
+
+        uint32_t offRead = pThis->pHdr->offH2PRead;
+        uint32_t offRing = offRead & (pThis->cbRing - 1);
+        uint32_t cbThisRead = MIN(cbAvail, cbReadLeft);
+        uint32_t cbFirst = MIN(cbThisRead, pThis->cbRing - offRing);
+
+        /* Don't read the data before the offset indicating its availability. */
+        pspStubX86DramMemBarrier();
+        memcpy(pbBuf, (const uint8_t *)pThis->pbH2P + offRing, cbFirst);
+        if (cbThisRead > cbFirst)
+            memcpy(pbBuf + cbFirst, (const uint8_t *)pThis->pbH2P, cbThisRead - cbFirst);
+
+        /* Everything must be read before the host can overwrite the area. */
+        pspStubX86DramMemBarrier();
+        pThis->pHdr->offH2PRead = offRead + cbThisRead;
+        pbBuf      += cbThisRead;
+        cbReadLeft -= cbThisRead;
+    }
+
+    pThis->Stats.cbRead += cbRead;
+    if (pcbRead)
+        *pcbRead = cbRead;
+
+    return INF_SUCCESS;
+}
+
+
+static int pspStubX86DramTranspQueryStats(PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    *pStats = pThis->Stats;
+    return INF_SUCCESS;
+}
+
+
+static size_t pspStubX86DramTranspPeek(PSPPDUTRANSP hPduTransp)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+    uint32_t cbAvail = 0;
+
+    /* A corrupted channel never has anything to read, writes fail with the error status. */
+    if (pspStubX86DramH2PAvail(pThis, &cbAvail))
+        return 0;
+
+    return cbAvail;
+}
+
+
+static int pspStubX86DramTranspEnd(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static int pspStubX86DramTranspBegin(PSPPDUTRANSP hPduTransp)
+{
+    /* Nothing to do. */
+    return INF_SUCCESS;
+}
+
+
+static void pspStubX86DramTranspTerm(PSPPDUTRANSP hPduTransp)
+{
+    PPSPPDUTRANSPINT pThis = hPduTransp;
+
+    pThis->pHdr->u32MagicPsp = 0;
+    pspSerialStubX86PhysUnmapByPtr(pThis->pHdr);
+    pThis->pHdr = NULL;
+}
+
+
+static int pspStubX86DramTranspInit(void *pvMem, size_t cbMem, PPSPPDUTRANSP phPduTransp)
+{
+    if (cbMem < sizeof(PSPPDUTRANSPINT))
+        return ERR_INVALID_PARAMETER;
+
+    PPSPPDUTRANSPINT pThis = (PPSPPDUTRANSPINT)pvMem;
+    X86PADDR PhysX86Mbx = PSP_X86_DRAM_MBX_PHYS_ADDR;
+    uint32_t offWnd = PhysX86Mbx & (_64M - 1);
+
+    memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+
+    /* The whole mailbox must be accessible through a single 64MB mapping window. */
+    int rc = pspSerialStubX86PhysMap(PhysX86Mbx, false /*fMmio*/, (void **)&pThis->pHdr);
+    if (!rc)
+    {
+        uint32_t cbRing = pThis->pHdr->cbRing;
+
+        if (   pThis->pHdr->u32MagicHost == PSP_X86_DRAM_MBX_MAGIC_HOST
+            && cbRing
+            && !(cbRing & (cbRing - 1))
+            && cbRing <= (_64M - offWnd - sizeof(PSPX86DRAMMBXHDR)) / 2)
+        {
+            pThis->cbRing     = cbRing;
+            pThis->fCorrupted = false;
+            pThis->pbH2P      = (volatile uint8_t *)(pThis->pHdr + 1);
+            pThis->pbP2H      = pThis->pbH2P + cbRing;
+
+            /* The offsets are left alone so the channel can be re-initialized without losing data. */
+            pThis->pHdr->u32MagicPsp = PSP_X86_DRAM_MBX_MAGIC_PSP;
+            *phPduTransp = pThis;
+            return INF_SUCCESS;
+        }
+
+        pspSerialStubX86PhysUnmapByPtr(pThis->pHdr);
+        pThis->pHdr = NULL;
+        rc = ERR_INVALID_STATE;
+    }
+
+    return rc;
+}
+
+
+const PSPPDUTRANSPIF g_X86DramTransp =
+{
+    /** cbState */
+    sizeof(PSPPDUTRANSPINT),
+    /** pfnInit */
+    pspStubX86DramTranspInit,
+    /** pfnTerm */
+    pspStubX86DramTranspTerm,
+    /** pfnBegin */
+    pspStubX86DramTranspBegin,
+    /** pfnEnd */
+    pspStubX86DramTranspEnd,
+    /** pfnPeek */
+    pspStubX86DramTranspPeek,
+    /** pfnRead */
+    pspStubX86DramTranspRead,
+    /** pfnWrite */
+    pspStubX86DramTranspWrite,
+    /** pfnQueryStats */
+    pspStubX86DramTranspQueryStats
+};
@@ -38,6 +38,32 @@ typedef struct PSPPDUTRANSPINT *PSPPDUTRANSP;
 typedef PSPPDUTRANSP *PPSPPDUTRANSP;
 
 
+/**
+ * PDU transport channel statistics, accumulated since the channel was initialized.
+ */
+typedef struct PSPPDUTRANSPSTATS
+{
+    /** Number of bytes read from the channel. */
+    uint64_t            cbRead;
+    /** Number of bytes written to the channel. */
+    uint64_t            cbWritten;
+    /** Number of microseconds spent waiting for the other end or the hardware. */
+    uint64_t            cUsBlocked;
+    /** Number of read transactions. */
+    uint32_t            cReads;
+    /** Number of write transactions. */
+    uint32_t            cWrites;
+    /** Number of busy wait loop iterations. */
+    uint32_t            cBusyWaits;
+    /** Number of times the channel lock was acquired (0 if the channel has no locking). */
+    uint32_t            cLocks;
+} PSPPDUTRANSPSTATS;
+/** Pointer to PDU transport channel statistics. */
+typedef PSPPDUTRANSPSTATS *PPSPPDUTRANSPSTATS;
+/** Pointer to const PDU transport channel statistics. */
+typedef const PSPPDUTRANSPSTATS *PCPSPPDUTRANSPSTATS;
+
+
 /** Pointer to a PDU transport channel interface. */
 typedef struct PSPPDUTRANSPIF *PPSPPDUTRANSPIF;
 /** Pointer to a const PDU transport channel interface. */
@@ -114,6 +140,15 @@ typedef struct PSPPDUTRANSPIF
      */
     int         (*pfnWrite) (PSPPDUTRANSP hPduTransp, const void *pvBuf, size_t cbWrite, size_t *pcbWritten);
 
+    /**
+     * Queries the statistics of the transport channel.
+     *
+     * @returns Status code.
+     * @param   hPduTransp          PDU transport channel instance handle.
+     * @param   pStats              Where to store the statistics.
+     */
+    int         (*pfnQueryStats) (PSPPDUTRANSP hPduTransp, PPSPPDUTRANSPSTATS pStats);
+
 } PSPPDUTRANSPIF;
 
 
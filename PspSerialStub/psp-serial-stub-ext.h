@@ -0,0 +1,1282 @@
+/** @file
+ * PSP serial stub - Protocol extensions on top of psp-stub/psp-serial-stub.h.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef __include_psp_serial_stub_ext_h
+#define __include_psp_serial_stub_ext_h
+
+#if defined(IN_PSP)
+# include <common/types.h>
+#else
+# error "Invalid environment"
+#endif
+
+#include <psp-stub/psp-serial-stub.h>
+
+/*
+ * The extension IDs live in their own ranges well above the IDs defined by the
+ * base protocol so both can evolve independently. A response ID is always the
+ * request ID offset into the response range.
+ */
+
+/** First request ID of the extension range. */
+#define PSPSERIALPDURRNID_REQUEST_EXT_FIRST             0x00000100
+/** First response ID of the extension range. */
+#define PSPSERIALPDURRNID_RESPONSE_EXT_FIRST            0x80000100
+/** First notification ID of the extension range. */
+#define PSPSERIALPDURRNID_NOTIFICATION_EXT_FIRST        0xc0000100
+
+/** Converts an extension request ID to the matching response ID. */
+#define PSP_SERIAL_EXT_REQ_2_RESP(a_enmReq)             ((a_enmReq) - PSPSERIALPDURRNID_REQUEST_EXT_FIRST + PSPSERIALPDURRNID_RESPONSE_EXT_FIRST)
+
+/** Transport probe echo request (host -> PSP), see PSPSERIALTRANSPPROBE. */
+#define PSPSERIALPDURRNID_REQUEST_TRANSP_PROBE          (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 0)
+/** Transport statistics query request (no payload). */
+#define PSPSERIALPDURRNID_REQUEST_TRANSP_STATS_QUERY    (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 1)
+/** Tears down all cached x86 and SMN mappings which are not in use (no payload). */
+#define PSPSERIALPDURRNID_REQUEST_MAP_FLUSH             (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 2)
+/** Mapping cache statistics query request (no payload). */
+#define PSPSERIALPDURRNID_REQUEST_MAP_STATS_QUERY       (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 3)
+/** Per mapping slot statistics query request (no payload). */
+#define PSPSERIALPDURRNID_REQUEST_MAP_SLOT_STATS_QUERY  (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 4)
+/** Streams an arbitrarily large SMN/x86 range to the host, see PSPSERIALMEMRANGEREADREQ. */
+#define PSPSERIALPDURRNID_REQUEST_MEM_RANGE_READ        (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 5)
+/** Pins a SMN/x86 mapping window for the session, see PSPSERIALMAPPINREQ. */
+#define PSPSERIALPDURRNID_REQUEST_MAP_PIN               (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 6)
+/** Releases a pinned window, see PSPSERIALMAPUNPINREQ. */
+#define PSPSERIALPDURRNID_REQUEST_MAP_UNPIN             (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 7)
+/** Reads through a pinned window, see PSPSERIALMAPPINXFERREQ. */
+#define PSPSERIALPDURRNID_REQUEST_MAP_PIN_READ          (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 8)
+/** Writes through a pinned window, see PSPSERIALMAPPINXFERREQ (followed by the data). */
+#define PSPSERIALPDURRNID_REQUEST_MAP_PIN_WRITE         (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 9)
+/** Reads x86 memory with an explicit memory type, see PSPSERIALX86XFEREXREQ. */
+#define PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_READ      (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 10)
+/** Writes x86 memory with an explicit memory type, see PSPSERIALX86XFEREXREQ (followed by the data). */
+#define PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_WRITE     (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 11)
+/** Measures the x86 memory throughput seen by the PSP, see PSPSERIALX86MEMBENCHREQ. */
+#define PSPSERIALPDURRNID_REQUEST_X86_MEM_BENCH         (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 12)
+/** Executes a list of data transfers in one go, see PSPSERIALDATAXFERSGREQ. */
+#define PSPSERIALPDURRNID_REQUEST_DATA_XFER_SG          (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 13)
+/** Polls an address until a masked value matches, see PSPSERIALPOLLREQ. */
+#define PSPSERIALPDURRNID_REQUEST_POLL                  (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 14)
+/** Read-modify-write of a register with interrupts masked, see PSPSERIALRMWREQ. */
+#define PSPSERIALPDURRNID_REQUEST_RMW                   (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 15)
+/** Searches a range for a byte pattern, see PSPSERIALMEMSEARCHREQ. */
+#define PSPSERIALPDURRNID_REQUEST_MEM_SEARCH            (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 16)
+/** Computes per block digests over a range, see PSPSERIALDIGESTREQ. */
+#define PSPSERIALPDURRNID_REQUEST_DIGEST                (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 17)
+/** Creates a snapshot of a range, see PSPSERIALSNAPSHOTCREATEREQ. */
+#define PSPSERIALPDURRNID_REQUEST_SNAPSHOT_CREATE       (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 18)
+/** Updates a snapshot, streaming the blocks changed since the last update, see PSPSERIALSNAPSHOTUPDATEREQ. */
+#define PSPSERIALPDURRNID_REQUEST_SNAPSHOT_UPDATE       (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 19)
+/** Destroys a snapshot, see PSPSERIALSNAPSHOTDESTROYREQ. */
+#define PSPSERIALPDURRNID_REQUEST_SNAPSHOT_DESTROY      (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 20)
+/** Fills a range with a pattern generated on the PSP, see PSPSERIALFILLREQ. */
+#define PSPSERIALPDURRNID_REQUEST_FILL                  (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 21)
+/** Copies between x86 memory and PSP memory on the PSP, see PSPSERIALX86COPYREQ. */
+#define PSPSERIALPDURRNID_REQUEST_X86_COPY              (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 22)
+/** Adds an address to the watchlist sampled in the main loop, see PSPSERIALWATCHADDREQ. */
+#define PSPSERIALPDURRNID_REQUEST_WATCH_ADD             (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 23)
+/** Removes an address from the watchlist, see PSPSERIALWATCHREMOVEREQ. */
+#define PSPSERIALPDURRNID_REQUEST_WATCH_REMOVE          (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 24)
+/** Sets the watchlist sampling interval, see PSPSERIALWATCHCONFIGREQ. */
+#define PSPSERIALPDURRNID_REQUEST_WATCH_CONFIG          (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 25)
+/** Measures SMN register read throughput on the PSP, see PSPSERIALREGPOLLBENCHREQ. */
+#define PSPSERIALPDURRNID_REQUEST_REG_POLL_BENCH        (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 26)
+/** First invalid extension request ID. */
+#define PSPSERIALPDURRNID_REQUEST_EXT_INVALID_FIRST     (PSPSERIALPDURRNID_REQUEST_EXT_FIRST + 27)
+
+/** Transport probe echo response. */
+#define PSPSERIALPDURRNID_RESPONSE_TRANSP_PROBE         PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_TRANSP_PROBE)
+/** Transport statistics query response, see PSPSERIALTRANSPSTATSRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_TRANSP_STATS_QUERY   PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_TRANSP_STATS_QUERY)
+/** Mapping flush response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_FLUSH            PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_FLUSH)
+/** Mapping cache statistics query response, see PSPSERIALMAPSTATSRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_STATS_QUERY      PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_STATS_QUERY)
+/** Per mapping slot statistics query response, see PSPSERIALMAPSLOTSTATSRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_SLOT_STATS_QUERY PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_SLOT_STATS_QUERY)
+/** Range read response sent after the last data notification, see PSPSERIALMEMRANGEREADRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_MEM_RANGE_READ       PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MEM_RANGE_READ)
+/** Window pin response, see PSPSERIALMAPPINRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_PIN              PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_PIN)
+/** Window unpin response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_UNPIN            PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_UNPIN)
+/** Pinned window read response, carries the data read. */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_PIN_READ         PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_PIN_READ)
+/** Pinned window write response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_MAP_PIN_WRITE        PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MAP_PIN_WRITE)
+/** x86 read with explicit memory type response, carries the data read. */
+#define PSPSERIALPDURRNID_RESPONSE_X86_XFER_EX_READ     PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_READ)
+/** x86 write with explicit memory type response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_X86_XFER_EX_WRITE    PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_X86_XFER_EX_WRITE)
+/** x86 memory benchmark response, see PSPSERIALX86MEMBENCHRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_X86_MEM_BENCH        PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_X86_MEM_BENCH)
+/** Scatter/gather data transfer response, see PSPSERIALDATAXFERSGRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_DATA_XFER_SG         PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_DATA_XFER_SG)
+/** Poll response, see PSPSERIALPOLLRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_POLL                 PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_POLL)
+/** Read-modify-write response, see PSPSERIALRMWRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_RMW                  PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_RMW)
+/** Memory search response, see PSPSERIALMEMSEARCHRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_MEM_SEARCH           PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_MEM_SEARCH)
+/** Digest response, see PSPSERIALDIGESTRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_DIGEST               PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_DIGEST)
+/** Snapshot create response, see PSPSERIALSNAPSHOTCREATERESP. */
+#define PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_CREATE      PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_SNAPSHOT_CREATE)
+/** Snapshot update response, see PSPSERIALSNAPSHOTUPDATERESP. */
+#define PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_UPDATE      PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_SNAPSHOT_UPDATE)
+/** Snapshot destroy response, no payload. */
+#define PSPSERIALPDURRNID_RESPONSE_SNAPSHOT_DESTROY     PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_SNAPSHOT_DESTROY)
+/** Fill response, see PSPSERIALFILLRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_FILL                 PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_FILL)
+/** x86 copy response, see PSPSERIALX86COPYRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_X86_COPY             PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_X86_COPY)
+/** Watchlist add response, see PSPSERIALWATCHADDRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_WATCH_ADD            PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_WATCH_ADD)
+/** Watchlist remove response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_WATCH_REMOVE         PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_WATCH_REMOVE)
+/** Watchlist config response (no payload). */
+#define PSPSERIALPDURRNID_RESPONSE_WATCH_CONFIG         PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_WATCH_CONFIG)
+/** Register poll benchmark response, see PSPSERIALREGPOLLBENCHRESP. */
+#define PSPSERIALPDURRNID_RESPONSE_REG_POLL_BENCH       PSP_SERIAL_EXT_REQ_2_RESP(PSPSERIALPDURRNID_REQUEST_REG_POLL_BENCH)
+
+/** Transport probe notification (PSP -> host), see PSPSERIALTRANSPPROBE. */
+#define PSPSERIALPDURRNID_NOTIFICATION_TRANSP_PROBE     (PSPSERIALPDURRNID_NOTIFICATION_EXT_FIRST + 0)
+/** Range read data notification (PSP -> host), see PSPSERIALMEMRANGEDATA. */
+#define PSPSERIALPDURRNID_NOTIFICATION_MEM_RANGE_DATA   (PSPSERIALPDURRNID_NOTIFICATION_EXT_FIRST + 1)
+/** Watched value changed notification (PSP -> host), see PSPSERIALWATCHNOT. */
+#define PSPSERIALPDURRNID_NOTIFICATION_WATCH            (PSPSERIALPDURRNID_NOTIFICATION_EXT_FIRST + 2)
+
+
+/**
+ * Transport channel identifiers.
+ */
+typedef enum PSPSERIALTRANSPID
+{
+    /** Invalid transport ID. */
+    PSPSERIALTRANSPID_INVALID = 0,
+    /** x86 UART. */
+    PSPSERIALTRANSPID_UART,
+    /** SPI flash message channel (requires a flash emulator). */
+    PSPSERIALTRANSPID_SPI_FLASH,
+    /** Dediprog EM100 u/dFIFO. */
+    PSPSERIALTRANSPID_SPI_EM100,
+    /** Mailbox in shared x86 DRAM. */
+    PSPSERIALTRANSPID_X86_DRAM,
+    /** Write only SPI flash log window (log channel only). */
+    PSPSERIALTRANSPID_SPI_LOG,
+    /** Unix domain socket (host build only). */
+    PSPSERIALTRANSPID_UNIX,
+    /** 32bit hack. */
+    PSPSERIALTRANSPID_32BIT_HACK = 0x7fffffff
+} PSPSERIALTRANSPID;
+
+
+/**
+ * Transport probe payload header.
+ *
+ * The PSP sends this followed by cbProbe bytes of probe pattern as a
+ * PSPSERIALPDURRNID_NOTIFICATION_TRANSP_PROBE on every transport channel it
+ * could initialize. A host listening on that channel echoes the complete payload
+ * back in a PSPSERIALPDURRNID_REQUEST_TRANSP_PROBE PDU (with a PDU counter of 1)
+ * and the round trip time is used to select the fastest channel.
+ * The response carries a PSPSERIALTRANSPPROBERESP.
+ */
+typedef struct PSPSERIALTRANSPPROBE
+{
+    /** The transport channel ID being probed. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** Number of probe pattern bytes following. */
+    uint32_t                    cbProbe;
+} PSPSERIALTRANSPPROBE;
+/** Pointer to a transport probe payload header. */
+typedef PSPSERIALTRANSPPROBE *PPSPSERIALTRANSPPROBE;
+/** Pointer to a const transport probe payload header. */
+typedef const PSPSERIALTRANSPPROBE *PCPSPSERIALTRANSPPROBE;
+
+
+/**
+ * Transport probe response payload.
+ */
+typedef struct PSPSERIALTRANSPPROBERESP
+{
+    /** The transport channel ID probed. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** Measured round trip bandwidth in bytes per second. */
+    uint32_t                    cbPerSec;
+} PSPSERIALTRANSPPROBERESP;
+/** Pointer to a transport probe response payload. */
+typedef PSPSERIALTRANSPPROBERESP *PPSPSERIALTRANSPPROBERESP;
+/** Pointer to a const transport probe response payload. */
+typedef const PSPSERIALTRANSPPROBERESP *PCPSPSERIALTRANSPPROBERESP;
+
+
+/**
+ * Transport statistics query response payload.
+ *
+ * The transport counters are accumulated since the channel was initialized,
+ * the PDU counters since the last connect.
+ */
+typedef struct PSPSERIALTRANSPSTATSRESP
+{
+    /** The transport channel ID in use. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** Number of PDUs sent by the stub. */
+    uint32_t                    cPdusSent;
+    /** Number of PDUs received by the stub. */
+    uint32_t                    cPdusRecvd;
+    /** Number of read transactions on the channel. */
+    uint32_t                    cReads;
+    /** Number of write transactions on the channel. */
+    uint32_t                    cWrites;
+    /** Number of busy wait loop iterations. */
+    uint32_t                    cBusyWaits;
+    /** Number of times the channel lock was acquired. */
+    uint32_t                    cLocks;
+    /** Reserved, set to 0. */
+    uint32_t                    u32Rsvd;
+    /** Number of bytes read from the channel. */
+    uint64_t                    cbRead;
+    /** Number of bytes written to the channel. */
+    uint64_t                    cbWritten;
+    /** Number of microseconds spent waiting on the channel. */
+    uint64_t                    cUsBlocked;
+} PSPSERIALTRANSPSTATSRESP;
+/** Pointer to a transport statistics query response payload. */
+typedef PSPSERIALTRANSPSTATSRESP *PPSPSERIALTRANSPSTATSRESP;
+/** Pointer to a const transport statistics query response payload. */
+typedef const PSPSERIALTRANSPSTATSRESP *PCPSPSERIALTRANSPSTATSRESP;
+
+
+/**
+ * Mapping cache statistics query response payload.
+ *
+ * All counters are accumulated since the stub started.
+ */
+typedef struct PSPSERIALMAPSTATSRESP
+{
+    /** Number of x86 map requests served by a cached mapping. */
+    uint32_t                    cX86Hits;
+    /** Number of x86 map requests which had to program a slot. */
+    uint32_t                    cX86Misses;
+    /** Number of cached x86 mappings evicted to make room for a new one. */
+    uint32_t                    cX86Evictions;
+    /** Number of x86 slots currently holding a mapping. */
+    uint32_t                    cX86SlotsMapped;
+    /** Number of SMN map requests served by a cached mapping. */
+    uint32_t                    cSmnHits;
+    /** Number of SMN map requests which had to program a slot. */
+    uint32_t                    cSmnMisses;
+    /** Number of cached SMN mappings evicted to make room for a new one. */
+    uint32_t                    cSmnEvictions;
+    /** Number of SMN slots currently holding a mapping. */
+    uint32_t                    cSmnSlotsMapped;
+} PSPSERIALMAPSTATSRESP;
+/** Pointer to a mapping cache statistics query response payload. */
+typedef PSPSERIALMAPSTATSRESP *PPSPSERIALMAPSTATSRESP;
+/** Pointer to a const mapping cache statistics query response payload. */
+typedef const PSPSERIALMAPSTATSRESP *PCPSPSERIALMAPSTATSRESP;
+
+
+/**
+ * Statistics of a single mapping slot.
+ */
+typedef struct PSPSERIALMAPSLOTSTATS
+{
+    /** The mapped base address, UINT64_MAX if the slot is free. */
+    uint64_t                    uAddrBase;
+    /** The memory type for x86 slots, 0 for SMN slots. */
+    uint32_t                    uMemType;
+    /** Number of references currently held. */
+    uint32_t                    cRefs;
+    /** Number of map requests served by the mapping already programmed. */
+    uint32_t                    cHits;
+    /** Number of times the slot was programmed for a map request. */
+    uint32_t                    cMisses;
+    /** Number of times a cached mapping was evicted from the slot. */
+    uint32_t                    cEvictions;
+    /** The die targeted by a SMN slot, 0 for x86 slots. */
+    uint32_t                    idDie;
+} PSPSERIALMAPSLOTSTATS;
+/** Pointer to the statistics of a single mapping slot. */
+typedef PSPSERIALMAPSLOTSTATS *PPSPSERIALMAPSLOTSTATS;
+/** Pointer to const statistics of a single mapping slot. */
+typedef const PSPSERIALMAPSLOTSTATS *PCPSPSERIALMAPSLOTSTATS;
+
+
+/**
+ * Per mapping slot statistics query response payload header.
+ *
+ * Followed by cX86Slots PSPSERIALMAPSLOTSTATS entries for the x86 slots
+ * and cSmnSlots entries for the SMN slots.
+ */
+typedef struct PSPSERIALMAPSLOTSTATSRESP
+{
+    /** Number of x86 slot entries following. */
+    uint32_t                    cX86Slots;
+    /** Number of SMN slot entries following the x86 ones. */
+    uint32_t                    cSmnSlots;
+} PSPSERIALMAPSLOTSTATSRESP;
+/** Pointer to a per mapping slot statistics query response payload header. */
+typedef PSPSERIALMAPSLOTSTATSRESP *PPSPSERIALMAPSLOTSTATSRESP;
+/** Pointer to a const per mapping slot statistics query response payload header. */
+typedef const PSPSERIALMAPSLOTSTATSRESP *PCPSPSERIALMAPSLOTSTATSRESP;
+
+
+/**
+ * Range read request payload.
+ *
+ * The range is walked window by window and sent as a stream of
+ * PSPSERIALPDURRNID_NOTIFICATION_MEM_RANGE_DATA notifications in ascending
+ * address order, followed by the response carrying a PSPSERIALMEMRANGEREADRESP.
+ */
+typedef struct PSPSERIALMEMRANGEREADREQ
+{
+    /** The address space to read from, only PSPADDRSPACE_SMN, PSPADDRSPACE_X86_MEM and PSPADDRSPACE_X86_MMIO are supported. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+    /** Start address of the range. */
+    uint64_t                    u64AddrStart;
+    /** Number of bytes to read. */
+    uint64_t                    cbRead;
+} PSPSERIALMEMRANGEREADREQ;
+/** Pointer to a range read request payload. */
+typedef PSPSERIALMEMRANGEREADREQ *PPSPSERIALMEMRANGEREADREQ;
+/** Pointer to a const range read request payload. */
+typedef const PSPSERIALMEMRANGEREADREQ *PCPSPSERIALMEMRANGEREADREQ;
+
+
+/**
+ * Range read data notification payload header, followed by the data.
+ */
+typedef struct PSPSERIALMEMRANGEDATA
+{
+    /** Offset of the data from the start of the range. */
+    uint64_t                    offData;
+} PSPSERIALMEMRANGEDATA;
+/** Pointer to a range read data notification payload header. */
+typedef PSPSERIALMEMRANGEDATA *PPSPSERIALMEMRANGEDATA;
+/** Pointer to a const range read data notification payload header. */
+typedef const PSPSERIALMEMRANGEDATA *PCPSPSERIALMEMRANGEDATA;
+
+
+/**
+ * Range read response payload.
+ */
+typedef struct PSPSERIALMEMRANGEREADRESP
+{
+    /** Number of bytes sent, less than requested if the status indicates an error. */
+    uint64_t                    cbRead;
+} PSPSERIALMEMRANGEREADRESP;
+/** Pointer to a range read response payload. */
+typedef PSPSERIALMEMRANGEREADRESP *PPSPSERIALMEMRANGEREADRESP;
+/** Pointer to a const range read response payload. */
+typedef const PSPSERIALMEMRANGEREADRESP *PCPSPSERIALMEMRANGEREADRESP;
+
+
+/**
+ * Window pin request payload.
+ *
+ * The window containing the given address stays mapped until it is unpinned
+ * or the host connects again, it is never evicted in the meantime. A pin is
+ * refused with ERR_INVALID_STATE if it would leave no unreferenced slot in one
+ * of the slot classes (plain x86, MMIO capable x86 and SMN).
+ */
+typedef struct PSPSERIALMAPPINREQ
+{
+    /** The address space, only PSPADDRSPACE_SMN, PSPADDRSPACE_X86_MEM and PSPADDRSPACE_X86_MMIO are supported. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+    /** An address inside the window to pin. */
+    uint64_t                    u64Addr;
+} PSPSERIALMAPPINREQ;
+/** Pointer to a window pin request payload. */
+typedef PSPSERIALMAPPINREQ *PPSPSERIALMAPPINREQ;
+/** Pointer to a const window pin request payload. */
+typedef const PSPSERIALMAPPINREQ *PCPSPSERIALMAPPINREQ;
+
+
+/**
+ * Window pin response payload.
+ */
+typedef struct PSPSERIALMAPPINRESP
+{
+    /** The pin handle to use for subsequent requests. */
+    uint32_t                    idPin;
+    /** Size of the pinned window in bytes. */
+    uint32_t                    cbWindow;
+    /** The base address of the pinned window. */
+    uint64_t                    uAddrBase;
+} PSPSERIALMAPPINRESP;
+/** Pointer to a window pin response payload. */
+typedef PSPSERIALMAPPINRESP *PPSPSERIALMAPPINRESP;
+/** Pointer to a const window pin response payload. */
+typedef const PSPSERIALMAPPINRESP *PCPSPSERIALMAPPINRESP;
+
+
+/**
+ * Window unpin request payload.
+ */
+typedef struct PSPSERIALMAPUNPINREQ
+{
+    /** The pin handle to release. */
+    uint32_t                    idPin;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALMAPUNPINREQ;
+/** Pointer to a window unpin request payload. */
+typedef PSPSERIALMAPUNPINREQ *PPSPSERIALMAPUNPINREQ;
+/** Pointer to a const window unpin request payload. */
+typedef const PSPSERIALMAPUNPINREQ *PCPSPSERIALMAPUNPINREQ;
+
+
+/**
+ * Pinned window read/write request payload.
+ *
+ * Transfers of 1, 2, 4 or 8 bytes are done as a single access, anything else is copied.
+ */
+typedef struct PSPSERIALMAPPINXFERREQ
+{
+    /** The pin handle. */
+    uint32_t                    idPin;
+    /** Offset into the pinned window. */
+    uint32_t                    offWindow;
+    /** Number of bytes to transfer. */
+    uint32_t                    cbXfer;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALMAPPINXFERREQ;
+/** Pointer to a pinned window read/write request payload. */
+typedef PSPSERIALMAPPINXFERREQ *PPSPSERIALMAPPINXFERREQ;
+/** Pointer to a const pinned window read/write request payload. */
+typedef const PSPSERIALMAPPINXFERREQ *PCPSPSERIALMAPPINXFERREQ;
+
+
+/**
+ * @name Extended PSPSERIALDATAXFERREQ::fFlags.
+ * @{ */
+/** Move 4 byte aligned runs in 32 byte ldm/stm bursts instead of one access per element,
+ * only valid for incrementing transfers with a stride of 4 or 8. */
+#define PSP_SERIAL_DATA_XFER_F_BURST                    0x80000000
+/** @} */
+
+
+/** Aligns the size of the data belonging to a scatter/gather descriptor. */
+#define PSP_SERIAL_DATA_XFER_SG_ALIGN(a_cb)             (((a_cb) + 7) & ~(size_t)7)
+
+
+/**
+ * Scatter/gather data transfer request payload.
+ *
+ * The header is followed by the given number of PSPSERIALDATAXFERREQ descriptors which
+ * are processed in order. The data of the write and memset descriptors comes after the
+ * descriptor array in the same order, each descriptor's data starting 8 byte aligned
+ * (see PSP_SERIAL_DATA_XFER_SG_ALIGN).
+ */
+typedef struct PSPSERIALDATAXFERSGREQ
+{
+    /** Number of descriptors following. */
+    uint32_t                    cDescs;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALDATAXFERSGREQ;
+/** Pointer to a scatter/gather data transfer request payload. */
+typedef PSPSERIALDATAXFERSGREQ *PPSPSERIALDATAXFERSGREQ;
+/** Pointer to a const scatter/gather data transfer request payload. */
+typedef const PSPSERIALDATAXFERSGREQ *PCPSPSERIALDATAXFERSGREQ;
+
+
+/**
+ * Scatter/gather data transfer response payload.
+ *
+ * Followed by the data of the completed read descriptors, laid out like the write
+ * data of the request. Processing stops at the first failing descriptor.
+ */
+typedef struct PSPSERIALDATAXFERSGRESP
+{
+    /** Number of descriptors completed successfully. */
+    uint32_t                    cDescsDone;
+    /** Reserved, always 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALDATAXFERSGRESP;
+/** Pointer to a scatter/gather data transfer response payload. */
+typedef PSPSERIALDATAXFERSGRESP *PPSPSERIALDATAXFERSGRESP;
+/** Pointer to a const scatter/gather data transfer response payload. */
+typedef const PSPSERIALDATAXFERSGRESP *PCPSPSERIALDATAXFERSGRESP;
+
+
+/**
+ * @name x86 caching flags.
+ *
+ * Used for PSPSERIALDATAXFERREQ::u::X86::fCaching and the extended x86 requests below.
+ * 0 selects the default memory type of the address space (write-back like for normal
+ * memory, strongly ordered for MMIO), otherwise the low bits are programmed into the
+ * mapping slot as is.
+ * @{ */
+/** The memory type in the low bits is valid. */
+#define PSP_SERIAL_X86_CACHING_F_MEMTYPE                0x80000000
+/** Mask of the memory type to program. */
+#define PSP_SERIAL_X86_CACHING_MEMTYPE_MASK             0x0000000f
+/** Mask of all valid caching flags. */
+#define PSP_SERIAL_X86_CACHING_VALID_MASK               (PSP_SERIAL_X86_CACHING_F_MEMTYPE | PSP_SERIAL_X86_CACHING_MEMTYPE_MASK)
+/** @} */
+
+
+/**
+ * @name x86 extended transfer and benchmark flags.
+ * @{ */
+/** The address is MMIO, mapped in the MMIO capable slots, 1, 2, 4 and 8 byte transfers are done as a single access. */
+#define PSP_SERIAL_X86_XFER_EX_F_MMIO                   0x00000001
+/** Benchmark only: Write instead of read (destroys the content of the range!). */
+#define PSP_SERIAL_X86_XFER_EX_F_WRITE                  0x00000002
+/** Benchmark only: Copy through the CCP instead of the mapping windows, not valid for MMIO or an explicit memory type. */
+#define PSP_SERIAL_X86_XFER_EX_F_CCP                    0x00000004
+/** @} */
+
+
+/**
+ * x86 read/write with explicit memory type request payload.
+ */
+typedef struct PSPSERIALX86XFEREXREQ
+{
+    /** Start x86 physical address. */
+    X86PADDR                    PhysX86Start;
+    /** Number of bytes to transfer. */
+    uint32_t                    cbXfer;
+    /** Transfer flags, only PSP_SERIAL_X86_XFER_EX_F_MMIO is valid. */
+    uint32_t                    fFlags;
+    /** Caching flags, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALX86XFEREXREQ;
+/** Pointer to a x86 read/write with explicit memory type request payload. */
+typedef PSPSERIALX86XFEREXREQ *PPSPSERIALX86XFEREXREQ;
+/** Pointer to a const x86 read/write with explicit memory type request payload. */
+typedef const PSPSERIALX86XFEREXREQ *PCPSPSERIALX86XFEREXREQ;
+
+
+/**
+ * x86 memory benchmark request payload.
+ *
+ * The range is copied to or from a buffer on the PSP the given number of times,
+ * so the result is not limited by the transport channel.
+ */
+typedef struct PSPSERIALX86MEMBENCHREQ
+{
+    /** Start x86 physical address. */
+    X86PADDR                    PhysX86Start;
+    /** Size of the range in bytes. */
+    uint32_t                    cbRange;
+    /** Benchmark flags, see PSP_SERIAL_X86_XFER_EX_F_XXX. */
+    uint32_t                    fFlags;
+    /** Caching flags, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** Number of passes over the range. */
+    uint32_t                    cPasses;
+} PSPSERIALX86MEMBENCHREQ;
+/** Pointer to a x86 memory benchmark request payload. */
+typedef PSPSERIALX86MEMBENCHREQ *PPSPSERIALX86MEMBENCHREQ;
+/** Pointer to a const x86 memory benchmark request payload. */
+typedef const PSPSERIALX86MEMBENCHREQ *PCPSPSERIALX86MEMBENCHREQ;
+
+
+/**
+ * x86 memory benchmark response payload.
+ */
+typedef struct PSPSERIALX86MEMBENCHRESP
+{
+    /** Number of bytes transferred. */
+    uint64_t                    cbXfered;
+    /** Number of microseconds the transfers took. */
+    uint64_t                    cMicros;
+} PSPSERIALX86MEMBENCHRESP;
+/** Pointer to a x86 memory benchmark response payload. */
+typedef PSPSERIALX86MEMBENCHRESP *PPSPSERIALX86MEMBENCHRESP;
+/** Pointer to a const x86 memory benchmark response payload. */
+typedef const PSPSERIALX86MEMBENCHRESP *PCPSPSERIALX86MEMBENCHRESP;
+
+
+/**
+ * Register poll benchmark request payload.
+ *
+ * The SMN register of the die the PDU is addressed to is read the given number of
+ * times, mapping and unmapping it around every read like a single register read
+ * request does.
+ */
+typedef struct PSPSERIALREGPOLLBENCHREQ
+{
+    /** The SMN register address. */
+    SMNADDR                     SmnAddr;
+    /** Benchmark flags, see PSP_SERIAL_REG_POLL_BENCH_F_XXX. */
+    uint32_t                    fFlags;
+    /** Number of reads. */
+    uint32_t                    cPolls;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALREGPOLLBENCHREQ;
+/** Pointer to a register poll benchmark request payload. */
+typedef PSPSERIALREGPOLLBENCHREQ *PPSPSERIALREGPOLLBENCHREQ;
+/** Pointer to a const register poll benchmark request payload. */
+typedef const PSPSERIALREGPOLLBENCHREQ *PCPSPSERIALREGPOLLBENCHREQ;
+
+/** Tear down the mapping after every read instead of leaving it cached, like before the SMN mapping cache. */
+#define PSP_SERIAL_REG_POLL_BENCH_F_NO_CACHE            0x00000001
+
+
+/**
+ * Register poll benchmark response payload.
+ */
+typedef struct PSPSERIALREGPOLLBENCHRESP
+{
+    /** Number of reads done. */
+    uint64_t                    cPolls;
+    /** Number of microseconds the reads took, including the mapping. */
+    uint64_t                    cMicros;
+} PSPSERIALREGPOLLBENCHRESP;
+/** Pointer to a register poll benchmark response payload. */
+typedef PSPSERIALREGPOLLBENCHRESP *PPSPSERIALREGPOLLBENCHRESP;
+/** Pointer to a const register poll benchmark response payload. */
+typedef const PSPSERIALREGPOLLBENCHRESP *PCPSPSERIALREGPOLLBENCHRESP;
+
+
+/**
+ * Poll request payload.
+ *
+ * The address is read with a single access of the given width until
+ * (value & u64Mask) == u64Expected or the timeout expires, in which case
+ * the response carries ERR_TIMEOUT as the status code. 8 byte registers are
+ * read as two 32bit accesses, low half first, so the value can be torn.
+ */
+typedef struct PSPSERIALPOLLREQ
+{
+    /** The address space to poll in. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Access width in bytes, 1, 2, 4 or 8, the address must be aligned accordingly. */
+    uint32_t                    cbAccess;
+    /** The address to poll. */
+    uint64_t                    u64Addr;
+    /** Mask applied to the value read. */
+    uint64_t                    u64Mask;
+    /** The expected value after masking. */
+    uint64_t                    u64Expected;
+    /** Timeout in microseconds. */
+    uint32_t                    cUsTimeout;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+} PSPSERIALPOLLREQ;
+/** Pointer to a poll request payload. */
+typedef PSPSERIALPOLLREQ *PPSPSERIALPOLLREQ;
+/** Pointer to a const poll request payload. */
+typedef const PSPSERIALPOLLREQ *PCPSPSERIALPOLLREQ;
+
+
+/**
+ * Poll response payload.
+ */
+typedef struct PSPSERIALPOLLRESP
+{
+    /** The last value read. */
+    uint64_t                    u64Val;
+    /** Number of microseconds spent polling. */
+    uint64_t                    cMicros;
+    /** Number of reads done. */
+    uint32_t                    cIterations;
+    /** Reserved, always 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALPOLLRESP;
+/** Pointer to a poll response payload. */
+typedef PSPSERIALPOLLRESP *PPSPSERIALPOLLRESP;
+/** Pointer to a const poll response payload. */
+typedef const PSPSERIALPOLLRESP *PCPSPSERIALPOLLRESP;
+
+
+/**
+ * @name Read-modify-write operations.
+ * @{ */
+/** value & operand. */
+#define PSP_SERIAL_RMW_OP_AND                           1
+/** value | operand. */
+#define PSP_SERIAL_RMW_OP_OR                            2
+/** value ^ operand. */
+#define PSP_SERIAL_RMW_OP_XOR                           3
+/** value + operand, wrapping at the access width. */
+#define PSP_SERIAL_RMW_OP_ADD                           4
+/** @} */
+
+
+/**
+ * Read-modify-write request payload.
+ *
+ * The register is read and written back with single accesses of the given width
+ * while interrupts are masked on the PSP. 8 byte registers are accessed as two
+ * 32bit accesses each, low half first, ARMv7 doesn't guarantee a single access
+ * for 64bit loads and stores to device memory.
+ */
+typedef struct PSPSERIALRMWREQ
+{
+    /** The address space of the register. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Access width in bytes, 1, 2, 4 or 8, the address must be aligned accordingly. */
+    uint32_t                    cbAccess;
+    /** The register address. */
+    uint64_t                    u64Addr;
+    /** The operation, see PSP_SERIAL_RMW_OP_XXX. */
+    uint32_t                    enmOp;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** The operand. */
+    uint64_t                    u64Operand;
+} PSPSERIALRMWREQ;
+/** Pointer to a read-modify-write request payload. */
+typedef PSPSERIALRMWREQ *PPSPSERIALRMWREQ;
+/** Pointer to a const read-modify-write request payload. */
+typedef const PSPSERIALRMWREQ *PCPSPSERIALRMWREQ;
+
+
+/**
+ * Read-modify-write response payload.
+ */
+typedef struct PSPSERIALRMWRESP
+{
+    /** The value read before the operation. */
+    uint64_t                    u64ValOld;
+    /** The value written. */
+    uint64_t                    u64ValNew;
+} PSPSERIALRMWRESP;
+/** Pointer to a read-modify-write response payload. */
+typedef PSPSERIALRMWRESP *PPSPSERIALRMWRESP;
+/** Pointer to a const read-modify-write response payload. */
+typedef const PSPSERIALRMWRESP *PCPSPSERIALRMWRESP;
+
+
+/**
+ * @name Memory search flags.
+ * @{ */
+/** A mask of the pattern size follows the pattern, only the bits set are compared. */
+#define PSP_SERIAL_MEM_SEARCH_F_MASK                    0x00000001
+/** Mask of all valid memory search flags. */
+#define PSP_SERIAL_MEM_SEARCH_F_VALID_MASK              PSP_SERIAL_MEM_SEARCH_F_MASK
+/** @} */
+
+
+/**
+ * Memory search request payload, followed by the pattern and the optional mask.
+ *
+ * The pattern can be up to 64 bytes long.
+ */
+typedef struct PSPSERIALMEMSEARCHREQ
+{
+    /** The address space to search in. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Size of the pattern in bytes. */
+    uint32_t                    cbPattern;
+    /** Start address of the range. */
+    uint64_t                    u64AddrStart;
+    /** Size of the range in bytes. */
+    uint64_t                    cbRange;
+    /** Maximum number of matches to return, capped by what fits into a response. */
+    uint32_t                    cMatchesMax;
+    /** Search flags, see PSP_SERIAL_MEM_SEARCH_F_XXX. */
+    uint32_t                    fFlags;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALMEMSEARCHREQ;
+/** Pointer to a memory search request payload. */
+typedef PSPSERIALMEMSEARCHREQ *PPSPSERIALMEMSEARCHREQ;
+/** Pointer to a const memory search request payload. */
+typedef const PSPSERIALMEMSEARCHREQ *PCPSPSERIALMEMSEARCHREQ;
+
+
+/**
+ * Memory search response payload, followed by the 64bit offsets of the matches
+ * relative to the start of the range.
+ */
+typedef struct PSPSERIALMEMSEARCHRESP
+{
+    /** Number of bytes scanned, a search stopped by the match limit continues at this offset. */
+    uint64_t                    cbScanned;
+    /** Number of matches following. */
+    uint32_t                    cMatches;
+    /** Reserved, always 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALMEMSEARCHRESP;
+/** Pointer to a memory search response payload. */
+typedef PSPSERIALMEMSEARCHRESP *PPSPSERIALMEMSEARCHRESP;
+/** Pointer to a const memory search response payload. */
+typedef const PSPSERIALMEMSEARCHRESP *PCPSPSERIALMEMSEARCHRESP;
+
+
+/**
+ * @name Digest algorithms.
+ * @{ */
+/** CRC32 (polynomial 0xedb88320 as used by zlib), stored as a little endian 32bit value. */
+#define PSP_SERIAL_DIGEST_ALGO_CRC32                    1
+/** SHA-256, 32 bytes. */
+#define PSP_SERIAL_DIGEST_ALGO_SHA256                   2
+/** @} */
+
+
+/**
+ * Digest request payload.
+ *
+ * The range is split into blocks of the given size (the last one can be shorter)
+ * and the digest of each block is returned, so the host can compare them against
+ * a cached copy and only fetch the blocks which changed.
+ */
+typedef struct PSPSERIALDIGESTREQ
+{
+    /** The address space of the range. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** The digest algorithm, see PSP_SERIAL_DIGEST_ALGO_XXX. */
+    uint32_t                    enmAlgo;
+    /** Start address of the range. */
+    uint64_t                    u64AddrStart;
+    /** Size of the range in bytes. */
+    uint64_t                    cbRange;
+    /** Block size in bytes, 0 for a single digest over the whole range. */
+    uint32_t                    cbBlock;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+} PSPSERIALDIGESTREQ;
+/** Pointer to a digest request payload. */
+typedef PSPSERIALDIGESTREQ *PPSPSERIALDIGESTREQ;
+/** Pointer to a const digest request payload. */
+typedef const PSPSERIALDIGESTREQ *PCPSPSERIALDIGESTREQ;
+
+
+/**
+ * Digest response payload, followed by the digests of the blocks.
+ */
+typedef struct PSPSERIALDIGESTRESP
+{
+    /** Number of digests following. */
+    uint32_t                    cBlocks;
+    /** Size of a single digest in bytes. */
+    uint32_t                    cbDigest;
+    /** Number of microseconds the calculation took. */
+    uint64_t                    cMicros;
+} PSPSERIALDIGESTRESP;
+/** Pointer to a digest response payload. */
+typedef PSPSERIALDIGESTRESP *PPSPSERIALDIGESTRESP;
+/** Pointer to a const digest response payload. */
+typedef const PSPSERIALDIGESTRESP *PCPSPSERIALDIGESTRESP;
+
+
+/**
+ * Snapshot create request payload.
+ *
+ * The stub remembers a CRC32 for every block of the range, each update compares
+ * the blocks against them and only sends the ones which changed. The first update
+ * after creating the snapshot sends all blocks. SMN ranges are read from the die the
+ * create request was sent to.
+ */
+typedef struct PSPSERIALSNAPSHOTCREATEREQ
+{
+    /** The address space of the range. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Block size in bytes, the last block can be shorter. */
+    uint32_t                    cbBlock;
+    /** Start address of the range. */
+    uint64_t                    u64AddrStart;
+    /** Size of the range in bytes. */
+    uint64_t                    cbRange;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALSNAPSHOTCREATEREQ;
+/** Pointer to a snapshot create request payload. */
+typedef PSPSERIALSNAPSHOTCREATEREQ *PPSPSERIALSNAPSHOTCREATEREQ;
+/** Pointer to a const snapshot create request payload. */
+typedef const PSPSERIALSNAPSHOTCREATEREQ *PCPSPSERIALSNAPSHOTCREATEREQ;
+
+
+/**
+ * Snapshot create response payload.
+ */
+typedef struct PSPSERIALSNAPSHOTCREATERESP
+{
+    /** The snapshot ID to use for the update and destroy requests. */
+    uint32_t                    idSnapshot;
+    /** Number of blocks the range was split into. */
+    uint32_t                    cBlocks;
+} PSPSERIALSNAPSHOTCREATERESP;
+/** Pointer to a snapshot create response payload. */
+typedef PSPSERIALSNAPSHOTCREATERESP *PPSPSERIALSNAPSHOTCREATERESP;
+/** Pointer to a const snapshot create response payload. */
+typedef const PSPSERIALSNAPSHOTCREATERESP *PCPSPSERIALSNAPSHOTCREATERESP;
+
+
+/**
+ * @name Snapshot update flags.
+ * @{ */
+/** Only report which blocks changed in the response, don't send the data. */
+#define PSP_SERIAL_SNAPSHOT_UPDATE_F_NO_DATA            0x00000001
+/** Forget the remembered state and report all blocks as changed. */
+#define PSP_SERIAL_SNAPSHOT_UPDATE_F_RESET              0x00000002
+/** @} */
+
+
+/**
+ * Snapshot update request payload.
+ *
+ * Every changed block is sent as a series of PSPSERIALPDURRNID_NOTIFICATION_MEM_RANGE_DATA
+ * notifications with the offset relative to the start of the range before the response.
+ */
+typedef struct PSPSERIALSNAPSHOTUPDATEREQ
+{
+    /** The snapshot ID. */
+    uint32_t                    idSnapshot;
+    /** Flags, see PSP_SERIAL_SNAPSHOT_UPDATE_F_XXX. */
+    uint32_t                    fFlags;
+} PSPSERIALSNAPSHOTUPDATEREQ;
+/** Pointer to a snapshot update request payload. */
+typedef PSPSERIALSNAPSHOTUPDATEREQ *PPSPSERIALSNAPSHOTUPDATEREQ;
+/** Pointer to a const snapshot update request payload. */
+typedef const PSPSERIALSNAPSHOTUPDATEREQ *PCPSPSERIALSNAPSHOTUPDATEREQ;
+
+
+/**
+ * Snapshot update response payload, followed by a bitmap of the changed blocks
+ * (one bit per block, 32 blocks per 32bit word).
+ */
+typedef struct PSPSERIALSNAPSHOTUPDATERESP
+{
+    /** Number of blocks checked, less than the total if an error occurred. */
+    uint32_t                    cBlocks;
+    /** Number of changed blocks. */
+    uint32_t                    cBlocksChanged;
+    /** Number of microseconds the update took. */
+    uint64_t                    cMicros;
+} PSPSERIALSNAPSHOTUPDATERESP;
+/** Pointer to a snapshot update response payload. */
+typedef PSPSERIALSNAPSHOTUPDATERESP *PPSPSERIALSNAPSHOTUPDATERESP;
+/** Pointer to a const snapshot update response payload. */
+typedef const PSPSERIALSNAPSHOTUPDATERESP *PCPSPSERIALSNAPSHOTUPDATERESP;
+
+
+/**
+ * Snapshot destroy request payload.
+ */
+typedef struct PSPSERIALSNAPSHOTDESTROYREQ
+{
+    /** The snapshot ID. */
+    uint32_t                    idSnapshot;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALSNAPSHOTDESTROYREQ;
+/** Pointer to a snapshot destroy request payload. */
+typedef PSPSERIALSNAPSHOTDESTROYREQ *PPSPSERIALSNAPSHOTDESTROYREQ;
+/** Pointer to a const snapshot destroy request payload. */
+typedef const PSPSERIALSNAPSHOTDESTROYREQ *PCPSPSERIALSNAPSHOTDESTROYREQ;
+
+
+/**
+ * @name Fill modes.
+ * @{ */
+/** Repeats the pattern following the request, aligned to the start of the range. */
+#define PSP_SERIAL_FILL_MODE_PATTERN                    1
+/** Stores an incrementing counter, starting at u64Seed and advancing by u64Incr for every element. */
+#define PSP_SERIAL_FILL_MODE_COUNTER                    2
+/** Stores the sequence of a xorshift64 LFSR seeded with u64Seed (must not be 0), the state is
+ * stored before advancing it (x ^= x << 13; x ^= x >> 7; x ^= x << 17) for the next element. */
+#define PSP_SERIAL_FILL_MODE_LFSR                       3
+/** @} */
+
+
+/**
+ * @name Fill flags.
+ * @{ */
+/** Store 4 byte aligned runs in 32 byte stm bursts, only valid with an element size of 4 or 8. */
+#define PSP_SERIAL_FILL_F_BURST                         0x00000001
+/** @} */
+
+
+/**
+ * Fill request payload, followed by the pattern for PSP_SERIAL_FILL_MODE_PATTERN.
+ *
+ * The range is written with one access of the element size per element, counter and
+ * LFSR values are truncated to the element size and stored little endian.
+ */
+typedef struct PSPSERIALFILLREQ
+{
+    /** The address space of the range. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** The fill mode, see PSP_SERIAL_FILL_MODE_XXX. */
+    uint32_t                    enmMode;
+    /** Start address of the range, aligned to the element size. */
+    uint64_t                    u64AddrStart;
+    /** Size of the range in bytes, multiple of the element size. */
+    uint64_t                    cbRange;
+    /** Initial counter value or LFSR state. */
+    uint64_t                    u64Seed;
+    /** Counter increment. */
+    uint64_t                    u64Incr;
+    /** Element size in bytes, 1, 2, 4 or 8. */
+    uint32_t                    cbElem;
+    /** Size of the pattern in bytes, multiple of the element size, 0 for the other modes. */
+    uint32_t                    cbPattern;
+    /** Flags, see PSP_SERIAL_FILL_F_XXX. */
+    uint32_t                    fFlags;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+} PSPSERIALFILLREQ;
+/** Pointer to a fill request payload. */
+typedef PSPSERIALFILLREQ *PPSPSERIALFILLREQ;
+/** Pointer to a const fill request payload. */
+typedef const PSPSERIALFILLREQ *PCPSPSERIALFILLREQ;
+
+
+/**
+ * Fill response payload.
+ */
+typedef struct PSPSERIALFILLRESP
+{
+    /** Number of bytes written. */
+    uint64_t                    cbFilled;
+    /** Counter value or LFSR state for the element following the last one written,
+     * to continue the sequence with another request. */
+    uint64_t                    u64SeedNext;
+    /** Number of microseconds the fill took. */
+    uint64_t                    cMicros;
+} PSPSERIALFILLRESP;
+/** Pointer to a fill response payload. */
+typedef PSPSERIALFILLRESP *PPSPSERIALFILLRESP;
+/** Pointer to a const fill response payload. */
+typedef const PSPSERIALFILLRESP *PCPSPSERIALFILLRESP;
+
+
+/**
+ * @name x86 copy flags.
+ * @{ */
+/** Copy from the PSP memory to the x86 memory instead of the other way around. */
+#define PSP_SERIAL_X86_COPY_F_TO_X86                    0x00000001
+/** Copy with the CPU through the mapping windows even if the CCP is available. */
+#define PSP_SERIAL_X86_COPY_F_CPU                       0x00000002
+/** @} */
+
+
+/**
+ * x86 copy request payload.
+ *
+ * Copies a range between the x86 memory and the PSP memory without involving the
+ * transport channel. The CCP passthrough engine is used if it is available and the
+ * default memory type is requested, the CPU copies through the mapping windows otherwise.
+ */
+typedef struct PSPSERIALX86COPYREQ
+{
+    /** The x86 physical address. */
+    X86PADDR                    PhysX86Addr;
+    /** The PSP address. */
+    PSPADDR                     PspAddr;
+    /** Number of bytes to copy. */
+    uint32_t                    cbCopy;
+    /** Flags, see PSP_SERIAL_X86_COPY_F_XXX. */
+    uint32_t                    fFlags;
+    /** Caching flags, see PSP_SERIAL_X86_CACHING_F_MEMTYPE, an explicit memory type forces a CPU copy. */
+    uint32_t                    fCaching;
+} PSPSERIALX86COPYREQ;
+/** Pointer to a x86 copy request payload. */
+typedef PSPSERIALX86COPYREQ *PPSPSERIALX86COPYREQ;
+/** Pointer to a const x86 copy request payload. */
+typedef const PSPSERIALX86COPYREQ *PCPSPSERIALX86COPYREQ;
+
+
+/**
+ * x86 copy response payload.
+ */
+typedef struct PSPSERIALX86COPYRESP
+{
+    /** Number of microseconds the copy took. */
+    uint64_t                    cMicros;
+    /** Flag whether the CCP did the copy. */
+    uint32_t                    fCcp;
+    /** Reserved, 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALX86COPYRESP;
+/** Pointer to a x86 copy response payload. */
+typedef PSPSERIALX86COPYRESP *PPSPSERIALX86COPYRESP;
+/** Pointer to a const x86 copy response payload. */
+typedef const PSPSERIALX86COPYRESP *PCPSPSERIALX86COPYRESP;
+
+
+/**
+ * Watchlist add request payload.
+ *
+ * The address is read with a single access of the given width every sampling
+ * interval while the stub waits for requests (two 32bit accesses, low half first,
+ * for 8 byte registers). A PSPSERIALPDURRNID_NOTIFICATION_WATCH
+ * notification is sent whenever (value & u64Mask) differs from the last sample.
+ */
+typedef struct PSPSERIALWATCHADDREQ
+{
+    /** The address space to watch in. */
+    PSPADDRSPACE                enmAddrSpace;
+    /** Access width in bytes, 1, 2, 4 or 8, the address must be aligned accordingly. */
+    uint32_t                    cbAccess;
+    /** The address to watch. */
+    uint64_t                    u64Addr;
+    /** Mask applied to the value read, changes outside of it are ignored. */
+    uint64_t                    u64Mask;
+    /** Caching flags for the x86 address spaces, see PSP_SERIAL_X86_CACHING_F_MEMTYPE. */
+    uint32_t                    fCaching;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALWATCHADDREQ;
+/** Pointer to a watchlist add request payload. */
+typedef PSPSERIALWATCHADDREQ *PPSPSERIALWATCHADDREQ;
+/** Pointer to a const watchlist add request payload. */
+typedef const PSPSERIALWATCHADDREQ *PCPSPSERIALWATCHADDREQ;
+
+
+/**
+ * Watchlist add response payload.
+ */
+typedef struct PSPSERIALWATCHADDRESP
+{
+    /** The watch ID used in the notifications and for removing the watch. */
+    uint32_t                    idWatch;
+    /** Reserved, 0. */
+    uint32_t                    u32Rsvd;
+    /** The masked value read when the watch was added. */
+    uint64_t                    u64Val;
+} PSPSERIALWATCHADDRESP;
+/** Pointer to a watchlist add response payload. */
+typedef PSPSERIALWATCHADDRESP *PPSPSERIALWATCHADDRESP;
+/** Pointer to a const watchlist add response payload. */
+typedef const PSPSERIALWATCHADDRESP *PCPSPSERIALWATCHADDRESP;
+
+
+/** Watch ID removing all watches. */
+#define PSP_SERIAL_WATCH_ID_ALL                         0xffffffff
+
+
+/**
+ * Watchlist remove request payload.
+ */
+typedef struct PSPSERIALWATCHREMOVEREQ
+{
+    /** The watch ID to remove or PSP_SERIAL_WATCH_ID_ALL. */
+    uint32_t                    idWatch;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALWATCHREMOVEREQ;
+/** Pointer to a watchlist remove request payload. */
+typedef PSPSERIALWATCHREMOVEREQ *PPSPSERIALWATCHREMOVEREQ;
+/** Pointer to a const watchlist remove request payload. */
+typedef const PSPSERIALWATCHREMOVEREQ *PCPSPSERIALWATCHREMOVEREQ;
+
+
+/**
+ * Watchlist config request payload.
+ */
+typedef struct PSPSERIALWATCHCONFIGREQ
+{
+    /** Sampling interval in milliseconds, 0 pauses sampling without removing the watches. */
+    uint32_t                    cMsInterval;
+    /** Reserved, must be 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALWATCHCONFIGREQ;
+/** Pointer to a watchlist config request payload. */
+typedef PSPSERIALWATCHCONFIGREQ *PPSPSERIALWATCHCONFIGREQ;
+/** Pointer to a const watchlist config request payload. */
+typedef const PSPSERIALWATCHCONFIGREQ *PCPSPSERIALWATCHCONFIGREQ;
+
+
+/**
+ * Watched value changed notification payload.
+ *
+ * The PDU carries the die the watch was added for. If sampling the address
+ * fails, the notification carries the status code with both values set to the
+ * last sample and the watch is removed.
+ */
+typedef struct PSPSERIALWATCHNOT
+{
+    /** The watch ID. */
+    uint32_t                    idWatch;
+    /** Reserved, 0. */
+    uint32_t                    u32Rsvd;
+    /** The masked value of the previous sample. */
+    uint64_t                    u64ValOld;
+    /** The masked value of the current sample. */
+    uint64_t                    u64ValNew;
+    /** Microsecond timestamp of the current sample. */
+    uint64_t                    tsMicros;
+} PSPSERIALWATCHNOT;
+/** Pointer to a watched value changed notification payload. */
+typedef PSPSERIALWATCHNOT *PPSPSERIALWATCHNOT;
+/** Pointer to a const watched value changed notification payload. */
+typedef const PSPSERIALWATCHNOT *PCPSPSERIALWATCHNOT;
+
+
+/**
+ * @name Connect request capability flags.
+ * @{ */
+/** The host understands the PSPSERIALCONNECTRESPEXT trailer of the connect response. */
+#define PSP_SERIAL_CONNECT_CAPS_F_RESP_EXT              0x00000001
+/** @} */
+
+
+/**
+ * Optional connect request payload.
+ *
+ * The base protocol connect request has no payload. A host which sends none gets
+ * the plain PSPSERIALCONNECTRESP, so hosts checking the exact response size keep working.
+ */
+typedef struct PSPSERIALCONNECTREQEXT
+{
+    /** Capabilities of the host, see PSP_SERIAL_CONNECT_CAPS_F_XXX. */
+    uint32_t                    fCaps;
+    /** Reserved, always 0. */
+    uint32_t                    u32Rsvd;
+} PSPSERIALCONNECTREQEXT;
+/** Pointer to a connect request payload. */
+typedef PSPSERIALCONNECTREQEXT *PPSPSERIALCONNECTREQEXT;
+/** Pointer to a const connect request payload. */
+typedef const PSPSERIALCONNECTREQEXT *PCPSPSERIALCONNECTREQEXT;
+
+
+/**
+ * Extension trailer appended to PSPSERIALCONNECTRESP, only sent to hosts announcing
+ * PSP_SERIAL_CONNECT_CAPS_F_RESP_EXT in the connect request.
+ */
+typedef struct PSPSERIALCONNECTRESPEXT
+{
+    /** The transport channel ID selected. */
+    PSPSERIALTRANSPID           enmTranspId;
+    /** Measured round trip bandwidth of the channel in bytes per second, 0 if it wasn't probed. */
+    uint32_t                    cbPerSec;
+} PSPSERIALCONNECTRESPEXT;
+/** Pointer to a connect response extension trailer. */
+typedef PSPSERIALCONNECTRESPEXT *PPSPSERIALCONNECTRESPEXT;
+/** Pointer to a const connect response extension trailer. */
+typedef const PSPSERIALCONNECTRESPEXT *PCPSPSERIALCONNECTRESPEXT;
+
+#endif /* !__include_psp_serial_stub_ext_h */
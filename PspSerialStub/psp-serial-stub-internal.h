@@ -43,6 +43,18 @@
 int pspSerialStubX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv);
 
 
+/**
+ * Maps the given x86 physical address into the PSP address space with the given memory type.
+ *
+ * @returns Status code.
+ * @param   PhysX86Addr             The x86 physical address to map.
+ * @param   fMmio                   Flag whether this a MMIO address.
+ * @param   uMemType                The memory type to program, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int pspSerialStubX86PhysMapEx(X86PADDR PhysX86Addr, bool fMmio, uint32_t uMemType, void **ppv);
+
+
 /**
  * Unmaps a previously mapped x86 physical address.
  *
@@ -71,6 +83,25 @@ int pspSerialStubSmnMap(SMNADDR SmnAddr, void **ppv);
 int pspSerialStubSmnUnmapByPtr(void *pv);
 
 
+/**
+ * Maps the given SMN address of the given die into the PSP address space.
+ *
+ * @returns Status code.
+ * @param   idDie                   The die to access, 0 for the local one.
+ * @param   SmnAddr                 The SMN address to map.
+ * @param   ppv                     Where to store the pointer to the mapping on success.
+ */
+int pspSerialStubSmnMapEx(uint32_t idDie, SMNADDR SmnAddr, void **ppv);
+
+
+/**
+ * Tears down all cached SMN mappings which are not referenced anymore.
+ *
+ * @returns nothing.
+ */
+void pspSerialStubSmnFlush(void);
+
+
 /**
  * Wait the given number of milli seconds.
  *
@@ -88,5 +119,58 @@ void pspSerialStubDelayMs(uint32_t cMillies);
  */
 void pspSerialStubDelayUs(uint64_t cMicros);
 
+
+/**
+ * Returns the number of microseconds passed since power on/reset.
+ *
+ * @returns Number of microseconds passed.
+ */
+uint64_t pspSerialStubGetMicros(void);
+
+
+/**
+ * Copies between x86 memory and PSP memory through the CCP passthrough engine.
+ *
+ * @returns Status code.
+ * @retval  ERR_CCP_NOT_AVAILABLE if the CCP can't be used.
+ * @param   PhysX86Addr             The x86 physical address.
+ * @param   pvPsp                   The PSP memory.
+ * @param   cbCopy                  Number of bytes to copy.
+ * @param   fToX86                  Flag whether to copy to the x86 memory instead of from it.
+ */
+int pspSerialStubCcpX86Copy(X86PADDR PhysX86Addr, void *pvPsp, size_t cbCopy, bool fToX86);
+
+
+/**
+ * Measures the throughput of copying a x86 physical address range from/to a PSP buffer.
+ *
+ * @returns Status code.
+ * @param   PhysX86Start            Start x86 physical address of the range.
+ * @param   cbRange                 Size of the range in bytes.
+ * @param   fMmio                   Flag whether the range is MMIO.
+ * @param   uMemType                The memory type to map the range with, MAPMGR_X86_MEMTYPE_DEFAULT for the default.
+ * @param   fWrite                  Flag whether to write the buffer content to the range instead of reading it.
+ * @param   fCcp                    Flag whether to copy through the CCP instead of the mapping windows.
+ * @param   cPasses                 Number of passes over the range.
+ * @param   pvBuf                   The PSP buffer to copy from/to.
+ * @param   cbBuf                   Size of the buffer, the range is copied in chunks of at most this size.
+ * @param   pcMicros                Where to store the number of microseconds all passes took on success.
+ */
+int pspSerialStubBenchX86Mem(X86PADDR PhysX86Start, uint32_t cbRange, bool fMmio, uint32_t uMemType, bool fWrite,
+                             bool fCcp, uint32_t cPasses, void *pvBuf, size_t cbBuf, uint64_t *pcMicros);
+
+
+/**
+ * Measures the throughput of reading a SMN register with a map/unmap pair around every read.
+ *
+ * @returns Status code.
+ * @param   idDie                   The die to access, 0 for the local one.
+ * @param   SmnAddr                 The SMN register address.
+ * @param   fNoCache                Flag whether to tear down the mapping after every read.
+ * @param   cPolls                  Number of reads.
+ * @param   pcMicros                Where to store the number of microseconds all reads took on success.
+ */
+int pspSerialStubBenchSmnPoll(uint32_t idDie, SMNADDR SmnAddr, bool fNoCache, uint32_t cPolls, uint64_t *pcMicros);
+
 #endif /* !__include_psp_serial_stub_internal_h */
 
@@ -0,0 +1,374 @@
+/** @file
+ * PSP link simulator - Fuzzer for the COBS PDU framing over a lossy byte stream.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/cdefs.h>
+
+#include "../../Lib/include/err.h"
+#include "../../Lib/include/cobs.h"
+
+
+/*
+ * Sends random PDU sized frames (with plenty of zero bytes) through the COBS encoder, drops, flips and
+ * inserts bytes on the way and feeds the result into the decoder. Every frame the noise didn't touch has to be
+ * recovered unchanged, regardless of what happened to the frames before it. Mangled frames should be
+ * rejected by the decoder or by the length and checksum checks the stub does on a PDU. As the PDU checksum
+ * is a plain byte sum it can't detect zero bytes moved around inside a frame by a corrupted block code, such frames
+ * are reported as false accepts. With the default noise they make up about 0.1 to 0.3% of the mangled frames, the run
+ * fails if they exceed the rate given with --false-accept-ppm.
+ */
+
+/** Maximum frame size (matches the PDU buffer of the stub). */
+#define COBS_FUZZ_FRAME_MAX             4096
+/** Default number of false accepts per million mangled frames tolerated before the run fails. */
+#define COBS_FUZZ_FALSE_ACCEPT_PPM      5000
+
+
+/**
+ * A single transmitted frame.
+ */
+typedef struct COBSFUZZFRAME
+{
+    /** Offset of the encoded frame in the stream (including the leading delimiter). */
+    size_t                      offStream;
+    /** Size of the encoded frame in bytes. */
+    size_t                      cbStream;
+    /** Flag whether the noise hit the frame. */
+    bool                        fMangled;
+    /** Flag whether the frame was received. */
+    bool                        fRecv;
+    /** Size of the frame payload. */
+    size_t                      cbFrame;
+    /** The frame, starts with the payload size like a PDU header and ends with the checksum. */
+    uint8_t                     *pbFrame;
+} COBSFUZZFRAME;
+
+
+/** The encoded stream. */
+static uint8_t *g_pbStream = NULL;
+/** Number of bytes in the encoded stream. */
+static size_t g_cbStream = 0;
+/** Size of the stream buffer. */
+static size_t g_cbStreamMax = 0;
+
+
+/**
+ * Returns a random number in the given range.
+ *
+ * @returns Random number.
+ * @param   uMax                Maximum value (exclusive).
+ */
+static uint32_t cobsFuzzRand(uint32_t uMax)
+{
+    return (uint32_t)(((uint64_t)random() << 31 | random()) % uMax);
+}
+
+
+/**
+ * Encoder output callback collecting everything in the stream buffer.
+ */
+static int cobsFuzzEncWrite(void *pvUser, const void *pvBuf, size_t cbBuf)
+{
+    (void)pvUser;
+
+    if (g_cbStream + cbBuf > g_cbStreamMax)
+    {
+        g_cbStreamMax = (g_cbStream + cbBuf) * 2;
+        g_pbStream    = (uint8_t *)realloc(g_pbStream, g_cbStreamMax);
+        if (!g_pbStream)
+            return ERR_BUFFER_OVERFLOW;
+    }
+
+    memcpy(&g_pbStream[g_cbStream], pvBuf, cbBuf);
+    g_cbStream += cbBuf;
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Calculates the PDU style checksum over the given data.
+ *
+ * @returns Checksum making the byte sum 0.
+ * @param   pb                  The data.
+ * @param   cb                  Number of bytes.
+ */
+static uint32_t cobsFuzzChkSum(const uint8_t *pb, size_t cb)
+{
+    uint32_t uChkSum = 0;
+
+    while (cb--)
+        uChkSum += *pb++;
+
+    return (0xffffffff - uChkSum) + 1;
+}
+
+
+/**
+ * Prints the usage of the tool.
+ *
+ * @returns nothing.
+ * @param   pszTool             The tool name.
+ */
+static void cobsFuzzUsage(const char *pszTool)
+{
+    printf("%s Options:\n", pszTool);
+    printf("  --frames          <count>  Number of frames to send (default 10000)\n");
+    printf("  --drop-ppm        <ppm>    Probability of a byte getting lost in parts per million (default 200)\n");
+    printf("  --flip-ppm        <ppm>    Probability of a bit flip in a byte in parts per million (default 200)\n");
+    printf("  --insert-ppm      <ppm>    Probability of a garbage byte getting inserted in parts per million (default 50)\n");
+    printf("  --seed            <seed>   Random seed (default 1)\n");
+    printf("  --false-accept-ppm <ppm>   False accepts tolerated per million mangled frames (default %u)\n",
+           COBS_FUZZ_FALSE_ACCEPT_PPM);
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t cFrames = 10000;
+    uint32_t uDropPpm = 200;
+    uint32_t uFlipPpm = 200;
+    uint32_t uInsertPpm = 50;
+    uint32_t uFalseAcceptPpm = COBS_FUZZ_FALSE_ACCEPT_PPM;
+    unsigned uSeed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            cobsFuzzUsage(argv[0]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--frames"))
+            cFrames = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--drop-ppm"))
+            uDropPpm = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--flip-ppm"))
+            uFlipPpm = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--insert-ppm"))
+            uInsertPpm = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--seed"))
+            uSeed = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--false-accept-ppm"))
+            uFalseAcceptPpm = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            cobsFuzzUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    srandom(uSeed);
+
+    COBSFUZZFRAME *paFrames = (COBSFUZZFRAME *)calloc(cFrames, sizeof(*paFrames));
+    uint8_t *pbDecoded = (uint8_t *)malloc(COBS_FUZZ_FRAME_MAX);
+    if (!paFrames || !pbDecoded)
+    {
+        fprintf(stderr, "cobs-fuzz: Out of memory\n");
+        return 1;
+    }
+
+    /* Encode all frames. */
+    COBSENC Enc;
+    COBSEncInit(&Enc, cobsFuzzEncWrite, NULL);
+    for (uint32_t i = 0; i < cFrames; i++)
+    {
+        COBSFUZZFRAME *pFrame = &paFrames[i];
+
+        /* Mix of tiny and full size frames, the block size boundaries are of particular interest. */
+        switch (cobsFuzzRand(4))
+        {
+            case 0:
+                pFrame->cbFrame = 8 + cobsFuzzRand(16);
+                break;
+            case 1:
+                pFrame->cbFrame = COBS_BLOCK_DATA_MAX - 2 + cobsFuzzRand(5);
+                break;
+            default:
+                pFrame->cbFrame = 8 + cobsFuzzRand(COBS_FUZZ_FRAME_MAX - 8 + 1);
+        }
+
+        pFrame->pbFrame = (uint8_t *)malloc(pFrame->cbFrame);
+        if (!pFrame->pbFrame)
+        {
+            fprintf(stderr, "cobs-fuzz: Out of memory\n");
+            return 1;
+        }
+
+        uint32_t uZeroPct = cobsFuzzRand(101);
+        uint32_t cbPayload = pFrame->cbFrame - 8;
+        memcpy(&pFrame->pbFrame[0], &cbPayload, sizeof(cbPayload));
+        for (size_t off = 4; off < pFrame->cbFrame - 4; off++)
+            pFrame->pbFrame[off] = cobsFuzzRand(100) < uZeroPct ? 0 : (uint8_t)cobsFuzzRand(256);
+
+        uint32_t uChkSum = cobsFuzzChkSum(pFrame->pbFrame, pFrame->cbFrame - 4);
+        memcpy(&pFrame->pbFrame[pFrame->cbFrame - 4], &uChkSum, sizeof(uChkSum));
+
+        pFrame->offStream = g_cbStream;
+        int rc = COBSEncFrameBegin(&Enc);
+        if (!rc)
+            rc = COBSEncWrite(&Enc, pFrame->pbFrame, pFrame->cbFrame);
+        if (!rc)
+            rc = COBSEncFrameEnd(&Enc);
+        if (rc)
+        {
+            fprintf(stderr, "cobs-fuzz: Encoding frame %u failed with %d\n", i, rc);
+            return 1;
+        }
+        pFrame->cbStream = g_cbStream - pFrame->offStream;
+    }
+
+    /*
+     * Feed the stream through the noisy link into the decoder. Frames are matched in order, so a decoded frame
+     * belongs to the oldest not yet received frame ending before the current stream position.
+     */
+    COBSDEC Dec;
+    COBSDecInit(&Dec, pbDecoded, COBS_FUZZ_FRAME_MAX);
+
+    uint64_t cbDropped = 0;
+    uint64_t cFlips = 0;
+    uint64_t cbInserted = 0;
+    uint64_t cDecoded = 0;
+    uint64_t cRejectedDec = 0;
+    uint64_t cRejectedChkSum = 0;
+    uint64_t cFalseAccepts = 0;
+    uint32_t idxFrame = 0;
+    for (size_t off = 0; off < g_cbStream; off++)
+    {
+        while (   idxFrame < cFrames
+               && paFrames[idxFrame].offStream + paFrames[idxFrame].cbStream <= off)
+            idxFrame++;
+
+        uint8_t abBytes[2];
+        uint32_t cBytes = 0;
+        if (cobsFuzzRand(1000000) < uInsertPpm)
+        {
+            abBytes[cBytes++] = (uint8_t)cobsFuzzRand(256);
+            cbInserted++;
+        }
+
+        uint8_t b = g_pbStream[off];
+        if (cobsFuzzRand(1000000) < uDropPpm)
+            cbDropped++;
+        else
+        {
+            if (cobsFuzzRand(1000000) < uFlipPpm)
+            {
+                b ^= (uint8_t)BIT(cobsFuzzRand(8));
+                cFlips++;
+            }
+            abBytes[cBytes++] = b;
+        }
+
+        if (   cBytes != 1
+            || abBytes[0] != g_pbStream[off])
+        {
+            if (idxFrame < cFrames)
+                paFrames[idxFrame].fMangled = true;
+        }
+
+        for (uint32_t i = 0; i < cBytes; i++)
+        {
+            int rc = COBSDecPutByte(&Dec, abBytes[i]);
+            if (rc == INF_SUCCESS)
+            {
+                size_t cbFrame = COBSDecGetFrameSize(&Dec);
+                uint32_t cbPayload = 0;
+                uint32_t uChkSum = 0;
+
+                cDecoded++;
+                if (cbFrame >= 8)
+                {
+                    memcpy(&cbPayload, &pbDecoded[0], sizeof(cbPayload));
+                    memcpy(&uChkSum, &pbDecoded[cbFrame - 4], sizeof(uChkSum));
+                }
+                if (   cbFrame < 8
+                    || cbFrame - 8 != cbPayload
+                    || cobsFuzzChkSum(pbDecoded, cbFrame - 4) != uChkSum)
+                {
+                    cRejectedChkSum++;
+                    continue;
+                }
+
+                /*
+                 * The frame ends at the current stream position, or in the leading delimiter of the next frame
+                 * if its trailing delimiter got lost.
+                 */
+                COBSFUZZFRAME *pFrame = NULL;
+                for (uint32_t idx = idxFrame ? idxFrame - 1 : 0; idx <= idxFrame && idx < cFrames; idx++)
+                    if (   paFrames[idx].cbFrame == cbFrame
+                        && !memcmp(paFrames[idx].pbFrame, pbDecoded, cbFrame))
+                        pFrame = &paFrames[idx];
+
+                if (pFrame)
+                    pFrame->fRecv = true;
+                else
+                    cFalseAccepts++;
+            }
+            else if (rc != INF_TRY_AGAIN)
+                cRejectedDec++;
+        }
+    }
+
+    uint32_t cClean = 0;
+    uint32_t cCleanLost = 0;
+    uint32_t cMangledRecv = 0;
+    for (uint32_t i = 0; i < cFrames; i++)
+    {
+        if (!paFrames[i].fMangled)
+        {
+            cClean++;
+            if (!paFrames[i].fRecv)
+            {
+                if (!cCleanLost)
+                    fprintf(stderr, "cobs-fuzz: Clean frame %u (%zu bytes) was lost\n", i, paFrames[i].cbFrame);
+                cCleanLost++;
+            }
+        }
+        else if (paFrames[i].fRecv)
+            cMangledRecv++;
+        free(paFrames[i].pbFrame);
+    }
+
+    printf("Frames:             %u (%zu bytes encoded)\n", cFrames, g_cbStream);
+    printf("Noise:              %llu dropped, %llu flipped, %llu inserted\n",
+           (unsigned long long)cbDropped, (unsigned long long)cFlips, (unsigned long long)cbInserted);
+    printf("Clean frames:       %u, %u lost\n", cClean, cCleanLost);
+    printf("Mangled frames:     %u, %u recovered anyway\n", cFrames - cClean, cMangledRecv);
+    printf("Decoded frames:     %llu\n", (unsigned long long)cDecoded);
+    printf("Rejected:           %llu by the decoder, %llu by the length/checksum\n",
+           (unsigned long long)cRejectedDec, (unsigned long long)cRejectedChkSum);
+    /* Round up so a short run with a handful of mangled frames can still have a false accept. */
+    uint64_t cFalseAcceptsMax = ((uint64_t)(cFrames - cClean) * uFalseAcceptPpm + 999999) / 1000000;
+    printf("False accepts:      %llu (%llu tolerated)\n", (unsigned long long)cFalseAccepts,
+           (unsigned long long)cFalseAcceptsMax);
+    if (cFalseAccepts > cFalseAcceptsMax)
+        fprintf(stderr, "cobs-fuzz: %llu corrupted frames were accepted, more than the %llu tolerated\n",
+                (unsigned long long)cFalseAccepts, (unsigned long long)cFalseAcceptsMax);
+
+    free(paFrames);
+    free(pbDecoded);
+    free(g_pbStream);
+    return cCleanLost || cFalseAccepts > cFalseAcceptsMax ? 1 : 0;
+}
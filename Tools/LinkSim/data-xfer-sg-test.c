@@ -0,0 +1,733 @@
+/** @file
+ * PSP link simulator - Scatter/gather data transfer test against the host build of the stub.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <common/cdefs.h>
+#include <common/types.h>
+#include <common/status.h>
+#include <psp-stub/psp-serial-stub.h>
+
+#include "../../Lib/include/err.h"
+#include "../../PspSerialStub/psp-serial-stub-ext.h"
+
+
+/** Default socket path of the host stub, see pdu-transp-unix.c. */
+#define SG_TEST_SOCKET_DEF              "/tmp/psp-serial-stub.sock"
+/** Maximum number of descriptors in a list. */
+#define SG_TEST_DESCS_MAX               24
+/** Maximum number of bytes transferred by a single descriptor. */
+#define SG_TEST_XFER_MAX                64
+/** Maximum size of the memory region a list operates on. */
+#define SG_TEST_REGION_MAX              _4K
+/** Chunk size when setting up and reading back a region. */
+#define SG_TEST_CHUNK_SZ                _1K
+/** Maximum PDU payload size handled. */
+#define SG_TEST_PDU_PAYLOAD_MAX         _4K
+
+/*
+ * Connects to the host build of the stub (make host in PspSerialStub) and runs random lists of read, write and
+ * memset descriptors through one scatter/gather request against one half of the stub scratch space. The same
+ * list is replayed as single data transfer requests against the other half, which has the same content
+ * beforehand. Status, number of completed descriptors, the read data and the memory content afterwards have to
+ * match. Odd transfer sizes are used to check that the data of every descriptor starts 8 byte aligned in both
+ * the request and the response. Some lists get a descriptor targeting an invalid address space, which passes
+ * the upfront validation but fails when executed, so processing has to stop right there.
+ */
+
+
+/**
+ * A single descriptor of a list.
+ */
+typedef struct SGTESTOP
+{
+    /** The descriptor, the PSP address is relative to the region start. */
+    PSPSERIALDATAXFERREQ        Desc;
+    /** The data for a write or memset. */
+    uint8_t                     abData[SG_TEST_XFER_MAX];
+} SGTESTOP;
+/** Pointer to a descriptor of a list. */
+typedef SGTESTOP *PSGTESTOP;
+/** Pointer to a const descriptor of a list. */
+typedef const SGTESTOP *PCSGTESTOP;
+
+
+/**
+ * The outcome of executing a list.
+ */
+typedef struct SGTESTRES
+{
+    /** Status of the list. */
+    PSPSTS                      rcReq;
+    /** Number of descriptors completed. */
+    uint32_t                    cDescsDone;
+    /** The read data, each descriptor starting 8 byte aligned. */
+    uint8_t                     abRead[SG_TEST_DESCS_MAX * SG_TEST_XFER_MAX];
+} SGTESTRES;
+/** Pointer to the outcome of executing a list. */
+typedef SGTESTRES *PSGTESTRES;
+
+
+/**
+ * The test connection state.
+ */
+typedef struct SGTEST
+{
+    /** The socket connected to the stub. */
+    int                         iFd;
+    /** Number of PDUs sent. */
+    uint32_t                    cPdusSent;
+    /** Size of the last received payload. */
+    size_t                      cbPayload;
+    /** The last received payload. */
+    uint8_t                     abPayload[SG_TEST_PDU_PAYLOAD_MAX];
+    /** PDU assembly buffer. */
+    uint8_t                     abPdu[SG_TEST_PDU_PAYLOAD_MAX];
+} SGTEST;
+/** Pointer to the test connection state. */
+typedef SGTEST *PSGTEST;
+
+
+/**
+ * Returns a random number in the given range.
+ *
+ * @returns Random number.
+ * @param   uMax                Maximum value (exclusive).
+ */
+static uint32_t sgTestRand(uint32_t uMax)
+{
+    return (uint32_t)(random() % uMax);
+}
+
+
+/**
+ * Reads the given number of bytes from the socket.
+ *
+ * @returns Status code.
+ * @param   pThis               The test connection state.
+ * @param   pvBuf               Where to store the data.
+ * @param   cbRead              Number of bytes to read.
+ */
+static int sgTestRead(PSGTEST pThis, void *pvBuf, size_t cbRead)
+{
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+
+    while (cbRead)
+    {
+        ssize_t cb = read(pThis->iFd, pbBuf, cbRead);
+        if (cb <= 0)
+            return -1;
+
+        pbBuf  += cb;
+        cbRead -= cb;
+    }
+
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Sends a request PDU.
+ *
+ * @returns Status code.
+ * @param   pThis               The test connection state.
+ * @param   enmRrnId            The request ID.
+ * @param   pvPayload           The payload.
+ * @param   cbPayload           Size of the payload in bytes.
+ */
+static int sgTestPduSend(PSGTEST pThis, PSPSERIALPDURRNID enmRrnId, const void *pvPayload, size_t cbPayload)
+{
+    PPSPSERIALPDUHDR pHdr = (PPSPSERIALPDUHDR)&pThis->abPdu[0];
+    size_t cbPayloadAligned = PSP_SERIAL_DATA_XFER_SG_ALIGN(cbPayload);
+
+    if (sizeof(*pHdr) + cbPayloadAligned + sizeof(PSPSERIALPDUFOOTER) > sizeof(pThis->abPdu))
+        return ERR_BUFFER_OVERFLOW;
+
+    memset(pHdr, 0, sizeof(*pHdr));
+    pHdr->u32Magic           = PSP_SERIAL_EXT_2_PSP_PDU_START_MAGIC;
+    pHdr->u.Fields.cbPdu     = cbPayload;
+    pHdr->u.Fields.cPdus     = ++pThis->cPdusSent;
+    pHdr->u.Fields.enmRrnId  = enmRrnId;
+
+    uint8_t *pbPayload = (uint8_t *)(pHdr + 1);
+    memcpy(pbPayload, pvPayload, cbPayload);
+    memset(pbPayload + cbPayload, 0, cbPayloadAligned - cbPayload);
+
+    uint32_t uChkSum = 0;
+    for (uint32_t i = 0; i < ELEMENTS(pHdr->u.ab); i++)
+        uChkSum += pHdr->u.ab[i];
+    for (size_t i = 0; i < cbPayloadAligned; i++)
+        uChkSum += pbPayload[i];
+
+    PSPSERIALPDUFOOTER Footer;
+    Footer.u32ChkSum = (0xffffffff - uChkSum) + 1;
+    Footer.u32Magic  = PSP_SERIAL_EXT_2_PSP_PDU_END_MAGIC;
+    memcpy(pbPayload + cbPayloadAligned, &Footer, sizeof(Footer));
+
+    size_t cbPdu = sizeof(*pHdr) + cbPayloadAligned + sizeof(Footer);
+    if (write(pThis->iFd, &pThis->abPdu[0], cbPdu) != (ssize_t)cbPdu)
+        return -1;
+
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Receives the response to the last request, notifications are skipped.
+ *
+ * @returns Status code.
+ * @param   pThis               The test connection state.
+ * @param   enmRrnId            The expected response ID.
+ * @param   prcReq              Where to store the request status.
+ */
+static int sgTestPduRecv(PSGTEST pThis, PSPSERIALPDURRNID enmRrnId, PSPSTS *prcReq)
+{
+    for (;;)
+    {
+        PSPSERIALPDUHDR Hdr;
+        PSPSERIALPDUFOOTER Footer;
+
+        int rc = sgTestRead(pThis, &Hdr, sizeof(Hdr));
+        if (rc)
+            return rc;
+
+        size_t cbPayloadAligned = PSP_SERIAL_DATA_XFER_SG_ALIGN(Hdr.u.Fields.cbPdu);
+        if (   Hdr.u32Magic != PSP_SERIAL_PSP_2_EXT_PDU_START_MAGIC
+            || cbPayloadAligned > sizeof(pThis->abPayload))
+            return ERR_INVALID_STATE;
+
+        rc = sgTestRead(pThis, &pThis->abPayload[0], cbPayloadAligned);
+        if (!rc)
+            rc = sgTestRead(pThis, &Footer, sizeof(Footer));
+        if (rc)
+            return rc;
+
+        uint32_t uChkSum = 0;
+        for (uint32_t i = 0; i < ELEMENTS(Hdr.u.ab); i++)
+            uChkSum += Hdr.u.ab[i];
+        for (size_t i = 0; i < cbPayloadAligned; i++)
+            uChkSum += pThis->abPayload[i];
+
+        if (   uChkSum + Footer.u32ChkSum != 0
+            || Footer.u32Magic != PSP_SERIAL_PSP_2_EXT_PDU_END_MAGIC)
+            return ERR_INVALID_STATE;
+
+        if ((uint32_t)Hdr.u.Fields.enmRrnId >= PSPSERIALPDURRNID_NOTIFICATION_FIRST)
+            continue;
+
+        if (Hdr.u.Fields.enmRrnId != enmRrnId)
+            return ERR_INVALID_STATE;
+
+        pThis->cbPayload = Hdr.u.Fields.cbPdu;
+        *prcReq = Hdr.u.Fields.rcReq;
+        return INF_SUCCESS;
+    }
+}
+
+
+/**
+ * Sends a request and waits for the response.
+ *
+ * @returns Status code of the exchange, the status of the request is returned in prcReq.
+ * @param   pThis               The test connection state.
+ * @param   enmRrnIdReq         The request ID.
+ * @param   enmRrnIdResp        The expected response ID.
+ * @param   pvPayload           The request payload.
+ * @param   cbPayload           Size of the request payload in bytes.
+ * @param   prcReq              Where to store the request status.
+ */
+static int sgTestReq(PSGTEST pThis, PSPSERIALPDURRNID enmRrnIdReq, PSPSERIALPDURRNID enmRrnIdResp,
+                     const void *pvPayload, size_t cbPayload, PSPSTS *prcReq)
+{
+    int rc = sgTestPduSend(pThis, enmRrnIdReq, pvPayload, cbPayload);
+    if (!rc)
+        rc = sgTestPduRecv(pThis, enmRrnIdResp, prcReq);
+    return rc;
+}
+
+
+/**
+ * Executes a single data transfer request.
+ *
+ * @returns Status code of the exchange, the status of the request is returned in prcReq.
+ * @param   pThis               The test connection state.
+ * @param   pDesc               The descriptor.
+ * @param   pvData              The data for a write or memset.
+ * @param   cbData              Size of the data in bytes.
+ * @param   prcReq              Where to store the request status.
+ */
+static int sgTestDataXfer(PSGTEST pThis, PCPSPSERIALDATAXFERREQ pDesc, const void *pvData, size_t cbData, PSPSTS *prcReq)
+{
+    uint8_t abReq[sizeof(*pDesc) + SG_TEST_CHUNK_SZ];
+
+    memcpy(&abReq[0], pDesc, sizeof(*pDesc));
+    memcpy(&abReq[sizeof(*pDesc)], pvData, cbData);
+    return sgTestReq(pThis, PSPSERIALPDURRNID_REQUEST_PSP_DATA_XFER, PSPSERIALPDURRNID_RESPONSE_PSP_DATA_XFER,
+                     &abReq[0], sizeof(*pDesc) + cbData, prcReq);
+}
+
+
+/**
+ * Reads or writes the given PSP memory range with plain single transfers.
+ *
+ * @returns Status code.
+ * @param   pThis               The test connection state.
+ * @param   PspAddr             Start address.
+ * @param   pvBuf               The buffer to write from or read into.
+ * @param   cb                  Number of bytes to transfer.
+ * @param   fWrite              Flag whether to write or read.
+ */
+static int sgTestPspMemXfer(PSGTEST pThis, PSPADDR PspAddr, void *pvBuf, size_t cb, bool fWrite)
+{
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+
+    while (cb)
+    {
+        size_t cbThis = MIN(cb, SG_TEST_CHUNK_SZ);
+        PSPSERIALDATAXFERREQ Desc;
+        PSPSTS rcReq = STS_INF_SUCCESS;
+
+        memset(&Desc, 0, sizeof(Desc));
+        Desc.enmAddrSpace   = PSPADDRSPACE_PSP_MEM;
+        Desc.fFlags         = PSP_SERIAL_DATA_XFER_F_INCR_ADDR
+                            | (fWrite ? PSP_SERIAL_DATA_XFER_F_WRITE : PSP_SERIAL_DATA_XFER_F_READ);
+        Desc.cbStride       = 1;
+        Desc.cbXfer         = cbThis;
+        Desc.u.PspAddrStart = PspAddr;
+
+        int rc = sgTestDataXfer(pThis, &Desc, pbBuf, fWrite ? cbThis : 0, &rcReq);
+        if (!rc && rcReq != STS_INF_SUCCESS)
+            rc = rcReq;
+        if (!rc && !fWrite && pThis->cbPayload != cbThis)
+            rc = ERR_INVALID_STATE;
+        if (rc)
+            return rc;
+
+        if (!fWrite)
+            memcpy(pbBuf, &pThis->abPayload[0], cbThis);
+
+        PspAddr += cbThis;
+        pbBuf   += cbThis;
+        cb      -= cbThis;
+    }
+
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Returns the number of data bytes of the given descriptor in the request.
+ *
+ * @returns Number of data bytes (not aligned).
+ * @param   pDesc               The descriptor.
+ */
+static size_t sgTestOpDataSize(PCPSPSERIALDATAXFERREQ pDesc)
+{
+    if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+        return pDesc->cbStride;
+    if (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_WRITE)
+        return pDesc->cbXfer;
+    return 0;
+}
+
+
+/**
+ * Generates a random descriptor list.
+ *
+ * @returns Number of descriptors generated.
+ * @param   paOps               Where to store the descriptors.
+ * @param   cbRegion            Size of the region the list operates on.
+ * @param   fFail               Flag whether to insert a descriptor failing during execution.
+ */
+static uint32_t sgTestListGen(PSGTESTOP paOps, size_t cbRegion, bool fFail)
+{
+    static const uint32_t s_acbStrides[] = { 1, 2, 4, 8 };
+    uint32_t cOps = 1 + sgTestRand(SG_TEST_DESCS_MAX);
+
+    for (uint32_t i = 0; i < cOps; i++)
+    {
+        PSGTESTOP pOp = &paOps[i];
+        uint32_t cbStride = s_acbStrides[sgTestRand(ELEMENTS(s_acbStrides))];
+        uint32_t cbXfer = cbStride * (1 + sgTestRand(SG_TEST_XFER_MAX / cbStride));
+        bool fIncrAddr = sgTestRand(4) != 0;
+        uint32_t cbRange = fIncrAddr ? cbXfer : cbStride;
+
+        memset(pOp, 0, sizeof(*pOp));
+        pOp->Desc.enmAddrSpace   = PSPADDRSPACE_PSP_MEM;
+        pOp->Desc.cbStride       = cbStride;
+        pOp->Desc.cbXfer         = cbXfer;
+        pOp->Desc.u.PspAddrStart = sgTestRand((cbRegion - cbRange) / cbStride + 1) * cbStride;
+        if (fIncrAddr)
+        {
+            pOp->Desc.fFlags |= PSP_SERIAL_DATA_XFER_F_INCR_ADDR;
+            if (cbStride >= 4 && !sgTestRand(4))
+                pOp->Desc.fFlags |= PSP_SERIAL_DATA_XFER_F_BURST;
+        }
+
+        switch (sgTestRand(3))
+        {
+            case 0:
+                pOp->Desc.fFlags |= PSP_SERIAL_DATA_XFER_F_READ;
+                break;
+            case 1:
+                pOp->Desc.fFlags |= PSP_SERIAL_DATA_XFER_F_WRITE;
+                break;
+            default:
+                pOp->Desc.fFlags |= PSP_SERIAL_DATA_XFER_F_MEMSET;
+                break;
+        }
+
+        for (uint32_t off = 0; off < sgTestOpDataSize(&pOp->Desc); off++)
+            pOp->abData[off] = (uint8_t)sgTestRand(256);
+    }
+
+    if (fFail)
+    {
+        /* Passes the validation, the address space is only looked at when the descriptor gets executed. */
+        PSGTESTOP pOp = &paOps[sgTestRand(cOps)];
+
+        pOp->Desc.enmAddrSpace = PSPADDRSPACE_INVALID;
+    }
+
+    return cOps;
+}
+
+
+/**
+ * Executes the given list with a single scatter/gather request.
+ *
+ * @returns Status code of the exchange.
+ * @param   pThis               The test connection state.
+ * @param   paOps               The descriptor list.
+ * @param   cOps                Number of descriptors.
+ * @param   PspAddrRegion       Start address of the region to operate on.
+ * @param   pRes                Where to store the outcome.
+ */
+static int sgTestListExecSg(PSGTEST pThis, PCSGTESTOP paOps, uint32_t cOps, PSPADDR PspAddrRegion, PSGTESTRES pRes)
+{
+    uint8_t abReq[SG_TEST_PDU_PAYLOAD_MAX];
+    PPSPSERIALDATAXFERSGREQ pReq = (PPSPSERIALDATAXFERSGREQ)&abReq[0];
+    PSPSERIALDATAXFERREQ *paDescs = (PSPSERIALDATAXFERREQ *)(pReq + 1);
+    size_t offData = sizeof(*pReq) + cOps * sizeof(*paDescs);
+
+    pReq->cDescs  = cOps;
+    pReq->u32Rsvd = 0;
+    for (uint32_t i = 0; i < cOps; i++)
+    {
+        size_t cbData = sgTestOpDataSize(&paOps[i].Desc);
+
+        paDescs[i] = paOps[i].Desc;
+        paDescs[i].u.PspAddrStart += PspAddrRegion;
+
+        /* Fill the alignment padding with garbage, it must not be taken for data. */
+        memset(&abReq[offData], 0xa5, PSP_SERIAL_DATA_XFER_SG_ALIGN(cbData));
+        memcpy(&abReq[offData], &paOps[i].abData[0], cbData);
+        offData += PSP_SERIAL_DATA_XFER_SG_ALIGN(cbData);
+    }
+
+    int rc = sgTestReq(pThis, PSPSERIALPDURRNID_REQUEST_DATA_XFER_SG, PSPSERIALPDURRNID_RESPONSE_DATA_XFER_SG,
+                       &abReq[0], offData, &pRes->rcReq);
+    if (rc)
+        return rc;
+
+    PCPSPSERIALDATAXFERSGRESP pResp = (PCPSPSERIALDATAXFERSGRESP)&pThis->abPayload[0];
+    if (pThis->cbPayload < sizeof(*pResp))
+    {
+        fprintf(stderr, "data-xfer-sg-test: Scatter/gather response is only %zu bytes\n", pThis->cbPayload);
+        return ERR_INVALID_STATE;
+    }
+
+    /* The response has to carry exactly the aligned read data of the completed descriptors. */
+    size_t cbRead = 0;
+    pRes->cDescsDone = pResp->cDescsDone;
+    for (uint32_t i = 0; i < pRes->cDescsDone && i < cOps; i++)
+    {
+        if (   !(paOps[i].Desc.fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+            && (paOps[i].Desc.fFlags & PSP_SERIAL_DATA_XFER_F_READ))
+            cbRead += PSP_SERIAL_DATA_XFER_SG_ALIGN(paOps[i].Desc.cbXfer);
+    }
+
+    if (   pRes->cDescsDone > cOps
+        || pThis->cbPayload != sizeof(*pResp) + cbRead)
+    {
+        fprintf(stderr, "data-xfer-sg-test: Scatter/gather response has %zu bytes for %u completed descriptors, expected %zu\n",
+                pThis->cbPayload, pRes->cDescsDone, sizeof(*pResp) + cbRead);
+        return ERR_INVALID_STATE;
+    }
+
+    memcpy(&pRes->abRead[0], pResp + 1, cbRead);
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Executes the given list with single data transfer requests, stopping at the first one failing.
+ *
+ * @returns Status code of the exchange.
+ * @param   pThis               The test connection state.
+ * @param   paOps               The descriptor list.
+ * @param   cOps                Number of descriptors.
+ * @param   PspAddrRegion       Start address of the region to operate on.
+ * @param   pRes                Where to store the outcome, the read data is laid out like in the scatter/gather response.
+ */
+static int sgTestListExecSingle(PSGTEST pThis, PCSGTESTOP paOps, uint32_t cOps, PSPADDR PspAddrRegion, PSGTESTRES pRes)
+{
+    size_t offRead = 0;
+
+    pRes->rcReq      = STS_INF_SUCCESS;
+    pRes->cDescsDone = 0;
+    for (uint32_t i = 0; i < cOps; i++)
+    {
+        PSPSERIALDATAXFERREQ Desc = paOps[i].Desc;
+        Desc.u.PspAddrStart += PspAddrRegion;
+
+        int rc = sgTestDataXfer(pThis, &Desc, &paOps[i].abData[0], sgTestOpDataSize(&Desc), &pRes->rcReq);
+        if (rc)
+            return rc;
+        if (pRes->rcReq != STS_INF_SUCCESS)
+            break;
+
+        if (   !(Desc.fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+            && (Desc.fFlags & PSP_SERIAL_DATA_XFER_F_READ))
+        {
+            if (pThis->cbPayload != Desc.cbXfer)
+                return ERR_INVALID_STATE;
+
+            memcpy(&pRes->abRead[offRead], &pThis->abPayload[0], Desc.cbXfer);
+            offRead += PSP_SERIAL_DATA_XFER_SG_ALIGN(Desc.cbXfer);
+        }
+        pRes->cDescsDone++;
+    }
+
+    return INF_SUCCESS;
+}
+
+
+/**
+ * Compares the outcome of both executions of a list.
+ *
+ * @returns Flag whether both match.
+ * @param   paOps               The descriptor list.
+ * @param   pResSg              The scatter/gather outcome.
+ * @param   pResRef             The single transfer outcome.
+ * @param   idxList             The list index for the messages.
+ */
+static bool sgTestResCompare(PCSGTESTOP paOps, PSGTESTRES pResSg, PSGTESTRES pResRef, uint32_t idxList)
+{
+    if (   pResSg->rcReq != pResRef->rcReq
+        || pResSg->cDescsDone != pResRef->cDescsDone)
+    {
+        fprintf(stderr, "data-xfer-sg-test: List %u completed %u descriptors with %d, expected %u with %d\n",
+                idxList, pResSg->cDescsDone, pResSg->rcReq, pResRef->cDescsDone, pResRef->rcReq);
+        return false;
+    }
+
+    /* Only the data is compared, the alignment padding in between is undefined. */
+    size_t offRead = 0;
+    for (uint32_t i = 0; i < pResSg->cDescsDone; i++)
+    {
+        PCPSPSERIALDATAXFERREQ pDesc = &paOps[i].Desc;
+
+        if (   (pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_MEMSET)
+            || !(pDesc->fFlags & PSP_SERIAL_DATA_XFER_F_READ))
+            continue;
+
+        if (memcmp(&pResSg->abRead[offRead], &pResRef->abRead[offRead], pDesc->cbXfer))
+        {
+            fprintf(stderr, "data-xfer-sg-test: List %u descriptor %u read data mismatch\n", idxList, i);
+            return false;
+        }
+        offRead += PSP_SERIAL_DATA_XFER_SG_ALIGN(pDesc->cbXfer);
+    }
+
+    return true;
+}
+
+
+/**
+ * Connects to the stub.
+ *
+ * @returns Status code.
+ * @param   pThis               The test connection state.
+ * @param   pszPath             The socket path.
+ * @param   pConnResp           Where to store the connect response.
+ */
+static int sgTestConnect(PSGTEST pThis, const char *pszPath, PSPSERIALCONNECTRESP *pConnResp)
+{
+    struct sockaddr_un SockAddr;
+
+    memset(&SockAddr, 0, sizeof(SockAddr));
+    SockAddr.sun_family = AF_UNIX;
+    if (strlen(pszPath) >= sizeof(SockAddr.sun_path))
+        return ERR_INVALID_PARAMETER;
+    strcpy(&SockAddr.sun_path[0], pszPath);
+
+    pThis->cPdusSent = 0;
+    pThis->iFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (pThis->iFd < 0)
+        return -1;
+
+    if (connect(pThis->iFd, (struct sockaddr *)&SockAddr, sizeof(SockAddr)))
+    {
+        fprintf(stderr, "data-xfer-sg-test: Connecting to %s failed, is the host stub running?\n", pszPath);
+        close(pThis->iFd);
+        return -1;
+    }
+
+    PSPSTS rcReq = STS_INF_SUCCESS;
+    int rc = sgTestReq(pThis, PSPSERIALPDURRNID_REQUEST_CONNECT, PSPSERIALPDURRNID_RESPONSE_CONNECT,
+                       NULL /*pvPayload*/, 0 /*cbPayload*/, &rcReq);
+    if (!rc && rcReq != STS_INF_SUCCESS)
+        rc = rcReq;
+    if (!rc && pThis->cbPayload < sizeof(*pConnResp))
+        rc = ERR_INVALID_STATE;
+    if (!rc)
+        memcpy(pConnResp, &pThis->abPayload[0], sizeof(*pConnResp));
+    else
+        close(pThis->iFd);
+
+    return rc;
+}
+
+
+/**
+ * Prints the usage of the tool.
+ *
+ * @returns nothing.
+ * @param   pszTool             The tool name.
+ */
+static void sgTestUsage(const char *pszTool)
+{
+    printf("%s Options:\n", pszTool);
+    printf("  --socket          <path>   Socket of the host stub (default $PSP_SERIAL_STUB_SOCKET or %s)\n", SG_TEST_SOCKET_DEF);
+    printf("  --lists           <count>  Number of random descriptor lists to run (default 1000)\n");
+    printf("  --fail-every      <count>  Insert a failing descriptor into every n-th list, 0 to disable (default 4)\n");
+    printf("  --seed            <seed>   Random seed (default 1)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *pszPath = getenv("PSP_SERIAL_STUB_SOCKET");
+    uint32_t cLists = 1000;
+    uint32_t cFailEvery = 4;
+    unsigned uSeed = 1;
+
+    if (!pszPath)
+        pszPath = SG_TEST_SOCKET_DEF;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            sgTestUsage(argv[0]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--socket"))
+            pszPath = argv[++i];
+        else if (!strcmp(argv[i], "--lists"))
+            cLists = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--fail-every"))
+            cFailEvery = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--seed"))
+            uSeed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            sgTestUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    srandom(uSeed);
+
+    static SGTEST s_Test;
+    PSPSERIALCONNECTRESP ConnResp;
+    int rc = sgTestConnect(&s_Test, pszPath, &ConnResp);
+    if (rc)
+    {
+        fprintf(stderr, "data-xfer-sg-test: Connecting to the stub failed with %d\n", rc);
+        return 1;
+    }
+
+    /* Both halves of the scratch space start out with the same content. */
+    size_t cbRegion = MIN(ConnResp.cbScratch / 2, SG_TEST_REGION_MAX);
+    PSPADDR PspAddrSg = ConnResp.PspAddrScratch;
+    PSPADDR PspAddrRef = ConnResp.PspAddrScratch + cbRegion;
+    static uint8_t s_abRegionSg[SG_TEST_REGION_MAX];
+    static uint8_t s_abRegionRef[SG_TEST_REGION_MAX];
+    static SGTESTOP s_aOps[SG_TEST_DESCS_MAX];
+    static SGTESTRES s_ResSg;
+    static SGTESTRES s_ResRef;
+
+    for (size_t off = 0; off < cbRegion; off++)
+        s_abRegionSg[off] = (uint8_t)sgTestRand(256);
+
+    rc = sgTestPspMemXfer(&s_Test, PspAddrSg, &s_abRegionSg[0], cbRegion, true /*fWrite*/);
+    if (!rc)
+        rc = sgTestPspMemXfer(&s_Test, PspAddrRef, &s_abRegionSg[0], cbRegion, true /*fWrite*/);
+
+    uint32_t cDescs = 0;
+    uint32_t cFailed = 0;
+    bool fMismatch = false;
+    for (uint32_t i = 0; i < cLists && !rc && !fMismatch; i++)
+    {
+        uint32_t cOps = sgTestListGen(&s_aOps[0], cbRegion, cFailEvery && !(i % cFailEvery));
+
+        memset(&s_ResSg, 0, sizeof(s_ResSg));
+        memset(&s_ResRef, 0, sizeof(s_ResRef));
+        rc = sgTestListExecSg(&s_Test, &s_aOps[0], cOps, PspAddrSg, &s_ResSg);
+        if (!rc)
+            rc = sgTestListExecSingle(&s_Test, &s_aOps[0], cOps, PspAddrRef, &s_ResRef);
+        if (!rc)
+            rc = sgTestPspMemXfer(&s_Test, PspAddrSg, &s_abRegionSg[0], cbRegion, false /*fWrite*/);
+        if (!rc)
+            rc = sgTestPspMemXfer(&s_Test, PspAddrRef, &s_abRegionRef[0], cbRegion, false /*fWrite*/);
+        if (rc)
+            break;
+
+        if (!sgTestResCompare(&s_aOps[0], &s_ResSg, &s_ResRef, i))
+            fMismatch = true;
+        else if (memcmp(&s_abRegionSg[0], &s_abRegionRef[0], cbRegion))
+        {
+            fprintf(stderr, "data-xfer-sg-test: List %u left different memory content behind\n", i);
+            fMismatch = true;
+        }
+
+        cDescs  += s_ResSg.cDescsDone;
+        cFailed += s_ResSg.rcReq != STS_INF_SUCCESS ? 1 : 0;
+    }
+
+    if (rc)
+        fprintf(stderr, "data-xfer-sg-test: Talking to the stub failed with %d\n", rc);
+
+    printf("Lists:              %u (%u stopped at a failing descriptor)\n", cLists, cFailed);
+    printf("Descriptors:        %u completed\n", cDescs);
+    printf("Result:             %s\n", rc || fMismatch ? "MISMATCH" : "OK");
+
+    close(s_Test.iFd);
+    return rc || fMismatch ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/** @file
+ * PSP link simulator - SPI master and Dediprog EM100 u/dFIFO model.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <common/cdefs.h>
+
+#include "linksim.h"
+
+#include "../../Lib/include/err.h"
+
+
+/*
+ * Must match PspSerialStub/pdu-transp-spi-em100.c.
+ */
+#define LINKSIM_SPI_MASTER_SMN_ADDR     0x02dc4000
+#define LINKSIM_SPI_MASTER_SZ           0x100
+#define PSP_SPI_MASTER_CMD_TRIG         0x47
+# define PSP_SPI_MASTER_CMD_TRIG_BIT    BIT(7)
+#define PSP_SPI_MASTER_TX_CNT           0x48
+#define PSP_SPI_MASTER_RX_CNT           0x4b
+#define PSP_SPI_MASTER_STATUS           0x4c
+# define PSP_SPI_MASTER_STATUS_BSY      BIT(31)
+#define PSP_SPI_FIFO_START              0x80
+
+/** FIFO sizes of the EM100. */
+#define EM100_UFIFO_SZ                  512
+#define EM100_DFIFO_SZ                  64
+/** EM100 hardware identifier returned in register 3. */
+#define EM100_ID                        0xaa
+/** Default SPI bus bandwidth (the transport programs 800kHz). */
+#define LINKSIM_EM100_BW_DEF            (800 * 1000 / 8)
+
+
+/**
+ * SPI master and EM100 model state.
+ */
+typedef struct LINKSIMEM100
+{
+    /** The simulation parameters. */
+    PCLINKSIMCFG                pCfg;
+    /** SPI bus bandwidth in bytes per second. */
+    uint64_t                    cbPerSec;
+    /** SPI master register file (including the FIFO). */
+    uint8_t                     abRegs[LINKSIM_SPI_MASTER_SZ];
+    /** When the current SPI transaction finishes. */
+    uint64_t                    tsBusy;
+    /** Upload FIFO (PSP to host). */
+    uint8_t                     abUFifo[EM100_UFIFO_SZ];
+    /** Number of bytes in the upload FIFO. */
+    uint32_t                    cbUFifo;
+    /** Download FIFO (host to PSP). */
+    uint8_t                     abDFifo[EM100_DFIFO_SZ];
+    /** Number of bytes in the download FIFO. */
+    uint32_t                    cbDFifo;
+    /** Flag whether the PSP acknowledged the last dFIFO chunk. */
+    bool                        fDFifoAcked;
+    /** When the host polls the EM100 the next time. */
+    uint64_t                    tsHostPoll;
+    /** Number of SPI transactions. */
+    uint64_t                    cXacts;
+    /** Number of bytes dropped because the upload FIFO was full. */
+    uint64_t                    cbUFifoDropped;
+    /** Number of malformed upload FIFO packets seen by the host. */
+    uint64_t                    cUFifoMalformed;
+} LINKSIMEM100;
+
+
+/** The EM100 model instance. */
+static LINKSIMEM100 g_Em100;
+
+
+/**
+ * Returns the content of the given EM100 register.
+ *
+ * @returns Register value.
+ * @param   pThis               The EM100 model.
+ * @param   idxReg              The register index.
+ */
+static uint8_t linkSimEm100RegRead(LINKSIMEM100 *pThis, uint8_t idxReg)
+{
+    switch (idxReg)
+    {
+        case 0:
+        {
+            /* Bit 5/6 indicate an empty u/dFIFO, bit 1/3 are the 9th bits of the lengths. */
+            uint8_t bMain = 0;
+            if (!pThis->cbUFifo)
+                bMain |= BIT(5);
+            if (!pThis->cbDFifo)
+                bMain |= BIT(6);
+            if (pThis->cbUFifo & BIT(8))
+                bMain |= BIT(1);
+            if (pThis->cbDFifo & BIT(8))
+                bMain |= BIT(3);
+            return bMain;
+        }
+        case 1:
+            return (uint8_t)pThis->cbUFifo;
+        case 2:
+            return (uint8_t)pThis->cbDFifo;
+        case 3:
+            return EM100_ID;
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * Executes the SPI transaction set up in the SPI master.
+ *
+ * @returns nothing.
+ * @param   pThis               The EM100 model.
+ */
+static void linkSimEm100Xact(LINKSIMEM100 *pThis)
+{
+    uint8_t *pbFifo = &pThis->abRegs[PSP_SPI_FIFO_START];
+    uint32_t cbTx = pThis->abRegs[PSP_SPI_MASTER_TX_CNT];
+    uint32_t cbRx = pThis->abRegs[PSP_SPI_MASTER_RX_CNT];
+
+    pThis->cXacts++;
+    pThis->tsBusy = linkSimNanoTS() + linkSimXferNs(1 + cbTx + cbRx, pThis->cbPerSec);
+
+    /* Received data follows the transmitted bytes in the FIFO, the EM100 clocks out a dummy byte after the command. */
+    uint8_t *pbRx = pbFifo + cbTx;
+    if (cbTx < 2 || cbTx + cbRx > LINKSIM_SPI_MASTER_SZ - PSP_SPI_FIFO_START)
+        return;
+
+    switch (pbFifo[1] & 0xf0)
+    {
+        case 0xa0: /* Register write, nothing of interest for the channel. */
+            break;
+        case 0xb0: /* Register read. */
+            if (cbRx >= 2)
+                pbRx[1] = linkSimEm100RegRead(pThis, pbFifo[1] & 0xf);
+            break;
+        case 0xc0: /* uFIFO write. */
+        {
+            uint32_t cbWrite = cbTx - 2;
+            uint32_t cbThis = MIN(cbWrite, EM100_UFIFO_SZ - pThis->cbUFifo);
+
+            memcpy(&pThis->abUFifo[pThis->cbUFifo], &pbFifo[2], cbThis);
+            pThis->cbUFifo        += cbThis;
+            pThis->cbUFifoDropped += cbWrite - cbThis;
+            break;
+        }
+        case 0xd0: /* dFIFO read, the dummy byte is part of the command here, the dFIFO is cleared afterwards. */
+        {
+            memset(pbRx, 0, cbRx);
+            memcpy(pbRx, &pThis->abDFifo[0], MIN(cbRx, pThis->cbDFifo));
+            pThis->cbDFifo = 0;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+
+static int linkSimEm100Init(PCLINKSIMCFG pCfg)
+{
+    LINKSIMEM100 *pThis = &g_Em100;
+
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pCfg        = pCfg;
+    pThis->cbPerSec    = pCfg->cbPerSecLink ? pCfg->cbPerSecLink : LINKSIM_EM100_BW_DEF;
+    pThis->fDFifoAcked = true;
+    return INF_SUCCESS;
+}
+
+
+static void linkSimEm100Read(uint64_t off, void *pvBuf, size_t cb)
+{
+    LINKSIMEM100 *pThis = &g_Em100;
+
+    if (   off == PSP_SPI_MASTER_STATUS
+        && cb == sizeof(uint32_t))
+    {
+        uint32_t u32Sts = linkSimNanoTS() < pThis->tsBusy ? PSP_SPI_MASTER_STATUS_BSY : 0;
+        memcpy(pvBuf, &u32Sts, sizeof(u32Sts));
+    }
+    else
+        memcpy(pvBuf, &pThis->abRegs[off], cb);
+}
+
+
+static void linkSimEm100Write(uint64_t off, const void *pvBuf, size_t cb)
+{
+    LINKSIMEM100 *pThis = &g_Em100;
+
+    memcpy(&pThis->abRegs[off], pvBuf, cb);
+    if (   off == PSP_SPI_MASTER_CMD_TRIG
+        && (pThis->abRegs[off] & PSP_SPI_MASTER_CMD_TRIG_BIT))
+    {
+        pThis->abRegs[off] &= ~PSP_SPI_MASTER_CMD_TRIG_BIT;
+        linkSimEm100Xact(pThis);
+    }
+}
+
+
+static void linkSimEm100Poll(uint64_t tsNow)
+{
+    LINKSIMEM100 *pThis = &g_Em100;
+
+    /* The host polls the EM100 over USB periodically. */
+    if (tsNow < pThis->tsHostPoll)
+        return;
+    pThis->tsHostPoll = tsNow + pThis->pCfg->cUsPeer * 1000;
+
+    /* Drain the uFIFO, it contains data packets (0xef <len> <data>) and dFIFO acknowledges (0xdf). */
+    uint32_t off = 0;
+    while (off < pThis->cbUFifo)
+    {
+        uint8_t bType = pThis->abUFifo[off];
+        if (bType == 0xdf)
+        {
+            pThis->fDFifoAcked = true;
+            off++;
+        }
+        else if (   bType == 0xef
+                 && off + 1 < pThis->cbUFifo
+                 && off + 2 + pThis->abUFifo[off + 1] <= pThis->cbUFifo)
+        {
+            linkSimPeerRecv(&pThis->abUFifo[off + 2], pThis->abUFifo[off + 1]);
+            off += 2 + pThis->abUFifo[off + 1];
+        }
+        else
+        {
+            pThis->cUFifoMalformed++;
+            off = pThis->cbUFifo;
+        }
+    }
+    pThis->cbUFifo = 0;
+
+    /* Refill the dFIFO once the PSP fetched the previous chunk. */
+    if (   pThis->fDFifoAcked
+        && !pThis->cbDFifo
+        && linkSimPeerSendReadyTs() <= tsNow)
+    {
+        pThis->cbDFifo     = (uint32_t)linkSimPeerSend(&pThis->abDFifo[0], EM100_DFIFO_SZ);
+        pThis->fDFifoAcked = false;
+    }
+}
+
+
+static void linkSimEm100DumpStats(void)
+{
+    LINKSIMEM100 *pThis = &g_Em100;
+
+    printf("SPI transactions:   %llu\n", (unsigned long long)pThis->cXacts);
+    printf("uFIFO dropped:      %llu bytes\n", (unsigned long long)pThis->cbUFifoDropped);
+    printf("uFIFO malformed:    %llu\n", (unsigned long long)pThis->cUFifoMalformed);
+}
+
+
+const LINKSIMDEVREG g_LinkSimDevEm100 =
+{
+    /** pszName */
+    "em100",
+    /** pszDesc */
+    "Dediprog EM100 u/dFIFO behind the SPI master, bandwidth is the SPI bus speed (default 800kHz)",
+    /** pIfTransp */
+    &g_SpiFlashTranspEm100,
+    /** enmAddrSpace */
+    LINKSIMADDRSPACE_SMN,
+    /** AddrStart */
+    LINKSIM_SPI_MASTER_SMN_ADDR,
+    /** cbRange */
+    LINKSIM_SPI_MASTER_SZ,
+    /** pfnInit */
+    linkSimEm100Init,
+    /** pfnRead */
+    linkSimEm100Read,
+    /** pfnWrite */
+    linkSimEm100Write,
+    /** pfnPoll */
+    linkSimEm100Poll,
+    /** pfnDumpStats */
+    linkSimEm100DumpStats
+};
@@ -0,0 +1,240 @@
+/** @file
+ * PSP link simulator - SPI flash message channel model (flash emulator on the other end).
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/cdefs.h>
+
+#include "linksim.h"
+
+#include "../../Lib/include/err.h"
+
+
+/*
+ * Must match the layout in PspSerialStub/pdu-transp-spi-flash.c.
+ */
+#define LINKSIM_SPI_FLASH_SMN_ADDR      0x0a000000
+#define LINKSIM_SPI_FLASH_SZ            (16 * 1024 * 1024)
+
+#define SPI_MSG_CHAN_HDR_OFF            0xaab000
+#define SPI_MSG_CHAN_AVAIL_OFF          0xaaa000
+#define SPI_MSG_CHAN_AVAIL_F_OFF        0xaac000
+#define SPI_MSG_CHAN_STS_OFF            0xaad000
+#define SPI_FLASH_LOCK_OFF              0xaa0000
+#define SPI_FLASH_LOCK_UNLOCK_REQ_MAGIC 0x19570528
+#define SPI_FLASH_LOCK_UNLOCKED_MAGIC   0x18280208
+#define SPI_FLASH_LOCK_LOCK_REQ_MAGIC   0x19380110
+#define SPI_FLASH_LOCK_LOCKED_MAGIC     0x18990223
+#define SPI_MSG_CHAN_AVAIL_MAGIC        0x19640522
+
+/** Maximum number of bytes the emulator posts at once. */
+#define LINKSIM_SPI_FLASH_POST_MAX      256
+/** Default SPI bus bandwidth (33MHz single I/O). */
+#define LINKSIM_SPI_FLASH_BW_DEF        (33 * 1000 * 1000 / 8)
+
+
+/**
+ * SPI flash model state.
+ */
+typedef struct LINKSIMSPIFLASH
+{
+    /** The simulation parameters. */
+    PCLINKSIMCFG                pCfg;
+    /** Bus bandwidth in bytes per second. */
+    uint64_t                    cbPerSec;
+    /** The flash content. */
+    uint8_t                     *pbFlash;
+    /** Pending lock/unlock request magic, 0 if none. */
+    uint32_t                    u32LockReq;
+    /** When the emulator sees the lock request. */
+    uint64_t                    tsLockReq;
+    /** Flag whether the PSP holds the lock. */
+    bool                        fLocked;
+    /** Number of bytes posted for the PSP at the message channel header offset. */
+    uint32_t                    cbPosted;
+    /** Number of lock handshakes. */
+    uint64_t                    cLockHandshakes;
+    /** Number of message channel writes outside of the lock. */
+    uint64_t                    cUnlockedWrites;
+    /** Number of status writes. */
+    uint64_t                    cStsWrites;
+} LINKSIMSPIFLASH;
+
+
+/** The SPI flash model instance. */
+static LINKSIMSPIFLASH g_SpiFlash;
+
+
+/**
+ * Stores a 32bit value in the flash content.
+ *
+ * @returns nothing.
+ * @param   pThis               The SPI flash model.
+ * @param   off                 Offset to store the value at.
+ * @param   u32Val              The value to store.
+ */
+static void linkSimSpiFlashStoreU32(LINKSIMSPIFLASH *pThis, uint32_t off, uint32_t u32Val)
+{
+    memcpy(&pThis->pbFlash[off], &u32Val, sizeof(u32Val));
+}
+
+
+static int linkSimSpiFlashInit(PCLINKSIMCFG pCfg)
+{
+    LINKSIMSPIFLASH *pThis = &g_SpiFlash;
+
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pCfg     = pCfg;
+    pThis->cbPerSec = pCfg->cbPerSecLink ? pCfg->cbPerSecLink : LINKSIM_SPI_FLASH_BW_DEF;
+    pThis->pbFlash  = (uint8_t *)calloc(1, LINKSIM_SPI_FLASH_SZ);
+    if (!pThis->pbFlash)
+        return ERR_INVALID_STATE;
+
+    linkSimSpiFlashStoreU32(pThis, SPI_FLASH_LOCK_OFF, SPI_FLASH_LOCK_UNLOCKED_MAGIC);
+    return INF_SUCCESS;
+}
+
+
+static void linkSimSpiFlashRead(uint64_t off, void *pvBuf, size_t cb)
+{
+    LINKSIMSPIFLASH *pThis = &g_SpiFlash;
+
+    /* Command, address and dummy cycles followed by the data. */
+    linkSimBusy(linkSimXferNs(5 + cb, pThis->cbPerSec));
+    memcpy(pvBuf, &pThis->pbFlash[off], cb);
+}
+
+
+static void linkSimSpiFlashWrite(uint64_t off, const void *pvBuf, size_t cb)
+{
+    LINKSIMSPIFLASH *pThis = &g_SpiFlash;
+    uint32_t u32Val = 0;
+
+    linkSimBusy(linkSimXferNs(4 + cb, pThis->cbPerSec));
+    memcpy(&u32Val, pvBuf, MIN(cb, sizeof(u32Val)));
+
+    /* The emulator captures the writes, they never change the flash content. */
+    if (   off >= SPI_MSG_CHAN_HDR_OFF
+        && off < SPI_MSG_CHAN_HDR_OFF + LINKSIM_SPI_FLASH_POST_MAX)
+    {
+        /* The PSP writes the data in dword sized pieces to consecutive addresses. */
+        if (pThis->fLocked)
+            linkSimPeerRecv(pvBuf, cb);
+        else
+            pThis->cUnlockedWrites++;
+        return;
+    }
+
+    switch (off)
+    {
+        case SPI_FLASH_LOCK_OFF:
+            if (   u32Val == SPI_FLASH_LOCK_LOCK_REQ_MAGIC
+                || u32Val == SPI_FLASH_LOCK_UNLOCK_REQ_MAGIC)
+            {
+                pThis->u32LockReq = u32Val;
+                pThis->tsLockReq  = linkSimNanoTS() + pThis->pCfg->cUsPeer * 1000;
+            }
+            break;
+        case SPI_MSG_CHAN_AVAIL_OFF:
+        {
+            /* The PSP acknowledges the bytes it consumed. */
+            uint32_t cbConsumed = MIN(u32Val, pThis->cbPosted);
+
+            pThis->cbPosted -= cbConsumed;
+            memmove(&pThis->pbFlash[SPI_MSG_CHAN_HDR_OFF], &pThis->pbFlash[SPI_MSG_CHAN_HDR_OFF + cbConsumed], pThis->cbPosted);
+            linkSimSpiFlashStoreU32(pThis, SPI_MSG_CHAN_AVAIL_OFF, pThis->cbPosted);
+            if (!pThis->cbPosted)
+                linkSimSpiFlashStoreU32(pThis, SPI_MSG_CHAN_AVAIL_F_OFF, 0);
+            break;
+        }
+        case SPI_MSG_CHAN_STS_OFF:
+            pThis->cStsWrites++;
+            break;
+        default:
+            break;
+    }
+}
+
+
+static void linkSimSpiFlashPoll(uint64_t tsNow)
+{
+    LINKSIMSPIFLASH *pThis = &g_SpiFlash;
+
+    if (   pThis->u32LockReq
+        && tsNow >= pThis->tsLockReq)
+    {
+        pThis->fLocked = pThis->u32LockReq == SPI_FLASH_LOCK_LOCK_REQ_MAGIC;
+        linkSimSpiFlashStoreU32(pThis, SPI_FLASH_LOCK_OFF,
+                                pThis->fLocked ? SPI_FLASH_LOCK_LOCKED_MAGIC : SPI_FLASH_LOCK_UNLOCKED_MAGIC);
+        pThis->u32LockReq = 0;
+        pThis->cLockHandshakes++;
+    }
+
+    /* The emulator only updates the message channel while the PSP doesn't hold the lock. */
+    if (   !pThis->fLocked
+        && !pThis->u32LockReq
+        && !pThis->cbPosted
+        && linkSimPeerSendReadyTs() <= tsNow)
+    {
+        pThis->cbPosted = linkSimPeerSend(&pThis->pbFlash[SPI_MSG_CHAN_HDR_OFF], LINKSIM_SPI_FLASH_POST_MAX);
+        linkSimSpiFlashStoreU32(pThis, SPI_MSG_CHAN_AVAIL_OFF, pThis->cbPosted);
+        linkSimSpiFlashStoreU32(pThis, SPI_MSG_CHAN_AVAIL_F_OFF, SPI_MSG_CHAN_AVAIL_MAGIC);
+    }
+}
+
+
+static void linkSimSpiFlashDumpStats(void)
+{
+    LINKSIMSPIFLASH *pThis = &g_SpiFlash;
+
+    printf("Lock handshakes:    %llu\n", (unsigned long long)pThis->cLockHandshakes);
+    printf("Unlocked writes:    %llu\n", (unsigned long long)pThis->cUnlockedWrites);
+    printf("Status writes:      %llu\n", (unsigned long long)pThis->cStsWrites);
+}
+
+
+const LINKSIMDEVREG g_LinkSimDevSpiFlash =
+{
+    /** pszName */
+    "spi-flash",
+    /** pszDesc */
+    "SPI flash message channel, bandwidth is the SPI bus speed (default 33MHz)",
+    /** pIfTransp */
+    &g_SpiFlashTransp,
+    /** enmAddrSpace */
+    LINKSIMADDRSPACE_SMN,
+    /** AddrStart */
+    LINKSIM_SPI_FLASH_SMN_ADDR,
+    /** cbRange */
+    LINKSIM_SPI_FLASH_SZ,
+    /** pfnInit */
+    linkSimSpiFlashInit,
+    /** pfnRead */
+    linkSimSpiFlashRead,
+    /** pfnWrite */
+    linkSimSpiFlashWrite,
+    /** pfnPoll */
+    linkSimSpiFlashPoll,
+    /** pfnDumpStats */
+    linkSimSpiFlashDumpStats
+};
@@ -0,0 +1,302 @@
+/** @file
+ * PSP link simulator - 16550 compatible UART model.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include <common/cdefs.h>
+
+#include "linksim.h"
+
+#include "../../Lib/include/err.h"
+
+
+/** x86 address of the UART used by the transport channel (lower 32bits). */
+#define LINKSIM_UART_ADDR               0xfc0003f8
+
+#define LINKSIM_UART_REG_RBR_THR        0
+#define LINKSIM_UART_REG_IER            1
+#define LINKSIM_UART_REG_FCR_IIR        2
+#define LINKSIM_UART_REG_LCR            3
+# define LINKSIM_UART_REG_LCR_DLAB      BIT(7)
+#define LINKSIM_UART_REG_MCR            4
+#define LINKSIM_UART_REG_LSR            5
+# define LINKSIM_UART_REG_LSR_DR        BIT(0)
+# define LINKSIM_UART_REG_LSR_OE        BIT(1)
+# define LINKSIM_UART_REG_LSR_THRE      BIT(5)
+# define LINKSIM_UART_REG_LSR_TEMT      BIT(6)
+#define LINKSIM_UART_REG_MSR            6
+#define LINKSIM_UART_REG_SCR            7
+
+/** Receive FIFO size when enabled. */
+#define LINKSIM_UART_FIFO_SZ            16
+
+
+/**
+ * UART model state.
+ */
+typedef struct LINKSIMUART
+{
+    /** The simulation parameters. */
+    PCLINKSIMCFG                pCfg;
+    /** Plain registers without side effects. */
+    uint8_t                     abRegs[8];
+    /** The divisor latch. */
+    uint16_t                    u16Divisor;
+    /** Time to transfer a single character in nanoseconds. */
+    uint64_t                    cNsChar;
+    /** Receive FIFO. */
+    uint8_t                     abRxFifo[LINKSIM_UART_FIFO_SZ];
+    /** Number of bytes in the receive FIFO. */
+    uint32_t                    cbRxFifo;
+    /** Read index into the receive FIFO. */
+    uint32_t                    idxRxFifo;
+    /** Flag whether an overrun occurred since the last LSR read. */
+    bool                        fOverrun;
+    /** Flag whether a byte is currently on the wire to the PSP. */
+    bool                        fRxInFlight;
+    /** The byte on the wire to the PSP. */
+    uint8_t                     bRxInFlight;
+    /** When the byte on the wire to the PSP arrives. */
+    uint64_t                    tsRxArrive;
+    /** When the receive line gets idle. */
+    uint64_t                    tsRxLineFree;
+    /** Flag whether a byte is currently on the wire to the host. */
+    bool                        fTxInFlight;
+    /** The byte on the wire to the host. */
+    uint8_t                     bTxInFlight;
+    /** When the transmit line gets idle (and the byte on the wire arrives at the host). */
+    uint64_t                    tsTxLineFree;
+    /** Number of bytes lost because the receive FIFO was full. */
+    uint64_t                    cRxOverruns;
+    /** Number of bytes written while the transmitter was still busy. */
+    uint64_t                    cTxOverruns;
+} LINKSIMUART;
+
+
+/** The UART model instance. */
+static LINKSIMUART g_Uart;
+
+
+/**
+ * Recalculates the character time after the divisor or configuration changed.
+ *
+ * @returns nothing.
+ * @param   pThis               The UART model.
+ */
+static void linkSimUartCharTimeUpdate(LINKSIMUART *pThis)
+{
+    /* 8N1 gives 10 bits per character, the UART is clocked at 1.8432MHz (115200 baud with a divisor of 1). */
+    if (pThis->pCfg->cbPerSecLink)
+        pThis->cNsChar = linkSimXferNs(1, pThis->pCfg->cbPerSecLink);
+    else
+        pThis->cNsChar = linkSimXferNs(1, 115200 / 10 / MAX(pThis->u16Divisor, 1));
+}
+
+
+static int linkSimUartInit(PCLINKSIMCFG pCfg)
+{
+    LINKSIMUART *pThis = &g_Uart;
+
+    memset(pThis, 0, sizeof(*pThis));
+    pThis->pCfg       = pCfg;
+    pThis->u16Divisor = 1;
+    linkSimUartCharTimeUpdate(pThis);
+    return INF_SUCCESS;
+}
+
+
+static void linkSimUartRead(uint64_t off, void *pvBuf, size_t cb)
+{
+    LINKSIMUART *pThis = &g_Uart;
+    uint8_t *pbBuf = (uint8_t *)pvBuf;
+    uint64_t tsNow = linkSimNanoTS();
+
+    memset(pvBuf, 0xff, cb);
+    if (cb != 1)
+        return;
+
+    if (pThis->abRegs[LINKSIM_UART_REG_LCR] & LINKSIM_UART_REG_LCR_DLAB && off <= 1)
+    {
+        *pbBuf = (uint8_t)(pThis->u16Divisor >> (off * 8));
+        return;
+    }
+
+    switch (off)
+    {
+        case LINKSIM_UART_REG_RBR_THR:
+        {
+            if (pThis->cbRxFifo)
+            {
+                *pbBuf = pThis->abRxFifo[pThis->idxRxFifo];
+                pThis->idxRxFifo = (pThis->idxRxFifo + 1) % LINKSIM_UART_FIFO_SZ;
+                pThis->cbRxFifo--;
+            }
+            else
+                *pbBuf = 0;
+            break;
+        }
+        case LINKSIM_UART_REG_FCR_IIR:
+        {
+            *pbBuf = 0x01; /* No interrupt pending. */
+            if (pThis->abRegs[LINKSIM_UART_REG_FCR_IIR] & BIT(0))
+                *pbBuf |= 0xc0;
+            break;
+        }
+        case LINKSIM_UART_REG_LSR:
+        {
+            uint8_t bLsr = 0;
+            if (pThis->cbRxFifo)
+                bLsr |= LINKSIM_UART_REG_LSR_DR;
+            if (pThis->fOverrun)
+                bLsr |= LINKSIM_UART_REG_LSR_OE;
+            if (tsNow >= pThis->tsTxLineFree)
+                bLsr |= LINKSIM_UART_REG_LSR_THRE | LINKSIM_UART_REG_LSR_TEMT;
+            pThis->fOverrun = false;
+            *pbBuf = bLsr;
+            break;
+        }
+        case LINKSIM_UART_REG_MSR:
+            *pbBuf = 0xb0; /* CTS, DSR and DCD asserted. */
+            break;
+        default:
+            *pbBuf = pThis->abRegs[off];
+    }
+}
+
+
+static void linkSimUartWrite(uint64_t off, const void *pvBuf, size_t cb)
+{
+    LINKSIMUART *pThis = &g_Uart;
+    uint8_t bVal = *(const uint8_t *)pvBuf;
+    uint64_t tsNow = linkSimNanoTS();
+
+    if (cb != 1)
+        return;
+
+    if (pThis->abRegs[LINKSIM_UART_REG_LCR] & LINKSIM_UART_REG_LCR_DLAB && off <= 1)
+    {
+        if (off == 0)
+            pThis->u16Divisor = (pThis->u16Divisor & 0xff00) | bVal;
+        else
+            pThis->u16Divisor = (pThis->u16Divisor & 0x00ff) | ((uint16_t)bVal << 8);
+        linkSimUartCharTimeUpdate(pThis);
+        return;
+    }
+
+    if (off == LINKSIM_UART_REG_RBR_THR)
+    {
+        if (tsNow < pThis->tsTxLineFree)
+            pThis->cTxOverruns++;
+        else
+        {
+            /* Deliver the previous character if the model wasn't polled in between. */
+            if (pThis->fTxInFlight)
+                linkSimPeerRecv(&pThis->bTxInFlight, 1);
+            pThis->bTxInFlight  = bVal;
+            pThis->fTxInFlight  = true;
+            pThis->tsTxLineFree = tsNow + pThis->cNsChar;
+        }
+    }
+    else
+        pThis->abRegs[off] = bVal;
+}
+
+
+static void linkSimUartPoll(uint64_t tsNow)
+{
+    LINKSIMUART *pThis = &g_Uart;
+
+    if (   pThis->fTxInFlight
+        && tsNow >= pThis->tsTxLineFree)
+    {
+        linkSimPeerRecv(&pThis->bTxInFlight, 1);
+        pThis->fTxInFlight = false;
+    }
+
+    for (;;)
+    {
+        if (pThis->fRxInFlight)
+        {
+            if (pThis->tsRxArrive > tsNow)
+                break;
+
+            uint32_t cbFifo = pThis->abRegs[LINKSIM_UART_REG_FCR_IIR] & BIT(0) ? LINKSIM_UART_FIFO_SZ : 1;
+            if (pThis->cbRxFifo < cbFifo)
+            {
+                pThis->abRxFifo[(pThis->idxRxFifo + pThis->cbRxFifo) % LINKSIM_UART_FIFO_SZ] = pThis->bRxInFlight;
+                pThis->cbRxFifo++;
+            }
+            else
+            {
+                pThis->fOverrun = true;
+                pThis->cRxOverruns++;
+            }
+
+            pThis->fRxInFlight  = false;
+            pThis->tsRxLineFree = pThis->tsRxArrive;
+        }
+
+        uint64_t tsReady = linkSimPeerSendReadyTs();
+        if (tsReady > tsNow)
+            break;
+
+        linkSimPeerSend(&pThis->bRxInFlight, 1);
+        pThis->fRxInFlight = true;
+        pThis->tsRxArrive  = MAX(pThis->tsRxLineFree, tsReady) + pThis->cNsChar;
+    }
+}
+
+
+static void linkSimUartDumpStats(void)
+{
+    LINKSIMUART *pThis = &g_Uart;
+
+    printf("UART RX overruns:   %llu\n", (unsigned long long)pThis->cRxOverruns);
+    printf("UART TX overruns:   %llu\n", (unsigned long long)pThis->cTxOverruns);
+}
+
+
+const LINKSIMDEVREG g_LinkSimDevUart =
+{
+    /** pszName */
+    "uart",
+    /** pszDesc */
+    "x86 16550 UART, bandwidth defaults to the programmed baud rate",
+    /** pIfTransp */
+    &g_UartTransp,
+    /** enmAddrSpace */
+    LINKSIMADDRSPACE_X86,
+    /** AddrStart */
+    LINKSIM_UART_ADDR,
+    /** cbRange */
+    8,
+    /** pfnInit */
+    linkSimUartInit,
+    /** pfnRead */
+    linkSimUartRead,
+    /** pfnWrite */
+    linkSimUartWrite,
+    /** pfnPoll */
+    linkSimUartPoll,
+    /** pfnDumpStats */
+    linkSimUartDumpStats
+};
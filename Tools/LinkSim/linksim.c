@@ -0,0 +1,460 @@
+/** @file
+ * PSP link simulator - Core, runs the real PDU transport channels against device models on a Linux host.
+ *
+ * The transport channels are compiled with PSP_MMIO_HOOKS defined so every device access ends up in
+ * pspMmio*() below which dispatches it to the selected device model. The model also plays the
+ * other end of the link (x86 host or flash emulator) which echoes every chunk it receives.
+ * Time is simulated, every device access costs a fixed latency, so results are reproducible
+ * and independent of the host.
+ *
+ * Usage: linksim --transp <uart|spi-flash|em100> [--size <bytes>] [--chunk <bytes>]
+ *                [--latency-ns <ns>] [--bandwidth <bytes/s>] [--peer-latency-us <us>]
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include <common/cdefs.h>
+
+#include "linksim.h"
+
+#include "../../Lib/include/err.h"
+#include "../../Lib/include/mmio.h"
+#include "../../PspSerialStub/psp-serial-stub-internal.h"
+
+
+/** Size of the address space reservations (we only care about 32bit addresses). */
+#define LINKSIM_ADDR_SPACE_SZ           (UINT64_C(4) * 1024 * 1024 * 1024)
+
+
+/**
+ * The peer at the other end of the link, echoes every chunk received.
+ */
+typedef struct LINKSIMPEER
+{
+    /** Chunk size. */
+    size_t                      cbChunk;
+    /** Receive buffer. */
+    uint8_t                     *pbRecv;
+    /** Number of bytes received in the current chunk. */
+    size_t                      cbRecv;
+    /** Send buffer. */
+    uint8_t                     *pbSend;
+    /** Number of bytes left to send. */
+    size_t                      cbSend;
+    /** Offset into the send buffer. */
+    size_t                      offSend;
+    /** Timestamp from which on the peer starts sending. */
+    uint64_t                    tsSendReady;
+    /** Number of bytes dropped because the peer was still busy sending. */
+    uint64_t                    cbDropped;
+} LINKSIMPEER;
+
+
+/** Available device models. */
+static PCLINKSIMDEVREG g_apDevs[] =
+{
+    &g_LinkSimDevUart,
+    &g_LinkSimDevSpiFlash,
+    &g_LinkSimDevEm100
+};
+
+/** The selected device model. */
+static PCLINKSIMDEVREG g_pDev = NULL;
+/** The simulation parameters. */
+static LINKSIMCFG g_Cfg;
+/** The peer. */
+static LINKSIMPEER g_Peer;
+/** SMN address space reservation. */
+static uint8_t *g_pbSmn = NULL;
+/** x86 address space reservation. */
+static uint8_t *g_pbX86 = NULL;
+/** The simulated time in nanoseconds, only advanced by device accesses and delays so host
+ * scheduling doesn't influence the results. */
+static uint64_t g_tsVirt = 0;
+/** Number of device accesses. */
+static uint64_t g_cAccesses = 0;
+
+
+uint64_t linkSimNanoTS(void)
+{
+    return g_tsVirt;
+}
+
+
+void linkSimBusy(uint64_t cNs)
+{
+    /* Nothing on the PSP side happens while spinning, so jump straight to the end and let the model catch up. */
+    g_tsVirt += cNs;
+    g_pDev->pfnPoll(g_tsVirt);
+}
+
+
+uint64_t linkSimXferNs(size_t cb, uint64_t cbPerSec)
+{
+    return cbPerSec ? (uint64_t)cb * UINT64_C(1000000000) / cbPerSec : 0;
+}
+
+
+void linkSimPeerRecv(const void *pvBuf, size_t cb)
+{
+    PLINKSIMCFG pCfg = &g_Cfg;
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+
+    while (cb)
+    {
+        size_t cbThis = MIN(cb, g_Peer.cbChunk - g_Peer.cbRecv);
+
+        memcpy(&g_Peer.pbRecv[g_Peer.cbRecv], pbBuf, cbThis);
+        g_Peer.cbRecv += cbThis;
+        pbBuf         += cbThis;
+        cb            -= cbThis;
+
+        if (g_Peer.cbRecv == g_Peer.cbChunk)
+        {
+            if (!g_Peer.cbSend)
+            {
+                memcpy(g_Peer.pbSend, g_Peer.pbRecv, g_Peer.cbChunk);
+                g_Peer.cbSend      = g_Peer.cbChunk;
+                g_Peer.offSend     = 0;
+                g_Peer.tsSendReady = linkSimNanoTS() + pCfg->cUsPeer * 1000;
+            }
+            else
+                g_Peer.cbDropped += g_Peer.cbChunk;
+            g_Peer.cbRecv = 0;
+        }
+    }
+}
+
+
+uint64_t linkSimPeerSendReadyTs(void)
+{
+    return g_Peer.cbSend ? g_Peer.tsSendReady : UINT64_MAX;
+}
+
+
+size_t linkSimPeerSend(void *pvBuf, size_t cbMax)
+{
+    size_t cbThis = MIN(cbMax, g_Peer.cbSend);
+
+    memcpy(pvBuf, &g_Peer.pbSend[g_Peer.offSend], cbThis);
+    g_Peer.offSend += cbThis;
+    g_Peer.cbSend  -= cbThis;
+    return cbThis;
+}
+
+
+/**
+ * Resolves the given pointer to the device model offset.
+ *
+ * @returns Offset into the device range, aborts if the access doesn't hit the device.
+ * @param   pv                  The pointer being accessed.
+ * @param   cb                  Size of the access.
+ */
+static uint64_t linkSimAccessResolve(volatile const void *pv, size_t cb)
+{
+    uint8_t *pbBase = g_pDev->enmAddrSpace == LINKSIMADDRSPACE_SMN ? g_pbSmn : g_pbX86;
+    uint64_t Addr = (uint64_t)((uintptr_t)pv - (uintptr_t)pbBase);
+
+    if (   (uintptr_t)pv < (uintptr_t)pbBase
+        || Addr < g_pDev->AddrStart
+        || Addr + cb > g_pDev->AddrStart + g_pDev->cbRange)
+    {
+        fprintf(stderr, "linksim: Access to %p (%zu bytes) outside of the %s device\n", pv, cb, g_pDev->pszName);
+        abort();
+    }
+
+    /* Every access costs some time and gives the model a chance to advance. */
+    g_cAccesses++;
+    linkSimBusy(g_Cfg.cNsAccess);
+    return Addr - g_pDev->AddrStart;
+}
+
+
+uint8_t pspMmioReadU8(volatile const void *pv)
+{
+    uint8_t bVal = 0;
+    g_pDev->pfnRead(linkSimAccessResolve(pv, sizeof(bVal)), &bVal, sizeof(bVal));
+    return bVal;
+}
+
+
+uint16_t pspMmioReadU16(volatile const void *pv)
+{
+    uint16_t u16Val = 0;
+    g_pDev->pfnRead(linkSimAccessResolve(pv, sizeof(u16Val)), &u16Val, sizeof(u16Val));
+    return u16Val;
+}
+
+
+uint32_t pspMmioReadU32(volatile const void *pv)
+{
+    uint32_t u32Val = 0;
+    g_pDev->pfnRead(linkSimAccessResolve(pv, sizeof(u32Val)), &u32Val, sizeof(u32Val));
+    return u32Val;
+}
+
+
+void pspMmioWriteU8(volatile void *pv, uint8_t bVal)
+{
+    g_pDev->pfnWrite(linkSimAccessResolve(pv, sizeof(bVal)), &bVal, sizeof(bVal));
+}
+
+
+void pspMmioWriteU16(volatile void *pv, uint16_t u16Val)
+{
+    g_pDev->pfnWrite(linkSimAccessResolve(pv, sizeof(u16Val)), &u16Val, sizeof(u16Val));
+}
+
+
+void pspMmioWriteU32(volatile void *pv, uint32_t u32Val)
+{
+    g_pDev->pfnWrite(linkSimAccessResolve(pv, sizeof(u32Val)), &u32Val, sizeof(u32Val));
+}
+
+
+void pspMmioCopyFrom(void *pvDst, volatile const void *pvSrc, size_t cb)
+{
+    g_pDev->pfnRead(linkSimAccessResolve(pvSrc, cb), pvDst, cb);
+}
+
+
+void pspMmioCopyTo(volatile void *pvDst, const void *pvSrc, size_t cb)
+{
+    g_pDev->pfnWrite(linkSimAccessResolve(pvDst, cb), pvSrc, cb);
+}
+
+
+int pspSerialStubX86PhysMap(X86PADDR PhysX86Addr, bool fMmio, void **ppv)
+{
+    (void)fMmio;
+    *ppv = g_pbX86 + (PhysX86Addr & UINT32_MAX);
+    return INF_SUCCESS;
+}
+
+
+int pspSerialStubX86PhysUnmapByPtr(void *pv)
+{
+    (void)pv;
+    return INF_SUCCESS;
+}
+
+
+int pspSerialStubSmnMap(SMNADDR SmnAddr, void **ppv)
+{
+    *ppv = g_pbSmn + SmnAddr;
+    return INF_SUCCESS;
+}
+
+
+int pspSerialStubSmnUnmapByPtr(void *pv)
+{
+    (void)pv;
+    return INF_SUCCESS;
+}
+
+
+void pspSerialStubDelayMs(uint32_t cMillies)
+{
+    linkSimBusy((uint64_t)cMillies * 1000000);
+}
+
+
+void pspSerialStubDelayUs(uint64_t cMicros)
+{
+    linkSimBusy(cMicros * 1000);
+}
+
+
+uint64_t pspSerialStubGetMicros(void)
+{
+    return linkSimNanoTS() / 1000;
+}
+
+
+/**
+ * Prints the usage of the tool.
+ *
+ * @returns nothing.
+ * @param   pszTool             The tool name.
+ */
+static void linkSimUsage(const char *pszTool)
+{
+    printf("%s Options:\n", pszTool);
+    printf("  --transp          <name>   The transport channel to simulate:\n");
+    for (uint32_t i = 0; i < ELEMENTS(g_apDevs); i++)
+        printf("                                 %-10s %s\n", g_apDevs[i]->pszName, g_apDevs[i]->pszDesc);
+    printf("  --size            <bytes>  Number of bytes to echo through the channel (default 64KiB)\n");
+    printf("  --chunk           <bytes>  Size of a single request/response (default 256)\n");
+    printf("  --latency-ns      <ns>     Latency of a single device access (default 100)\n");
+    printf("  --bandwidth       <bytes>  Link bandwidth in bytes per second (default depends on the model)\n");
+    printf("  --peer-latency-us <us>     Turnaround latency of the other end (default 100)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *pszTransp = NULL;
+    size_t cbTotal = 64 * 1024;
+
+    g_Cfg.cNsAccess    = 100;
+    g_Cfg.cbPerSecLink = 0;
+    g_Cfg.cUsPeer      = 100;
+    g_Cfg.cbChunk      = 256;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            linkSimUsage(argv[0]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--transp"))
+            pszTransp = argv[++i];
+        else if (!strcmp(argv[i], "--size"))
+            cbTotal = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--chunk"))
+            g_Cfg.cbChunk = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--latency-ns"))
+            g_Cfg.cNsAccess = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--bandwidth"))
+            g_Cfg.cbPerSecLink = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--peer-latency-us"))
+            g_Cfg.cUsPeer = strtoull(argv[++i], NULL, 0);
+        else
+        {
+            linkSimUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < ELEMENTS(g_apDevs) && pszTransp; i++)
+        if (!strcmp(g_apDevs[i]->pszName, pszTransp))
+            g_pDev = g_apDevs[i];
+
+    if (   !g_pDev
+        || !g_Cfg.cbChunk
+        || !g_Cfg.cNsAccess
+        || cbTotal % g_Cfg.cbChunk)
+    {
+        fprintf(stderr, "linksim: Unknown transport channel, zero access latency or size not a multiple of the chunk size\n");
+        linkSimUsage(argv[0]);
+        return 1;
+    }
+
+    /* Reserve the address spaces so any stray access outside of the models faults. */
+    g_pbSmn = (uint8_t *)mmap(NULL, LINKSIM_ADDR_SPACE_SZ, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    g_pbX86 = (uint8_t *)mmap(NULL, LINKSIM_ADDR_SPACE_SZ, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    g_Peer.cbChunk = g_Cfg.cbChunk;
+    g_Peer.pbRecv  = (uint8_t *)malloc(g_Cfg.cbChunk);
+    g_Peer.pbSend  = (uint8_t *)malloc(g_Cfg.cbChunk);
+    uint8_t *pbChunk = (uint8_t *)malloc(g_Cfg.cbChunk);
+    uint8_t *pbEcho  = (uint8_t *)malloc(g_Cfg.cbChunk);
+    if (   g_pbSmn == MAP_FAILED
+        || g_pbX86 == MAP_FAILED
+        || !g_Peer.pbRecv
+        || !g_Peer.pbSend
+        || !pbChunk
+        || !pbEcho)
+    {
+        fprintf(stderr, "linksim: Out of memory\n");
+        return 1;
+    }
+
+    int rc = g_pDev->pfnInit(&g_Cfg);
+    if (rc)
+    {
+        fprintf(stderr, "linksim: Initializing the %s model failed with %d\n", g_pDev->pszName, rc);
+        return 1;
+    }
+
+    PCPSPPDUTRANSPIF pIfTransp = g_pDev->pIfTransp;
+    PSPPDUTRANSP hPduTransp = NULL;
+    uint64_t au64TranspData[512 / sizeof(uint64_t)];
+
+    uint64_t tsInit = linkSimNanoTS();
+    rc = pIfTransp->pfnInit(&au64TranspData[0], sizeof(au64TranspData), &hPduTransp);
+    if (rc)
+    {
+        fprintf(stderr, "linksim: Initializing the %s transport channel failed with %d\n", g_pDev->pszName, rc);
+        return 1;
+    }
+    tsInit = linkSimNanoTS() - tsInit;
+
+    /* Echo the data chunk by chunk the same way the stub sends a PDU and polls for the response. */
+    uint64_t tsXfer = linkSimNanoTS();
+    uint64_t cMismatches = 0;
+    for (size_t off = 0; off < cbTotal && !rc; off += g_Cfg.cbChunk)
+    {
+        for (size_t i = 0; i < g_Cfg.cbChunk; i++)
+            pbChunk[i] = (uint8_t)((off + i) * 7 + (off / g_Cfg.cbChunk));
+
+        rc = pIfTransp->pfnBegin(hPduTransp);
+        if (!rc)
+            rc = pIfTransp->pfnWrite(hPduTransp, pbChunk, g_Cfg.cbChunk, NULL /*pcbWritten*/);
+        if (!rc)
+            rc = pIfTransp->pfnEnd(hPduTransp);
+
+        size_t cbRecv = 0;
+        while (   cbRecv < g_Cfg.cbChunk
+               && !rc)
+        {
+            size_t cbAvail = pIfTransp->pfnPeek(hPduTransp);
+            if (cbAvail)
+                rc = pIfTransp->pfnRead(hPduTransp, &pbEcho[cbRecv], MIN(cbAvail, g_Cfg.cbChunk - cbRecv), NULL /*pcbRead*/);
+            cbRecv += MIN(cbAvail, g_Cfg.cbChunk - cbRecv);
+        }
+
+        if (   !rc
+            && memcmp(pbChunk, pbEcho, g_Cfg.cbChunk))
+            cMismatches++;
+    }
+    tsXfer = linkSimNanoTS() - tsXfer;
+
+    PSPPDUTRANSPSTATS Stats;
+    memset(&Stats, 0, sizeof(Stats));
+    pIfTransp->pfnQueryStats(hPduTransp, &Stats);
+    pIfTransp->pfnTerm(hPduTransp);
+
+    printf("Transport:          %s (%s)\n", g_pDev->pszName, g_pDev->pszDesc);
+    printf("Status:             %d, %llu of %zu chunks corrupted\n", rc, (unsigned long long)cMismatches, cbTotal / g_Cfg.cbChunk);
+    printf("Init:               %llu us\n", (unsigned long long)(tsInit / 1000));
+    printf("Echoed:             %zu bytes in %llu us\n", cbTotal, (unsigned long long)(tsXfer / 1000));
+    printf("Throughput:         %llu bytes/s (both directions)\n",
+           (unsigned long long)(tsXfer ? 2 * (uint64_t)cbTotal * UINT64_C(1000000000) / tsXfer : 0));
+    printf("Device accesses:    %llu\n", (unsigned long long)g_cAccesses);
+    printf("Reads/Writes:       %u/%u (%llu/%llu bytes)\n", Stats.cReads, Stats.cWrites,
+           (unsigned long long)Stats.cbRead, (unsigned long long)Stats.cbWritten);
+    printf("Busy waits:         %u\n", Stats.cBusyWaits);
+    printf("Locks:              %u\n", Stats.cLocks);
+    printf("Blocked:            %llu us\n", (unsigned long long)Stats.cUsBlocked);
+    printf("Peer dropped:       %llu bytes\n", (unsigned long long)g_Peer.cbDropped);
+    if (g_pDev->pfnDumpStats)
+        g_pDev->pfnDumpStats();
+
+    free(pbEcho);
+    free(pbChunk);
+    free(g_Peer.pbSend);
+    free(g_Peer.pbRecv);
+    return rc || cMismatches ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/** @file
+ * PSP link simulator - Interfaces shared between the simulator core and the device models.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef __include_linksim_h
+#define __include_linksim_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "../../PspSerialStub/pdu-transp.h"
+
+
+/**
+ * Address space a device model is attached to.
+ */
+typedef enum LINKSIMADDRSPACE
+{
+    /** Invalid address space. */
+    LINKSIMADDRSPACE_INVALID = 0,
+    /** SMN address space. */
+    LINKSIMADDRSPACE_SMN,
+    /** x86 physical address space (lower 32bits). */
+    LINKSIMADDRSPACE_X86,
+    /** 32bit hack. */
+    LINKSIMADDRSPACE_32BIT_HACK = 0x7fffffff
+} LINKSIMADDRSPACE;
+
+
+/**
+ * Simulation parameters.
+ */
+typedef struct LINKSIMCFG
+{
+    /** Latency of a single device access in nanoseconds. */
+    uint64_t                    cNsAccess;
+    /** Link bandwidth in bytes per second, 0 to use the model default. */
+    uint64_t                    cbPerSecLink;
+    /** Turnaround latency of the peer at the other end of the link in microseconds,
+     * also used as the polling interval of the flash emulators. */
+    uint64_t                    cUsPeer;
+    /** Number of bytes the peer collects before echoing them back. */
+    size_t                      cbChunk;
+} LINKSIMCFG;
+/** Pointer to the simulation parameters. */
+typedef LINKSIMCFG *PLINKSIMCFG;
+/** Pointer to const simulation parameters. */
+typedef const LINKSIMCFG *PCLINKSIMCFG;
+
+
+/**
+ * Device model registration record.
+ */
+typedef struct LINKSIMDEVREG
+{
+    /** Model name as given on the command line. */
+    const char                  *pszName;
+    /** Short description. */
+    const char                  *pszDesc;
+    /** The transport channel driven by the model. */
+    PCPSPPDUTRANSPIF            pIfTransp;
+    /** Address space the device lives in. */
+    LINKSIMADDRSPACE            enmAddrSpace;
+    /** Start address of the device. */
+    uint64_t                    AddrStart;
+    /** Size of the device range in bytes. */
+    uint64_t                    cbRange;
+
+    /**
+     * Initializes the model.
+     *
+     * @returns Status code.
+     * @param   pCfg                The simulation parameters.
+     */
+    int         (*pfnInit) (PCLINKSIMCFG pCfg);
+
+    /**
+     * Device read access.
+     *
+     * @returns nothing.
+     * @param   off                 Offset into the device range.
+     * @param   pvBuf               Where to store the read data.
+     * @param   cb                  Number of bytes to read.
+     */
+    void        (*pfnRead) (uint64_t off, void *pvBuf, size_t cb);
+
+    /**
+     * Device write access.
+     *
+     * @returns nothing.
+     * @param   off                 Offset into the device range.
+     * @param   pvBuf               The data written.
+     * @param   cb                  Number of bytes written.
+     */
+    void        (*pfnWrite) (uint64_t off, const void *pvBuf, size_t cb);
+
+    /**
+     * Advances the model and the other end of the link to the given point in time.
+     *
+     * @returns nothing.
+     * @param   tsNow               Current timestamp in nanoseconds.
+     */
+    void        (*pfnPoll) (uint64_t tsNow);
+
+    /**
+     * Prints model specific statistics, optional.
+     *
+     * @returns nothing.
+     */
+    void        (*pfnDumpStats) (void);
+} LINKSIMDEVREG;
+/** Pointer to a const device model registration record. */
+typedef const LINKSIMDEVREG *PCLINKSIMDEVREG;
+
+
+/**
+ * Returns the current simulated timestamp.
+ *
+ * @returns Timestamp in nanoseconds.
+ */
+uint64_t linkSimNanoTS(void);
+
+/**
+ * Advances the simulated time by the given amount and lets the device model catch up.
+ *
+ * @returns nothing.
+ * @param   cNs                 Number of nanoseconds to spin.
+ */
+void linkSimBusy(uint64_t cNs);
+
+/**
+ * Returns the time it takes to transfer the given number of bytes over a link.
+ *
+ * @returns Number of nanoseconds.
+ * @param   cb                  Number of bytes.
+ * @param   cbPerSec            Link bandwidth in bytes per second.
+ */
+uint64_t linkSimXferNs(size_t cb, uint64_t cbPerSec);
+
+/**
+ * Hands data received from the PSP over to the peer.
+ *
+ * @returns nothing.
+ * @param   pvBuf               The data received.
+ * @param   cb                  Number of bytes received.
+ */
+void linkSimPeerRecv(const void *pvBuf, size_t cb);
+
+/**
+ * Returns the timestamp from which on the peer has data to send to the PSP.
+ *
+ * @returns Timestamp in nanoseconds, UINT64_MAX if there is nothing to send.
+ */
+uint64_t linkSimPeerSendReadyTs(void);
+
+/**
+ * Fetches data the peer sends to the PSP (doesn't check the timestamp).
+ *
+ * @returns Number of bytes fetched.
+ * @param   pvBuf               Where to store the data.
+ * @param   cbMax               Maximum number of bytes to fetch.
+ */
+size_t linkSimPeerSend(void *pvBuf, size_t cbMax);
+
+
+extern const PSPPDUTRANSPIF g_UartTransp;
+extern const PSPPDUTRANSPIF g_SpiFlashTransp;
+extern const PSPPDUTRANSPIF g_SpiFlashTranspEm100;
+
+extern const LINKSIMDEVREG g_LinkSimDevUart;
+extern const LINKSIMDEVREG g_LinkSimDevSpiFlash;
+extern const LINKSIMDEVREG g_LinkSimDevEm100;
+
+#endif /* !__include_linksim_h */
@@ -0,0 +1,650 @@
+/** @file
+ * PSP link simulator - Mapping manager test against the simulated register file.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/cdefs.h>
+
+#include "../../Lib/include/err.h"
+#include "../../Lib/include/map-mgr.h"
+
+
+/** Maximum number of references the random run holds at the same time. */
+#define MAP_MGR_TEST_REFS_MAX           32
+/** Number of distinct x86 windows the random run maps. */
+#define MAP_MGR_TEST_X86_WINDOWS        24
+/** Number of distinct SMN windows the random run maps. */
+#define MAP_MGR_TEST_SMN_WINDOWS        40
+
+/*
+ * Drives the mapping manager through the simulated register file (g_MapMgrRegIfSim) the host build of the
+ * stub uses. A few fixed scenarios check the least recently used eviction order for both slot kinds and the
+ * x86 slot classes, and that a flush only tears down unreferenced mappings. A random run of map, unmap and
+ * flush calls then checks after every step that each window is held by at most one slot (per memory type and
+ * slot class for x86, per die for SMN), that every mapped slot is reachable through the hash bucket of its
+ * window and nothing else is, and that the register file matches the slot state.
+ */
+
+
+/**
+ * A reference held by the random run.
+ */
+typedef struct MAPMGRTESTREF
+{
+    /** Flag whether this is a SMN mapping. */
+    bool                        fSmn;
+    /** The mapping pointer returned. */
+    void                        *pv;
+} MAPMGRTESTREF;
+
+
+/** Number of failed checks. */
+static uint32_t g_cErrors = 0;
+
+
+/**
+ * Reports a failed check.
+ *
+ * @returns nothing.
+ * @param   pszWhat             What was checked.
+ * @param   uStep               The step the check failed in.
+ */
+static void mapMgrTestFail(const char *pszWhat, uint32_t uStep)
+{
+    if (g_cErrors++ < 20)
+        fprintf(stderr, "map-mgr-test: Step %u: %s\n", uStep, pszWhat);
+}
+
+
+/**
+ * Returns a random number in the given range.
+ *
+ * @returns Random number.
+ * @param   uMax                Maximum value (exclusive).
+ */
+static uint32_t mapMgrTestRand(uint32_t uMax)
+{
+    return (uint32_t)(random() % uMax);
+}
+
+
+/**
+ * Returns the slot index a mapping pointer belongs to.
+ *
+ * @returns Slot index.
+ * @param   pv                  The mapping pointer.
+ * @param   fSmn                Flag whether this is a SMN mapping.
+ */
+static uint32_t mapMgrTestSlotFromPtr(void *pv, bool fSmn)
+{
+    if (fSmn)
+        return ((uintptr_t)pv - MAPMGR_SMN_WINDOW_BASE) / _1M;
+    return ((uintptr_t)pv - MAPMGR_X86_WINDOW_BASE) / _64M;
+}
+
+
+/**
+ * Returns the x86 window base address for the given window index of the random run.
+ *
+ * @returns x86 base address, spread over the 64bit address space to exercise the high address bits.
+ * @param   idxWindow           The window index.
+ */
+static X86PADDR mapMgrTestX86Window(uint32_t idxWindow)
+{
+    return ((X86PADDR)(idxWindow % 3) << 32) | ((X86PADDR)idxWindow * 5 % 64) * _64M;
+}
+
+
+/**
+ * Checks that the hash chains contain each mapped slot exactly once and no free slot.
+ *
+ * @returns nothing.
+ * @param   paidxHash           The hash bucket heads.
+ * @param   cBuckets            Number of buckets.
+ * @param   pfnNext             Returns the next slot in a chain.
+ * @param   pvSlots             The slot array handed to pfnNext.
+ * @param   pafMapped           Which slots are mapped.
+ * @param   cSlots              Number of slots.
+ * @param   uStep               The current step for the messages.
+ */
+static void mapMgrTestCheckChains(const uint8_t *paidxHash, uint32_t cBuckets, uint8_t (*pfnNext)(const void *, uint32_t),
+                                  const void *pvSlots, const bool *pafMapped, uint32_t cSlots, uint32_t uStep)
+{
+    uint32_t acSeen[MAPMGR_SMN_SLOT_COUNT];
+
+    memset(&acSeen[0], 0, sizeof(acSeen));
+    for (uint32_t idxBucket = 0; idxBucket < cBuckets; idxBucket++)
+    {
+        uint32_t cLinks = 0;
+
+        for (uint32_t idxSlot = paidxHash[idxBucket]; idxSlot != MAPMGR_HASH_NIL; idxSlot = pfnNext(pvSlots, idxSlot))
+        {
+            if (   idxSlot >= cSlots
+                || ++cLinks > cSlots)
+            {
+                mapMgrTestFail("Hash chain is corrupted", uStep);
+                return;
+            }
+            acSeen[idxSlot]++;
+        }
+    }
+
+    for (uint32_t idxSlot = 0; idxSlot < cSlots; idxSlot++)
+    {
+        if (acSeen[idxSlot] != (pafMapped[idxSlot] ? 1 : 0))
+            mapMgrTestFail(  pafMapped[idxSlot]
+                           ? "Mapped slot is not exactly once in the hash chains"
+                           : "Free slot is in a hash chain", uStep);
+    }
+}
+
+
+static uint8_t mapMgrTestX86Next(const void *pvSlots, uint32_t idxSlot)
+{
+    return ((const MAPMGRX86SLOT *)pvSlots)[idxSlot].idxHashNext;
+}
+
+
+static uint8_t mapMgrTestSmnNext(const void *pvSlots, uint32_t idxSlot)
+{
+    return ((const MAPMGRSMNSLOT *)pvSlots)[idxSlot].idxHashNext;
+}
+
+
+/**
+ * Checks the slot invariants and that the register file matches the slot state.
+ *
+ * @returns nothing.
+ * @param   pMapMgr             The mapping manager.
+ * @param   pRegSim             The simulated register file.
+ * @param   uStep               The current step for the messages.
+ */
+static void mapMgrTestCheckState(PMAPMGR pMapMgr, PMAPMGRREGSIM pRegSim, uint32_t uStep)
+{
+    MAPMGRSLOTINFO aX86[MAPMGR_X86_SLOT_COUNT];
+    MAPMGRSLOTINFO aSmn[MAPMGR_SMN_SLOT_COUNT];
+    bool afX86Mapped[MAPMGR_X86_SLOT_COUNT];
+    bool afSmnMapped[MAPMGR_SMN_SLOT_COUNT];
+
+    for (uint32_t i = 0; i < MAPMGR_X86_SLOT_COUNT; i++)
+    {
+        MAPMgrX86SlotQuery(pMapMgr, i, &aX86[i]);
+        afX86Mapped[i] = aX86[i].uAddrBase != NIL_X86PADDR;
+
+        if (!afX86Mapped[i])
+        {
+            if (aX86[i].cRefs)
+                mapMgrTestFail("Free x86 slot is referenced", uStep);
+            if (pRegSim->au32X86Regs[i * 4] || pRegSim->au32X86Regs[i * 4 + 2])
+                mapMgrTestFail("Free x86 slot is still programmed", uStep);
+            continue;
+        }
+
+        uint32_t u32RegBase = ((aX86[i].uAddrBase >> 32) << 6) | ((aX86[i].uAddrBase >> 26) & 0x3f);
+        if (   pRegSim->au32X86Regs[i * 4] != u32RegBase
+            || pRegSim->au32X86Regs[i * 4 + 2] != aX86[i].uMemType
+            || pRegSim->au32X86Regs[i * 4 + 3] != aX86[i].uMemType)
+            mapMgrTestFail("x86 slot registers don't match the mapping", uStep);
+
+        for (uint32_t j = 0; j < i; j++)
+        {
+            if (   afX86Mapped[j]
+                && aX86[j].uAddrBase == aX86[i].uAddrBase
+                && aX86[j].uMemType == aX86[i].uMemType
+                && pMapMgr->aX86Slots[j].fMmio == pMapMgr->aX86Slots[i].fMmio)
+                mapMgrTestFail("x86 window is mapped by two slots of the same class", uStep);
+        }
+    }
+
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+    {
+        MAPMgrSmnSlotQuery(pMapMgr, i, &aSmn[i]);
+        afSmnMapped[i] = aSmn[i].uAddrBase != UINT64_MAX;
+
+        uint32_t u16Ctrl = (pRegSim->au32SmnRegs[i / 2] >> ((i & 1) * 16)) & 0xffff;
+        if (!afSmnMapped[i])
+        {
+            if (aSmn[i].cRefs)
+                mapMgrTestFail("Free SMN slot is referenced", uStep);
+            if (u16Ctrl)
+                mapMgrTestFail("Free SMN slot is still programmed", uStep);
+            continue;
+        }
+
+        if (u16Ctrl != ((aSmn[i].idDie << MAPMGR_SMN_SLOT_DIE_SHIFT) | (uint32_t)(aSmn[i].uAddrBase >> 20)))
+            mapMgrTestFail("SMN slot register doesn't match the mapping", uStep);
+
+        for (uint32_t j = 0; j < i; j++)
+        {
+            if (   afSmnMapped[j]
+                && aSmn[j].uAddrBase == aSmn[i].uAddrBase
+                && aSmn[j].idDie == aSmn[i].idDie)
+                mapMgrTestFail("SMN window of a die is mapped by two slots", uStep);
+        }
+    }
+
+    mapMgrTestCheckChains(&pMapMgr->aidxX86Hash[0], MAPMGR_X86_HASH_SZ, mapMgrTestX86Next, &pMapMgr->aX86Slots[0],
+                          &afX86Mapped[0], MAPMGR_X86_SLOT_COUNT, uStep);
+    mapMgrTestCheckChains(&pMapMgr->aidxSmnHash[0], MAPMGR_SMN_HASH_SZ, mapMgrTestSmnNext, &pMapMgr->aSmnSlots[0],
+                          &afSmnMapped[0], MAPMGR_SMN_SLOT_COUNT, uStep);
+
+    /* Every mapped window has to be found through its bucket, i.e. mapping it again hits without touching a register. */
+    for (uint32_t i = 0; i < MAPMGR_X86_SLOT_COUNT; i++)
+    {
+        if (!afX86Mapped[i])
+            continue;
+
+        uint32_t cRegWrites = pRegSim->cRegWrites;
+        void *pv = NULL;
+        int rc = MAPMgrX86PhysMapEx(pMapMgr, aX86[i].uAddrBase, pMapMgr->aX86Slots[i].fMmio, aX86[i].uMemType, &pv);
+        if (   rc
+            || mapMgrTestSlotFromPtr(pv, false /*fSmn*/) != i
+            || pRegSim->cRegWrites != cRegWrites)
+            mapMgrTestFail("Mapped x86 slot isn't found through its bucket", uStep);
+        if (!rc)
+            MAPMgrX86PhysUnmapByPtr(pMapMgr, pv);
+    }
+
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+    {
+        if (!afSmnMapped[i])
+            continue;
+
+        uint32_t cRegWrites = pRegSim->cRegWrites;
+        void *pv = NULL;
+        int rc = MAPMgrSmnMapEx(pMapMgr, aSmn[i].idDie, (SMNADDR)aSmn[i].uAddrBase, &pv);
+        if (   rc
+            || mapMgrTestSlotFromPtr(pv, true /*fSmn*/) != i
+            || pRegSim->cRegWrites != cRegWrites)
+            mapMgrTestFail("Mapped SMN slot isn't found through its bucket", uStep);
+        if (!rc)
+            MAPMgrSmnUnmapByPtr(pMapMgr, pv);
+    }
+}
+
+
+/**
+ * Maps and immediately unmaps the given x86 window, returning the slot used.
+ *
+ * @returns Slot index, UINT32_MAX on failure.
+ * @param   pMapMgr             The mapping manager.
+ * @param   PhysX86Addr         The address to map.
+ * @param   fMmio               The slot class.
+ */
+static uint32_t mapMgrTestX86Touch(PMAPMGR pMapMgr, X86PADDR PhysX86Addr, bool fMmio)
+{
+    void *pv = NULL;
+
+    if (MAPMgrX86PhysMap(pMapMgr, PhysX86Addr, fMmio, &pv))
+        return UINT32_MAX;
+
+    MAPMgrX86PhysUnmapByPtr(pMapMgr, pv);
+    return mapMgrTestSlotFromPtr(pv, false /*fSmn*/);
+}
+
+
+/**
+ * Maps and immediately unmaps the given SMN window, returning the slot used.
+ *
+ * @returns Slot index, UINT32_MAX on failure.
+ * @param   pMapMgr             The mapping manager.
+ * @param   idDie               The die.
+ * @param   SmnAddr             The address to map.
+ */
+static uint32_t mapMgrTestSmnTouch(PMAPMGR pMapMgr, uint32_t idDie, SMNADDR SmnAddr)
+{
+    void *pv = NULL;
+
+    if (MAPMgrSmnMapEx(pMapMgr, idDie, SmnAddr, &pv))
+        return UINT32_MAX;
+
+    MAPMgrSmnUnmapByPtr(pMapMgr, pv);
+    return mapMgrTestSlotFromPtr(pv, true /*fSmn*/);
+}
+
+
+/**
+ * Checks the x86 eviction order and the slot classes.
+ *
+ * @returns nothing.
+ * @param   pMapMgr             The mapping manager.
+ * @param   pRegSim             The simulated register file.
+ */
+static void mapMgrTestX86Lru(PMAPMGR pMapMgr, PMAPMGRREGSIM pRegSim)
+{
+    uint32_t aidxSlots[MAPMGR_X86_SLOT_COUNT];
+
+    MAPMgrRegSimInit(pRegSim);
+    MAPMgrInit(pMapMgr, &g_MapMgrRegIfSim, pRegSim);
+
+    /* Free slots are taken first, in order. */
+    for (uint32_t i = 0; i < MAPMGR_X86_SLOT_COUNT; i++)
+    {
+        aidxSlots[i] = mapMgrTestX86Touch(pMapMgr, (X86PADDR)i * _64M, false /*fMmio*/);
+        if (aidxSlots[i] != i)
+            mapMgrTestFail("x86 mapping didn't take the next free slot", 0);
+    }
+
+    /* Touch the windows in reverse, window 14 becomes the least recently used. */
+    for (uint32_t i = MAPMGR_X86_SLOT_COUNT; i > 0; i--)
+        mapMgrTestX86Touch(pMapMgr, (X86PADDR)(i - 1) * _64M, false /*fMmio*/);
+
+    /* Hold a reference to window 14, window 13 is the next candidate. */
+    void *pvHeld = NULL;
+    if (MAPMgrX86PhysMap(pMapMgr, (X86PADDR)14 * _64M, false /*fMmio*/, &pvHeld))
+        mapMgrTestFail("Mapping a cached x86 window failed", 0);
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        uint32_t idxSlot = mapMgrTestX86Touch(pMapMgr, (X86PADDR)(32 + i) * _64M, false /*fMmio*/);
+        if (idxSlot != 13 - i)
+            mapMgrTestFail("x86 mapping didn't evict the least recently used unreferenced slot", 0);
+    }
+
+    /* MMIO mappings stay in their class, evicting the least recently used slot there (slot 10 now). */
+    uint32_t idxSlot = mapMgrTestX86Touch(pMapMgr, (X86PADDR)40 * _64M, true /*fMmio*/);
+    if (idxSlot != 10)
+        mapMgrTestFail("x86 MMIO mapping didn't evict the least recently used MMIO slot", 0);
+
+    /* The same window in the other class gets a slot of its own. */
+    idxSlot = mapMgrTestX86Touch(pMapMgr, 0, true /*fMmio*/);
+    if (   idxSlot == UINT32_MAX
+        || idxSlot == aidxSlots[0]
+        || idxSlot < MAPMGR_X86_SLOT_MMIO_FIRST)
+        mapMgrTestFail("x86 MMIO mapping reused the normal memory slot of the window", 0);
+
+    mapMgrTestCheckState(pMapMgr, pRegSim, 0);
+    MAPMgrX86PhysUnmapByPtr(pMapMgr, pvHeld);
+}
+
+
+/**
+ * Checks the SMN eviction order.
+ *
+ * @returns nothing.
+ * @param   pMapMgr             The mapping manager.
+ * @param   pRegSim             The simulated register file.
+ */
+static void mapMgrTestSmnLru(PMAPMGR pMapMgr, PMAPMGRREGSIM pRegSim)
+{
+    MAPMgrRegSimInit(pRegSim);
+    MAPMgrInit(pMapMgr, &g_MapMgrRegIfSim, pRegSim);
+
+    /* The same window on different dies needs different slots. */
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+    {
+        if (mapMgrTestSmnTouch(pMapMgr, i % 4, (i / 4) * _1M) != i)
+            mapMgrTestFail("SMN mapping didn't take the next free slot", 0);
+    }
+
+    /* Touch every even slot, the odd ones are evicted first, in order. */
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i += 2)
+        mapMgrTestSmnTouch(pMapMgr, i % 4, (i / 4) * _1M);
+
+    for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+    {
+        uint32_t idxSlot = mapMgrTestSmnTouch(pMapMgr, 0, (64 + i) * _1M);
+        uint32_t idxExpected = i < MAPMGR_SMN_SLOT_COUNT / 2 ? i * 2 + 1 : (i - MAPMGR_SMN_SLOT_COUNT / 2) * 2;
+
+        if (idxSlot != idxExpected)
+            mapMgrTestFail("SMN mapping didn't evict the least recently used slot", 0);
+    }
+
+    mapMgrTestCheckState(pMapMgr, pRegSim, 0);
+}
+
+
+/**
+ * Checks that a flush leaves referenced mappings alone.
+ *
+ * @returns nothing.
+ * @param   pMapMgr             The mapping manager.
+ * @param   pRegSim             The simulated register file.
+ */
+static void mapMgrTestFlush(PMAPMGR pMapMgr, PMAPMGRREGSIM pRegSim)
+{
+    void *apvX86[4];
+    void *apvSmn[4];
+
+    MAPMgrRegSimInit(pRegSim);
+    MAPMgrInit(pMapMgr, &g_MapMgrRegIfSim, pRegSim);
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        mapMgrTestX86Touch(pMapMgr, (X86PADDR)i * _64M, i & 1);
+        mapMgrTestSmnTouch(pMapMgr, i & 1, i * _1M);
+    }
+    for (uint32_t i = 0; i < ELEMENTS(apvX86); i++)
+    {
+        if (   MAPMgrX86PhysMap(pMapMgr, (X86PADDR)i * 2 * _64M, false /*fMmio*/, &apvX86[i])
+            || MAPMgrSmnMapEx(pMapMgr, 0 /*idDie*/, i * 2 * _1M, &apvSmn[i]))
+            mapMgrTestFail("Mapping a cached window failed", 0);
+    }
+
+    MAPMgrX86Flush(pMapMgr);
+    MAPMgrSmnFlush(pMapMgr);
+    mapMgrTestCheckState(pMapMgr, pRegSim, 0);
+
+    MAPMGRSTATS Stats;
+    MAPMgrQueryStats(pMapMgr, &Stats);
+    if (   Stats.cX86SlotsMapped != ELEMENTS(apvX86)
+        || Stats.cSmnSlotsMapped != ELEMENTS(apvSmn))
+        mapMgrTestFail("Flush didn't tear down exactly the unreferenced mappings", 0);
+
+    for (uint32_t i = 0; i < ELEMENTS(apvX86); i++)
+    {
+        MAPMGRSLOTINFO Info;
+
+        MAPMgrX86SlotQuery(pMapMgr, mapMgrTestSlotFromPtr(apvX86[i], false /*fSmn*/), &Info);
+        if (   Info.uAddrBase != (X86PADDR)i * 2 * _64M
+            || Info.cRefs != 1)
+            mapMgrTestFail("Flush touched a referenced x86 mapping", 0);
+        MAPMgrX86PhysUnmapByPtr(pMapMgr, apvX86[i]);
+
+        MAPMgrSmnSlotQuery(pMapMgr, mapMgrTestSlotFromPtr(apvSmn[i], true /*fSmn*/), &Info);
+        if (   Info.uAddrBase != i * 2 * _1M
+            || Info.cRefs != 1)
+            mapMgrTestFail("Flush touched a referenced SMN mapping", 0);
+        MAPMgrSmnUnmapByPtr(pMapMgr, apvSmn[i]);
+    }
+
+    MAPMgrX86Flush(pMapMgr);
+    MAPMgrSmnFlush(pMapMgr);
+    MAPMgrQueryStats(pMapMgr, &Stats);
+    if (   Stats.cX86SlotsMapped
+        || Stats.cSmnSlotsMapped)
+        mapMgrTestFail("Flush left unreferenced mappings behind", 0);
+    mapMgrTestCheckState(pMapMgr, pRegSim, 0);
+}
+
+
+/**
+ * Random map, unmap and flush sequence checking the invariants after every step.
+ *
+ * @returns nothing.
+ * @param   pMapMgr             The mapping manager.
+ * @param   pRegSim             The simulated register file.
+ * @param   cSteps              Number of steps to run.
+ */
+static void mapMgrTestRandom(PMAPMGR pMapMgr, PMAPMGRREGSIM pRegSim, uint32_t cSteps)
+{
+    static const uint32_t s_auMemTypes[] = { MAPMGR_X86_MEMTYPE_DEFAULT, MAPMGR_X86_MEMTYPE_MEM, MAPMGR_X86_MEMTYPE_MMIO, 0x1 };
+    MAPMGRTESTREF aRefs[MAP_MGR_TEST_REFS_MAX];
+    uint32_t cRefs = 0;
+
+    MAPMgrRegSimInit(pRegSim);
+    MAPMgrInit(pMapMgr, &g_MapMgrRegIfSim, pRegSim);
+
+    for (uint32_t uStep = 1; uStep <= cSteps; uStep++)
+    {
+        uint32_t uOp = mapMgrTestRand(100);
+
+        if (uOp < 30 && cRefs < ELEMENTS(aRefs))
+        {
+            X86PADDR PhysX86Addr = mapMgrTestX86Window(mapMgrTestRand(MAP_MGR_TEST_X86_WINDOWS)) + mapMgrTestRand(_64M);
+            bool fMmio = mapMgrTestRand(2) != 0;
+            void *pv = NULL;
+
+            int rc = MAPMgrX86PhysMapEx(pMapMgr, PhysX86Addr, fMmio, s_auMemTypes[mapMgrTestRand(ELEMENTS(s_auMemTypes))], &pv);
+            if (!rc)
+            {
+                uint32_t idxSlot = mapMgrTestSlotFromPtr(pv, false /*fSmn*/);
+                if (   fMmio
+                    && idxSlot < MAPMGR_X86_SLOT_MMIO_FIRST)
+                    mapMgrTestFail("x86 MMIO mapping ended up in a normal memory slot", uStep);
+
+                aRefs[cRefs].fSmn = false;
+                aRefs[cRefs].pv   = pv;
+                cRefs++;
+            }
+            else
+            {
+                /* Only allowed if every slot of the class is referenced. */
+                for (uint32_t i = fMmio ? MAPMGR_X86_SLOT_MMIO_FIRST : 0; i < MAPMGR_X86_SLOT_COUNT; i++)
+                {
+                    MAPMGRSLOTINFO Info;
+
+                    MAPMgrX86SlotQuery(pMapMgr, i, &Info);
+                    if (!Info.cRefs)
+                        mapMgrTestFail("x86 mapping failed with an unreferenced slot left", uStep);
+                }
+            }
+        }
+        else if (uOp < 60 && cRefs < ELEMENTS(aRefs))
+        {
+            SMNADDR SmnAddr = mapMgrTestRand(MAP_MGR_TEST_SMN_WINDOWS) * 3 * _1M + mapMgrTestRand(_1M);
+            void *pv = NULL;
+
+            int rc = MAPMgrSmnMapEx(pMapMgr, mapMgrTestRand(4), SmnAddr, &pv);
+            if (!rc)
+            {
+                aRefs[cRefs].fSmn = true;
+                aRefs[cRefs].pv   = pv;
+                cRefs++;
+            }
+            else
+            {
+                for (uint32_t i = 0; i < MAPMGR_SMN_SLOT_COUNT; i++)
+                {
+                    MAPMGRSLOTINFO Info;
+
+                    MAPMgrSmnSlotQuery(pMapMgr, i, &Info);
+                    if (!Info.cRefs)
+                        mapMgrTestFail("SMN mapping failed with an unreferenced slot left", uStep);
+                }
+            }
+        }
+        else if (uOp < 98)
+        {
+            if (!cRefs)
+                continue;
+
+            /* Release a random reference, keeping the rest of the array packed. */
+            uint32_t idxRef = mapMgrTestRand(cRefs);
+            int rc =   aRefs[idxRef].fSmn
+                     ? MAPMgrSmnUnmapByPtr(pMapMgr, aRefs[idxRef].pv)
+                     : MAPMgrX86PhysUnmapByPtr(pMapMgr, aRefs[idxRef].pv);
+            if (rc)
+                mapMgrTestFail("Releasing a held reference failed", uStep);
+            aRefs[idxRef] = aRefs[--cRefs];
+        }
+        else
+        {
+            MAPMgrX86Flush(pMapMgr);
+            MAPMgrSmnFlush(pMapMgr);
+        }
+
+        mapMgrTestCheckState(pMapMgr, pRegSim, uStep);
+        if (g_cErrors)
+            break;
+    }
+
+    while (cRefs)
+    {
+        cRefs--;
+        if (aRefs[cRefs].fSmn)
+            MAPMgrSmnUnmapByPtr(pMapMgr, aRefs[cRefs].pv);
+        else
+            MAPMgrX86PhysUnmapByPtr(pMapMgr, aRefs[cRefs].pv);
+    }
+}
+
+
+/**
+ * Prints the usage of the tool.
+ *
+ * @returns nothing.
+ * @param   pszTool             The tool name.
+ */
+static void mapMgrTestUsage(const char *pszTool)
+{
+    printf("%s Options:\n", pszTool);
+    printf("  --steps           <count>  Number of random map/unmap/flush steps (default 100000)\n");
+    printf("  --seed            <seed>   Random seed (default 1)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t cSteps = 100000;
+    unsigned uSeed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            mapMgrTestUsage(argv[0]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--steps"))
+            cSteps = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--seed"))
+            uSeed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            mapMgrTestUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    srandom(uSeed);
+
+    static MAPMGR s_MapMgr;
+    static MAPMGRREGSIM s_RegSim;
+
+    mapMgrTestX86Lru(&s_MapMgr, &s_RegSim);
+    mapMgrTestSmnLru(&s_MapMgr, &s_RegSim);
+    mapMgrTestFlush(&s_MapMgr, &s_RegSim);
+    if (!g_cErrors)
+        mapMgrTestRandom(&s_MapMgr, &s_RegSim, cSteps);
+
+    /* The hit counts include the lookups done by the checks, only the evictions are of interest. */
+    MAPMGRSTATS Stats;
+    MAPMgrQueryStats(&s_MapMgr, &Stats);
+    printf("Steps:              %u\n", cSteps);
+    printf("Evictions:          %u x86, %u SMN\n", Stats.X86.cEvictions, Stats.Smn.cEvictions);
+    printf("Result:             %s (%u failed checks)\n", g_cErrors ? "MISMATCH" : "OK", g_cErrors);
+
+    return g_cErrors ? 1 : 0;
+}
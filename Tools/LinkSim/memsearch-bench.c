@@ -0,0 +1,249 @@
+/** @file
+ * PSP link simulator - Benchmark for the on target memory pattern search.
+ */
+
+/*
+ * Copyright (C) 2020 Alexander Eichner <alexander.eichner@campus.tu-berlin.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <common/cdefs.h>
+
+#include "../../Lib/include/err.h"
+#include "../../Lib/include/memsearch.h"
+
+
+/** Maximum number of matches collected. */
+#define MEMSEARCH_BENCH_MATCHES_MAX     (1024 * 1024)
+
+/*
+ * Runs the skip table search the stub uses for the memory search request against a plain
+ * byte by byte search over a random buffer with the pattern planted at random offsets.
+ * Both have to report the same matches, the throughput of each is printed. A small alphabet
+ * and wildcards close to the pattern end are the cases where the skip table helps the least.
+ */
+
+
+/**
+ * Returns a random number in the given range.
+ *
+ * @returns Random number.
+ * @param   uMax                Maximum value (exclusive).
+ */
+static uint32_t memSearchBenchRand(uint32_t uMax)
+{
+    return (uint32_t)(((uint64_t)random() << 31 | random()) % uMax);
+}
+
+
+/**
+ * Returns the current time in nanoseconds.
+ *
+ * @returns Monotonic timestamp in nanoseconds.
+ */
+static uint64_t memSearchBenchNanoTs(void)
+{
+    struct timespec Ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &Ts);
+    return (uint64_t)Ts.tv_sec * 1000000000ULL + Ts.tv_nsec;
+}
+
+
+/**
+ * Plain byte by byte search for reference.
+ *
+ * @returns Number of matches found.
+ * @param   pbBuf               The buffer to search.
+ * @param   cbBuf               Size of the buffer in bytes.
+ * @param   pbPattern           The pattern.
+ * @param   pbMask              The mask.
+ * @param   cbPattern           Size of the pattern in bytes.
+ * @param   paoffMatches        Where to store the match offsets.
+ * @param   cMatchesMax         Maximum number of matches to store.
+ */
+static size_t memSearchBenchNaive(const uint8_t *pbBuf, size_t cbBuf, const uint8_t *pbPattern, const uint8_t *pbMask,
+                                  size_t cbPattern, size_t *paoffMatches, size_t cMatchesMax)
+{
+    size_t cMatches = 0;
+
+    for (size_t off = 0; off + cbPattern <= cbBuf && cMatches < cMatchesMax; off++)
+    {
+        size_t i = 0;
+        while (   i < cbPattern
+               && (pbBuf[off + i] & pbMask[i]) == (pbPattern[i] & pbMask[i]))
+            i++;
+
+        if (i == cbPattern)
+            paoffMatches[cMatches++] = off;
+    }
+
+    return cMatches;
+}
+
+
+/**
+ * Prints the usage of the tool.
+ *
+ * @returns nothing.
+ * @param   pszTool             The tool name.
+ */
+static void memSearchBenchUsage(const char *pszTool)
+{
+    printf("%s Options:\n", pszTool);
+    printf("  --size            <bytes>  Size of the buffer to search (default 64MiB)\n");
+    printf("  --pattern-len     <bytes>  Size of the pattern, up to %u (default 8)\n", MEMSEARCH_PATTERN_MAX);
+    printf("  --wildcards       <count>  Number of pattern bytes with a zero mask (default 0)\n");
+    printf("  --alphabet        <count>  Number of distinct byte values in the buffer (default 256)\n");
+    printf("  --plant           <count>  Number of times the pattern is planted in the buffer (default 100)\n");
+    printf("  --seed            <seed>   Random seed (default 1)\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t cbBuf = 64 * 1024 * 1024;
+    uint32_t cbPattern = 8;
+    uint32_t cWildcards = 0;
+    uint32_t cAlphabet = 256;
+    uint32_t cPlant = 100;
+    unsigned uSeed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 >= argc)
+        {
+            memSearchBenchUsage(argv[0]);
+            return 1;
+        }
+
+        if (!strcmp(argv[i], "--size"))
+            cbBuf = strtoull(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--pattern-len"))
+            cbPattern = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--wildcards"))
+            cWildcards = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--alphabet"))
+            cAlphabet = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--plant"))
+            cPlant = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "--seed"))
+            uSeed = strtoul(argv[++i], NULL, 0);
+        else
+        {
+            memSearchBenchUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (   !cbPattern
+        || cbPattern > MEMSEARCH_PATTERN_MAX
+        || cWildcards > cbPattern
+        || !cAlphabet
+        || cAlphabet > 256
+        || cbBuf < cbPattern)
+    {
+        memSearchBenchUsage(argv[0]);
+        return 1;
+    }
+
+    srandom(uSeed);
+
+    /* Overlapping matches can start at every offset, both searches stop at the same limit. */
+    size_t cMatchesMax = MIN(cbBuf, MEMSEARCH_BENCH_MATCHES_MAX);
+    uint8_t *pbBuf = (uint8_t *)malloc(cbBuf);
+    size_t *paoffRef = (size_t *)malloc(cMatchesMax * sizeof(size_t));
+    size_t *paoffFound = (size_t *)malloc(cMatchesMax * sizeof(size_t));
+    if (!pbBuf || !paoffRef || !paoffFound)
+    {
+        fprintf(stderr, "memsearch-bench: Out of memory\n");
+        return 1;
+    }
+
+    uint8_t abPattern[MEMSEARCH_PATTERN_MAX];
+    uint8_t abMask[MEMSEARCH_PATTERN_MAX];
+    for (uint32_t i = 0; i < cbPattern; i++)
+    {
+        abPattern[i] = (uint8_t)memSearchBenchRand(cAlphabet);
+        abMask[i]    = 0xff;
+    }
+    for (uint32_t cSet = 0; cSet < cWildcards;)
+    {
+        uint32_t idx = memSearchBenchRand(cbPattern);
+        if (abMask[idx])
+        {
+            abMask[idx] = 0;
+            cSet++;
+        }
+    }
+
+    for (size_t off = 0; off < cbBuf; off++)
+        pbBuf[off] = (uint8_t)memSearchBenchRand(cAlphabet);
+    for (uint32_t i = 0; i < cPlant; i++)
+        memcpy(&pbBuf[memSearchBenchRand(cbBuf - cbPattern + 1)], &abPattern[0], cbPattern);
+
+    uint64_t tsStart = memSearchBenchNanoTs();
+    size_t cRef = memSearchBenchNaive(pbBuf, cbBuf, &abPattern[0], &abMask[0], cbPattern, paoffRef, cMatchesMax);
+    uint64_t cNsNaive = memSearchBenchNanoTs() - tsStart;
+
+    /* Same way the stub collects the matches, continuing right after each one. */
+    MEMSEARCH Search;
+    int rc = MEMSearchInit(&Search, &abPattern[0], &abMask[0], cbPattern);
+    if (rc)
+    {
+        fprintf(stderr, "memsearch-bench: Initialising the search failed with %d\n", rc);
+        return 1;
+    }
+
+    size_t cFound = 0;
+    size_t off = 0;
+    size_t offMatch = 0;
+    tsStart = memSearchBenchNanoTs();
+    while (   cFound < cMatchesMax
+           && MEMSearchFind(&Search, &pbBuf[off], cbBuf - off, &offMatch))
+    {
+        paoffFound[cFound++] = off + offMatch;
+        off += offMatch + 1;
+    }
+    uint64_t cNsSkip = memSearchBenchNanoTs() - tsStart;
+
+    bool fMismatch = cFound != cRef;
+    for (size_t i = 0; i < cFound && !fMismatch; i++)
+    {
+        if (paoffFound[i] != paoffRef[i])
+        {
+            fprintf(stderr, "memsearch-bench: Match %zu at %#zx, expected %#zx\n", i, paoffFound[i], paoffRef[i]);
+            fMismatch = true;
+        }
+    }
+
+    printf("Buffer:             %zu bytes, alphabet of %u\n", cbBuf, cAlphabet);
+    printf("Pattern:            %u bytes, %u wildcards, planted %u times\n", cbPattern, cWildcards, cPlant);
+    printf("Matches:            %zu (reference %zu)%s\n", cFound, cRef, fMismatch ? " MISMATCH" : "");
+    printf("Naive:              %llu us, %llu MiB/s\n", (unsigned long long)(cNsNaive / 1000),
+           (unsigned long long)(cNsNaive ? (uint64_t)cbBuf * 1000000000ULL / cNsNaive / (1024 * 1024) : 0));
+    printf("Skip table:         %llu us, %llu MiB/s\n", (unsigned long long)(cNsSkip / 1000),
+           (unsigned long long)(cNsSkip ? (uint64_t)cbBuf * 1000000000ULL / cNsSkip / (1024 * 1024) : 0));
+
+    free(pbBuf);
+    free(paoffRef);
+    free(paoffFound);
+    return fMismatch ? 1 : 0;
+}
@@ -0,0 +1,330 @@
+#!/usr/bin/env python3
+"""
+Host side of the x86 DRAM mailbox PDU transport channel (PspSerialStub/pdu-transp-x86-dram.c).
+
+The mailbox is accessed through a mmap()ed file which is either /dev/mem (with the region reserved
+through memmap= on the kernel command line) or a plain file to exercise the protocol without hardware.
+"""
+import mmap;
+import os;
+import socket;
+import struct;
+import sys;
+import threading;
+import time;
+
+g_uMagicHost = 0x19120623; # Alan Turing
+g_uMagicPsp  = 0x19061209; # Grace Hopper
+g_cbHdr      = 64;
+
+# Header field offsets, see PSPX86DRAMMBXHDR.
+g_offMagicHost = 0x00;
+g_offMagicPsp  = 0x04;
+g_offCbRing    = 0x08;
+g_offH2PWrite  = 0x10;
+g_offH2PRead   = 0x14;
+g_offP2HWrite  = 0x18;
+g_offP2HRead   = 0x1c;
+
+class DramMbx(object):
+    """
+    One end of the mailbox, fPsp selects whether this acts as the PSP (for testing) or the host.
+    """
+
+    def __init__(self, oMap, offMbx, fPsp = False):
+        self.oMap   = oMap;
+        self.offMbx = offMbx;
+        self.fPsp   = fPsp;
+        self.cbRing = 0;
+
+    def rdU32(self, off):
+        return struct.unpack_from('<I', self.oMap, self.offMbx + off)[0];
+
+    def wrU32(self, off, uVal):
+        struct.pack_into('<I', self.oMap, self.offMbx + off, uVal & 0xffffffff);
+
+    def setup(self, cbRing):
+        """
+        Initializes the mailbox header, the magic is written last so the PSP sees a consistent state.
+        """
+        if cbRing == 0 or (cbRing & (cbRing - 1)) != 0:
+            raise Exception('Invalid ring size', 'The ring size must be a power of two');
+        self.oMap[self.offMbx:self.offMbx + g_cbHdr] = bytes(g_cbHdr);
+        self.wrU32(g_offCbRing, cbRing);
+        self.wrU32(g_offMagicHost, g_uMagicHost);
+        self.cbRing = cbRing;
+
+    def attach(self):
+        """
+        Attaches to an already set up mailbox.
+        """
+        if self.rdU32(g_offMagicHost) != g_uMagicHost:
+            raise Exception('Invalid mailbox', 'Host magic not found');
+        self.cbRing = self.rdU32(g_offCbRing);
+        if self.fPsp:
+            self.wrU32(g_offMagicPsp, g_uMagicPsp);
+
+    def isPspAttached(self):
+        return self.rdU32(g_offMagicPsp) == g_uMagicPsp;
+
+    def getRxRing(self):
+        """
+        Returns (ring start, write offset field, read offset field) of the direction we receive on.
+        """
+        if self.fPsp:
+            return (self.offMbx + g_cbHdr, g_offH2PWrite, g_offH2PRead);
+        return (self.offMbx + g_cbHdr + self.cbRing, g_offP2HWrite, g_offP2HRead);
+
+    def getTxRing(self):
+        """
+        Returns (ring start, write offset field, read offset field) of the direction we send on.
+        """
+        if self.fPsp:
+            return (self.offMbx + g_cbHdr + self.cbRing, g_offP2HWrite, g_offP2HRead);
+        return (self.offMbx + g_cbHdr, g_offH2PWrite, g_offH2PRead);
+
+    def peek(self):
+        offRing, offWrField, offRdField = self.getRxRing();
+        return (self.rdU32(offWrField) - self.rdU32(offRdField)) & 0xffffffff;
+
+    def read(self, cbMax):
+        """
+        Reads up to cbMax bytes, returns an empty bytes object if nothing is available.
+        """
+        offRing, offWrField, offRdField = self.getRxRing();
+        offRead = self.rdU32(offRdField);
+        cbAvail = (self.rdU32(offWrField) - offRead) & 0xffffffff;
+        cbThis  = min(cbAvail, cbMax);
+        if cbThis == 0:
+            return b'';
+
+        offStart = offRead & (self.cbRing - 1);
+        cbFirst  = min(cbThis, self.cbRing - offStart);
+        abData   = self.oMap[offRing + offStart:offRing + offStart + cbFirst];
+        if cbThis > cbFirst:
+            abData += self.oMap[offRing:offRing + cbThis - cbFirst];
+        self.wrU32(offRdField, offRead + cbThis);
+        return abData;
+
+    def write(self, abData):
+        """
+        Writes as much of the given data as fits, returns the number of bytes written.
+        """
+        offRing, offWrField, offRdField = self.getTxRing();
+        offWrite = self.rdU32(offWrField);
+        cbFree   = self.cbRing - ((offWrite - self.rdU32(offRdField)) & 0xffffffff);
+        cbThis   = min(cbFree, len(abData));
+        if cbThis == 0:
+            return 0;
+
+        offStart = offWrite & (self.cbRing - 1);
+        cbFirst  = min(cbThis, self.cbRing - offStart);
+        self.oMap[offRing + offStart:offRing + offStart + cbFirst] = abData[:cbFirst];
+        if cbThis > cbFirst:
+            self.oMap[offRing:offRing + cbThis - cbFirst] = abData[cbFirst:cbThis];
+        self.wrU32(offWrField, offWrite + cbThis);
+        return cbThis;
+
+    def writeAll(self, abData):
+        offData = 0;
+        while offData < len(abData):
+            offData += self.write(abData[offData:]);
+
+class DramMbxTool(object):
+    """
+    The main class implementing the command line tool.
+    """
+
+    def __init__(self):
+        self.sToolName  = None;
+        self.sFile      = None;
+        self.PhysAddr   = 0x10000000;
+        self.cbRing     = 256 * 1024;
+        self.fSetup     = True;
+        self.uPort      = None;
+        self.cbSelfTest = None;
+
+    def showUsage(self):
+        """
+        Prints the usage of the tool to stdout.
+        """
+        print('%s Options:' % (self.sToolName,));
+        print('  --file            <path>');
+        print('      The file to map, /dev/mem for the real thing or a plain file for testing');
+        print('  --phys-addr       <address>');
+        print('      Physical address of the mailbox (offset into the file), default 0x10000000');
+        print('  --ring-size       <bytes>');
+        print('      Size of each ring buffer (power of two), default 256KiB');
+        print('  --attach');
+        print('      Attach to an already set up mailbox instead of initializing it');
+        print('  --listen          <port>');
+        print('      Relays the mailbox to a single TCP client on the given port');
+        print('  --self-test       <bytes>');
+        print('      Runs an emulated PSP end echoing data and measures the throughput (requires a plain file)');
+
+    def parseOption(self, asArgs, iArg):
+        """
+        Parses a single option at the given index.
+        """
+        if asArgs[iArg] == '--file':
+            iArg += 1;
+            if iArg >= len(asArgs): raise Exception('Invalid option', '--file takes a file path');
+            self.sFile = asArgs[iArg];
+        elif asArgs[iArg] == '--phys-addr':
+            iArg += 1;
+            if iArg >= len(asArgs): raise Exception('Invalid option', '--phys-addr takes an address');
+            self.PhysAddr = int(asArgs[iArg], 0);
+        elif asArgs[iArg] == '--ring-size':
+            iArg += 1;
+            if iArg >= len(asArgs): raise Exception('Invalid option', '--ring-size takes a size');
+            self.cbRing = int(asArgs[iArg], 0);
+        elif asArgs[iArg] == '--attach':
+            self.fSetup = False;
+        elif asArgs[iArg] == '--listen':
+            iArg += 1;
+            if iArg >= len(asArgs): raise Exception('Invalid option', '--listen takes a port');
+            self.uPort = int(asArgs[iArg], 0);
+        elif asArgs[iArg] == '--self-test':
+            iArg += 1;
+            if iArg >= len(asArgs): raise Exception('Invalid option', '--self-test takes a size');
+            self.cbSelfTest = int(asArgs[iArg], 0);
+        else:
+            self.showUsage();
+            raise Exception('Invalid option', 'Option "%s" is unknown' % (asArgs[iArg],));
+
+        return iArg + 1;
+
+    def mapMbx(self):
+        """
+        Maps the mailbox region, plain files are grown to the required size.
+        """
+        cbMbx     = g_cbHdr + 2 * self.cbRing;
+        offMapPg  = self.PhysAddr & ~(mmap.ALLOCATIONGRANULARITY - 1);
+        offInMap  = self.PhysAddr - offMapPg;
+        iFd = os.open(self.sFile, os.O_RDWR | os.O_CREAT | os.O_SYNC);
+        if self.sFile != '/dev/mem' and os.fstat(iFd).st_size < self.PhysAddr + cbMbx:
+            os.ftruncate(iFd, self.PhysAddr + cbMbx);
+        oMap = mmap.mmap(iFd, offInMap + cbMbx, mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE, offset = offMapPg);
+        os.close(iFd);
+        return (oMap, offInMap);
+
+    def runRelay(self, oMbx):
+        """
+        Relays between a TCP client and the mailbox until the client disconnects.
+        """
+        oSockSrv = socket.socket(socket.AF_INET, socket.SOCK_STREAM);
+        oSockSrv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1);
+        oSockSrv.bind(('', self.uPort));
+        oSockSrv.listen(1);
+        print('Waiting for a client on port %s' % (self.uPort,));
+        oSock, oAddr = oSockSrv.accept();
+        oSock.setblocking(False);
+        print('Client %s connected' % (oAddr,));
+
+        abPending = b'';
+        while True:
+            fIdle = True;
+            abRx = oMbx.read(64 * 1024);
+            if abRx:
+                oSock.sendall(abRx);
+                fIdle = False;
+            if not abPending:
+                try:
+                    abPending = oSock.recv(64 * 1024);
+                    if not abPending:
+                        break;
+                except BlockingIOError:
+                    pass;
+            if abPending:
+                cbWritten = oMbx.write(abPending);
+                abPending = abPending[cbWritten:];
+                fIdle = fIdle and cbWritten == 0;
+            if fIdle:
+                time.sleep(0.0001);
+
+        oSock.close();
+        oSockSrv.close();
+
+    def runSelfTest(self, oMap, offMbx):
+        """
+        Runs an emulated PSP end echoing everything back and verifies the data.
+        """
+        oHost = DramMbx(oMap, offMbx);
+        oHost.setup(self.cbRing);
+        oPsp = DramMbx(oMap, offMbx, fPsp = True);
+        oPsp.attach();
+
+        def pspEcho():
+            cbLeft = self.cbSelfTest;
+            while cbLeft:
+                abData = oPsp.read(cbLeft);
+                oPsp.writeAll(abData);
+                cbLeft -= len(abData);
+
+        oThrd = threading.Thread(target = pspEcho);
+        oThrd.start();
+
+        abPattern = bytes(i & 0xff for i in range(64 * 1024));
+        abRecv    = bytearray();
+        cbSent    = 0;
+        tsStart   = time.time();
+        while len(abRecv) < self.cbSelfTest:
+            if cbSent < self.cbSelfTest:
+                offPattern = cbSent % len(abPattern);
+                cbThis = min(self.cbSelfTest - cbSent, len(abPattern) - offPattern);
+                cbSent += oHost.write(abPattern[offPattern:offPattern + cbThis]);
+            abRecv += oHost.read(self.cbSelfTest - len(abRecv));
+        tsElapsed = time.time() - tsStart;
+        oThrd.join();
+
+        for off in range(0, len(abRecv), len(abPattern)):
+            cbCmp = min(len(abPattern), len(abRecv) - off);
+            if abRecv[off:off + cbCmp] != abPattern[:cbCmp]:
+                print('Data mismatch at offset %#x' % (off,));
+                return 1;
+
+        print('Echoed %s bytes in %.3fs (%.1f KiB/s)' % (len(abRecv), tsElapsed, len(abRecv) / 1024.0 / max(tsElapsed, 1e-6)));
+        return 0;
+
+    def main(self, asArgs = None):
+        """
+        Main entry point doing the argument parsing and doing the work.
+        """
+
+        self.sToolName = asArgs[0];
+        iArg = 1;
+        try:
+            while iArg < len(asArgs):
+                iNext = self.parseOption(asArgs, iArg);
+                if iNext == iArg:
+                    self.showUsage();
+                    raise Exception('Invalid option', 'Option "%s" is unknown' % (asArgs[iArg],));
+                iArg = iNext;
+        except Exception as oXcpt:
+            print(oXcpt);
+            sys.exit(1);
+
+        # Check that all required options present.
+        if    self.sFile is None\
+           or (self.uPort is None and self.cbSelfTest is None):
+            print('A required option is missing');
+            self.showUsage();
+            sys.exit(1);
+
+        oMap, offMbx = self.mapMbx();
+        if self.cbSelfTest is not None:
+            sys.exit(self.runSelfTest(oMap, offMbx));
+
+        oMbx = DramMbx(oMap, offMbx);
+        if self.fSetup:
+            oMbx.setup(self.cbRing);
+        else:
+            oMbx.attach();
+
+        self.runRelay(oMbx);
+        oMap.close();
+        sys.exit(0);
+
+
+if __name__ == '__main__':
+    sys.exit(DramMbxTool().main(sys.argv));